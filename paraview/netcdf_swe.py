@@ -4,6 +4,45 @@ try: paraview.simple
 except: from paraview.simple import *
 paraview.simple._DisableFirstRenderCameraReset()
 
+import os
+import subprocess
+
+def findExpandTool():
+	"""Returns the path of SWE_netcdf_expand (see SConscript) or None"""
+	directories = []
+	try:
+		# build directory next to this script
+		directories.append(os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'build'))
+	except NameError:
+		# __file__ is not defined if the script is run from the ParaView python shell
+		pass
+	directories += os.environ.get('PATH', '').split(os.pathsep)
+	for directory in directories:
+		tool = os.path.join(directory, 'SWE_netcdf_expand')
+		if os.path.isfile(tool) and os.access(tool, os.X_OK):
+			return tool
+	return None
+
+# Tool to reconstruct incremental output
+expandTool = findExpandTool()
+
+def fullTimeSteps(file):
+	"""Returns the name of a file with all time steps of the SWE output file"""
+	expandedFile = os.path.splitext(file)[0] + '_expanded.nc'
+	# reuse an expanded file that is newer than the output
+	if os.path.exists(expandedFile) and os.path.getmtime(expandedFile) >= os.path.getmtime(file):
+		return expandedFile
+	if expandTool is None:
+		print('WARNING: SWE_netcdf_expand not found (build it or add it to PATH), '
+			+ 'incremental output in ' + file + ' cannot be expanded')
+		return file
+	if subprocess.call([expandTool, file]) != 0:
+		raise RuntimeError('SWE_netcdf_expand failed on ' + file)
+	# the tool does not write a file if the output contains only full time steps
+	if os.path.exists(expandedFile) and os.path.getmtime(expandedFile) >= os.path.getmtime(file):
+		return expandedFile
+	return file
+
 # Select the files with PyQt4
 from PyQt4 import QtGui, QtCore
 def nullMessageOutput(type, msg):
@@ -16,7 +55,7 @@ sources = []
 
 for file in files:
 	# Create NetCDF reader
-	reader = NetCDFReader( FileName=[str(file)] )
+	reader = NetCDFReader( FileName=[fullTimeSteps(str(file))] )
 	reader.Dimensions = '(y, x)'
 
 	sources.append(reader)
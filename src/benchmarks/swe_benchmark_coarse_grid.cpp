@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "writer/CoarseGridWrapper.hh"
+
+/// @return The wall clock time in seconds
+static double wallTime()
+{
+    timeval t;
+    gettimeofday(&t, 0L);
+    return t.tv_sec + t.tv_usec * 1e-6;
+}
+
+/// Compute the coarse grid with one getElem call per coarse cell
+/**
+ * This is how the writers used the CoarseGridWrapper before getAllElems.
+ */
+static void runPerCell(io::CoarseGridWrapper &wrapper, std::vector<float> &values)
+{
+    const unsigned int cols = wrapper.getCols();
+    const unsigned int rows = wrapper.getRows();
+
+    for(unsigned int col = 0; col < cols; col++) {
+        for(unsigned int row = 0; row < rows; row++)
+            values[row*cols + col] = wrapper.getElem(col, row);
+    }
+}
+
+/// Measure both variants for one coarseness factor and print the results
+static void runCoarseness(const Float2D &grid, int nx, int ny, float coarseness, int repetitions)
+{
+    io::BoundarySize boundarySize = {{1, 1, 1, 1}};
+    io::CoarseGridWrapper wrapper(grid, boundarySize, nx, ny, coarseness);
+
+    std::vector<float> perCellValues(wrapper.getCols() * wrapper.getRows());
+    std::vector<float> bulkValues(perCellValues.size());
+
+    double start = wallTime();
+    for(int r = 0; r < repetitions; r++)
+        runPerCell(wrapper, perCellValues);
+    double perCellTime = (wallTime() - start) / repetitions;
+
+    start = wallTime();
+    for(int r = 0; r < repetitions; r++)
+        wrapper.getAllElems(&bulkValues[0]);
+    double bulkTime = (wallTime() - start) / repetitions;
+
+    float maxDifference = 0.f;
+    for(size_t i = 0; i < bulkValues.size(); i++)
+        maxDifference = std::max(maxDifference, std::abs(bulkValues[i] - perCellValues[i]));
+
+    // refined cells read per second
+    double cells = double(nx) * ny;
+
+    std::cout << std::setw(12) << coarseness
+              << std::setw(8) << wrapper.getCols() << " x " << std::setw(6) << wrapper.getRows()
+              << std::setw(12) << std::setprecision(2) << perCellTime * 1e3
+              << std::setw(12) << bulkTime * 1e3
+              << std::setw(15) << cells / perCellTime * 1e-6
+              << std::setw(15) << cells / bulkTime * 1e-6
+              << std::setw(10) << std::setprecision(1) << perCellTime / bulkTime
+              << std::setw(12) << std::scientific << std::setprecision(1) << maxDifference
+              << std::fixed << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    //! Number of cells in x-direction
+    int l_nX = 4000;
+    //! Number of cells in y-direction
+    int l_nY = 4000;
+    //! Number of repetitions
+    int l_repetitions = 5;
+    //! Coarseness factors
+    std::vector<float> l_coarseness;
+
+    int c;
+    while ((c = getopt(argc, argv, "x:y:n:c:h")) != -1) {
+        switch(c) {
+            case 'x':
+                l_nX = atoi(optarg);
+                break;
+            case 'y':
+                l_nY = atoi(optarg);
+                break;
+            case 'n':
+                l_repetitions = atoi(optarg);
+                break;
+            case 'c':
+                l_coarseness.push_back(atof(optarg));
+                break;
+            default:
+                std::cout << "Usage: " << argv[0] << " [OPTIONS]" << std::endl;
+                std::cout << "    -x <num>        The number of cells in x-direction (default 4000)" << std::endl;
+                std::cout << "    -y <num>        The number of cells in y-direction (default 4000)" << std::endl;
+                std::cout << "    -n <num>        The number of repetitions (default 5)" << std::endl;
+                std::cout << "    -c <num>        A coarseness factor, may be given several times (default 1, 2, 4, 1.5 and 3.7)" << std::endl;
+                return (c == 'h') ? 0 : 1;
+        }
+    }
+
+    if (l_coarseness.empty()) {
+        const float l_defaultCoarseness[] = {1.f, 2.f, 4.f, 1.5f, 3.7f};
+        l_coarseness.assign(l_defaultCoarseness, l_defaultCoarseness + 5);
+    }
+
+    Float2D l_grid(l_nX+2, l_nY+2);
+    for(int i = 0; i < l_nX+2; i++) {
+        for(int j = 0; j < l_nY+2; j++)
+            l_grid[i][j] = 10.f + std::sin(.01f * i) * std::cos(.02f * j);
+    }
+
+    std::cout << "Grid: " << l_nX << " x " << l_nY << ", "
+              << l_repetitions << " repetitions" << std::endl;
+    std::cout << std::endl;
+
+    std::cout << std::fixed;
+    std::cout << std::setw(12) << "coarseness" << std::setw(17) << "coarse grid"
+              << std::setw(12) << "per cell ms" << std::setw(12) << "bulk ms"
+              << std::setw(15) << "per cell MC/s" << std::setw(15) << "bulk MC/s"
+              << std::setw(10) << "speedup" << std::setw(12) << "max diff" << std::endl;
+
+    for(size_t i = 0; i < l_coarseness.size(); i++) {
+        if (l_coarseness[i] < 1.f) {
+            std::cerr << "Coarseness factor must be at least 1" << std::endl;
+            return 1;
+        }
+
+        std::cout << std::setprecision(1);
+        runCoarseness(l_grid, l_nX, l_nY, l_coarseness[i], l_repetitions);
+    }
+
+    return 0;
+}
@@ -0,0 +1,173 @@
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "writer/NetCdfWriter.hh"
+
+/// @return The wall clock time in seconds
+static double wallTime()
+{
+    timeval t;
+    gettimeofday(&t, 0L);
+    return t.tv_sec + t.tv_usec * 1e-6;
+}
+
+/// Fill the unknowns with some values
+static void initUnknowns(Float2D &h, Float2D &hu, Float2D &hv, Float2D &b)
+{
+    for(int i = 0; i < h.getCols(); i++) {
+        for(int j = 0; j < h.getRows(); j++) {
+            h[i][j] = 10.f + (i % 7) * .1f;
+            hu[i][j] = (j % 5) * .2f;
+            hv[i][j] = -hu[i][j];
+            b[i][j] = -10.f;
+        }
+    }
+}
+
+/// Write the checkpoints with one nc_put_vara_float call per column
+/**
+ * This is the output scheme used by NetCdfWriter before the whole
+ * variable was written at once (default chunking, one call per column).
+ *
+ * @return Wall clock time in seconds (including closing the file)
+ */
+static double runPerColumn(const std::string &fileName, int nx, int ny, int checkpoints)
+{
+    Float2D h(nx+2, ny+2), hu(nx+2, ny+2), hv(nx+2, ny+2), b(nx+2, ny+2);
+    initUnknowns(h, hu, hv, b);
+
+    double start = wallTime();
+
+    int dataFile;
+    nc_create(fileName.c_str(), NC_NETCDF4, &dataFile);
+
+    int timeDim, xDim, yDim;
+    nc_def_dim(dataFile, "time", NC_UNLIMITED, &timeDim);
+    nc_def_dim(dataFile, "x", nx, &xDim);
+    nc_def_dim(dataFile, "y", ny, &yDim);
+
+    int timeVar, vars[4];
+    nc_def_var(dataFile, "time", NC_FLOAT, 1, &timeDim, &timeVar);
+    int dims[] = {timeDim, yDim, xDim};
+    nc_def_var(dataFile, "h",  NC_FLOAT, 3, dims, &vars[0]);
+    nc_def_var(dataFile, "hu", NC_FLOAT, 3, dims, &vars[1]);
+    nc_def_var(dataFile, "hv", NC_FLOAT, 3, dims, &vars[2]);
+    nc_def_var(dataFile, "b",  NC_FLOAT, 2, &dims[1], &vars[3]);
+
+    // bathymetry
+    size_t start2d[] = {0, 0};
+    size_t count2d[] = {(size_t) ny, 1};
+    for(int col = 0; col < nx; col++) {
+        start2d[1] = col;
+        nc_put_vara_float(dataFile, vars[3], start2d, count2d, &b[col+1][1]);
+    }
+
+    const Float2D* unknowns[] = {&h, &hu, &hv};
+    for(size_t timeStep = 0; timeStep < (size_t) checkpoints; timeStep++) {
+        float time = timeStep;
+        nc_put_var1_float(dataFile, timeVar, &timeStep, &time);
+
+        for(int var = 0; var < 3; var++) {
+            size_t start3d[] = {timeStep, 0, 0};
+            size_t count3d[] = {1, (size_t) ny, 1};
+            for(int col = 0; col < nx; col++) {
+                start3d[2] = col;
+                nc_put_vara_float(dataFile, vars[var], start3d, count3d, &(*unknowns[var])[col+1][1]);
+            }
+        }
+
+        nc_sync(dataFile);
+    }
+
+    nc_close(dataFile);
+
+    return wallTime() - start;
+}
+
+/// Write the checkpoints with the NetCdfWriter
+/**
+ * @return Wall clock time in seconds (including closing the file)
+ */
+static double runWriter(const std::string &baseName, int nx, int ny, int checkpoints)
+{
+    Float2D h(nx+2, ny+2), hu(nx+2, ny+2), hv(nx+2, ny+2), b(nx+2, ny+2);
+    initUnknowns(h, hu, hv, b);
+    io::BoundarySize boundarySize = {{1, 1, 1, 1}};
+
+    double start = wallTime();
+    {
+        io::NetCdfWriter writer(baseName, b, boundarySize, nx, ny, 1.f, 1.f);
+        for(int timeStep = 0; timeStep < checkpoints; timeStep++)
+            writer.writeTimeStep(h, hu, hv, timeStep);
+    }
+
+    return wallTime() - start;
+}
+
+int main(int argc, char** argv)
+{
+    //! Number of cells in x-direction
+    int l_nX = 4000;
+    //! Number of cells in y-direction
+    int l_nY = 1000;
+    //! Number of checkpoints
+    int l_checkpoints = 10;
+    //! Base name of the output files
+    std::string l_baseName = "swe_benchmark_netcdf";
+
+    int c;
+    while ((c = getopt(argc, argv, "x:y:n:o:h")) != -1) {
+        switch(c) {
+            case 'x':
+                l_nX = atoi(optarg);
+                break;
+            case 'y':
+                l_nY = atoi(optarg);
+                break;
+            case 'n':
+                l_checkpoints = atoi(optarg);
+                break;
+            case 'o':
+                l_baseName = optarg;
+                break;
+            default:
+                std::cout << "Usage: " << argv[0] << " [OPTIONS]" << std::endl;
+                std::cout << "    -x <num>        The number of cells in x-direction (default 4000)" << std::endl;
+                std::cout << "    -y <num>        The number of cells in y-direction (default 1000)" << std::endl;
+                std::cout << "    -n <num>        The number of checkpoints (default 10)" << std::endl;
+                std::cout << "    -o <filename>   Base name of the output files, removed afterwards (default swe_benchmark_netcdf)" << std::endl;
+                return (c == 'h') ? 0 : 1;
+        }
+    }
+
+    // h, hu and hv of all checkpoints
+    double megabytes = 3. * l_checkpoints * l_nX * l_nY * sizeof(float) / (1024. * 1024.);
+
+    std::cout << "Grid: " << l_nX << " x " << l_nY << ", "
+              << l_checkpoints << " checkpoints, "
+              << std::fixed << std::setprecision(1) << megabytes << " MB" << std::endl;
+    std::cout << std::endl;
+
+    std::string perColumnFile = l_baseName + "_columns.nc";
+    double perColumnTime = runPerColumn(perColumnFile, l_nX, l_nY, l_checkpoints);
+    remove(perColumnFile.c_str());
+
+    double writerTime = runWriter(l_baseName, l_nX, l_nY, l_checkpoints);
+    remove((l_baseName + ".nc").c_str());
+
+    std::cout << std::setw(24) << "" << std::setw(12) << "s" << std::setw(12) << "MB/s" << std::endl;
+    std::cout << std::setw(24) << "per column"
+              << std::setw(12) << std::setprecision(3) << perColumnTime
+              << std::setw(12) << std::setprecision(1) << megabytes / perColumnTime << std::endl;
+    std::cout << std::setw(24) << "NetCdfWriter (slabs)"
+              << std::setw(12) << std::setprecision(3) << writerTime
+              << std::setw(12) << std::setprecision(1) << megabytes / writerTime << std::endl;
+
+    return 0;
+}
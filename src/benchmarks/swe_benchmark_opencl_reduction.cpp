@@ -0,0 +1,122 @@
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "blocks/opencl/SWE_DimensionalSplittingOpenCL.hh"
+#include "scenarios/SWE_simple_scenarios.hh"
+
+/// @return The wall clock time in seconds
+static double wallTime()
+{
+    timeval t;
+    gettimeofday(&t, 0L);
+    return t.tv_sec + t.tv_usec * 1e-6;
+}
+
+/// Compute the net updates of the radial dam break
+/**
+ * Every step waits for the maximum wave speed on the host, hence the
+ * time per step includes the complete reduction.
+ *
+ * @param n Number of cells in x- and y-direction
+ * @param steps Number of measured timesteps
+ * @param deviceType The preferred OpenCL device type
+ * @param kernelType The kernel memory type
+ * @param fusedReduction Reduce the maximum in the sweep kernels
+ * @param maxTimestep The maximum timestep of the last step
+ * @return Average wall clock time per timestep in seconds
+ */
+static double runBlock(int n, int steps, cl_device_type deviceType, KernelType kernelType,
+    bool fusedReduction, float &maxTimestep)
+{
+    SWE_RadialDamBreakScenario scenario;
+    float dx = (scenario.getBoundaryPos(BND_RIGHT) - scenario.getBoundaryPos(BND_LEFT)) / n;
+
+    SWE_DimensionalSplittingOpenCL block(n, n, dx, dx, deviceType, 1, kernelType, 1024, false, fusedReduction);
+    block.initScenario(0.f, 0.f, scenario);
+
+    // Warm up (first kernel launches)
+    block.setGhostLayer();
+    block.computeNumericalFluxes();
+
+    double start = wallTime();
+    for(int step = 0; step < steps; step++) {
+        block.setGhostLayer();
+        block.computeNumericalFluxes();
+    }
+    double elapsed = wallTime() - start;
+
+    maxTimestep = block.getMaxTimestep();
+    return elapsed / steps;
+}
+
+int main(int argc, char** argv)
+{
+    //! Number of measured timesteps per grid size
+    int l_steps = 100;
+    //! Largest grid size
+    int l_maxSize = 2048;
+    //! Preferred OpenCL device type
+    cl_device_type l_deviceType = 0;
+    //! Kernel memory type
+    KernelType l_kernelType = MEM_GLOBAL;
+
+    int c;
+    while ((c = getopt(argc, argv, "n:x:clh")) != -1) {
+        switch(c) {
+            case 'n':
+                l_steps = atoi(optarg);
+                break;
+            case 'x':
+                l_maxSize = atoi(optarg);
+                break;
+            case 'c':
+                l_deviceType = CL_DEVICE_TYPE_CPU;
+                break;
+            case 'l':
+                l_kernelType = MEM_LOCAL;
+                break;
+            default:
+                std::cout << "Usage: " << argv[0] << " [OPTIONS]" << std::endl;
+                std::cout << "    -n <num>        The number of measured timesteps per grid size (default 100)" << std::endl;
+                std::cout << "    -x <num>        The largest number of cells in x- and y-direction (default 2048)" << std::endl;
+                std::cout << "    -c              Use an OpenCL CPU device (e.g. pocl)" << std::endl;
+                std::cout << "    -l              Use the local memory kernels" << std::endl;
+                return (c == 'h') ? 0 : 1;
+        }
+    }
+
+    {
+        SWE_DimensionalSplittingOpenCL block(8, 8, 1.f, 1.f, l_deviceType, 1, l_kernelType);
+        block.printDeviceInformation();
+    }
+    std::cout << l_steps << " timesteps per grid size" << std::endl;
+    std::cout << std::endl;
+
+    std::cout << std::setw(8) << "grid"
+              << std::setw(14) << "us/step"
+              << std::setw(14) << "us/step"
+              << std::setw(10) << "speedup"
+              << std::setw(14) << "dt diff" << std::endl;
+    std::cout << std::setw(8) << ""
+              << std::setw(14) << "(multi-pass)"
+              << std::setw(14) << "(fused)" << std::endl;
+
+    for(int n = 64; n <= l_maxSize; n *= 2) {
+        float multiPassTimestep, fusedTimestep;
+        double multiPassStep = runBlock(n, l_steps, l_deviceType, l_kernelType, false, multiPassTimestep);
+        double fusedStep = runBlock(n, l_steps, l_deviceType, l_kernelType, true, fusedTimestep);
+        std::cout << std::setw(8) << n
+                  << std::fixed << std::setprecision(2)
+                  << std::setw(14) << multiPassStep * 1e6
+                  << std::setw(14) << fusedStep * 1e6
+                  << std::setw(10) << multiPassStep / fusedStep
+                  << std::scientific << std::setprecision(1)
+                  << std::setw(14) << std::fabs(multiPassTimestep - fusedTimestep) << std::endl;
+    }
+
+    return 0;
+}
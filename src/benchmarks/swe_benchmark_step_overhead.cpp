@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <unistd.h>
+#include <sys/time.h>
+
+#ifdef USEOPENMP
+#include <omp.h>
+#endif
+
+#include "blocks/SWE_DimensionalSplitting.hh"
+#include "scenarios/SWE_simple_scenarios.hh"
+
+/// @return The wall clock time in seconds
+static double wallTime()
+{
+    timeval t;
+    gettimeofday(&t, 0L);
+    return t.tv_sec + t.tv_usec * 1e-6;
+}
+
+/// Measure the synchronization of an empty timestep
+/**
+ * Runs the same sequence of parallel constructs as
+ * SWE_DimensionalSplitting::computeNumericalFluxes and updateUnknowns
+ * without any work. This is the lower bound for the time of a step.
+ *
+ * @param steps Number of timesteps
+ * @return Average wall clock time per timestep in seconds
+ */
+static double runEmptyStep(int steps)
+{
+    float maxValue = 0.f;
+    float values[64] = { 0.f };
+
+    double start = wallTime();
+    for(int step = 0; step < steps; step++) {
+#ifdef USEOPENMP
+#pragma omp parallel
+#endif
+        {
+#ifdef USEOPENMP
+#pragma omp for reduction(max:maxValue)
+#endif
+            for(int i = 0; i < 64; i++)
+                maxValue = std::max(maxValue, (float) i);
+#ifdef USEOPENMP
+#pragma omp single
+#endif
+            maxValue += 1.f;
+#ifdef USEOPENMP
+#pragma omp for reduction(max:maxValue)
+#endif
+            for(int i = 0; i < 64; i++)
+                maxValue = std::max(maxValue, (float) i);
+        }
+#ifdef USEOPENMP
+#pragma omp parallel for
+#endif
+        for(int i = 0; i < 64; i++)
+            values[i] += maxValue;
+    }
+    double elapsed = wallTime() - start;
+
+    // keep the compiler from removing the loops
+    if(values[0] < 0.f)
+        std::cout << values[0] << std::endl;
+
+    return elapsed / steps;
+}
+
+/// Run the radial dam break on a small block
+/**
+ * @param n Number of cells in x- and y-direction
+ * @param steps Number of measured timesteps
+ * @param batchSolver Use the vectorized batch F-Wave solver
+ * @return Average wall clock time per timestep in seconds
+ */
+static double runBlock(int n, int steps, bool batchSolver)
+{
+    SWE_RadialDamBreakScenario scenario;
+    float dx = (scenario.getBoundaryPos(BND_RIGHT) - scenario.getBoundaryPos(BND_LEFT)) / n;
+
+    SWE_DimensionalSplitting block(n, n, dx, dx);
+    block.setBatchSolver(batchSolver);
+    block.initScenario(0.f, 0.f, scenario);
+
+    // Warm up (thread pool, page faults)
+    block.setGhostLayer();
+    block.computeNumericalFluxes();
+    block.updateUnknowns(block.getMaxTimestep());
+
+    // The timestep is fixed to the first one, the waves stay inside the domain
+    float dt = .5f * block.getMaxTimestep();
+
+    double start = wallTime();
+    for(int step = 0; step < steps; step++) {
+        block.setGhostLayer();
+        block.computeNumericalFluxes();
+        block.updateUnknowns(dt);
+    }
+
+    return (wallTime() - start) / steps;
+}
+
+int main(int argc, char** argv)
+{
+    //! Number of measured timesteps per grid size
+    int l_steps = 10000;
+    //! Largest grid size
+    int l_maxSize = 128;
+
+    int c;
+    while ((c = getopt(argc, argv, "n:x:h")) != -1) {
+        switch(c) {
+            case 'n':
+                l_steps = atoi(optarg);
+                break;
+            case 'x':
+                l_maxSize = atoi(optarg);
+                break;
+            default:
+                std::cout << "Usage: " << argv[0] << " [OPTIONS]" << std::endl;
+                std::cout << "    -n <num>        The number of measured timesteps per grid size (default 10000)" << std::endl;
+                std::cout << "    -x <num>        The largest number of cells in x- and y-direction (default 128)" << std::endl;
+                return (c == 'h') ? 0 : 1;
+        }
+    }
+
+#ifdef USEOPENMP
+    std::cout << "Threads: " << omp_get_max_threads() << std::endl;
+#else
+    std::cout << "Threads: 1 (compiled without OpenMP)" << std::endl;
+#endif
+    std::cout << l_steps << " timesteps per grid size" << std::endl;
+    std::cout << std::endl;
+
+    double emptyStep = runEmptyStep(l_steps);
+    std::cout << std::fixed << std::setprecision(2)
+              << "Synchronization of an empty step: " << emptyStep * 1e6 << " us" << std::endl;
+    std::cout << std::endl;
+
+    std::cout << std::setw(8) << "grid"
+              << std::setw(14) << "us/step"
+              << std::setw(14) << "steps/s"
+              << std::setw(14) << "us/step"
+              << std::setw(14) << "steps/s" << std::endl;
+    std::cout << std::setw(8) << ""
+              << std::setw(28) << "(scalar solver)"
+              << std::setw(28) << "(batch solver)" << std::endl;
+
+    for(int n = 8; n <= l_maxSize; n *= 2) {
+        double scalarStep = runBlock(n, l_steps, false);
+        double batchStep = runBlock(n, l_steps, true);
+        std::cout << std::setw(8) << n
+                  << std::setw(14) << std::setprecision(2) << scalarStep * 1e6
+                  << std::setw(14) << std::setprecision(0) << 1. / scalarStep
+                  << std::setw(14) << std::setprecision(2) << batchStep * 1e6
+                  << std::setw(14) << std::setprecision(0) << 1. / batchStep << std::endl;
+    }
+
+    return 0;
+}
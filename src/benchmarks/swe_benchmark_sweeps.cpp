@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "blocks/SWE_DimensionalSplitting.hh"
+#include "scenarios/SWE_simple_scenarios.hh"
+#include "tools/help.hh"
+
+/// Configuration of a single benchmark run
+struct SweepVariant {
+    //! Name printed in the result table
+    std::string name;
+    //! Tile width of the fused sweep (0 = separate sweeps)
+    int fusedTileWidth;
+    //! Rows per strip of the X-Sweep (0 = whole columns)
+    int sweepBlockRows;
+    //! Use the vectorized batch F-Wave solver
+    bool batchSolver;
+};
+
+/// @return The wall clock time in seconds
+static double wallTime()
+{
+    timeval t;
+    gettimeofday(&t, 0L);
+    return t.tv_sec + t.tv_usec * 1e-6;
+}
+
+/// Run a variant for a number of timesteps
+/**
+ * @param variant The configuration of the block
+ * @param nx Number of cells in x-direction
+ * @param ny Number of cells in y-direction
+ * @param steps Number of timesteps to measure
+ * @param reference Water height of a previous run to compare with (may be 0)
+ * @param result Copy of the final water height (may be 0)
+ * @param maxDifference Set to the maximum difference of the water height to the reference
+ * @return Average wall clock time per timestep in seconds
+ */
+static double runVariant(const SweepVariant &variant, int nx, int ny, int steps,
+    const Float2D *reference, Float2D *result, float &maxDifference)
+{
+    SWE_RadialDamBreakScenario scenario;
+    // Square cells, the dam is placed in the center of the block
+    float dx = (scenario.getBoundaryPos(BND_RIGHT) - scenario.getBoundaryPos(BND_LEFT)) / std::max(nx, ny);
+    float centerX = .5f * (scenario.getBoundaryPos(BND_RIGHT) + scenario.getBoundaryPos(BND_LEFT));
+    float centerY = .5f * (scenario.getBoundaryPos(BND_TOP) + scenario.getBoundaryPos(BND_BOTTOM));
+
+    SWE_DimensionalSplitting block(nx, ny, dx, dx);
+    block.setFusedTileWidth(variant.fusedTileWidth);
+    block.setSweepBlockRows(variant.sweepBlockRows);
+    block.setBatchSolver(variant.batchSolver);
+    block.initScenario(centerX - .5f*nx*dx, centerY - .5f*ny*dx, scenario);
+
+    // Warm up (page faults, caches)
+    block.setGhostLayer();
+    block.computeNumericalFluxes();
+    block.updateUnknowns(block.getMaxTimestep());
+
+    double start = wallTime();
+    for(int step = 0; step < steps; step++) {
+        block.setGhostLayer();
+        block.computeNumericalFluxes();
+        block.updateUnknowns(block.getMaxTimestep());
+    }
+    double elapsed = wallTime() - start;
+
+    const Float2D &h = block.getWaterHeight();
+    maxDifference = 0.f;
+    for(int i = 1; i <= nx; i++) {
+        for(int j = 1; j <= ny; j++) {
+            if(reference != 0L)
+                maxDifference = std::max(maxDifference, std::fabs(h[i][j] - (*reference)[i][j]));
+            if(result != 0L)
+                (*result)[i][j] = h[i][j];
+        }
+    }
+
+    return elapsed / steps;
+}
+
+int main(int argc, char** argv)
+{
+    //! Number of cells in x direction
+    int l_nX = 1024;
+    //! Number of cells in y direction
+    int l_nY = 4096;
+    //! Number of measured timesteps
+    int l_steps = 20;
+    //! Rows per strip of the row-blocked X-Sweep
+    int l_sweepBlockRows = 256;
+    //! Tile width of the fused sweep
+    int l_fusedTileWidth = 32;
+
+    int c;
+    while ((c = getopt(argc, argv, "x:y:n:r:w:h")) != -1) {
+        switch(c) {
+            case 'x':
+                l_nX = atoi(optarg);
+                break;
+            case 'y':
+                l_nY = atoi(optarg);
+                break;
+            case 'n':
+                l_steps = atoi(optarg);
+                break;
+            case 'r':
+                l_sweepBlockRows = atoi(optarg);
+                break;
+            case 'w':
+                l_fusedTileWidth = atoi(optarg);
+                break;
+            default:
+                std::cout << "Usage: " << argv[0] << " [OPTIONS]" << std::endl;
+                std::cout << "    -x <num>        The number of cells in x-direction (default 1024)" << std::endl;
+                std::cout << "    -y <num>        The number of cells in y-direction (default 4096)" << std::endl;
+                std::cout << "    -n <num>        The number of measured timesteps (default 20)" << std::endl;
+                std::cout << "    -r <num>        Rows per strip of the row-blocked X-Sweep (default 256)" << std::endl;
+                std::cout << "    -w <num>        Tile width of the fused sweep (default 32)" << std::endl;
+                return (c == 'h') ? 0 : 1;
+        }
+    }
+
+    SweepVariant variants[] = {
+        { "separate",                    0,                  0,                  false },
+        { "separate, row strips",        0,                  l_sweepBlockRows,   false },
+        { "fused",                       l_fusedTileWidth,   0,                  false },
+        { "separate, batch",             0,                  0,                  true },
+        { "separate, row strips, batch", 0,                  l_sweepBlockRows,   true },
+        { "fused, batch",                l_fusedTileWidth,   0,                  true }
+    };
+    int numberOfVariants = sizeof(variants) / sizeof(variants[0]);
+
+    std::cout << "Grid: " << l_nX << " x " << l_nY << ", " << l_steps << " timesteps" << std::endl;
+    std::cout << "Batch solver instruction set: "
+              << solver::FWaveBatch::getInstructionSetName(solver::FWaveBatch::detectInstructionSet())
+              << std::endl;
+    // Minimal memory traffic per cell and timestep: read h, hu, hv, b and write h, hu, hv
+    std::cout << "Bandwidth is based on the minimal traffic of 7 floats per cell and timestep" << std::endl;
+    std::cout << std::endl;
+    std::cout << std::left << std::setw(30) << "variant"
+              << std::right << std::setw(12) << "ms/step"
+              << std::setw(12) << "MLUPS"
+              << std::setw(12) << "GB/s"
+              << std::setw(14) << "max |h-h0|" << std::endl;
+
+    Float2D reference(l_nX+2, l_nY+2, true);
+    for(int v = 0; v < numberOfVariants; v++) {
+        float maxDifference;
+        double timePerStep = runVariant(variants[v], l_nX, l_nY, l_steps,
+            (v == 0) ? 0L : &reference, (v == 0) ? &reference : 0L, maxDifference);
+
+        double cells = (double) l_nX * l_nY;
+        std::cout << std::left << std::setw(30) << variants[v].name
+                  << std::right << std::fixed
+                  << std::setw(12) << std::setprecision(3) << timePerStep * 1e3
+                  << std::setw(12) << std::setprecision(1) << cells / timePerStep * 1e-6
+                  << std::setw(12) << std::setprecision(2) << 7 * sizeof(float) * cells / timePerStep * 1e-9
+                  << std::setw(14) << std::scientific << std::setprecision(2) << maxDifference
+                  << std::endl;
+    }
+
+    return 0;
+}
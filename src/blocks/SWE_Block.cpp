@@ -33,6 +33,7 @@
 #include <iostream>
 #include <cassert>
 #include <limits>
+#include <vector>
 
 // gravitational acceleration
 const float SWE_Block::g = 9.81f;
@@ -55,13 +56,16 @@ SWE_Block::SWE_Block(int l_nx, int l_ny,
 	  dx(l_dx), dy(l_dy),
 	  h(nx+2,ny+2), hu(nx+2,ny+2), hv(nx+2,ny+2), b(nx+2,ny+2),
 	  // This three are only set here, so eclipse does not complain
-	  maxTimestep(0), offsetX(0), offsetY(0)
+	  maxTimestep(0), activeTileSize(0), offsetX(0), offsetY(0)
 {
   // set WALL as default boundary condition
   for (int i=0; i<4; i++) {
      boundary[i] = PASSIVE;
      neighbour[i] = NULL;
   };
+
+  // a single tile, which is always active
+  setActiveTileSize(0);
 }
 
 /**
@@ -93,23 +97,26 @@ void SWE_Block::initScenario( float _offsetX, float _offsetY,
 	offsetX = _offsetX;
 	offsetY = _offsetY;
 
+  // cell centers (including the ghost layer), the scenario samples the whole block at once
+  std::vector<float> l_x(nx+2), l_y(ny+2);
+  for(int i=0; i<=nx+1; i++)
+    l_x[i] = offsetX + (i-0.5f)*dx;
+  for(int j=0; j<=ny+1; j++)
+    l_y[j] = offsetY + (j-0.5f)*dy;
+
   // initialize water height and discharge
+  assert(hu.getLeadingDimension() == h.getLeadingDimension());
+  assert(hv.getLeadingDimension() == h.getLeadingDimension());
+  i_scenario.getInitialValuesBlock( &l_x[1], nx, &l_y[1], ny, h.getLeadingDimension(),
+                                    &h[1][1], &hu[1][1], &hv[1][1] );
   for(int i=1; i<=nx; i++)
     for(int j=1; j<=ny; j++) {
-      float x = offsetX + (i-0.5f)*dx;
-      float y = offsetY + (j-0.5f)*dy;
-      h[i][j] =  i_scenario.getWaterHeight(x,y);
-      hu[i][j] = i_scenario.getVeloc_u(x,y) * h[i][j];
-      hv[i][j] = i_scenario.getVeloc_v(x,y) * h[i][j]; 
+      hu[i][j] *= h[i][j];
+      hv[i][j] *= h[i][j];
     };
 
   // initialize bathymetry
-  for(int i=0; i<=nx+1; i++) {
-    for(int j=0; j<=ny+1; j++) {
-      b[i][j] = i_scenario.getBathymetry( offsetX + (i-0.5f)*dx,
-                                          offsetY + (j-0.5f)*dy );
-    }
-  }
+  i_scenario.getBathymetryBlock( &l_x[0], nx+2, &l_y[0], ny+2, b.getLeadingDimension(), &b[0][0] );
 
   // in the case of multiple blocks the calling routine takes care about proper boundary conditions.
   if( i_multipleBlocks == false ) {
@@ -460,6 +467,116 @@ void SWE_Block::computeMaxTimestep( const float i_dryTol,
   maxTimestep *= i_cflNumber;
 }
 
+//==================================================================
+// tracking of active tiles
+//==================================================================
+
+/**
+ * Enable the tracking of active tiles.
+ *
+ * Blocks supporting the tracking only compute edges next to active tiles
+ * and only update cells of active tiles. This skips dry regions and water
+ * at rest. All tiles are active in the first time step.
+ *
+ * @param i_size number of cells per direction of a tile, 0 disables the tracking
+ */
+void SWE_Block::setActiveTileSize(int i_size) {
+  assert(i_size >= 0);
+
+  activeTileSize = i_size;
+  activeTileSizeX = (i_size > 0) ? std::min(i_size, nx) : nx;
+  activeTileSizeY = (i_size > 0) ? std::min(i_size, ny) : ny;
+  activeTilesX = (nx + activeTileSizeX - 1) / activeTileSizeX;
+  activeTilesY = (ny + activeTileSizeY - 1) / activeTileSizeY;
+
+  activeTiles.assign(activeTilesX*activeTilesY, 1);
+  changedTiles.assign(activeTilesX*activeTilesY, 0);
+}
+
+/**
+ * @return number of tiles which are computed in the next time step
+ */
+int SWE_Block::getNumberOfActiveTiles() {
+  return std::count(activeTiles.begin(), activeTiles.end(), 1);
+}
+
+/**
+ * Mark all tiles as active, e.g. after an external update of the unknowns.
+ */
+void SWE_Block::activateAllTiles() {
+  std::fill(activeTiles.begin(), activeTiles.end(), 1);
+}
+
+/**
+ * Compute the active tiles for the next time step.
+ *
+ * A tile is active if one of the tiles in its 3x3 neighbourhood changed
+ * in the current time step. Tiles at INFLOW, CONNECT and PASSIVE boundaries
+ * are always active, since their ghost cells are set externally.
+ * Has to be called at the end of updateUnknowns.
+ */
+void SWE_Block::updateActiveTiles() {
+  if (activeTileSize == 0)
+    return;
+
+  // ghost cells of OUTFLOW and WALL boundaries only depend on the adjacent cells
+  bool l_externalBoundary[4];
+  for (int i = 0; i < 4; i++)
+    l_externalBoundary[i] = (boundary[i] != OUTFLOW && boundary[i] != WALL);
+
+  for (int tx = 0; tx < activeTilesX; tx++) {
+    for (int ty = 0; ty < activeTilesY; ty++) {
+      bool l_active = (tx == 0 && l_externalBoundary[BND_LEFT])
+                   || (tx == activeTilesX-1 && l_externalBoundary[BND_RIGHT])
+                   || (ty == 0 && l_externalBoundary[BND_BOTTOM])
+                   || (ty == activeTilesY-1 && l_externalBoundary[BND_TOP]);
+
+      for (int l_tx = std::max(tx-1, 0); l_tx <= std::min(tx+1, activeTilesX-1); l_tx++)
+        for (int l_ty = std::max(ty-1, 0); l_ty <= std::min(ty+1, activeTilesY-1); l_ty++)
+          l_active = l_active || changedTiles[l_tx*activeTilesY + l_ty];
+
+      activeTiles[tx*activeTilesY + ty] = l_active;
+    }
+  }
+
+  std::fill(changedTiles.begin(), changedTiles.end(), 0);
+}
+
+/**
+ * Store a copy of the unknowns h, hu, and hv (incl. the ghost layers).
+ * The copy can be used to repeat time steps with a smaller time step width
+ * (see restoreUnknowns).
+ */
+void SWE_Block::storeUnknowns() {
+  synchWaterHeightBeforeRead();
+  synchDischargeBeforeRead();
+
+  // the columns may be padded (see Float2D::setDefaultPadding)
+  int l_size = h.getLeadingDimension()*(nx+2);
+  assert(hu.getLeadingDimension() == h.getLeadingDimension());
+  assert(hv.getLeadingDimension() == h.getLeadingDimension());
+  storedUnknowns.resize(3*l_size);
+
+  std::copy(h.elemVector(), h.elemVector()+l_size, &storedUnknowns[0]);
+  std::copy(hu.elemVector(), hu.elemVector()+l_size, &storedUnknowns[l_size]);
+  std::copy(hv.elemVector(), hv.elemVector()+l_size, &storedUnknowns[2*l_size]);
+}
+
+/**
+ * Reset the unknowns h, hu, and hv to the copy of the last call of storeUnknowns.
+ */
+void SWE_Block::restoreUnknowns() {
+  int l_size = h.getLeadingDimension()*(nx+2);
+  assert(storedUnknowns.size() == 3*(unsigned int) l_size);
+
+  std::copy(&storedUnknowns[0], &storedUnknowns[l_size], h.elemVector());
+  std::copy(&storedUnknowns[l_size], &storedUnknowns[2*l_size], hu.elemVector());
+  std::copy(&storedUnknowns[2*l_size], &storedUnknowns[0]+3*l_size, hv.elemVector());
+
+  synchWaterHeightAfterWrite();
+  synchDischargeAfterWrite();
+}
+
 
 //==================================================================
 // protected member functions for simulation
@@ -656,19 +773,25 @@ void SWE_Block::synchAfterWrite() {
  * Update temporary and non-local (for heterogeneous computing) variables
  * after an external update of the water height h
  */
-void SWE_Block::synchWaterHeightAfterWrite() {}
+void SWE_Block::synchWaterHeightAfterWrite() {
+  activateAllTiles();
+}
 
 /**
  * Update temporary and non-local (for heterogeneous computing) variables
  * after an external update of the discharge variables hu and hv
  */
-void SWE_Block::synchDischargeAfterWrite() {}
+void SWE_Block::synchDischargeAfterWrite() {
+  activateAllTiles();
+}
 
 /**
  * Update temporary and non-local (for heterogeneous computing) variables
  * after an external update of the bathymetry b
  */
-void SWE_Block::synchBathymetryAfterWrite() {}
+void SWE_Block::synchBathymetryAfterWrite() {
+  activateAllTiles();
+}
 
 /**
  * Update the ghost layers (only for CONNECT and PASSIVE boundary conditions)
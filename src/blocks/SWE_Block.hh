@@ -34,6 +34,8 @@
 
 #include <iostream>
 #include <fstream>
+#include <vector>
+#include <algorithm>
 
 using namespace std;
 
@@ -204,6 +206,20 @@ class SWE_Block {
     /// returns #ny, i.e. the grid size in y-direction 
     int getNy() { return ny; }
 
+    // tracking of active tiles
+    /// enable the tracking of active tiles (0 disables the tracking)
+    void setActiveTileSize(int i_size);
+    /// returns the number of cells per direction of an active tile (0 if disabled)
+    int getActiveTileSize() { return activeTileSize; }
+    /// returns the number of tiles which are computed in the next time step
+    int getNumberOfActiveTiles();
+
+    // storing of unknowns (e.g. to repeat time steps)
+    /// store a copy of the unknowns h, hu, and hv
+    void storeUnknowns();
+    /// reset the unknowns h, hu, and hv to the last stored copy
+    void restoreUnknowns();
+
   // Konstanten:
     /// static variable that holds the gravity constant (g = 9.81 m/s^2):
     static const float g;
@@ -233,6 +249,28 @@ class SWE_Block {
     /// set boundary conditions in ghost layers (set boundary conditions)
     virtual void setBoundaryConditions();
 
+    // tracking of active tiles
+    /// mark all tiles as active (after an external update of the unknowns)
+    void activateAllTiles();
+    /// compute the active tiles of the next time step from the changed tiles
+    void updateActiveTiles();
+    /// returns the tile column of cell column i (ghost cells belong to the adjacent tiles)
+    int getTileX(int i) { return std::min(std::max(i-1, 0), nx-1) / activeTileSizeX; }
+    /// returns the tile row of cell row j (ghost cells belong to the adjacent tiles)
+    int getTileY(int j) { return std::min(std::max(j-1, 0), ny-1) / activeTileSizeY; }
+    /// returns true if the tile is computed in the current time step
+    bool isTileActive(int tx, int ty) { return activeTiles[tx*activeTilesY + ty] != 0; }
+    /// mark a tile as changed in the current time step
+    /**
+     * Called concurrently by all threads that update a column of the tile.
+     */
+    void markTileChanged(int tx, int ty) {
+#ifdef USEOPENMP
+#pragma omp atomic write
+#endif
+      changedTiles[tx*activeTilesY + ty] = 1;
+    }
+
     // grid size: number of cells (incl. ghost layer in x and y direction:
     int nx;	///< size of Cartesian arrays in x-direction
     int ny;	///< size of Cartesian arrays in y-direction
@@ -260,6 +298,25 @@ class SWE_Block {
      */
     float maxTimestep;
 
+    /// number of cells per direction of an active tile (0 if the tracking is disabled)
+    /**
+     * The interior cells of the block are divided into tiles. A tile is active if a
+     * cell in the tile or in one of its 8 neighbour tiles changed in the last time step.
+     * Cells of inactive tiles keep their values, so the edges between two inactive tiles
+     * do not need to be computed.
+     * If the tracking is disabled, the block consists of a single (always active) tile.
+     */
+    int activeTileSize;
+    int activeTileSizeX; ///< number of cell columns per tile
+    int activeTileSizeY; ///< number of cell rows per tile
+    int activeTilesX;    ///< number of tiles in x-direction
+    int activeTilesY;    ///< number of tiles in y-direction
+    std::vector<unsigned char> activeTiles;  ///< tiles computed in the current time step
+    std::vector<unsigned char> changedTiles; ///< tiles with changed cells in the current time step
+
+    /// copy of h, hu, and hv (incl. ghost layers), see storeUnknowns
+    std::vector<float> storedUnknowns;
+
     // offset of current block
     float offsetX;	///< x-coordinate of the origin (left-bottom corner) of the Cartesian grid
     float offsetY;	///< y-coordinate of the origin (left-bottom corner) of the Cartesian grid
@@ -1,7 +1,10 @@
 #ifndef SWE_DIMENSIONALSPLITTING_CPP_
 #define SWE_DIMENSIONALSPLITTING_CPP_
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <iostream>
 
 #include "SWE_DimensionalSplitting.hh"
 #include "tools/help.hh"
@@ -9,9 +12,13 @@
 #include <omp.h>
 #endif
 
+//! Cells below this water height are ignored when estimating the wave speeds (same as the F-Wave solver)
+static const float cellDryTol = 0.01f;
+
 SWE_DimensionalSplitting::SWE_DimensionalSplitting(int l_nx, int l_ny,
     float l_dx, float l_dy):
     SWE_Block(l_nx, l_ny, l_dx, l_dy),
+    useBatchSolver(false),
     hNetUpdatesLeft  (nx+1, ny+2, false),
     hNetUpdatesRight (nx+1, ny+2, false),
     huNetUpdatesLeft (nx+1, ny+2, false),
@@ -20,80 +27,184 @@ SWE_DimensionalSplitting::SWE_DimensionalSplitting(int l_nx, int l_ny,
     hNetUpdatesAbove (nx, ny+1, false),
     hvNetUpdatesBelow(nx, ny+1, false),
     hvNetUpdatesAbove(nx, ny+1, false),
-    hStar(nx, ny+2, false)
+    hStar(nx, ny+2, false),
+    sweepBlockRows(0),
+    cflNumber(.4f),
+    fusedTileWidth(0),
+    fusedScratch(0),
+    fusedScratchThreads(0),
+    fusedStep(false)
+{
+}
+
+SWE_DimensionalSplitting::~SWE_DimensionalSplitting()
 {
+    delete fusedScratch;
+}
+
+void SWE_DimensionalSplitting::setFusedTileWidth(int tileWidth)
+{
+    assert(tileWidth >= 0);
+    
+    delete fusedScratch;
+    fusedScratch = 0;
+    fusedScratchThreads = 0;
+    
+    fusedTileWidth = std::min(tileWidth, nx);
+    if(fusedTileWidth == 0)
+        return;
+    
+    /**
+     * The parallel regions of the fused sweep are limited to this number
+     * of threads (num_threads clause), so the scratch columns are never
+     * indexed out of bounds if the number of threads grows later.
+     */
+#ifdef USEOPENMP
+    fusedScratchThreads = omp_get_max_threads();
+#else
+    fusedScratchThreads = 1;
+#endif
+    
+    // 1 column for hStar and 4 columns for the Y-Sweep net updates
+    fusedScratch = new Float2D(5*fusedScratchThreads, ny+2, false);
 }
 
 void SWE_DimensionalSplitting::computeNumericalFluxes()
 {
-    float maxWaveSpeed = 0.f;
+    if(fusedTileWidth > 0) {
+        // hStar and the Y-Sweep are done by updateUnknowns
+        computeFusedMaxTimestep();
+        if(fusedStep)
+            return;
+        
+        // The fused Y-Sweep might violate the CFL condition, use the separate one
+        // (on all tiles, the fused sweep does not track the active tiles)
+        if(activeTileSize > 0)
+            activateAllTiles();
+        float maxWaveSpeedY = 0.f;
+#ifdef USEOPENMP
+#pragma omp parallel reduction(max:maxWaveSpeedY)
+#endif
+        {
+            solver::FWave<float> edgeSolver;
+            maxWaveSpeedY = computeYSweep(edgeSolver);
+        }
+        repeatYSweep(maxWaveSpeedY);
+        return;
+    }
     
     /**
-     * **X-Sweep**
-     *
-     * Iterate through every row (including ghost-only rows) and compute 
-     * the left and right net updates for each edge. NetUpdatesLeft[i][j]
-     * denotes the left-going update from cell i+1 to cell i in row j,
-     * while NetUpdatesRight[i][j] denotes the right-going update from cell i
-     * to cell i+1 in row j
+     * All loops of the timestep run in a single parallel region. Every thread
+     * uses its own solver, the maximum wave speeds are combined by reductions.
      */
+    float maxWaveSpeed = 0.f;
+    float maxCellSpeedY = 0.f;
+    float maxWaveSpeedY = 0.f;
+    
+    if(activeTileSize > 0 && getNumberOfActiveTiles() == 0) {
+        // Nothing changes in this timestep, keep the timestep of the last one
+        return;
+    }
+    
+    // Strips of rows processed by the X-Sweep (the rows of the tiles if active tiles are tracked)
+    int rowsPerBlock = (activeTileSize > 0) ? activeTileSizeY
+        : ((sweepBlockRows > 0) ? std::min(sweepBlockRows, ny) : ny);
+    int numberOfRowBlocks = (ny + rowsPerBlock-1) / rowsPerBlock;
     
 #ifdef USEOPENMP
-    // Save maximum wave speed for each thread
-    float* maxWaveSpeedsArray = new float[omp_get_max_threads()];
-    for(int i = 0; i < omp_get_max_threads(); i++)
-        maxWaveSpeedsArray[i] = 0.f;
-#pragma omp parallel for
+#pragma omp parallel reduction(max:maxWaveSpeedY)
 #endif
-    for(int i = 0; i < nx+1; i++) {
-        float maxEdgeSpeed = 0.f;
+    {
+        // The solver used for local edge Riemann problems (one per thread)
+        solver::FWave<float> edgeSolver;
+        
+        /**
+         * **X-Sweep**
+         *
+         * Iterate through every row (including ghost-only rows) and compute 
+         * the left and right net updates for each edge. NetUpdatesLeft[i][j]
+         * denotes the left-going update from cell i+1 to cell i in row j,
+         * while NetUpdatesRight[i][j] denotes the right-going update from cell i
+         * to cell i+1 in row j
+         *
+         * If sweepBlockRows is set, the rows are processed in strips of that
+         * height, so that column i+1 of a strip is still cached when it is
+         * reused as the left cell of edge i+1. The ghost rows belong to the
+         * first and the last strip.
+         *
+         * If active tiles are tracked, the strips are the rows of the tiles
+         * and edges between two inactive tiles are skipped.
+         *
+         * The wave speeds of the Y-Sweep are estimated from the cells of the
+         * right column (which is still in cache), since the timestep has to be
+         * known before the Y-Sweep.
+         */
 #ifdef USEOPENMP
-        // create solver for this thread
-        solver::FWave<float> dimensionalSplittingSolver;
-        int thread_id = omp_get_thread_num();
+#pragma omp for reduction(max:maxWaveSpeed,maxCellSpeedY)
 #endif
-        for(int j = 0; j < ny+2; j++) {
-            dimensionalSplittingSolver.computeNetUpdates( h[i][j], h[i+1][j],
-                    hu[i][j], hu[i+1][j],
-                    b[i][j], b[i+1][j],
-                    hNetUpdatesLeft[i][j], hNetUpdatesRight[i][j],
-                    huNetUpdatesLeft[i][j], huNetUpdatesRight[i][j],
-                    maxEdgeSpeed );
+        for(int k = 0; k < numberOfRowBlocks*(nx+1); k++) {
+            int i = k % (nx+1);
+            int ty = k / (nx+1);
+            if(activeTileSize > 0 && !isTileActive(getTileX(i), ty) && !isTileActive(getTileX(i+1), ty))
+                continue;
+            
+            int jStart = (ty == 0) ? 0 : 1 + ty*rowsPerBlock;
+            int rows = ((ty == numberOfRowBlocks-1) ? ny+2 : 1 + (ty+1)*rowsPerBlock) - jStart;
             // Update maxWaveSpeed (x direction)
-            // maxWaveSpeed is likely to be greater than maxEdgeSpeed
+            computeEdgeNetUpdates( edgeSolver, rows,
+                    h[i]+jStart, h[i+1]+jStart,
+                    hu[i]+jStart, hu[i+1]+jStart,
+                    b[i]+jStart, b[i+1]+jStart,
+                    hNetUpdatesLeft[i]+jStart, hNetUpdatesRight[i]+jStart,
+                    huNetUpdatesLeft[i]+jStart, huNetUpdatesRight[i]+jStart,
+                    maxWaveSpeed );
+            // Estimate maxWaveSpeedY (the right ghost column has no Y-Sweep)
+            if(i < nx)
+                maxCellSpeedY = std::max(maxCellSpeedY,
+                    computeMaxCellSpeed(rows, h[i+1]+jStart, hv[i+1]+jStart));
+        }
+        
 #ifdef USEOPENMP
-            // calculate maximum wave speed for this thread only
-            if (maxEdgeSpeed < maxWaveSpeedsArray[thread_id]) {
-                // nothing to do
-            } else {
-                maxWaveSpeedsArray[thread_id] = maxEdgeSpeed;
-            }
-#else
-            if (maxEdgeSpeed < maxWaveSpeed) {
-                // nothing to do
-            } else {
-                maxWaveSpeed = maxEdgeSpeed;
-            }
+#pragma omp single
 #endif
-        }
+        computeSweepTimestep(maxWaveSpeed, maxCellSpeedY);
+        
+        maxWaveSpeedY = computeYSweep(edgeSolver);
     }
+    
+    repeatYSweep(maxWaveSpeedY);
+}
+
+void SWE_DimensionalSplitting::repeatYSweep(float maxWaveSpeedY)
+{
+    /**
+     * The estimated wave speeds of the Y-Sweep may be lower than the wave
+     * speeds computed by the solver. If the CFL condition is violated,
+     * repeat hStar and the Y-Sweep with a smaller timestep.
+     */
+    for(int retry = 0; retry < 2 && maxTimestep * maxWaveSpeedY > .5f * dy; retry++) {
+        maxTimestep = cflNumber * dy / maxWaveSpeedY;
+        maxWaveSpeedY = 0.f;
+        
 #ifdef USEOPENMP
-        maxWaveSpeed = maxWaveSpeedsArray[0];
-        for(int i = 1; i < omp_get_max_threads(); i++) {
-            if(maxWaveSpeed > maxWaveSpeedsArray[i]) {
-                // nothing to do
-            } else {
-                maxWaveSpeed = maxWaveSpeedsArray[i];
-            }
-        }
+#pragma omp parallel reduction(max:maxWaveSpeedY)
 #endif
+        {
+            solver::FWave<float> edgeSolver;
+            maxWaveSpeedY = computeYSweep(edgeSolver);
+        }
+    }
     
-    assert(maxWaveSpeed > 0.f);
-    
-    // Compute CFL condition (slightly pessimistic)
-    maxTimestep = dx/maxWaveSpeed * .4f;
-    
-    assert(std::isfinite(maxTimestep));
+    if(maxTimestep * maxWaveSpeedY > .5f * dy) {
+        // Oops, CFL condition is NOT satisfied
+        std::cerr << "WARNING: CFL condition is not satisfied in y-sweep: "
+                  << .5f * dy / maxWaveSpeedY << " < " << maxTimestep << std::endl;
+    }
+}
+
+float SWE_DimensionalSplitting::computeYSweep(solver::FWave<float> &edgeSolver)
+{
+    float maxWaveSpeedY = 0.f;
     
     /**
      * **Update intermediate heights (hStar)**
@@ -103,25 +214,8 @@ void SWE_DimensionalSplitting::computeNumericalFluxes()
      * the ghost cells at the left and right boundary of the block. Therefore
      * the cell hStar[i][j] corresponds to h[i+1][j] since indexing begins with 0
      * in hStar, similarly hStar contains two cells less than h in horizontal (x)
-     * direction 
-     */
-#ifdef USEOPENMP
-#pragma omp parallel for
-#endif
-    for (int i = 0; i < nx; i++) {
-        for (int j = 0; j < ny+2; j++) {
-            hStar[i][j] =  h[i+1][j] - maxTimestep/dx * (hNetUpdatesRight[i][j] + hNetUpdatesLeft[i+1][j]);
-            
-            // catch negative heights
-            if(hStar[i][j] > 0.f) {
-                // nothing to do
-            } else {
-                hStar[i][j] = 0.f;
-            }
-        }
-    }
-    
-    /**
+     * direction
+     *
      * **Y-Sweep**
      *
      * Iterate through every column of hStar (therefore excluding the left and right
@@ -129,108 +223,353 @@ void SWE_DimensionalSplitting::computeNumericalFluxes()
      * updates. NetUpdatesBelow[i][j] denotes the updates going from cell j+1 to cell j
      * in the (i+1)-th column , while NetUpdatesAbove[i][j] denotes the updates going from cell 
      * j to j+1 in the (i+1)-th column of the block
+     *
+     * The Y-Sweep of a column only depends on hStar of the same column, so
+     * both are computed in the same iteration.
+     *
+     * Every tile computes the edges below its cells (the last tile also the
+     * top edge). If a tile is inactive, only the edge to an active tile below
+     * is computed. Without tracking of active tiles, the column is a single tile.
      */
-    maxWaveSpeed = 0.f;
 #ifdef USEOPENMP
-    // reset maximum wave speed
-    for(int i = 0; i < omp_get_max_threads(); i++)
-        maxWaveSpeedsArray[i] = 0.f;
-
-#pragma omp parallel for
+#pragma omp for
 #endif
     for(int i = 0; i < nx; i++) {
-
-        float maxEdgeSpeed = 0.f;
-#ifdef USEOPENMP
-        // create solver for this thread
-        solver::FWave<float> dimensionalSplittingSolver;
-  #ifndef NEDBUG
-        int thread_id = omp_get_thread_num();
-  #endif
-#endif
-        for(int j = 0; j < ny+1; j++) {
-            dimensionalSplittingSolver.computeNetUpdates( hStar[i][j], hStar[i][j+1],
-                    hv[i+1][j], hv[i+1][j+1],
-                    b[i+1][j], b[i+1][j+1],
-                    hNetUpdatesBelow[i][j], hNetUpdatesAbove[i][j],
-                    hvNetUpdatesBelow[i][j], hvNetUpdatesAbove[i][j],
-                    maxEdgeSpeed );
-#ifndef NDEBUG
-            // Update maxWaveSpeed (y direction)
-            // maxWaveSpeed is likely to be greater than maxEdgeSpeed
-  #ifdef USEOPENMP
-            // calculate maximum wave speed for this thread only
-            if (maxEdgeSpeed < maxWaveSpeedsArray[thread_id]) {
-                // nothing to do
-            } else {
-                maxWaveSpeedsArray[thread_id] = maxEdgeSpeed;
-            }
-  #else
-            if (maxEdgeSpeed < maxWaveSpeed) {
-                // nothing to do
-            } else {
-                maxWaveSpeed = maxEdgeSpeed;
+        int tx = getTileX(i+1);
+        
+        for(int ty = 0; ty < activeTilesY; ty++) {
+            int edgeBegin = ty*activeTileSizeY;
+            int edgeEnd = (ty == activeTilesY-1) ? ny+1 : edgeBegin + activeTileSizeY;
+            if(!isTileActive(tx, ty)) {
+                if(ty > 0 && isTileActive(tx, ty-1))
+                    edgeEnd = edgeBegin + 1;
+                else
+                    continue;
             }
-  #endif
-#endif
+            
+            // hStar of the cells above and below the edges
+            computeIntermediateHeights(i, edgeBegin, edgeEnd+1, hStar[i]);
+            
+            computeEdgeNetUpdates( edgeSolver, edgeEnd-edgeBegin,
+                    hStar[i]+edgeBegin, hStar[i]+edgeBegin+1,
+                    hv[i+1]+edgeBegin, hv[i+1]+edgeBegin+1,
+                    b[i+1]+edgeBegin, b[i+1]+edgeBegin+1,
+                    hNetUpdatesBelow[i]+edgeBegin, hNetUpdatesAbove[i]+edgeBegin,
+                    hvNetUpdatesBelow[i]+edgeBegin, hvNetUpdatesAbove[i]+edgeBegin,
+                    maxWaveSpeedY );
         }
     }
     
-#ifndef NDEBUG
-  #ifdef USEOPENMP
-    maxWaveSpeed = maxWaveSpeedsArray[0];
-    for(int i = 1; i < omp_get_max_threads(); i++) {
-        if(maxWaveSpeed > maxWaveSpeedsArray[i]) {
+    return maxWaveSpeedY;
+}
+
+void SWE_DimensionalSplitting::computeIntermediateHeights(int i, int begin, int end, float *o_hStar)
+{
+    for (int j = begin; j < end; j++) {
+        o_hStar[j] =  h[i+1][j] - maxTimestep/dx * (hNetUpdatesRight[i][j] + hNetUpdatesLeft[i+1][j]);
+        
+        // catch negative heights
+        if(o_hStar[j] > 0.f) {
             // nothing to do
         } else {
-            maxWaveSpeed = maxWaveSpeedsArray[i];
+            o_hStar[j] = 0.f;
+        }
+    }
+}
+
+float SWE_DimensionalSplitting::computeMaxEdgeSpeedBound(int n, const float *h, const float *hv)
+{
+    float maxEdgeSpeed = 0.f;
+    // |v| and sqrt(g*h) of the cell below (0 for dry cells, which reflect the wet cell)
+    float speedBelow = 0.f;
+    float celerityBelow = 0.f;
+    for(int j = 0; j < n; j++) {
+        float speed = 0.f;
+        float celerity = 0.f;
+        if(h[j] >= cellDryTol) {
+            speed = std::fabs(hv[j]) / h[j];
+            celerity = std::sqrt(g * h[j]);
+        }
+        maxEdgeSpeed = std::max(maxEdgeSpeed, std::max(speed, speedBelow) + std::max(celerity, celerityBelow));
+        speedBelow = speed;
+        celerityBelow = celerity;
+    }
+    return maxEdgeSpeed;
+}
+
+float SWE_DimensionalSplitting::computeMaxCellSpeed(int n, const float *h, const float *hv)
+{
+    float maxCellSpeed = 0.f;
+    for(int j = 0; j < n; j++) {
+        if(h[j] > cellDryTol) {
+            float cellSpeed = std::fabs(hv[j]) / h[j] + std::sqrt(g * h[j]);
+            maxCellSpeed = std::max(maxCellSpeed, cellSpeed);
         }
     }
-  #endif
-    assert(maxWaveSpeed > 0.f);
+    return maxCellSpeed;
+}
+
+void SWE_DimensionalSplitting::computeSweepTimestep(float maxWaveSpeedX, float maxWaveSpeedY)
+{
+    assert(maxWaveSpeedX > 0.f);
     
-    // Check if the CFL condition is also satisfied for y direction
-    float maxTimestepY = .5f * dy / maxWaveSpeed;
-    if(maxTimestepY >= maxTimestep) {
-        // OK, everything's fine
+    // Compute CFL condition for both directions
+    maxTimestep = cflNumber * dx / maxWaveSpeedX;
+    if(maxWaveSpeedY > 0.f)
+        maxTimestep = std::min(maxTimestep, cflNumber * dy / maxWaveSpeedY);
+    
+    assert(std::isfinite(maxTimestep));
+}
+
+inline void SWE_DimensionalSplitting::updateCell(int i, int j, float dt)
+{
+    // Update heights
+    h[i+1][j+1]  = hStar[i][j+1] - dt/dy * (hNetUpdatesAbove[i][j] + hNetUpdatesBelow[i][j+1]);
+    // Update momentum in x-direction
+    hu[i+1][j+1] -= dt/dx * (huNetUpdatesLeft[i+1][j+1] + huNetUpdatesRight[i][j+1]);
+    // Update momentum in y-direction
+    hv[i+1][j+1] -= dt/dy * (hvNetUpdatesBelow[i][j+1] + hvNetUpdatesAbove[i][j]);
+    
+    // catch negative heights
+    if(h[i+1][j+1] > 0.f) {
+        // nothing to do
     } else {
-        // Oops, CFL condition is NOT satisfied
-        std::cerr << "WARNING: CFL condition is not satisfied in y-sweep: "
-                  << maxTimestepY << " < " << maxTimestep << std::endl;
+        h[i+1][j+1] = 0.f;
+        hu[i+1][j+1] = 0.f;
+        hv[i+1][j+1] = 0.f;
     }
-#endif
-
-#ifdef USEOPENMP
-    delete[] maxWaveSpeedsArray;
-#endif
 }
 
 void SWE_DimensionalSplitting::updateUnknowns(float dt)
 {
+    // computeNumericalFluxes may have fallen back to the separate Y-Sweep
+    if(fusedTileWidth > 0 && fusedStep) {
+        updateUnknownsFused(dt);
+        return;
+    }
+    
     /**
      * Iterate through every cell inside the block (excluding ghost cells)
      * and compute the resulting height, horizontal and vertical momentum
      * using the left, right, above and below net updates
      */
+    if(activeTileSize == 0) {
+#ifdef USEOPENMP
+#pragma omp parallel for
+#endif
+        for (int i = 0; i < nx; i++) {
+            for (int j = 0; j < ny; j++) {
+                updateCell(i, j, dt);
+            }
+        }
+        return;
+    }
+    
+    // Cells of inactive tiles are skipped, changed tiles are marked
 #ifdef USEOPENMP
 #pragma omp parallel for
 #endif
     for (int i = 0; i < nx; i++) {
-        for (int j = 0; j < ny; j++) {
-            // Update heights
-            h[i+1][j+1]  = hStar[i][j+1] - dt/dy * (hNetUpdatesAbove[i][j] + hNetUpdatesBelow[i][j+1]);
-            // Update momentum in x-direction
-            hu[i+1][j+1] -= dt/dx * (huNetUpdatesLeft[i+1][j+1] + huNetUpdatesRight[i][j+1]);
-            // Update momentum in y-direction
-            hv[i+1][j+1] -= dt/dy * (hvNetUpdatesBelow[i][j+1] + hvNetUpdatesAbove[i][j]);
+        int tx = getTileX(i+1);
+        
+        for(int ty = 0; ty < activeTilesY; ty++) {
+            if(!isTileActive(tx, ty))
+                continue;
+            
+            bool changed = false;
+            int rowEnd = std::min((ty+1)*activeTileSizeY, ny);
+            for (int j = ty*activeTileSizeY; j < rowEnd; j++) {
+                float hOld = h[i+1][j+1];
+                float huOld = hu[i+1][j+1];
+                float hvOld = hv[i+1][j+1];
+                
+                updateCell(i, j, dt);
+                
+                changed |= (h[i+1][j+1] != hOld) | (hu[i+1][j+1] != huOld) | (hv[i+1][j+1] != hvOld);
+            }
+            
+            if(changed)
+                markTileChanged(tx, ty);
+        }
+    }
+    
+    updateActiveTiles();
+}
+
+void SWE_DimensionalSplitting::setBatchSolver(bool enabled)
+{
+    useBatchSolver = enabled;
+}
+
+void SWE_DimensionalSplitting::setCflNumber(float cfl)
+{
+    assert(cfl > 0.f && cfl <= .5f);
+    cflNumber = cfl;
+}
+
+void SWE_DimensionalSplitting::setSweepBlockRows(int rows)
+{
+    assert(rows >= 0);
+    sweepBlockRows = rows;
+}
+
+void SWE_DimensionalSplitting::computeEdgeNetUpdates(solver::FWave<float> &edgeSolver, int n,
+    const float *hLeft, const float *hRight,
+    const float *huLeft, const float *huRight,
+    const float *bLeft, const float *bRight,
+    float *hNetUpdatesLeft, float *hNetUpdatesRight,
+    float *huNetUpdatesLeft, float *huNetUpdatesRight,
+    float &maxWaveSpeed)
+{
+    if(useBatchSolver) {
+        batchSolver.computeNetUpdates(n, hLeft, hRight, huLeft, huRight, bLeft, bRight,
+            hNetUpdatesLeft, hNetUpdatesRight, huNetUpdatesLeft, huNetUpdatesRight,
+            maxWaveSpeed);
+        return;
+    }
+    
+    float maxEdgeSpeed = 0.f;
+    for(int k = 0; k < n; k++) {
+        edgeSolver.computeNetUpdates( hLeft[k], hRight[k],
+                huLeft[k], huRight[k],
+                bLeft[k], bRight[k],
+                hNetUpdatesLeft[k], hNetUpdatesRight[k],
+                huNetUpdatesLeft[k], huNetUpdatesRight[k],
+                maxEdgeSpeed );
+        if (maxEdgeSpeed < maxWaveSpeed) {
+            // nothing to do
+        } else {
+            maxWaveSpeed = maxEdgeSpeed;
+        }
+    }
+}
+
+void SWE_DimensionalSplitting::computeFusedMaxTimestep()
+{
+    float maxWaveSpeed = 0.f;
+    float maxCellSpeedY = 0.f;
+    float maxEdgeSpeedY = 0.f;
+    
+#ifdef USEOPENMP
+#pragma omp parallel num_threads(fusedScratchThreads) reduction(max:maxEdgeSpeedY)
+#endif
+    {
+        solver::FWave<float> edgeSolver;
+        
+        /**
+         * Same X-Sweep as in computeNumericalFluxes (on whole columns).
+         * The net updates are kept for updateUnknownsFused (or the
+         * separate Y-Sweep), so no edge is solved twice.
+         *
+         * The timestep depends on the wave speeds of all edges, so no tile
+         * can be updated before the whole X-Sweep is done. Keeping only the
+         * net updates of a tile in scratch columns would solve every edge
+         * twice (and the edges at the border of a tile before its neighbour
+         * is updated in place). In swe_benchmark_sweeps (1024 x 4096 cells,
+         * one thread), solving the edges again per tile was about 35% slower
+         * with the scalar solver and not faster with the batch solver, even
+         * without the bound below.
+         */
+#ifdef USEOPENMP
+#pragma omp for reduction(max:maxWaveSpeed,maxCellSpeedY)
+#endif
+        for(int i = 0; i < nx+1; i++) {
+            computeEdgeNetUpdates( edgeSolver, ny+2, h[i], h[i+1],
+                    hu[i], hu[i+1],
+                    b[i], b[i+1],
+                    hNetUpdatesLeft[i], hNetUpdatesRight[i],
+                    huNetUpdatesLeft[i], huNetUpdatesRight[i],
+                    maxWaveSpeed );
+            if(i < nx)
+                maxCellSpeedY = std::max(maxCellSpeedY, computeMaxCellSpeed(ny+2, h[i+1], hv[i+1]));
+        }
+        
+#ifdef USEOPENMP
+#pragma omp single
+#endif
+        computeSweepTimestep(maxWaveSpeed, maxCellSpeedY);
+        
+        /**
+         * Bound the wave speeds of the Y-Sweep with this timestep. This pass
+         * only reads h, hv and the height updates of the X-Sweep. It takes
+         * about 10% of the fused timestep (same benchmark), but the update
+         * is done in place and cannot be repeated with a smaller timestep.
+         */
+#ifdef USEOPENMP
+        float *hStarColumn = (*fusedScratch)[5*omp_get_thread_num()];
+#pragma omp for
+#else
+        float *hStarColumn = (*fusedScratch)[0];
+#endif
+        for(int i = 0; i < nx; i++) {
+            computeIntermediateHeights(i, 0, ny+2, hStarColumn);
+            maxEdgeSpeedY = std::max(maxEdgeSpeedY, computeMaxEdgeSpeedBound(ny+2, hStarColumn, hv[i+1]));
+        }
+    }
+    
+    /**
+     * If the bound satisfies the CFL condition, the separate sweeps would not
+     * repeat the Y-Sweep either. The margin covers the rounding of the solver.
+     */
+    fusedStep = !(maxTimestep * maxEdgeSpeedY * 1.001f > .5f * dy);
+}
+
+void SWE_DimensionalSplitting::updateUnknownsFused(float dt)
+{
+    int numberOfTiles = (nx + fusedTileWidth - 1) / fusedTileWidth;
+    
+#ifdef USEOPENMP
+#pragma omp parallel num_threads(fusedScratchThreads)
+#endif
+    {
+        solver::FWave<float> edgeSolver;
+        Float2D &scratch = *fusedScratch;
+#ifdef USEOPENMP
+        int s = 5*omp_get_thread_num();
+#pragma omp for schedule(static,1)
+#else
+        int s = 0;
+#endif
+        for(int t = 0; t < numberOfTiles; t++) {
+            int first = 1 + t*fusedTileWidth;
+            int last = std::min(first + fusedTileWidth - 1, nx);
+            
+            // the bound of computeFusedMaxTimestep already satisfies the CFL condition
+            float maxWaveSpeedY = 0.f;
+            
+            float *hStarColumn = scratch[s];
+            float *hNetUpdateBelow = scratch[s+1];
+            float *hNetUpdateAbove = scratch[s+2];
+            float *hvNetUpdateBelow = scratch[s+3];
+            float *hvNetUpdateAbove = scratch[s+4];
             
-            // catch negative heights
-            if(h[i+1][j+1] > 0.f) {
-                // nothing to do
-            } else {
-                h[i+1][j+1] = 0.f;
-                hu[i+1][j+1] = 0.f;
-                hv[i+1][j+1] = 0.f;
+            for(int i = first; i <= last; i++) {
+                // intermediate heights (equals hStar[i-1] of the separate sweeps)
+                computeIntermediateHeights(i-1, 0, ny+2, hStarColumn);
+                
+                // Y-Sweep
+                computeEdgeNetUpdates( edgeSolver, ny+1, hStarColumn, hStarColumn+1,
+                        hv[i], hv[i]+1,
+                        b[i], b[i]+1,
+                        hNetUpdateBelow, hNetUpdateAbove,
+                        hvNetUpdateBelow, hvNetUpdateAbove,
+                        maxWaveSpeedY );
+                
+                // Update unknowns of column i
+                for(int j = 0; j < ny; j++) {
+                    h[i][j+1]  = hStarColumn[j+1] - dt/dy * (hNetUpdateAbove[j] + hNetUpdateBelow[j+1]);
+                    hu[i][j+1] -= dt/dx * (huNetUpdatesLeft[i][j+1] + huNetUpdatesRight[i-1][j+1]);
+                    hv[i][j+1] -= dt/dy * (hvNetUpdateBelow[j+1] + hvNetUpdateAbove[j]);
+                    
+                    // catch negative heights
+                    if(h[i][j+1] > 0.f) {
+                        // nothing to do
+                    } else {
+                        h[i][j+1] = 0.f;
+                        hu[i][j+1] = 0.f;
+                        hv[i][j+1] = 0.f;
+                    }
+                }
             }
         }
     }
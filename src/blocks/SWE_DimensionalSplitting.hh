@@ -4,6 +4,7 @@
 #include "blocks/SWE_Block.hh"
 #include "tools/help.hh"
 #include "fwave_solver/FWave.hpp"
+#include "blocks/simd/FWaveBatch.hh"
 
 /**
  * Dimensional Splitting Block
@@ -14,10 +15,10 @@
  */
 class SWE_DimensionalSplitting : public SWE_Block {
 private:
-#ifndef USEOPENMP
-    //! The solver used for local edge Riemann problems
-	solver::FWave<float> dimensionalSplittingSolver;
-#endif
+    //! Solver computing the updates of a whole column of edges at once
+    solver::FWaveBatch batchSolver;
+    //! Use the batch solver instead of the scalar solver
+    bool useBatchSolver;
         
     //! net-updates for the heights of the cells on the left sides of the vertical edges.
     Float2D hNetUpdatesLeft;
@@ -42,6 +43,85 @@ private:
     //! intermediate height of the cells after the x-sweep has been performed.
 	Float2D hStar;
 	
+    //! Number of rows per strip of the X-Sweep, 0 processes whole columns
+    int sweepBlockRows;
+    
+    //! CFL number used to compute the maximum timestep
+    float cflNumber;
+	
+    //! Width (in columns) of the tiles processed by the fused sweep, 0 selects the separate sweeps
+    int fusedTileWidth;
+    //! Scratch columns for hStar and the y-sweep of every thread (fused sweep only)
+    Float2D *fusedScratch;
+    //! Number of threads with scratch columns, parallel regions of the fused sweep use at most this many
+    int fusedScratchThreads;
+    //! The current timestep is completed by the fused sweep (false: fall back to the separate Y-Sweep)
+    bool fusedStep;
+    
+    /// Compute the net updates of n edges with the selected solver
+    /**
+     * @param edgeSolver The scalar solver of the calling thread
+     * @param maxWaveSpeed Set to the maximum of its old value and the wave speeds of all edges
+     */
+    void computeEdgeNetUpdates(solver::FWave<float> &edgeSolver, int n,
+        const float *hLeft, const float *hRight,
+        const float *huLeft, const float *huRight,
+        const float *bLeft, const float *bRight,
+        float *hNetUpdatesLeft, float *hNetUpdatesRight,
+        float *huNetUpdatesLeft, float *huNetUpdatesRight,
+        float &maxWaveSpeed);
+    
+    /// Compute hStar and the Y-Sweep for the columns assigned to the calling thread
+    /**
+     * Must be called by all threads of a parallel region (or outside of one).
+     *
+     * @param edgeSolver The scalar solver of the calling thread
+     * @return The maximum wave speed of the Y-Sweep of the calling thread
+     */
+    float computeYSweep(solver::FWave<float> &edgeSolver);
+    
+    /// Estimate the maximum wave speed in y-direction from the cell values
+    /**
+     * @param n Number of cells
+     * @return The maximum of |v| + sqrt(g*h) over all wet cells
+     */
+    float computeMaxCellSpeed(int n, const float *h, const float *hv);
+    
+    /// Set maxTimestep from the maximum wave speeds in both directions
+    void computeSweepTimestep(float maxWaveSpeedX, float maxWaveSpeedY);
+    
+    /// Compute the intermediate heights of rows [begin, end) of a column after the X-Sweep
+    /**
+     * @param i The column of hStar (column i+1 of the unknowns)
+     * @param o_hStar The intermediate heights of the column (indexed by row)
+     */
+    void computeIntermediateHeights(int i, int begin, int end, float *o_hStar);
+    
+    /// Repeat hStar and the Y-Sweep with a smaller timestep while the CFL condition is violated
+    /**
+     * @param maxWaveSpeedY The maximum wave speed of the last Y-Sweep
+     */
+    void repeatYSweep(float maxWaveSpeedY);
+    
+    /// Upper bound of the wave speeds of the Y-Sweep in a column
+    /**
+     * The F-Wave speeds of an edge are bounded by the largest |v| plus the
+     * largest sqrt(g*h) of the two wet cells (Roe averages lie in between).
+     *
+     * @param n Number of cells
+     * @return The maximum of the bounds of all edges between the n cells
+     */
+    float computeMaxEdgeSpeedBound(int n, const float *h, const float *hv);
+    
+    /// X-Sweep and timestep of the fused sweep, checks if the fused Y-Sweep satisfies the CFL condition
+    void computeFusedMaxTimestep();
+    
+    /// Update the unknowns of interior cell (i+1, j+1) with the net updates of the separate sweeps
+    inline void updateCell(int i, int j, float dt);
+    
+    /// Run hStar, Y-Sweep and the update tile by tile (fused sweep only)
+    void updateUnknownsFused(float dt);
+    
 public:
     /// Dimensional Splitting Constructor
     /**
@@ -53,6 +133,83 @@ public:
     SWE_DimensionalSplitting(int l_nx, int l_ny,
         float l_dx, float l_dy);
     
+    /// Destructor
+    ~SWE_DimensionalSplitting();
+    
+    /// Select between the separate sweeps and the fused single-pass sweep
+    /**
+     * The X-Sweep is computed as in the separate sweeps, since its maximum
+     * wave speed determines the timestep and therefore hStar. The fused sweep
+     * then processes the block in tiles of tileWidth columns and computes
+     * the intermediate heights, the Y-Sweep and the update of each column
+     * in one pass, keeping hStar and the Y net-updates in a few scratch
+     * columns instead of full-size arrays.
+     *
+     * The unknowns are updated before all Y-Sweeps are known, so the
+     * Y-Sweep could not be repeated with a smaller timestep. Therefore a
+     * cheap pass (no Riemann solves) bounds the Y wave speeds from hStar
+     * first. If the bound violates the CFL condition, the timestep falls
+     * back to the separate Y-Sweep and update. Both variants produce
+     * bit-identical results.
+     * The fused sweep does not skip inactive tiles (see SWE_Block::setActiveTileSize),
+     * a fallback timestep activates all tiles.
+     *
+     * @param tileWidth Number of columns per tile, 0 selects the separate sweeps
+     */
+    void setFusedTileWidth(int tileWidth);
+    
+    /// @return The tile width of the fused sweep (0 if the separate sweeps are used)
+    int getFusedTileWidth() { return fusedTileWidth; }
+    
+    /// @return True if the last timestep is completed by the fused sweep (false if it fell back to the separate Y-Sweep)
+    bool isFusedStep() { return fusedTileWidth > 0 && fusedStep; }
+    
+    /// Select between the scalar F-Wave solver and the vectorized batch solver
+    /**
+     * The batch solver computes the net updates of a whole column of
+     * edges at once in both sweeps. The instruction set (AVX-512, AVX2 or scalar)
+     * is selected depending on the CPU features.
+     *
+     * Note: The batch solver does not produce bit-identical results compared
+     * to the scalar solver.
+     *
+     * @param enabled Use the batch solver (true) or the scalar solver (false)
+     */
+    void setBatchSolver(bool enabled);
+    
+    /// @return The batch solver (e.g. to query the selected instruction set)
+    const solver::FWaveBatch& getBatchSolver() { return batchSolver; }
+    
+    /// Process the X-Sweep of the separate sweeps in strips of rows
+    /**
+     * Every edge of the X-Sweep reads the cells on both sides, so each column
+     * of the unknowns is read twice. On tall blocks the left column has left
+     * the cache before it is read again. Processing the rows in strips keeps
+     * the columns of a strip in cache.
+     * The Y-Sweep and the update read every column only once and are not
+     * affected. Results are bit-identical for all strip heights.
+     *
+     * @param rows Number of rows per strip, 0 processes whole columns
+     */
+    void setSweepBlockRows(int rows);
+    
+    /// @return The number of rows per strip of the X-Sweep (0 if whole columns are processed)
+    int getSweepBlockRows() { return sweepBlockRows; }
+    
+    /// Set the CFL number used to compute the maximum timestep
+    /**
+     * The timestep is limited by the wave speeds of the X-Sweep and by an estimate
+     * of the wave speeds of the Y-Sweep computed from the cell values. If the
+     * Y-Sweep still violates the CFL condition, it is repeated with a smaller timestep
+     * (the fused sweep falls back to the separate Y-Sweep in this case).
+     *
+     * @param cfl The CFL number (0 < cfl <= 0.5, default 0.4)
+     */
+    void setCflNumber(float cfl);
+    
+    /// @return The CFL number used to compute the maximum timestep
+    float getCflNumber() { return cflNumber; }
+    
     /// Simulate a single timestep.
     /**
      * @param dt The timestep
@@ -73,6 +230,9 @@ public:
      * and store intermediate heights (used in the Y-Sweep) in the 
      * hStar member variable.
      * Then, we're computing all updates in y direction (Y-Sweep).
+     *
+     * If the fused sweep is selected only the X-Sweep and the maximum
+     * timestep are computed here, hStar and the Y-Sweep are done in updateUnknowns.
      */
     void computeNumericalFluxes();
     
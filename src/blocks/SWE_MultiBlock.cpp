@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+#include "SWE_MultiBlock.hh"
+#ifdef USEOPENMP
+#include <omp.h>
+#endif
+
+SWE_MultiBlock::SWE_MultiBlock(int l_nx, int l_ny, float l_dx, float l_dy,
+    int l_blocksX, int l_blocksY):
+    blocksX(l_blocksX), blocksY(l_blocksY),
+    dx(l_dx), dy(l_dy),
+    blockNx(l_blocksX), blockNy(l_blocksY),
+    blockOffsetX(l_blocksX), blockOffsetY(l_blocksY),
+    blocks(l_blocksX*l_blocksY, 0L),
+    connections(l_blocksX*l_blocksY),
+    maxTimestep(0.f)
+{
+    assert(blocksX > 0 && blocksY > 0);
+    assert(l_nx >= blocksX && l_ny >= blocksY);
+
+    // Same decomposition as in swe_mpi: the last block gets the remaining cells
+    for(int bx = 0; bx < blocksX; bx++) {
+        blockOffsetX[bx] = bx * (l_nx/blocksX);
+        blockNx[bx] = (bx < blocksX-1) ? l_nx/blocksX : l_nx - blockOffsetX[bx];
+    }
+    for(int by = 0; by < blocksY; by++) {
+        blockOffsetY[by] = by * (l_ny/blocksY);
+        blockNy[by] = (by < blocksY-1) ? l_ny/blocksY : l_ny - blockOffsetY[by];
+    }
+
+    int numberOfBlocks = blocksX * blocksY;
+
+    // The constructor of Float2D initializes the memory, such that the
+    // pages of a block are placed on the NUMA node of the allocating thread
+#ifdef USEOPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for(int block = 0; block < numberOfBlocks; block++) {
+        blocks[block] = new SWE_WavePropagationBlock(blockNx[block / blocksY], blockNy[block % blocksY],
+            dx, dy);
+    }
+
+    // Connect the inner boundaries
+    for(int bx = 0; bx < blocksX; bx++) {
+        for(int by = 0; by < blocksY; by++) {
+            SWE_WavePropagationBlock &block = getBlock(bx, by);
+            std::vector<Connection> &blockConnections = connections[bx*blocksY + by];
+
+            if(bx > 0) {
+                Connection left = { block.grabGhostLayer(BND_LEFT),
+                    getBlock(bx-1, by).registerCopyLayer(BND_RIGHT), blockNy[by] };
+                blockConnections.push_back(left);
+            }
+            if(bx < blocksX-1) {
+                Connection right = { block.grabGhostLayer(BND_RIGHT),
+                    getBlock(bx+1, by).registerCopyLayer(BND_LEFT), blockNy[by] };
+                blockConnections.push_back(right);
+            }
+            if(by > 0) {
+                Connection bottom = { block.grabGhostLayer(BND_BOTTOM),
+                    getBlock(bx, by-1).registerCopyLayer(BND_TOP), blockNx[bx] };
+                blockConnections.push_back(bottom);
+            }
+            if(by < blocksY-1) {
+                Connection top = { block.grabGhostLayer(BND_TOP),
+                    getBlock(bx, by+1).registerCopyLayer(BND_BOTTOM), blockNx[bx] };
+                blockConnections.push_back(top);
+            }
+        }
+    }
+}
+
+SWE_MultiBlock::~SWE_MultiBlock()
+{
+    for(unsigned int block = 0; block < blocks.size(); block++) {
+        for(unsigned int c = 0; c < connections[block].size(); c++) {
+            delete connections[block][c].ghostLayer;
+            delete connections[block][c].copyLayer;
+        }
+        delete blocks[block];
+    }
+}
+
+void SWE_MultiBlock::initScenario(float offsetX, float offsetY, SWE_Scenario &scenario)
+{
+    // Scenarios are not required to be thread-safe
+    for(int bx = 0; bx < blocksX; bx++) {
+        for(int by = 0; by < blocksY; by++) {
+            SWE_WavePropagationBlock &block = getBlock(bx, by);
+
+            // Initializes the bathymetry of the ghost layers as well,
+            // therefore it does not have to be exchanged between the blocks
+            block.initScenario(offsetX + blockOffsetX[bx]*dx,
+                offsetY + blockOffsetY[by]*dy, scenario, true);
+
+            if(bx == 0)
+                block.setBoundaryType(BND_LEFT, scenario.getBoundaryType(BND_LEFT));
+            if(bx == blocksX-1)
+                block.setBoundaryType(BND_RIGHT, scenario.getBoundaryType(BND_RIGHT));
+            if(by == 0)
+                block.setBoundaryType(BND_BOTTOM, scenario.getBoundaryType(BND_BOTTOM));
+            if(by == blocksY-1)
+                block.setBoundaryType(BND_TOP, scenario.getBoundaryType(BND_TOP));
+        }
+    }
+}
+
+void SWE_MultiBlock::setGhostLayer(int block)
+{
+    // Only the interior cells of the copy layers are read. The corners are
+    // ghost cells of the neighbour, which may be set concurrently.
+    // (The wave propagation solver does not use the corner ghost cells.)
+    for(unsigned int c = 0; c < connections[block].size(); c++) {
+        SWE_Block1D &ghostLayer = *connections[block][c].ghostLayer;
+        const SWE_Block1D &copyLayer = *connections[block][c].copyLayer;
+        int size = connections[block][c].size;
+
+        for(int k = 1; k <= size; k++) {
+            ghostLayer.h[k] = copyLayer.h[k];
+            ghostLayer.hu[k] = copyLayer.hu[k];
+            ghostLayer.hv[k] = copyLayer.hv[k];
+        }
+    }
+
+    // Outer boundaries
+    blocks[block]->setGhostLayer();
+}
+
+void SWE_MultiBlock::computeNumericalFluxes()
+{
+    int numberOfBlocks = blocksX * blocksY;
+
+    // Reading the copy layer of a neighbour is safe while the neighbour
+    // computes its net updates, since the unknowns are not modified
+#ifdef USEOPENMP
+#pragma omp parallel
+#pragma omp single
+#endif
+    for(int block = 0; block < numberOfBlocks; block++) {
+#ifdef USEOPENMP
+#pragma omp task firstprivate(block)
+#endif
+        {
+            setGhostLayer(block);
+            blocks[block]->computeNumericalFluxes();
+        }
+    }
+
+    // Global reduction
+    maxTimestep = std::numeric_limits<float>::max();
+    for(int block = 0; block < numberOfBlocks; block++)
+        maxTimestep = std::min(maxTimestep, blocks[block]->getMaxTimestep());
+}
+
+void SWE_MultiBlock::updateUnknowns(float dt)
+{
+    int numberOfBlocks = blocksX * blocksY;
+
+#ifdef USEOPENMP
+#pragma omp parallel
+#pragma omp single
+#endif
+    for(int block = 0; block < numberOfBlocks; block++) {
+#ifdef USEOPENMP
+#pragma omp task firstprivate(block)
+#endif
+        blocks[block]->updateUnknowns(dt);
+    }
+}
@@ -0,0 +1,121 @@
+#ifndef SWE_MULTIBLOCK_HH_
+#define SWE_MULTIBLOCK_HH_
+
+#include <vector>
+
+#include "blocks/SWE_WavePropagationBlock.hh"
+#include "scenarios/SWE_Scenario.hh"
+
+/**
+ * Multiple wave propagation blocks in a single process
+ *
+ * The domain is decomposed into blocksX * blocksY SWE_WavePropagationBlocks,
+ * which are connected at their inner boundaries. In every time step,
+ * each block is processed by an OpenMP task. Decomposing the domain into
+ * more blocks than threads balances blocks with different costs
+ * (e.g. blocks with inactive tiles, see SWE_Block::setActiveTileSize).
+ *
+ * The ghost layers at inner boundaries are filled directly from the copy
+ * layers of the neighbours (using SWE_Block1D proxies), no intermediate
+ * buffers are required.
+ *
+ * Note: SWE_WavePropagationBlock has to be compiled without LOOP_OPENMP.
+ */
+class SWE_MultiBlock {
+private:
+    /// An inner boundary of a block
+    struct Connection {
+        //! Ghost layer of the block
+        SWE_Block1D *ghostLayer;
+        //! Copy layer of the neighbour
+        SWE_Block1D *copyLayer;
+        //! Number of interior cells along the boundary
+        int size;
+    };
+
+    //! Number of blocks in x- and y-direction
+    int blocksX, blocksY;
+
+    //! Mesh size of the Cartesian grid in x- and y-direction
+    float dx, dy;
+
+    //! Number of cells of each block in x- and y-direction (without ghost cells)
+    std::vector<int> blockNx, blockNy;
+
+    //! Position of the first cell of each block in x- and y-direction
+    std::vector<int> blockOffsetX, blockOffsetY;
+
+    //! The blocks (index bx*blocksY + by)
+    std::vector<SWE_WavePropagationBlock*> blocks;
+
+    //! Inner boundaries of each block (same index as blocks)
+    std::vector<std::vector<Connection> > connections;
+
+    //! Largest allowed time step of all blocks
+    float maxTimestep;
+
+    /// Set the ghost layers of a single block
+    void setGhostLayer(int block);
+
+public:
+    /// Multi-block constructor
+    /**
+     * Allocates all blocks and connects them at the inner boundaries.
+     * The memory of the blocks is first touched by the threads of a static
+     * OpenMP loop, which distributes the blocks across NUMA nodes.
+     *
+     * @param l_nx The total grid size in x-direction (excluding ghost cells)
+     * @param l_ny The total grid size in y-direction (excluding ghost cells)
+     * @param l_dx The mesh size of the Cartesian grid in x-direction
+     * @param l_dy The mesh size of the Cartesian grid in y-direction
+     * @param l_blocksX Number of blocks in x-direction
+     * @param l_blocksY Number of blocks in y-direction
+     */
+    SWE_MultiBlock(int l_nx, int l_ny, float l_dx, float l_dy,
+        int l_blocksX, int l_blocksY);
+
+    /// Destructor
+    ~SWE_MultiBlock();
+
+    /// Initialize all blocks with a scenario
+    /**
+     * The outer boundaries get the boundary types of the scenario.
+     *
+     * @param offsetX x-coordinate of the origin of the whole domain
+     * @param offsetY y-coordinate of the origin of the whole domain
+     */
+    void initScenario(float offsetX, float offsetY, SWE_Scenario &scenario);
+
+    /// Set the ghost layers and compute the net updates of all blocks
+    /**
+     * Afterwards, getMaxTimestep returns the minimum of the maximum
+     * timesteps of all blocks.
+     */
+    void computeNumericalFluxes();
+
+    /// @return The largest allowed time step of all blocks
+    float getMaxTimestep() { return maxTimestep; }
+
+    /// Update the unknowns of all blocks
+    /**
+     * @param dt The time step, should not be larger than getMaxTimestep()
+     */
+    void updateUnknowns(float dt);
+
+    /// @return Number of blocks in x-direction
+    int getNumberOfBlocksX() { return blocksX; }
+
+    /// @return Number of blocks in y-direction
+    int getNumberOfBlocksY() { return blocksY; }
+
+    /// @return The block at position (bx, by)
+    SWE_WavePropagationBlock &getBlock(int bx, int by) { return *blocks[bx*blocksY + by]; }
+
+    /// @return Position of the first cell of the blocks in column bx
+    int getBlockOffsetX(int bx) { return blockOffsetX[bx]; }
+
+    /// @return Position of the first cell of the blocks in row by
+    int getBlockOffsetY(int by) { return blockOffsetY[by]; }
+};
+
+#endif /* SWE_MULTIBLOCK_HH_ */
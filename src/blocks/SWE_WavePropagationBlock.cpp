@@ -100,7 +100,8 @@ SWE_WavePropagationBlock::SWE_WavePropagationBlock(
   huNetUpdatesAbove(nx, ny+1),
   #endif
   hvNetUpdatesBelow(nx, ny+1),
-  hvNetUpdatesAbove(nx, ny+1)
+  hvNetUpdatesAbove(nx, ny+1),
+  interiorMaxWaveSpeed(0.f)
 {}
 
 /**
@@ -110,9 +111,53 @@ SWE_WavePropagationBlock::SWE_WavePropagationBlock(
  */
 void SWE_WavePropagationBlock::computeNumericalFluxes() {
 	//maximum (linearized) wave speed within one iteration
-	float maxWaveSpeed = (float) 0.;
+	float maxWaveSpeed = std::max( computeVerticalNetUpdates(1, nx+2),
+	                               computeHorizontalNetUpdates(1, ny+2) );
+
+	setMaxTimestepFromWaveSpeed(maxWaveSpeed);
+}
+
+/**
+ * Compute the net updates of all edges that do not touch the ghost layer.
+ *
+ * Together with computeBoundaryNumericalFluxes, this computes the same net updates
+ * as computeNumericalFluxes. The ghost layers are not read, hence they can be received
+ * from the neighbours in the meantime.
+ */
+void SWE_WavePropagationBlock::computeInteriorNumericalFluxes() {
+	interiorMaxWaveSpeed = std::max( computeVerticalNetUpdates(2, nx+1),
+	                                 computeHorizontalNetUpdates(2, ny+1) );
+}
+
+/**
+ * Compute the net updates of the edges between the ghost layer and the domain.
+ * Must be called after computeInteriorNumericalFluxes.
+ * The member variable #maxTimestep will be updated with the
+ * maximum allowed time step size of all edges.
+ */
+void SWE_WavePropagationBlock::computeBoundaryNumericalFluxes() {
+	float maxWaveSpeed = interiorMaxWaveSpeed;
+
+	// left and right edges
+	maxWaveSpeed = std::max(maxWaveSpeed, computeVerticalNetUpdates(1, 2));
+	maxWaveSpeed = std::max(maxWaveSpeed, computeVerticalNetUpdates(nx+1, nx+2));
 
-	// compute the net-updates for the vertical edges
+	// bottom and top edges
+	maxWaveSpeed = std::max(maxWaveSpeed, computeHorizontalNetUpdates(1, 2));
+	maxWaveSpeed = std::max(maxWaveSpeed, computeHorizontalNetUpdates(ny+1, ny+2));
+
+	setMaxTimestepFromWaveSpeed(maxWaveSpeed);
+}
+
+/**
+ * Compute the net updates for the vertical edges i_iBegin <= i < i_iEnd.
+ * The edge i is located between the cells (i-1, j) and (i, j).
+ *
+ * @return the maximum wave speed of the computed edges
+ */
+float SWE_WavePropagationBlock::computeVerticalNetUpdates(const int i_iBegin, const int i_iEnd) {
+	//maximum (linearized) wave speed of the edges
+	float maxWaveSpeed = (float) 0.;
 
 #ifdef LOOP_OPENMP
 #pragma omp parallel
@@ -124,77 +169,131 @@ void SWE_WavePropagationBlock::computeNumericalFluxes() {
 	// Use OpenMP for the outer loop
 	#pragma omp for
 #endif // LOOP_OPENMP
-	for(int i = 1; i < nx+2; i++) {
+	for(int i = i_iBegin; i < i_iEnd; i++) {
+		// tiles left and right of the edges
+		int l_tileLeft = getTileX(i-1);
+		int l_tileRight = getTileX(i);
+
+		for(int ty = 0; ty < activeTilesY; ty++) {
+			// skip edges between inactive tiles
+			if(!isTileActive(l_tileLeft, ty) && !isTileActive(l_tileRight, ty))
+				continue;
 
+			int l_jEnd = std::min(1 + (ty+1)*activeTileSizeY, ny+1);
 
 #if  WAVE_PROPAGATION_SOLVER==4
-		// Vectorization is currently only possible for the FWaveVec solver
+			// Vectorization is currently only possible for the FWaveVec solver
 #ifdef VECTORIZE
-		// Vectorize the inner loop
-		#pragma simd
+			// Vectorize the inner loop
+			#pragma simd
 #endif // VECTORIZE
 #endif // WAVE_PROPAGATION_SOLVER==4
-		for(int j = 1; j < ny+1; j++) {
+			for(int j = 1 + ty*activeTileSizeY; j < l_jEnd; j++) {
 
-			float maxEdgeSpeed;
+				float maxEdgeSpeed;
 
-			#if WAVE_PROPAGATION_SOLVER!=3
-				wavePropagationSolver.computeNetUpdates( h[i-1][j], h[i][j],
+				#if WAVE_PROPAGATION_SOLVER!=3
+					wavePropagationSolver.computeNetUpdates( h[i-1][j], h[i][j],
                                                hu[i-1][j], hu[i][j],
                                                b[i-1][j], b[i][j],
                                                hNetUpdatesLeft[i-1][j-1], hNetUpdatesRight[i-1][j-1],
                                                huNetUpdatesLeft[i-1][j-1], huNetUpdatesRight[i-1][j-1],
                                                maxEdgeSpeed );
-			#else // WAVE_PROPAGATION_SOLVER!=3
-				#error "Solver not implemented in SWE_WavePropagationBlock"
-			#endif // WAVE_PROPAGATION_SOLVER!=3
-
-			#ifdef LOOP_OPENMP
-				//update the thread-local maximum wave speed
-				l_maxWaveSpeed = std::max(l_maxWaveSpeed, maxEdgeSpeed);
-			#else // LOOP_OPENMP
-				//update the maximum wave speed
-				maxWaveSpeed = std::max(maxWaveSpeed, maxEdgeSpeed);
-			#endif // LOOP_OPENMP
+				#else // WAVE_PROPAGATION_SOLVER!=3
+					#error "Solver not implemented in SWE_WavePropagationBlock"
+				#endif // WAVE_PROPAGATION_SOLVER!=3
+
+				#ifdef LOOP_OPENMP
+					//update the thread-local maximum wave speed
+					l_maxWaveSpeed = std::max(l_maxWaveSpeed, maxEdgeSpeed);
+				#else // LOOP_OPENMP
+					//update the maximum wave speed
+					maxWaveSpeed = std::max(maxWaveSpeed, maxEdgeSpeed);
+				#endif // LOOP_OPENMP
+			}
 		}
 	}
 
-	// compute the net-updates for the horizontal edges
+#ifdef LOOP_OPENMP
+	#pragma omp critical
+	{
+		maxWaveSpeed = std::max(l_maxWaveSpeed, maxWaveSpeed);
+	}
+
+} // #pragma omp parallel
+#endif
+
+	return maxWaveSpeed;
+}
+
+/**
+ * Compute the net updates for the horizontal edges i_jBegin <= j < i_jEnd.
+ * The edge j is located between the cells (i, j-1) and (i, j).
+ *
+ * @return the maximum wave speed of the computed edges
+ */
+float SWE_WavePropagationBlock::computeHorizontalNetUpdates(const int i_jBegin, const int i_jEnd) {
+	//maximum (linearized) wave speed of the edges
+	float maxWaveSpeed = (float) 0.;
 
 #ifdef LOOP_OPENMP
+#pragma omp parallel
+{
+
+	float l_maxWaveSpeed = (float) 0.;
+	solver::Hybrid<float> wavePropagationSolver;
+
 	// Use OpenMP for the outer loop
 	#pragma omp for
 #endif // LOOP_OPENMP
 	for(int i = 1; i < nx+1; i++) {
+		int l_tileX = getTileX(i);
+
+		for(int ty = 0; ty < activeTilesY; ty++) {
+			// edges below the cells of the tile, the last tile also computes the top edge
+			int l_jBegin = 1 + ty*activeTileSizeY;
+			int l_jEnd = (ty == activeTilesY-1) ? ny+2 : l_jBegin + activeTileSizeY;
+			if(!isTileActive(l_tileX, ty)) {
+				if(ty > 0 && isTileActive(l_tileX, ty-1))
+					// only the edge to the active tile below
+					l_jEnd = l_jBegin + 1;
+				else
+					continue;
+			}
+
+			// restrict to the requested edges
+			l_jBegin = std::max(l_jBegin, i_jBegin);
+			l_jEnd = std::min(l_jEnd, i_jEnd);
 
 #if  WAVE_PROPAGATION_SOLVER==4
-		// Vectorization is currently only possible for the FWaveVec solver
+			// Vectorization is currently only possible for the FWaveVec solver
 #ifdef VECTORIZE
-		// Vectorize the inner loop
-		#pragma simd
+			// Vectorize the inner loop
+			#pragma simd
 #endif // VECTORIZE
 #endif // WAVE_PROPAGATION_SOLVER==4
-		for(int j = 1; j < ny+2; j++) {
-			float maxEdgeSpeed;
+			for(int j = l_jBegin; j < l_jEnd; j++) {
+				float maxEdgeSpeed;
 
-			#if WAVE_PROPAGATION_SOLVER!=3
-				wavePropagationSolver.computeNetUpdates( h[i][j-1], h[i][j],
+				#if WAVE_PROPAGATION_SOLVER!=3
+					wavePropagationSolver.computeNetUpdates( h[i][j-1], h[i][j],
                                                hv[i][j-1], hv[i][j],
                                                b[i][j-1], b[i][j],
                                                hNetUpdatesBelow[i-1][j-1], hNetUpdatesAbove[i-1][j-1],
                                                hvNetUpdatesBelow[i-1][j-1], hvNetUpdatesAbove[i-1][j-1],
                                                maxEdgeSpeed );
-			#else // WAVE_PROPAGATION_SOLVER!=3
-				#error "Solver not implemented in SWE_WavePropagationBlock"
-			#endif // WAVE_PROPAGATION_SOLVER!=3
-
-			#ifdef LOOP_OPENMP
-				//update the thread-local maximum wave speed
-				l_maxWaveSpeed = std::max(l_maxWaveSpeed, maxEdgeSpeed);
-			#else // LOOP_OPENMP
-				//update the maximum wave speed
-				maxWaveSpeed = std::max(maxWaveSpeed, maxEdgeSpeed);
-			#endif // LOOP_OPENMP
+				#else // WAVE_PROPAGATION_SOLVER!=3
+					#error "Solver not implemented in SWE_WavePropagationBlock"
+				#endif // WAVE_PROPAGATION_SOLVER!=3
+
+				#ifdef LOOP_OPENMP
+					//update the thread-local maximum wave speed
+					l_maxWaveSpeed = std::max(l_maxWaveSpeed, maxEdgeSpeed);
+				#else // LOOP_OPENMP
+					//update the maximum wave speed
+					maxWaveSpeed = std::max(maxWaveSpeed, maxEdgeSpeed);
+				#endif // LOOP_OPENMP
+			}
 		}
 	}
 
@@ -207,7 +306,16 @@ void SWE_WavePropagationBlock::computeNumericalFluxes() {
 } // #pragma omp parallel
 #endif
 
-	if(maxWaveSpeed > 0.00001) {
+	return maxWaveSpeed;
+}
+
+/**
+ * Set the member variable #maxTimestep from the maximum wave speed of all edges.
+ *
+ * @param i_maxWaveSpeed maximum (linearized) wave speed
+ */
+void SWE_WavePropagationBlock::setMaxTimestepFromWaveSpeed(const float i_maxWaveSpeed) {
+	if(i_maxWaveSpeed > 0.00001) {
 		//TODO zeroTol
 
 		//compute the time step width
@@ -215,7 +323,7 @@ void SWE_WavePropagationBlock::computeNumericalFluxes() {
 		//(max. wave speed) * dt / dx < .5
 		// => dt = .5 * dx/(max wave speed)
 
-		maxTimestep = std::min( dx/maxWaveSpeed, dy/maxWaveSpeed );
+		maxTimestep = std::min( dx/i_maxWaveSpeed, dy/i_maxWaveSpeed );
 
 		#if WAVE_PROPAGATION_SOLVER!=3
 			maxTimestep *= (float) .4; //CFL-number = .5
@@ -229,50 +337,98 @@ void SWE_WavePropagationBlock::computeNumericalFluxes() {
 		maxTimestep = std::numeric_limits<float>::max();
 }
 
+/**
+ * Updates the unknowns of a single cell with the already computed net-updates.
+ *
+ * @param i x-index of the cell.
+ * @param j y-index of the cell.
+ * @param dt time step width used in the update.
+ */
+inline void SWE_WavePropagationBlock::updateCell(int i, int j, float dt) {
+	h[i][j] -=   dt/dx * (hNetUpdatesRight[i-1][j-1] + hNetUpdatesLeft[i][j-1])
+           	   + dt/dy * (hNetUpdatesAbove[i-1][j-1] + hNetUpdatesBelow[i-1][j]);
+	hu[i][j] -= dt/dx * (huNetUpdatesRight[i-1][j-1] + huNetUpdatesLeft[i][j-1]);
+	hv[i][j] -= dt/dy * (hvNetUpdatesAbove[i-1][j-1] + hvNetUpdatesBelow[i-1][j]);
+	#if WAVE_PROPAGATION_SOLVER==3
+		hv[i][j] -= dt/dx * (hvNetUpdatesRight[i-1][j-1] + hvNetUpdatesLeft[i][j-1]);
+		hu[i][j] -= dt/dy * (huNetUpdatesAbove[i-1][j-1] + huNetUpdatesBelow[i-1][j]);
+	#endif // WAVE_PROPAGATION_SOLVER==3
+
+
+	if (h[i][j] < 0) {
+		//TODO: dryTol
+#ifndef NDEBUG
+		// Only print this warning when debug is enabled
+		// Otherwise we cannot vectorize this loop
+		if (h[i][j] < -0.1) {
+			std::cerr << "Warning, negative height: (i,j)=(" << i << "," << j << ")=" << h[i][j] << std::endl;
+			std::cerr << "         b: " << b[i][j] << std::endl;
+		}
+#endif // NDEBUG
+		//zero (small) negative depths
+		h[i][j] = hu[i][j] = hv[i][j] = 0.;
+	} else if (h[i][j] < 0.1)
+		hu[i][j] = hv[i][j] = 0.; //no water, no speed!
+}
+
 /**
  * Updates the unknowns with the already computed net-updates.
  *
  * @param dt time step width used in the update.
  */
 void SWE_WavePropagationBlock::updateUnknowns(float dt) {
-  //update cell averages with the net-updates
+	if(activeTileSize == 0) {
+		// no tile tracking: update all cells
+#ifdef LOOP_OPENMP
+		#pragma omp parallel for
+#endif // LOOP_OPENMP
+		for(int i = 1; i < nx+1; i++) {
+
+#ifdef VECTORIZE
+			// Tell the compiler that he can safely ignore all dependencies in this loop
+			#pragma ivdep
+#endif // VECTORIZE
+			for(int j = 1; j < ny+1; j++)
+				updateCell(i, j, dt);
+		}
+
+		return;
+	}
+
+  //update cell averages of the active tiles with the net-updates
 #ifdef LOOP_OPENMP
 	#pragma omp parallel for
 #endif // LOOP_OPENMP
 	for(int i = 1; i < nx+1; i++) {
+		int l_tileX = getTileX(i);
+
+		for(int ty = 0; ty < activeTilesY; ty++) {
+			// cells of inactive tiles do not change
+			if(!isTileActive(l_tileX, ty))
+				continue;
+
+			int l_jBegin = 1 + ty*activeTileSizeY;
+			int l_jEnd = std::min(l_jBegin + activeTileSizeY, ny+1);
+			bool l_changed = false;
 
 #ifdef VECTORIZE
-		// Tell the compiler that he can safely ignore all dependencies in this loop
-		#pragma ivdep
+			// Tell the compiler that he can safely ignore all dependencies in this loop
+			#pragma ivdep
 #endif // VECTORIZE
-		for(int j = 1; j < ny+1; j++) {
+			for(int j = l_jBegin; j < l_jEnd; j++) {
+				float l_h = h[i][j], l_hu = hu[i][j], l_hv = hv[i][j];
 
-			h[i][j] -=   dt/dx * (hNetUpdatesRight[i-1][j-1] + hNetUpdatesLeft[i][j-1])
-                	   + dt/dy * (hNetUpdatesAbove[i-1][j-1] + hNetUpdatesBelow[i-1][j]);
-			hu[i][j] -= dt/dx * (huNetUpdatesRight[i-1][j-1] + huNetUpdatesLeft[i][j-1]);
-			hv[i][j] -= dt/dy * (hvNetUpdatesAbove[i-1][j-1] + hvNetUpdatesBelow[i-1][j]);
-        	#if WAVE_PROPAGATION_SOLVER==3
-				hv[i][j] -= dt/dx * (hvNetUpdatesRight[i-1][j-1] + hvNetUpdatesLeft[i][j-1]);
-				hu[i][j] -= dt/dy * (huNetUpdatesAbove[i-1][j-1] + huNetUpdatesBelow[i-1][j]);
-        	#endif // WAVE_PROPAGATION_SOLVER==3
+				updateCell(i, j, dt);
 
+				l_changed |= (h[i][j] != l_h) | (hu[i][j] != l_hu) | (hv[i][j] != l_hv);
+			}
 
-			if (h[i][j] < 0) {
-				//TODO: dryTol
-#ifndef NDEBUG
-				// Only print this warning when debug is enabled
-				// Otherwise we cannot vectorize this loop
-				if (h[i][j] < -0.1) {
-					std::cerr << "Warning, negative height: (i,j)=(" << i << "," << j << ")=" << h[i][j] << std::endl;
-					std::cerr << "         b: " << b[i][j] << std::endl;
-				}
-#endif // NDEBUG
-				//zero (small) negative depths
-				h[i][j] = hu[i][j] = hv[i][j] = 0.;
-			} else if (h[i][j] < 0.1)
-				hu[i][j] = hv[i][j] = 0.; //no water, no speed!
+			if(l_changed)
+				markTileChanged(l_tileX, ty);
 		}
 	}
+
+	updateActiveTiles();
 }
 
 /**
@@ -297,6 +453,9 @@ bool SWE_WavePropagationBlock::updateBathymetryWithDynamicDisplacement(scenarios
 
   setBoundaryBathymetry();
 
+  // the bathymetry changed everywhere
+  activateAllTiles();
+
   return true;
 }
 #endif
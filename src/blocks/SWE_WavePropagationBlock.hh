@@ -119,6 +119,21 @@ class SWE_WavePropagationBlock: public SWE_Block {
     Float2D huNetUpdatesAbove;
     #endif
 
+    //! maximum wave speed of the interior edges (see computeInteriorNumericalFluxes)
+    float interiorMaxWaveSpeed;
+
+    //computes the net-updates for the vertical edges i_iBegin <= i < i_iEnd
+    float computeVerticalNetUpdates(int i_iBegin, int i_iEnd);
+
+    //computes the net-updates for the horizontal edges i_jBegin <= j < i_jEnd
+    float computeHorizontalNetUpdates(int i_jBegin, int i_jEnd);
+
+    //sets the maximum time step from the maximum wave speed
+    void setMaxTimestepFromWaveSpeed(float i_maxWaveSpeed);
+
+    //updates the unknowns of cell (i,j) with the net-updates
+    inline void updateCell(int i, int j, float dt);
+
   public:
     //constructor of a SWE_WavePropagationBlock.
     SWE_WavePropagationBlock(int l_nx, int l_ny,
@@ -130,6 +145,12 @@ class SWE_WavePropagationBlock: public SWE_Block {
     //computes the net-updates for the block
     void computeNumericalFluxes();
 
+    //computes the net-updates of the edges, which do not touch the ghost layer
+    void computeInteriorNumericalFluxes();
+
+    //computes the remaining net-updates after computeInteriorNumericalFluxes
+    void computeBoundaryNumericalFluxes();
+
     //update the cells
     void updateUnknowns(float dt);
 
@@ -88,6 +88,9 @@ SWE_BlockCUDA::SWE_BlockCUDA(
 		float l_dx, float l_dy)
 	: SWE_Block(l_nx, l_ny, l_dx, l_dy)
 {
+  // arrays are copied from/to the device as a whole, padded columns are not supported
+  assert(h.getLeadingDimension() == ny+2);
+
   if (nx % TILE_SIZE != 0) {
     cout << "WARNING: nx not a multiple of TILE_SIZE  -> will lead to crashes!" 
          << endl << flush;
@@ -0,0 +1,121 @@
+#ifndef OPENCLTUNINGCACHE_HH
+#define OPENCLTUNINGCACHE_HH
+
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+
+#include "SWE_DimensionalSplittingOpenCL.hh"
+
+/// Tuning cache
+/**
+ * Stores the fastest kernel configuration (see SWE_DimensionalSplittingOpenCL::tune)
+ * for each set of devices and grid size in a text file, so that later runs
+ * can skip the auto-tuning.
+ *
+ * Each line of the file contains one entry with tab separated fields:
+ * devices (name and driver version), cells in x- and y-direction,
+ * kernel memory type ("global" or "local"), work group size and the
+ * measured device time per time step in nanoseconds. Later entries
+ * replace earlier entries with the same devices and grid size.
+ */
+class OpenCLTuningCache {
+private:
+    //! Name of the cache file
+    std::string fileName;
+
+    //! Kernel configuration of each key (see getKey)
+    std::map<std::string, KernelConfig> entries;
+
+    /// Get the key of an entry
+    /**
+     * @param devices Names and driver versions of the devices
+     * @param nx Number of cells in x-direction
+     * @param ny Number of cells in y-direction
+     * @return The tab separated key fields
+     */
+    static std::string getKey(const std::string &devices, int nx, int ny) {
+        std::string key = devices;
+        for(unsigned int i = 0; i < key.size(); i++) {
+            // the fields are separated by tabs, the entries by newlines
+            if(key[i] == '\t' || key[i] == '\n' || key[i] == '\r')
+                key[i] = ' ';
+        }
+        std::ostringstream s;
+        s << key << '\t' << nx << '\t' << ny;
+        return s.str();
+    }
+
+    /// Read all entries of the cache file (a missing file is an empty cache)
+    void load() {
+        std::ifstream file(fileName.c_str());
+        std::string line;
+        while(std::getline(file, line)) {
+            // key fields, memory type, work group size and time
+            std::string fields[6];
+            std::istringstream s(line);
+            unsigned int count = 0;
+            while(count < 6 && std::getline(s, fields[count], '\t'))
+                count++;
+
+            KernelConfig config;
+            std::istringstream groupSize(fields[4]);
+            if(count < 6 || !(groupSize >> config.workGroupSize) || config.workGroupSize == 0
+                    || (fields[3] != "global" && fields[3] != "local")) {
+                std::cerr << "WARNING: Ignoring invalid entry in tuning cache " << fileName << std::endl;
+                continue;
+            }
+            config.kernelType = (fields[3] == "global") ? MEM_GLOBAL : MEM_LOCAL;
+
+            entries[fields[0] + '\t' + fields[1] + '\t' + fields[2]] = config;
+        }
+    }
+
+public:
+    /// Constructor
+    /**
+     * @param _fileName Name of the cache file
+     */
+    OpenCLTuningCache(const std::string &_fileName) : fileName(_fileName) {
+        load();
+    }
+
+    /// Find the kernel configuration of a set of devices and a grid size
+    /**
+     * @param devices Names and driver versions of the devices (see OpenCLWrapper::getDeviceDescription)
+     * @param nx Number of cells in x-direction
+     * @param ny Number of cells in y-direction
+     * @param config Returns the kernel configuration
+     * @return True if the cache contains a configuration
+     */
+    bool find(const std::string &devices, int nx, int ny, KernelConfig &config) const {
+        std::map<std::string, KernelConfig>::const_iterator entry = entries.find(getKey(devices, nx, ny));
+        if(entry == entries.end())
+            return false;
+        config = entry->second;
+        return true;
+    }
+
+    /// Add the kernel configuration of a set of devices and a grid size to the cache file
+    /**
+     * @param devices Names and driver versions of the devices (see OpenCLWrapper::getDeviceDescription)
+     * @param nx Number of cells in x-direction
+     * @param ny Number of cells in y-direction
+     * @param config The kernel configuration
+     * @param time Measured device time per time step in nanoseconds
+     */
+    void store(const std::string &devices, int nx, int ny, const KernelConfig &config, double time) {
+        std::string key = getKey(devices, nx, ny);
+        entries[key] = config;
+
+        std::ofstream file(fileName.c_str(), std::ios::app);
+        file << key << '\t' << ((config.kernelType == MEM_GLOBAL) ? "global" : "local")
+             << '\t' << config.workGroupSize << '\t' << (unsigned long)time << std::endl;
+        if(!file)
+            std::cerr << "WARNING: Unable to write tuning cache " << fileName << std::endl;
+    }
+};
+
+#endif /* OPENCLTUNINGCACHE_HH */
@@ -4,11 +4,18 @@
 #define __CL_ENABLE_EXCEPTIONS 1
 #include <CL/cl.hpp>
 #include <cassert>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <map>
 #include <cmath>
+#include <sstream>
+#include <string>
 
 #include <pthread.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 //! Type to identifiy different execution states (queued<->submitted, submitted<->start, start<->end)
 typedef enum { PROFILING_QUEUE, PROFILING_SUBMIT, PROFILING_EXEC } ProfilingState;
@@ -40,12 +47,19 @@ protected:
     std::vector<cl::Device> devices;
     //! List of command queues corresponding to the OpenCL devices
     std::vector<cl::CommandQueue> queues;
+    //! Second command queue for each device, for transfers that overlap with the computation
+    std::vector<cl::CommandQueue> transferQueues;
     
     //! The OpenCL program
     cl::Program program;
     //! OpenCL Kernels in the program identified by kernel function name
     std::map<std::string, cl::Kernel> kernels;
     
+    //! Directory of the cached program binaries (empty = no cache)
+    std::string programCacheDirectory;
+    //! The program was created from cached binaries
+    bool programFromCache;
+    
     //! Kernel and memory profiling information
     std::map < std::string, profilingInfo > profilingEvents;
 
@@ -117,7 +131,8 @@ protected:
      * is chosen.
      * Note that the context contains ALL computing devices of that type. So if
      * there are two GPUs available on the platform, both GPUs will be used in
-     * the context.
+     * the context. With CL_DEVICE_TYPE_ALL, the context contains all devices of
+     * the platform (e.g. a CPU and a GPU).
      * The queues will be creating using the supplied queue options
      * (for instance out-of-order exec)
      *
@@ -132,6 +147,9 @@ protected:
         // check if preferred type has devices
         if(deviceTypeCount[preferredDeviceType] > 0) {
             deviceType = preferredDeviceType;
+        } else if(preferredDeviceType == CL_DEVICE_TYPE_ALL) {
+            // the platform has at least one device (see setupPlatform)
+            deviceType = CL_DEVICE_TYPE_ALL;
         } else {
             // go through type list and choose first device type
             // (list is ordered in descending priority)
@@ -159,8 +177,10 @@ protected:
             context.getInfo(CL_CONTEXT_DEVICES, &devices);
             
             // for each computing device, create an in-order command queue
+            // and a separate queue for transfers between the devices
             for(unsigned int i = 0; i < devices.size(); i++) { 
                 queues.push_back(cl::CommandQueue(context, devices[i], queueProperties));
+                transferQueues.push_back(cl::CommandQueue(context, devices[i], queueProperties));
             }
         } catch (cl::Error &e) {
             std::cerr << "Error: Unable to create OpenCL context: Error " << e.err() << std::endl;
@@ -189,16 +209,170 @@ protected:
        return groupSize * (size_t)ceil(float(range) / groupSize);
    }
     
+    /// Compute the 64 bit FNV-1a hash of a byte string
+    /**
+     * @param data The bytes
+     * @param length Number of bytes
+     * @param hash The hash of the preceding bytes (to hash several strings)
+     * @return The hash
+     */
+    static uint64_t fnv1a(const char* data, size_t length, uint64_t hash = 14695981039346656037ULL) {
+        for(size_t i = 0; i < length; i++) {
+            hash ^= (unsigned char)data[i];
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+    
+    /// Get the key of the cached program binary of a device
+    /**
+     * @param device The device
+     * @param options The build options
+     * @return Device name, driver version and build options
+     */
+    std::string getProgramCacheKey(const cl::Device &device, const std::string &options) {
+        return device.getInfo<CL_DEVICE_NAME>() + '\n' + device.getInfo<CL_DRIVER_VERSION>() + '\n' + options;
+    }
+    
+    /// Get the file name of the cached program binary of a device
+    /**
+     * @param key The key of the binary (see getProgramCacheKey)
+     * @return The file name in the program cache directory
+     */
+    std::string getProgramCacheFileName(const std::string &key) {
+        char name[32];
+        sprintf(name, "/%016llx.clbin", (unsigned long long)fnv1a(key.data(), key.size()));
+        return programCacheDirectory + name;
+    }
+    
+    /// Create the program from the cached binaries of all devices
+    /**
+     * File layout: "SWECLBIN", the hash of the sources, the length and the
+     * characters of the key (see getProgramCacheKey), the size and the bytes
+     * of the binary.
+     * 
+     * @param sourceHash The hash of the kernel sources
+     * @param options The build options
+     * @return False if a binary is missing or does not match the sources,
+     *  the build options, the device or the driver
+     */
+    bool loadProgramBinaries(uint64_t sourceHash, const std::string &options) {
+        std::vector< std::vector<char> > binaries(devices.size());
+        cl::Program::Binaries programBinaries;
+        for(unsigned int i = 0; i < devices.size(); i++) {
+            std::string key = getProgramCacheKey(devices[i], options);
+            FILE* file = fopen(getProgramCacheFileName(key).c_str(), "rb");
+            if(file == NULL)
+                return false;
+            
+            char magic[8];
+            uint64_t hash, keyLength, binarySize;
+            std::vector<char> fileKey;
+            bool valid = fread(magic, 1, 8, file) == 8 && memcmp(magic, "SWECLBIN", 8) == 0
+                && fread(&hash, sizeof(hash), 1, file) == 1 && hash == sourceHash
+                && fread(&keyLength, sizeof(keyLength), 1, file) == 1 && keyLength == key.size();
+            if(valid) {
+                fileKey.resize(key.size());
+                valid = (key.empty() || fread(&fileKey[0], 1, key.size(), file) == key.size())
+                    && std::string(fileKey.begin(), fileKey.end()) == key
+                    && fread(&binarySize, sizeof(binarySize), 1, file) == 1 && binarySize > 0;
+            }
+            if(valid) {
+                binaries[i].resize(binarySize);
+                valid = fread(&binaries[i][0], 1, binarySize, file) == binarySize;
+            }
+            fclose(file);
+            if(!valid)
+                return false;
+            
+            programBinaries.push_back(std::make_pair((const void*)&binaries[i][0], binaries[i].size()));
+        }
+        
+        try {
+            program = cl::Program(context, devices, programBinaries);
+            program.build(devices, options.c_str());
+        } catch(cl::Error &e) {
+            // e.g. a binary of an older driver version with the same version string
+            std::cerr << "WARNING: Invalid cached OpenCL program binary (" << e.err() << "), building from source" << std::endl;
+            return false;
+        }
+        return true;
+    }
+    
+    /// Store the binaries of the program of all devices in the program cache
+    /**
+     * Each file is written to a temporary file first and then renamed,
+     * so that concurrently started processes never read incomplete files.
+     * 
+     * @param sourceHash The hash of the kernel sources
+     * @param options The build options
+     */
+    void storeProgramBinaries(uint64_t sourceHash, const std::string &options) {
+        std::vector<size_t> sizes(devices.size());
+        std::vector< std::vector<char> > binaries(devices.size());
+        std::vector<char*> pointers(devices.size());
+        // the C API, since CL_PROGRAM_BINARIES requires allocated buffers
+        cl_int err = clGetProgramInfo(program(), CL_PROGRAM_BINARY_SIZES,
+            sizes.size()*sizeof(size_t), &sizes[0], NULL);
+        if(err == CL_SUCCESS) {
+            for(unsigned int i = 0; i < devices.size(); i++) {
+                binaries[i].resize(std::max(sizes[i], (size_t)1));
+                pointers[i] = &binaries[i][0];
+            }
+            err = clGetProgramInfo(program(), CL_PROGRAM_BINARIES,
+                pointers.size()*sizeof(char*), &pointers[0], NULL);
+        }
+        if(err != CL_SUCCESS) {
+            std::cerr << "WARNING: Unable to read the OpenCL program binaries (" << err << ")" << std::endl;
+            return;
+        }
+        
+        // the directory may exist already
+        mkdir(programCacheDirectory.c_str(), 0755);
+        
+        for(unsigned int i = 0; i < devices.size(); i++) {
+            if(sizes[i] == 0)
+                continue;
+            
+            std::string key = getProgramCacheKey(devices[i], options);
+            std::string fileName = getProgramCacheFileName(key);
+            char suffix[32];
+            sprintf(suffix, ".%d.tmp", (int)getpid());
+            std::string tmpFileName = fileName + suffix;
+            
+            FILE* file = fopen(tmpFileName.c_str(), "wb");
+            uint64_t keyLength = key.size(), binarySize = sizes[i];
+            bool written = file != NULL
+                && fwrite("SWECLBIN", 1, 8, file) == 8
+                && fwrite(&sourceHash, sizeof(sourceHash), 1, file) == 1
+                && fwrite(&keyLength, sizeof(keyLength), 1, file) == 1
+                && fwrite(key.data(), 1, key.size(), file) == key.size()
+                && fwrite(&binarySize, sizeof(binarySize), 1, file) == 1
+                && fwrite(&binaries[i][0], 1, sizes[i], file) == sizes[i];
+            if(file != NULL)
+                written = (fclose(file) == 0) && written;
+            
+            if(!written || rename(tmpFileName.c_str(), fileName.c_str()) != 0) {
+                std::cerr << "WARNING: Unable to write the OpenCL program cache " << fileName << std::endl;
+                remove(tmpFileName.c_str());
+            }
+        }
+    }
+    
 public:
     /// Constructor
     /**
      * @param preferredDeviceType The preferred OpenCL device type (CPU, GPU, ..)
      * @param queueProperties OpenCL queue options for device command queues
      * @param _workGroupSize The maximum work group size to use for kernel execution
+     * @param _programCacheDirectory Directory of the cached program binaries (empty = no cache)
      */
     OpenCLWrapper(  cl_device_type preferredDeviceType = 0,
                     cl_command_queue_properties queueProperties = 0,
-                    size_t _workGroupSize = 1024) : workGroupSize(_workGroupSize){
+                    size_t _workGroupSize = 1024,
+                    const std::string &_programCacheDirectory = std::string()) :
+                    programCacheDirectory(_programCacheDirectory), programFromCache(false),
+                    workGroupSize(_workGroupSize) {
         // List of available OpenCL device types, highest priority first
         deviceTypes.push_back(CL_DEVICE_TYPE_ACCELERATOR);
         deviceTypes.push_back(CL_DEVICE_TYPE_GPU);
@@ -217,6 +391,29 @@ public:
         pthread_mutex_destroy(&profilingMutex);
     }
     
+    /// Get a description of the devices in the context
+    /**
+     * @param count Number of devices to describe (0 = all devices)
+     * @return Name and driver version of each device
+     */
+    std::string getDeviceDescription(unsigned int count = 0) {
+        if(count == 0 || count > devices.size())
+            count = devices.size();
+        
+        std::ostringstream description;
+        try {
+            for(unsigned int i = 0; i < count; i++) {
+                if(i > 0)
+                    description << ", ";
+                description << devices[i].getInfo<CL_DEVICE_NAME>()
+                            << " (" << devices[i].getInfo<CL_DRIVER_VERSION>() << ")";
+            }
+        } catch(cl::Error &e) {
+            handleError(e, "Unable to query device info");
+        }
+        return description.str();
+    }
+    
     /// Get pointer to profiling info supplied to profiling callback for a certain description (kernel name)
     /**
      * @param description The description (e.g. Kernel name)
@@ -256,11 +453,31 @@ public:
         pthread_mutex_unlock(info->first);
     }
     
+    /// Build the program and create its kernels
+    /**
+     * With a program cache directory, the program is created from the cached
+     * binaries if they match the sources and the options. Otherwise, the
+     * program is built from source and its binaries are cached.
+     * 
+     * @param kernelSources The kernel sources
+     * @param options The build options
+     */
     void buildProgram(cl::Program::Sources &kernelSources, const std::string &options = std::string()) {
-        try {        
-            program = cl::Program(context, kernelSources);
-            program.build(devices, options.c_str());
+        uint64_t sourceHash = fnv1a(NULL, 0);
+        for(unsigned int i = 0; i < kernelSources.size(); i++)
+            sourceHash = fnv1a(kernelSources[i].first, kernelSources[i].second, sourceHash);
+        
+        programFromCache = !programCacheDirectory.empty() && loadProgramBinaries(sourceHash, options);
         
+        try {
+            if(!programFromCache) {
+                program = cl::Program(context, kernelSources);
+                program.build(devices, options.c_str());
+                
+                if(!programCacheDirectory.empty())
+                    storeProgramBinaries(sourceHash, options);
+            }
+            
             std::vector<cl::Kernel> _kernels;
             program.createKernels(&_kernels);
             
@@ -3,8 +3,11 @@
 
 #include <cassert>
 #include <cmath>
+#include <limits>
+#include <sys/time.h>
 
 #include "SWE_DimensionalSplittingOpenCL.hh"
+#include "OpenCLTuningCache.hh"
 #include "tools/help.hh"
 
 // Note: kernels/kernels.h is created during build process
@@ -16,10 +19,17 @@ SWE_DimensionalSplittingOpenCL::SWE_DimensionalSplittingOpenCL(int l_nx, int l_n
     cl_device_type preferredDeviceType,
     unsigned int maxDevices,
     KernelType _kernelType,
-    size_t _workGroupSize):
+    size_t _workGroupSize,
+    bool _deviceTimestep,
+    bool _fusedReduction,
+    const std::string &programCacheDirectory):
     SWE_Block(l_nx, l_ny, l_dx, l_dy),
-    OpenCLWrapper(preferredDeviceType, getCommandQueueProperties(), _workGroupSize),
-    kernelType(_kernelType)
+    OpenCLWrapper(preferredDeviceType, getCommandQueueProperties(), _workGroupSize, programCacheDirectory),
+    balancedDevices(false),
+    kernelType(_kernelType),
+    fusedReduction(_fusedReduction),
+    deviceTimestep(_deviceTimestep),
+    simulatedTimesteps(0)
 {
     cl::Program::Sources kernelSources;
     getKernelSources(kernelSources);
@@ -41,13 +51,22 @@ SWE_DimensionalSplittingOpenCL::SWE_DimensionalSplittingOpenCL(int l_nx, int l_n
         reduceOpts = std::string("-D GLOBAL_REDUCE ");
     }
     
+    if(fusedReduction) {
+        // reduce within the sweep kernels
+        reduceOpts = std::string("-D ATOMIC_REDUCE ");
+    }
+    
 #ifdef NDEBUG
     std::string debugOpts = std::string(" ");
 #else
     std::string debugOpts = std::string("-D DEBUG ");
 #endif
     
-    std::string options = memOpts + debugOpts + reduceOpts;
+    std::string timestepOpts;
+    if(deviceTimestep)
+        timestepOpts = std::string("-D DEVICE_TIMESTEP ");
+    
+    std::string options = memOpts + debugOpts + reduceOpts + timestepOpts;
     
     buildProgram(kernelSources, options);
     
@@ -56,6 +75,9 @@ SWE_DimensionalSplittingOpenCL::SWE_DimensionalSplittingOpenCL(int l_nx, int l_n
     else
         useDevices = std::min((size_t)maxDevices, devices.size());
     
+    // Buffers are copied from/to the host as contiguous columns
+    assert(h.getLeadingDimension() == h.getRows());
+    
     createBuffers();
 }
 
@@ -75,6 +97,9 @@ void SWE_DimensionalSplittingOpenCL::printDeviceInformation()
         case CL_DEVICE_TYPE_DEFAULT:
             std::cout << "DEFAULT";
             break;
+        case CL_DEVICE_TYPE_ALL:
+            std::cout << "ALL";
+            break;
         default:
             std::cout << "UNKNOWN";
     }
@@ -99,12 +124,21 @@ void SWE_DimensionalSplittingOpenCL::printDeviceInformation()
     std::cout << " memory." << std::endl;
     
     std::cout << "Using ";
-    if(kernelReduceType == MEM_GLOBAL) std::cout << "global";
+    if(fusedReduction) std::cout << "fused";
+    else if(kernelReduceType == MEM_GLOBAL) std::cout << "global";
     else std::cout << "local";
     std::cout << " maximum reduction." << std::endl;
     
+    std::cout << "Computing the time step on the ";
+    if(deviceTimestep) std::cout << "device";
+    else std::cout << "host";
+    std::cout << "." << std::endl;
+    
     if(kernelType == MEM_LOCAL)
         std::cout << "Maximum work group size: " << workGroupSize << std::endl;
+    
+    if(programFromCache)
+        std::cout << "Using cached program binaries from " << programCacheDirectory << "." << std::endl;
     std::cout << std::endl;
 }
 
@@ -226,7 +260,20 @@ void SWE_DimensionalSplittingOpenCL::reduceMaximum(cl::CommandQueue &queue, cl::
     queue.flush();
 }
 
-void SWE_DimensionalSplittingOpenCL::calculateBufferChunks(size_t cols, size_t deviceCount) {
+void SWE_DimensionalSplittingOpenCL::resetMaximum(unsigned int i, std::vector<cl::Event> &waitList)
+{
+    // Zero is the neutral element for the (non-negative) wave speeds
+    static const cl_float zero = 0.f;
+    
+    cl::Event e;
+    queues[i].enqueueWriteBuffer(waveSpeeds[i], CL_FALSE, 0, sizeof(cl_float), &zero, &waitList, &e);
+    addProfilingEvent(e, "reset maxWaveSpeed");
+    
+    waitList.clear();
+    waitList.push_back(e);
+}
+
+void SWE_DimensionalSplittingOpenCL::calculateBufferChunks(size_t cols, size_t deviceCount, const std::vector<float> &weights) {
     
     /**
     Example: 11 Columns, 3 Devices, Chunksize = 4
@@ -252,8 +299,37 @@ void SWE_DimensionalSplittingOpenCL::calculateBufferChunks(size_t cols, size_t d
     for h and hu must be copied back to the varible buffers of device 1
     and 2 respectively. Note that hv does not have to be copied since 
     the overlapping net updates only affect the X-Sweep (and not the Y-Sweep)
+    
+    With weights, the edges are split proportionally to the weights,
+    every device gets at least MIN_CHUNK_EDGES edges.
     */
     
+    if(weights.size() >= deviceCount && deviceCount > 1 && cols-1 >= deviceCount*MIN_CHUNK_EDGES) {
+        float total = 0.f;
+        for(size_t j = 0; j < deviceCount; j++)
+            total += weights[j];
+        
+        size_t start = 0;
+        float accumulated = 0.f;
+        chunkSize = 0;
+        for(size_t j = 0; j < deviceCount; j++) {
+            accumulated += weights[j];
+            size_t end = cols-1;
+            if(j < deviceCount-1) {
+                end = static_cast <size_t> (float(cols-1) * accumulated / total + .5f);
+                // leave enough edges for the remaining devices
+                end = std::max(end, start + MIN_CHUNK_EDGES);
+                end = std::min(end, cols-1 - (deviceCount-1-j)*MIN_CHUNK_EDGES);
+            }
+            
+            bufferChunks.push_back( std::make_pair(start, end-start+1) );
+            chunkSize = std::max(chunkSize, (unsigned int)(end-start));
+            
+            start = end;
+        }
+        return;
+    }
+    
     chunkSize = static_cast <size_t> (std::ceil(float(cols) / deviceCount));
     
     size_t start = 0;
@@ -270,11 +346,42 @@ void SWE_DimensionalSplittingOpenCL::calculateBufferChunks(size_t cols, size_t d
 }
 
 void SWE_DimensionalSplittingOpenCL::createBuffers()
+{
+    calculateBufferChunks(h.getCols(), useDevices);
+    
+    createChunkBuffers();
+    
+    if(deviceTimestep) {
+        try {
+            for(unsigned int i = 0; i < useDevices; i++) {
+                timesteps.push_back(cl::Buffer(context, CL_MEM_READ_WRITE, TIMESTEP_SIZE*sizeof(cl_float)));
+                timestepCounts.push_back(cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(cl_uint)));
+            }
+            maxWaveSpeeds = cl::Buffer(context, CL_MEM_READ_WRITE, useDevices*sizeof(cl_float));
+        } catch(cl::Error &e) {
+            handleError(e, "Unable to create time step buffers");
+        }
+    }
+}
+
+void SWE_DimensionalSplittingOpenCL::createChunkBuffers()
 {
     size_t y = h.getRows();
     size_t colSize = y * sizeof(cl_float);
     
-    calculateBufferChunks(h.getCols(), useDevices);
+    hd.clear();
+    hud.clear();
+    hvd.clear();
+    bd.clear();
+    hNetUpdatesLeft.clear();
+    hNetUpdatesRight.clear();
+    huNetUpdatesLeft.clear();
+    huNetUpdatesRight.clear();
+    waveSpeeds.clear();
+    for(int edge = 0; edge < EDGE_NONE; edge++) {
+        edgeSendBuffers[edge].clear();
+        edgeReceiveBuffers[edge].clear();
+    }
     
     for(unsigned int i = 0; i < useDevices; i++) {
         size_t size = colSize * bufferChunks[i].second;
@@ -299,10 +406,12 @@ void SWE_DimensionalSplittingOpenCL::createBuffers()
         }
         
         if(i < useDevices-1) {
-            // create edge copy buffers
+            // create the edge buffers between device i and i+1 (two columns each)
             try {
-                hNetUpdatesLeftEdgeCopy.push_back(cl::Buffer(context, CL_MEM_READ_WRITE, colSize));
-                huNetUpdatesLeftEdgeCopy.push_back(cl::Buffer(context, CL_MEM_READ_WRITE, colSize));
+                for(int edge = 0; edge < EDGE_NONE; edge++) {
+                    edgeSendBuffers[edge].push_back(cl::Buffer(context, CL_MEM_READ_WRITE, 2*colSize));
+                    edgeReceiveBuffers[edge].push_back(cl::Buffer(context, CL_MEM_READ_WRITE, 2*colSize));
+                }
             } catch(cl::Error &e) {
                 handleError(e, "Unable to create edge copy buffers");
             }
@@ -310,6 +419,268 @@ void SWE_DimensionalSplittingOpenCL::createBuffers()
     }
 }
 
+void SWE_DimensionalSplittingOpenCL::enqueueBoundaryFirst(unsigned int i, cl::Kernel &k,
+    const cl::NDRange &globalRange, const cl::NDRange &localRange, EdgeExchange edge,
+    std::vector<cl::Event> *waitList, cl::Event &boundaryEvent, cl::Event &edgeEvent, cl::Event &event,
+    const char* name)
+{
+    size_t columns = globalRange[0];
+    size_t rows = globalRange[1];
+    // the boundary is one work group wide, the offsets must be multiples of the group size
+    size_t width = (localRange.dimensions() > 0) ? localRange[0] : 1;
+    
+    if(edge == EDGE_NONE || columns <= width) {
+        queues[i].enqueueNDRangeKernel(k, cl::NullRange, globalRange, localRange, waitList, &event);
+        addProfilingEvent(event, name);
+        boundaryEvent = event;
+        if(edge != EDGE_NONE)
+            enqueueEdgeGather(i, edge, edgeEvent);
+        return;
+    }
+    
+    // the net updates of the first edge are sent to the previous device,
+    // the unknowns of the last column to the next device
+    size_t boundaryOffset = (edge == EDGE_NET_UPDATES) ? 0 : columns-width;
+    size_t interiorOffset = (edge == EDGE_NET_UPDATES) ? width : 0;
+    
+    queues[i].enqueueNDRangeKernel(k, cl::NDRange(boundaryOffset, 0), cl::NDRange(width, rows), localRange, waitList, &boundaryEvent);
+    addProfilingEvent(boundaryEvent, name);
+    enqueueEdgeGather(i, edge, edgeEvent);
+    // start the boundary (and the transfers waiting for it) while the interior is enqueued
+    queues[i].flush();
+    
+    // the interior follows the boundary in the in-order queue
+    queues[i].enqueueNDRangeKernel(k, cl::NDRange(interiorOffset, 0), cl::NDRange(columns-width, rows), localRange, NULL, &event);
+    addProfilingEvent(event, name);
+}
+
+void SWE_DimensionalSplittingOpenCL::enqueueEdgeGather(unsigned int i, EdgeExchange edge, cl::Event &event)
+{
+    size_t y = h.getRows();
+    size_t colSize = y*sizeof(cl_float);
+    cl::Event e;
+    
+    if(edge == EDGE_NET_UPDATES) {
+        // first edge of device i, sent to device i-1
+        cl::Kernel *k = &(kernels["writeNetUpdatesEdgeCopy"]);
+        k->setArg(0, hNetUpdatesLeft[i]);
+        k->setArg(1, huNetUpdatesLeft[i]);
+        k->setArg(2, edgeSendBuffers[edge][i-1]);
+        k->setArg(3, (unsigned int)bufferChunks[i].second);
+        queues[i].enqueueNDRangeKernel(*k, cl::NullRange, cl::NDRange(y), cl::NullRange, NULL, &event);
+        addProfilingEvent(event, "writeNetUpdatesEdgeCopy");
+        return;
+    }
+    
+    // last column of device i, sent to device i+1
+    // (hv is not updated in the X-Sweep, hu not in the Y-Sweep)
+    size_t offset = (bufferChunks[i].second-1)*colSize;
+    cl::Buffer &momentum = (edge == EDGE_X_UPDATE) ? hud[i] : hvd[i];
+    queues[i].enqueueCopyBuffer(hd[i], edgeSendBuffers[edge][i], offset, 0, colSize, NULL, &e);
+    addProfilingEvent(e, "write edge copy");
+    queues[i].enqueueCopyBuffer(momentum, edgeSendBuffers[edge][i], offset, colSize, colSize, NULL, &event);
+    addProfilingEvent(event, "write edge copy");
+}
+
+void SWE_DimensionalSplittingOpenCL::enqueueEdgeTransfer(unsigned int i, EdgeExchange edge,
+    cl::Event &edgeEvent, cl::Event &event)
+{
+    size_t y = h.getRows();
+    size_t colSize = y*sizeof(cl_float);
+    unsigned int destination = (edge == EDGE_NET_UPDATES) ? i : i+1;
+    
+    // move the edge buffer to the receiving device
+    std::vector<cl::Event> copyWaitList(1, edgeEvent);
+    cl::Event e;
+    transferQueues[destination].enqueueCopyBuffer(edgeSendBuffers[edge][i], edgeReceiveBuffers[edge][i],
+        0, 0, 2*colSize, &copyWaitList, &e);
+    addProfilingEvent(e, "copy edges");
+    transferQueues[destination].flush();
+    
+    copyWaitList.clear();
+    copyWaitList.push_back(e);
+    
+    if(edge == EDGE_NET_UPDATES) {
+        // last edge of device i
+        cl::Kernel *k = &(kernels["readNetUpdatesEdgeCopy"]);
+        k->setArg(0, hNetUpdatesLeft[i]);
+        k->setArg(1, huNetUpdatesLeft[i]);
+        k->setArg(2, edgeReceiveBuffers[edge][i]);
+        k->setArg(3, (unsigned int)bufferChunks[i].second);
+        queues[i].enqueueNDRangeKernel(*k, cl::NullRange, cl::NDRange(y), cl::NullRange, &copyWaitList, &event);
+        addProfilingEvent(event, "readNetUpdatesEdgeCopy");
+    } else {
+        // first column of device i+1
+        cl::Buffer &momentum = (edge == EDGE_X_UPDATE) ? hud[i+1] : hvd[i+1];
+        queues[i+1].enqueueCopyBuffer(edgeReceiveBuffers[edge][i], hd[i+1], 0, 0, colSize, &copyWaitList, &e);
+        addProfilingEvent(e, "read edge copy");
+        queues[i+1].enqueueCopyBuffer(edgeReceiveBuffers[edge][i], momentum, colSize, 0, colSize, NULL, &event);
+        addProfilingEvent(event, "read edge copy");
+    }
+    queues[destination].flush();
+}
+
+size_t SWE_DimensionalSplittingOpenCL::enqueueXSweep(unsigned int i, std::vector<cl::Event> &waitList,
+    cl::Event &boundaryEvent, cl::Event &edgeEvent, cl::Event &event)
+{
+    cl::Kernel *k = &(kernels["dimensionalSplitting_XSweep_netUpdates"]);
+    size_t y = h.getRows();
+    size_t length = bufferChunks[i].second;
+    
+    size_t groupSize, globalSize;
+    cl::NDRange globalRange, localRange;
+    if(kernelType == MEM_LOCAL || fusedReduction) {
+        groupSize = getKernelGroupSize(*k, devices[i]);
+        globalSize = getKernelRange(groupSize, length-1);
+        globalRange = cl::NDRange(globalSize, y);
+        localRange = cl::NDRange(groupSize, 1);
+    } else {
+        groupSize = 1;
+        globalSize = length-1;
+        globalRange = cl::NDRange(length-1, y);
+        localRange = cl::NullRange;
+    }
+    k->setArg(0, hd[i]);
+    k->setArg(1, hud[i]);
+    k->setArg(2, bd[i]);
+    k->setArg(3, hNetUpdatesLeft[i]);
+    k->setArg(4, hNetUpdatesRight[i]);
+    k->setArg(5, huNetUpdatesLeft[i]);
+    k->setArg(6, huNetUpdatesRight[i]);
+    k->setArg(7, waveSpeeds[i]);
+    if(kernelType == MEM_LOCAL) {
+        k->setArg(8, cl::__local((groupSize+1)*sizeof(cl_float)));
+        k->setArg(9, cl::__local((groupSize+1)*sizeof(cl_float)));
+        k->setArg(10, cl::__local((groupSize+1)*sizeof(cl_float)));
+        k->setArg(11, cl::__local(groupSize*sizeof(cl_float)));
+        k->setArg(12, cl::__local(groupSize*sizeof(cl_float)));
+        k->setArg(13, cl::__local(groupSize*sizeof(cl_float)));
+        k->setArg(14, cl::__local(groupSize*sizeof(cl_float)));
+        k->setArg(15, cl::__local(groupSize*sizeof(cl_float)));
+        k->setArg(16, (unsigned int)length-1);
+        k->setArg(17, (unsigned int)y);
+    } else {
+        k->setArg(8, (unsigned int)length-1);
+        if(fusedReduction)
+            k->setArg(9, cl::__local(groupSize*sizeof(cl_float)));
+    }
+    
+    // the net updates at the left edge are copied to the previous device
+    enqueueBoundaryFirst(i, *k, globalRange, localRange, (i > 0) ? EDGE_NET_UPDATES : EDGE_NONE,
+        &waitList, boundaryEvent, edgeEvent, event, "X-Sweep");
+    
+    if(kernelReduceType == MEM_LOCAL) {
+        // local reduction
+        return y * globalSize/groupSize;
+    } else {
+        // global reduction
+        return (length-1) * y;
+    }
+}
+
+void SWE_DimensionalSplittingOpenCL::balanceDevices()
+{
+    balancedDevices = true;
+    if(useDevices < 2)
+        return;
+    
+    // Edges per nanosecond of each device
+    std::vector<float> throughput;
+    try {
+        // Fastest X-Sweep of each device (the first one may include a lazy kernel compilation)
+        std::vector<cl_ulong> sweepTime(useDevices, 0);
+        for(unsigned int run = 0; run < BALANCE_RUNS; run++) {
+            std::vector<cl::Event> firstEvents(useDevices), edgeEvents(useDevices), events(useDevices);
+            for(unsigned int i = 0; i < useDevices; i++) {
+                enqueueXSweep(i, stepEvents, firstEvents[i], edgeEvents[i], events[i]);
+                queues[i].flush();
+            }
+            cl::Event::waitForEvents(events);
+            
+            for(unsigned int i = 0; i < useDevices; i++) {
+                cl_ulong time = events[i].getProfilingInfo<CL_PROFILING_COMMAND_END>()
+                    - firstEvents[i].getProfilingInfo<CL_PROFILING_COMMAND_START>();
+                if(run == 0 || time < sweepTime[i])
+                    sweepTime[i] = time;
+            }
+        }
+        
+        for(unsigned int i = 0; i < useDevices; i++) {
+            if(sweepTime[i] == 0)
+                // no profiling information, keep the equal split
+                return;
+            throughput.push_back(float(bufferChunks[i].second-1) / sweepTime[i]);
+        }
+    } catch(cl::Error &e) {
+        handleError(e, "Unable to measure the device throughput");
+    }
+    
+    std::vector< std::pair<size_t, size_t> > equalChunks(bufferChunks);
+    bufferChunks.clear();
+    calculateBufferChunks(h.getCols(), useDevices, throughput);
+    if(bufferChunks == equalChunks)
+        return;
+    
+    // Move the unknowns to the weighted buffer chunks
+    std::vector< std::pair<size_t, size_t> > weightedChunks(bufferChunks);
+    bufferChunks = equalChunks;
+    synchBeforeRead();
+    
+    bufferChunks = weightedChunks;
+    createChunkBuffers();
+    synchAfterWrite();
+}
+
+void SWE_DimensionalSplittingOpenCL::enqueueComputeTimestep(std::vector<cl::Event> &waitList)
+{
+    // Gather the maximum of each device (first element after the reduction),
+    // the copies are chained because they write to the same buffer
+    std::vector<cl::Event> copyEvents;
+    for(unsigned int i = 0; i < useDevices; i++) {
+        std::vector<cl::Event> copyWaitList(1, waitList[i]);
+        if(i > 0)
+            copyWaitList.push_back(copyEvents.back());
+        cl::Event e;
+        queues[i].enqueueCopyBuffer(waveSpeeds[i], maxWaveSpeeds, 0, i*sizeof(cl_float), sizeof(cl_float), &copyWaitList, &e);
+        addProfilingEvent(e, "gather maxWaveSpeed");
+        copyEvents.push_back(e);
+    }
+    
+    waitList.clear();
+    
+    // Every device computes the same time step in its own buffer
+    cl::Kernel *k = &(kernels["computeTimestep"]);
+    for(unsigned int i = 0; i < useDevices; i++) {
+        k->setArg(0, maxWaveSpeeds);
+        k->setArg(1, useDevices);
+        k->setArg(2, dx);
+        k->setArg(3, dy);
+        k->setArg(4, timesteps[i]);
+        k->setArg(5, timestepCounts[i]);
+        
+        cl::Event e;
+        queues[i].enqueueNDRangeKernel(*k, cl::NullRange, cl::NDRange(1), cl::NullRange, &copyEvents, &e);
+        addProfilingEvent(e, "compute timestep");
+        waitList.push_back(e);
+    }
+}
+
+void SWE_DimensionalSplittingOpenCL::writeTimestep(float tStart, float tEnd)
+{
+    cl_float timestep[TIMESTEP_SIZE] = {0};
+    cl_uint steps = 0;
+    
+    timestep[TIMESTEP_TIME] = tStart;
+    timestep[TIMESTEP_END] = tEnd;
+    for(unsigned int i = 0; i < useDevices; i++) {
+        cl::Event e;
+        queues[i].enqueueWriteBuffer(timesteps[i], CL_TRUE, 0, sizeof(timestep), timestep, &stepEvents, &e);
+        addProfilingEvent(e, "write timestep");
+        queues[i].enqueueWriteBuffer(timestepCounts[i], CL_TRUE, 0, sizeof(steps), &steps, NULL, &e);
+        addProfilingEvent(e, "write timestep count");
+    }
+}
+
 void SWE_DimensionalSplittingOpenCL::setBoundaryConditions()
 {
     cl::Kernel *k;
@@ -317,6 +688,7 @@ void SWE_DimensionalSplittingOpenCL::setBoundaryConditions()
     cl::Event event;
     
     // Set boundary conditions at top and bottom boundary
+    // (after the previous time step if it was not waited for)
     k = &(kernels["setBottomTopBoundary"]);
     for(unsigned int i = 0; i < useDevices; i++) {
         try {
@@ -332,7 +704,7 @@ void SWE_DimensionalSplittingOpenCL::setBoundaryConditions()
         
         size_t length = bufferChunks[i].second;
         try {
-            queues[i].enqueueNDRangeKernel(*k, cl::NullRange, cl::NDRange(length), cl::NullRange, NULL, &event);
+            queues[i].enqueueNDRangeKernel(*k, cl::NullRange, cl::NDRange(length), cl::NullRange, &stepEvents, &event);
             addProfilingEvent(event, "set top/bottom boundary");
         } catch(cl::Error &e) {
             handleError(e, "Unable to enqueue setBottomTopBoundary kernel");
@@ -385,7 +757,10 @@ void SWE_DimensionalSplittingOpenCL::setBoundaryConditions()
     for(unsigned int i = 0; i < useDevices; i++)
         queues[i].flush();
     
-    cl::Event::waitForEvents(waitList);
+    if(deviceTimestep)
+        stepEvents = waitList;
+    else
+        cl::Event::waitForEvents(waitList);
 }
 
 void SWE_DimensionalSplittingOpenCL::syncBuffersBeforeRead(std::vector< std::pair< std::vector<cl::Buffer>*, float*> > &buffers) {
@@ -400,7 +775,7 @@ void SWE_DimensionalSplittingOpenCL::syncBuffersBeforeRead(std::vector< std::pai
             size_t length = bufferChunks[j].second;
             size_t size = ((j == useDevices-1) ? length : (length-1)) * colSize;
             float* dst = buffers[i].second + (start*y);
-            queues[j].enqueueReadBuffer((*buffers[i].first)[j], CL_FALSE, 0, size, dst, NULL, &event);
+            queues[j].enqueueReadBuffer((*buffers[i].first)[j], CL_FALSE, 0, size, dst, &stepEvents, &event);
             addProfilingEvent(event, "sync before read");
             events.push_back(event);
         }
@@ -422,7 +797,7 @@ void SWE_DimensionalSplittingOpenCL::syncBuffersAfterWrite(std::vector< std::pai
             size_t length = bufferChunks[j].second;
             size_t size = length * colSize;
             float* src = buffers[i].second + (start*y);
-            queues[j].enqueueWriteBuffer((*buffers[i].first)[j], CL_FALSE, 0, size, src, NULL, &event);
+            queues[j].enqueueWriteBuffer((*buffers[i].first)[j], CL_FALSE, 0, size, src, &stepEvents, &event);
             addProfilingEvent(event, "sync after write");
             events.push_back(event);
         }
@@ -498,6 +873,10 @@ void SWE_DimensionalSplittingOpenCL::synchBathymetryBeforeRead()
 
 void SWE_DimensionalSplittingOpenCL::computeNumericalFluxes()
 {
+    // Weight the split by the device throughput (first time step only)
+    if(!balancedDevices)
+        balanceDevices();
+    
     // Pointer to kernel object
     cl::Kernel *k;
     // Number of rows
@@ -510,127 +889,58 @@ void SWE_DimensionalSplittingOpenCL::computeNumericalFluxes()
     // Event waitlist for various kernel enqueues
     std::vector<cl::Event> waitList;
     // Device specific event waitList
-    std::vector< std::vector<cl::Event> > deviceWaitList;
-    for(unsigned int i = 0; i < useDevices; i++)
-        deviceWaitList.push_back(std::vector<cl::Event>());
+    std::vector< std::vector<cl::Event> > deviceWaitList(useDevices);
+    // Events of the boundary columns, of writing the edge buffers and of the last kernel of each device
+    std::vector<cl::Event> boundaryEvents(useDevices), edgeEvents(useDevices), kernelEvents(useDevices);
     
     try {
         // enqueue X-Sweep Kernel
-        k = &(kernels["dimensionalSplitting_XSweep_netUpdates"]);
-        
         for(unsigned int i = 0; i < useDevices; i++) {
+            std::vector<cl::Event> sweepWaitList(stepEvents);
+            if(fusedReduction)
+                resetMaximum(i, sweepWaitList);
             
-            length = bufferChunks[i].second;
-            
-            size_t groupSize, globalSize;
-            cl::NDRange globalRange, localRange;
-            if(kernelType == MEM_LOCAL) {
-                groupSize = getKernelGroupSize(*k, devices[i]);
-                globalSize = getKernelRange(groupSize, length-1);
-                globalRange = cl::NDRange(globalSize, y);
-                localRange = cl::NDRange(groupSize, 1);
-            } else {
-                globalRange = cl::NDRange(length-1, y);
-                localRange = cl::NullRange;
-            }
-            k->setArg(0, hd[i]);
-            k->setArg(1, hud[i]);
-            k->setArg(2, bd[i]);
-            k->setArg(3, hNetUpdatesLeft[i]);
-            k->setArg(4, hNetUpdatesRight[i]);
-            k->setArg(5, huNetUpdatesLeft[i]);
-            k->setArg(6, huNetUpdatesRight[i]);
-            k->setArg(7, waveSpeeds[i]);
-            if(kernelType == MEM_LOCAL) {
-                k->setArg(8, cl::__local((groupSize+1)*sizeof(cl_float)));
-                k->setArg(9, cl::__local((groupSize+1)*sizeof(cl_float)));
-                k->setArg(10, cl::__local((groupSize+1)*sizeof(cl_float)));
-                k->setArg(11, cl::__local(groupSize*sizeof(cl_float)));
-                k->setArg(12, cl::__local(groupSize*sizeof(cl_float)));
-                k->setArg(13, cl::__local(groupSize*sizeof(cl_float)));
-                k->setArg(14, cl::__local(groupSize*sizeof(cl_float)));
-                k->setArg(15, cl::__local(groupSize*sizeof(cl_float)));
-                k->setArg(16, (unsigned int)length-1);
-                k->setArg(17, (unsigned int)y);
-            }
-            
-            cl::Event sweepEvent;
-            queues[i].enqueueNDRangeKernel(*k, cl::NullRange, globalRange, localRange, NULL, &sweepEvent);
-            addProfilingEvent(sweepEvent, "X-Sweep");
+            size_t maxWaveSpeedLength = enqueueXSweep(i, sweepWaitList, boundaryEvents[i], edgeEvents[i], kernelEvents[i]);
             
-            // reduce waveSpeed Maximum
-            cl::Event maximumEvent;
-            size_t maxWaveSpeedLength;
-            if(kernelReduceType == MEM_LOCAL) {
-                // local reduction
-                maxWaveSpeedLength = y * globalSize/groupSize;
+            if(fusedReduction) {
+                // the maximum has been reduced by the sweep
+                waitList.push_back(kernelEvents[i]);
             } else {
-                // global reduction
-                maxWaveSpeedLength = (length-1) * y;
+                // reduce waveSpeed Maximum
+                cl::Event maximumEvent;
+                reduceMaximum(queues[i], waveSpeeds[i], maxWaveSpeedLength, &kernelEvents[i], &maximumEvent);
+                waitList.push_back(maximumEvent);
             }
-            reduceMaximum(queues[i], waveSpeeds[i], maxWaveSpeedLength, &sweepEvent, &maximumEvent);
-            waitList.push_back(maximumEvent);
         }
         
-        cl::Event::waitForEvents(waitList);
-        waitList.clear();
-        
-        // Read maximum
-        float maxWaveSpeed = -INFINITY;
-        for(unsigned int i = 0; i < useDevices; i++) {
-            float result;
+        // Copy the net updates at the first edge of device n+1 to device n
+        // (on the transfer queues while the interior and the maximum are computed),
+        // the X-Update of device n follows in its queue
+        for(unsigned int i = 0; i < useDevices-1; i++) {
             cl::Event e;
-            queues[i].enqueueReadBuffer(waveSpeeds[i], CL_TRUE, 0, sizeof(cl_float), &result, NULL, &e);
-            addProfilingEvent(e, "read maxWaveSpeed (X)");
-            maxWaveSpeed = std::max(maxWaveSpeed, result);
+            enqueueEdgeTransfer(i, EDGE_NET_UPDATES, edgeEvents[i+1], e);
         }
         
-        // calculate maximum timestep
-        maxTimestep = dx/maxWaveSpeed * 0.4f;
-        
-        // Copy net update buffers at edges from device n+1 to device n
-        for(unsigned int i = 0; i < useDevices-1; i++) {            
-            cl::Event e;
-            std::vector<cl::Event> copyWaitListH, copyWaitListHu;
-            unsigned int cols;
-            
-            cols = (unsigned int)bufferChunks[i+1].second;
-            k = &(kernels["writeNetUpdatesEdgeCopy"]);
-            // READ MEMORY TO EDGE COPY ON DEVICE i+1
-            // write h
-            k->setArg(0, hNetUpdatesLeft[i+1]);
-            k->setArg(1, hNetUpdatesLeftEdgeCopy[i]);
-            k->setArg(2, cols);
-            queues[i+1].enqueueNDRangeKernel(*k, cl::NullRange, cl::NDRange(h.getRows()), cl::NullRange, NULL, &e);
-            addProfilingEvent(e, "writeNetUpdatesEdgeCopy");
-            copyWaitListH.push_back(e);
-            
-            // write hu
-            k->setArg(0, huNetUpdatesLeft[i+1]);
-            k->setArg(1, huNetUpdatesLeftEdgeCopy[i]);
-            k->setArg(2, cols);
-            queues[i+1].enqueueNDRangeKernel(*k, cl::NullRange, cl::NDRange(h.getRows()), cl::NullRange, NULL, &e);
-            addProfilingEvent(e, "writeNetUpdatesEdgeCopy");
-            copyWaitListHu.push_back(e);
-            
-            // READ EDGE COPY ON DEVICE i INTO MEMORY
-            cols = (unsigned int)bufferChunks[i].second;
-            k = &(kernels["readNetUpdatesEdgeCopy"]);
-            // read h
-            k->setArg(0, hNetUpdatesLeft[i]);
-            k->setArg(1, hNetUpdatesLeftEdgeCopy[i]);
-            k->setArg(2, cols);
-            queues[i].enqueueNDRangeKernel(*k, cl::NullRange, cl::NDRange(h.getRows()), cl::NullRange, &copyWaitListH, &e);
-            addProfilingEvent(e, "readNetUpdatesEdgeCopy");
-            deviceWaitList[i].push_back(e);
+        float maxWaveSpeed = -INFINITY;
+        if(deviceTimestep) {
+            // the update kernels read the time step from the device buffer
+            enqueueComputeTimestep(waitList);
+            waitList.clear();
+        } else {
+            cl::Event::waitForEvents(waitList);
+            waitList.clear();
             
-            // read hu
-            k->setArg(0, huNetUpdatesLeft[i]);
-            k->setArg(1, huNetUpdatesLeftEdgeCopy[i]);
-            k->setArg(2, cols);
-            queues[i].enqueueNDRangeKernel(*k, cl::NullRange, cl::NDRange(h.getRows()), cl::NullRange, &copyWaitListHu, &e);
-            addProfilingEvent(e, "readNetUpdatesEdgeCopy");
-            deviceWaitList[i].push_back(e);
+            // Read maximum
+            for(unsigned int i = 0; i < useDevices; i++) {
+                float result;
+                cl::Event e;
+                queues[i].enqueueReadBuffer(waveSpeeds[i], CL_TRUE, 0, sizeof(cl_float), &result, NULL, &e);
+                addProfilingEvent(e, "read maxWaveSpeed (X)");
+                maxWaveSpeed = std::max(maxWaveSpeed, result);
+            }
+            
+            // calculate maximum timestep
+            maxTimestep = dx/maxWaveSpeed * 0.4f;
         }
         
         // enqueue updateUnknowns Kernel (X-Sweep)
@@ -651,7 +961,10 @@ void SWE_DimensionalSplittingOpenCL::computeNumericalFluxes()
                 localRange = cl::NullRange;
             }
             
-            k->setArg(0, dt_dx);
+            if(deviceTimestep)
+                k->setArg(0, timesteps[i]);
+            else
+                k->setArg(0, dt_dx);
             k->setArg(1, hd[i]);
             k->setArg(2, hud[i]);
             k->setArg(3, hNetUpdatesLeft[i]);
@@ -667,33 +980,24 @@ void SWE_DimensionalSplittingOpenCL::computeNumericalFluxes()
                 k->setArg(12, cl::__local(groupSize*sizeof(cl_float)));
                 k->setArg(13, (unsigned int)length-1);
                 k->setArg(14, (unsigned int)y);
+            } else {
+                k->setArg(7, (unsigned int)length-1);
             }
             
-            cl::Event e;
-            queues[i].enqueueNDRangeKernel(*k, cl::NullRange, globalRange, localRange, &deviceWaitList[i], &e);
-            addProfilingEvent(e, "X-Update");
-            waitList.push_back(e);
+            // the last columns are copied to the next device
+            enqueueBoundaryFirst(i, *k, globalRange, localRange, (i < useDevices-1) ? EDGE_X_UPDATE : EDGE_NONE,
+                NULL, boundaryEvents[i], edgeEvents[i], kernelEvents[i], "X-Update");
         }
         
-        // Copy updates edges between buffers from device n to n+1
+        // Copy the last column of device n to device n+1
+        // (on the transfer queues while the interior of device n is updated),
+        // it is written after the X-Update of device n+1
+        // Note that we do not need to copy hvd, since vertical momentum is not updated in the X-Sweep
         for(unsigned int i = 0; i < useDevices-1; i++) {
-            // We're initiating a copy from device n (to fetch data from device n+1)
-            length = bufferChunks[i].second;
-            size_t offset = (length-1)*colSize;
             cl::Event e;
-            deviceWaitList[i+1].clear();
-            
-            queues[i+1].enqueueCopyBuffer(hd[i], hd[i+1], offset, 0, colSize, &waitList, &e);
-            deviceWaitList[i+1].push_back(e);
-            addProfilingEvent(e, "copy edges");
-            queues[i+1].enqueueCopyBuffer(hud[i], hud[i+1], offset, 0, colSize, &waitList, &e);
-            deviceWaitList[i+1].push_back(e);
-            addProfilingEvent(e, "copy edges");
-            // Note that we do not need to copy hvd, since vertical momentum is not updated in the X-Sweep
+            enqueueEdgeTransfer(i, EDGE_X_UPDATE, edgeEvents[i], e);
         }
         
-        waitList.clear();
-        
         // enqueue Y-Sweep Kernel
         k = &(kernels["dimensionalSplitting_YSweep_netUpdates"]);
         for(unsigned int i = 0; i < useDevices; i++) {
@@ -702,7 +1006,7 @@ void SWE_DimensionalSplittingOpenCL::computeNumericalFluxes()
             
             size_t groupSize, globalSize;
             cl::NDRange globalRange, localRange;
-            if(kernelType == MEM_LOCAL) {
+            if(kernelType == MEM_LOCAL || fusedReduction) {
                 groupSize = getKernelGroupSize(*k, devices[i]);
                 globalSize = getKernelRange(groupSize, y-1);
                 globalRange = cl::NDRange(length, globalSize);
@@ -731,8 +1035,17 @@ void SWE_DimensionalSplittingOpenCL::computeNumericalFluxes()
                 k->setArg(15, cl::__local(groupSize*sizeof(cl_float)));
                 k->setArg(16, (unsigned int)length);
                 k->setArg(17, (unsigned int)y-1);
+            } else if(fusedReduction) {
+                k->setArg(8, cl::__local(groupSize*sizeof(cl_float)));
+                k->setArg(9, (unsigned int)y-1);
             }
             
+#ifndef NDEBUG
+            // the fused reduction of the Y-Sweep is only used for the CFL check
+            if(fusedReduction && !deviceTimestep)
+                resetMaximum(i, deviceWaitList[i]);
+#endif
+            
             cl::Event e;
             queues[i].enqueueNDRangeKernel(*k, cl::NullRange, globalRange, localRange, &deviceWaitList[i], &e);
             addProfilingEvent(e, "Y-Sweep");
@@ -740,42 +1053,51 @@ void SWE_DimensionalSplittingOpenCL::computeNumericalFluxes()
             deviceWaitList[i].push_back(e);
             
 #ifndef NDEBUG
-            // reduce waveSpeed Maximum
-            cl::Event maximumEvent;
-            size_t maxWaveSpeedLength;
-            if(kernelReduceType == MEM_LOCAL) {
-                // local reduction
-                maxWaveSpeedLength = length * globalSize/groupSize;
-            } else {
-                // global reduction
-                maxWaveSpeedLength = length * (y-1);
+            // reduce waveSpeed Maximum (for the CFL check on the host)
+            if(!deviceTimestep && fusedReduction) {
+                // the maximum has been reduced by the sweep
+                waitList.push_back(e);
+            } else if(!deviceTimestep) {
+                cl::Event maximumEvent;
+                size_t maxWaveSpeedLength;
+                if(kernelReduceType == MEM_LOCAL) {
+                    // local reduction
+                    maxWaveSpeedLength = length * globalSize/groupSize;
+                } else {
+                    // global reduction
+                    maxWaveSpeedLength = length * (y-1);
+                }
+                reduceMaximum(queues[i], waveSpeeds[i], maxWaveSpeedLength, &e, &maximumEvent);
+                waitList.push_back(maximumEvent);
             }
-            reduceMaximum(queues[i], waveSpeeds[i], maxWaveSpeedLength, &e, &maximumEvent);
-            waitList.push_back(maximumEvent);
 #endif
         }
         
 #ifndef NDEBUG
-        cl::Event::waitForEvents(waitList);
-        waitList.clear();
-        // Read maximum
-        float maxWaveSpeedY = -INFINITY;
-        for(unsigned int i = 0; i < useDevices; i++) {
-            float result;
-            cl::Event e;
-            queues[i].enqueueReadBuffer(waveSpeeds[i], CL_TRUE, 0, sizeof(cl_float), &result, &waitList, &e);
-            addProfilingEvent(e, "read maxWaveSpeed (Y)");
-            maxWaveSpeedY = std::max(maxWaveSpeedY, result);
-        }
-        
-        // Check CFL condition
-        float maxTimestepY = .5f * dy / maxWaveSpeed;
-        if(maxTimestepY >= maxTimestep) {
-            // OK, everything's fine
-        } else {
-            // Oops, CFL condition is NOT satisfied
-            std::cerr << "WARNING: CFL condition is not satisfied in y-sweep: "
-                      << maxTimestepY << " < " << maxTimestep << std::endl;
+        // The CFL condition can only be checked if the time step is known on the host
+        if(!deviceTimestep) {
+            cl::Event::waitForEvents(waitList);
+            waitList.clear();
+            
+            // Read maximum
+            float maxWaveSpeedY = -INFINITY;
+            for(unsigned int i = 0; i < useDevices; i++) {
+                float result;
+                cl::Event e;
+                queues[i].enqueueReadBuffer(waveSpeeds[i], CL_TRUE, 0, sizeof(cl_float), &result, &waitList, &e);
+                addProfilingEvent(e, "read maxWaveSpeed (Y)");
+                maxWaveSpeedY = std::max(maxWaveSpeedY, result);
+            }
+            
+            // Check CFL condition
+            float maxTimestepY = .5f * dy / maxWaveSpeed;
+            if(maxTimestepY >= maxTimestep) {
+                // OK, everything's fine
+            } else {
+                // Oops, CFL condition is NOT satisfied
+                std::cerr << "WARNING: CFL condition is not satisfied in y-sweep: "
+                          << maxTimestepY << " < " << maxTimestep << std::endl;
+            }
         }
 #endif
 
@@ -797,7 +1119,10 @@ void SWE_DimensionalSplittingOpenCL::computeNumericalFluxes()
                 localRange = cl::NullRange;
             }
             
-            k->setArg(0, dt_dy);
+            if(deviceTimestep)
+                k->setArg(0, timesteps[i]);
+            else
+                k->setArg(0, dt_dy);
             k->setArg(1, hd[i]);
             k->setArg(2, hvd[i]);
             k->setArg(3, hNetUpdatesLeft[i]);
@@ -815,34 +1140,29 @@ void SWE_DimensionalSplittingOpenCL::computeNumericalFluxes()
                 k->setArg(14, (unsigned int)y-1);
             }
             
-            cl::Event e;
-            queues[i].enqueueNDRangeKernel(*k, cl::NullRange, globalRange, localRange, &deviceWaitList[i], &e);
-            addProfilingEvent(e, "Y-Update");
-            waitList.push_back(e);
+            // the last column is copied to the next device
+            enqueueBoundaryFirst(i, *k, globalRange, localRange, (i < useDevices-1) ? EDGE_Y_UPDATE : EDGE_NONE,
+                &deviceWaitList[i], boundaryEvents[i], edgeEvents[i], kernelEvents[i], "Y-Update");
+            waitList.push_back(kernelEvents[i]);
         }
         
         // Copy updated edge columns after Y-Sweep so we ensure that the overlapping 
         // edge columns really have identical values
         for(unsigned int i = 0; i < useDevices-1; i++) {
-            // We're initiating a copy from device n+1 (to fetch data from device n)
-            length = bufferChunks[i].second;
-            size_t offset = (length-1)*colSize;
             cl::Event e;
-            deviceWaitList[i+1].clear();
-            
-            queues[i+1].enqueueCopyBuffer(hd[i], hd[i+1], offset, 0, colSize, &waitList, &e);
-            addProfilingEvent(e, "copy edges (after Y-update)");
-            waitList.push_back(e);
-            queues[i+1].enqueueCopyBuffer(hvd[i], hvd[i+1], offset, 0, colSize, &waitList, &e);
-            addProfilingEvent(e, "copy edges (after Y-update)");
+            enqueueEdgeTransfer(i, EDGE_Y_UPDATE, edgeEvents[i], e);
             waitList.push_back(e);
-            // Note that we do not need to copy hvd, since vertical momentum is not updated in the X-Sweep
         }
         
-        for(unsigned int i = 0; i < useDevices; i++)
+        for(unsigned int i = 0; i < useDevices; i++) {
             queues[i].flush();
+            transferQueues[i].flush();
+        }
         
-        cl::Event::waitForEvents(waitList);
+        if(deviceTimestep)
+            stepEvents = waitList;
+        else
+            cl::Event::waitForEvents(waitList);
     } catch(cl::Error &e) {
         handleError(e);
     }
@@ -862,20 +1182,174 @@ void SWE_DimensionalSplittingOpenCL::simulateTimestep(float dt)
 float SWE_DimensionalSplittingOpenCL::simulate(float tStart,float tEnd)
 {
     float t = tStart;
-    do {
-        //set values in ghost cells
-        setGhostLayer();
+    simulatedTimesteps = 0;
+    
+    if(!deviceTimestep) {
+        do {
+            //set values in ghost cells
+            setGhostLayer();
+            
+            // compute net updates for every edge
+            computeNumericalFluxes();
+            //execute a wave propagation time step
+            updateUnknowns(maxTimestep);
+            t += maxTimestep;
+            simulatedTimesteps++;
+            
+            std::cout << "Simulation at time " << t << std::endl << std::flush;
+        } while(t < tEnd);
+        
+        return t;
+    }
+    
+    // Values of the time step buffers
+    cl_float timestep[TIMESTEP_SIZE] = {0};
+    cl_uint steps = 0;
+    
+    try {
+        writeTimestep(tStart, tEnd);
+        
+        do {
+            // Estimate the remaining time steps from the last time step,
+            // superfluous time steps (after tEnd) do not change the unknowns
+            unsigned int batch = 1;
+            if(maxTimestep > 0.f) {
+                float remaining = (tEnd - t) / maxTimestep;
+                batch = MAX_QUEUED_TIMESTEPS;
+                if(remaining < batch)
+                    batch = std::max((unsigned int)std::ceil(remaining), 1u);
+            }
+            
+            for(unsigned int step = 0; step < batch; step++) {
+                //set values in ghost cells
+                setGhostLayer();
+                
+                // compute net updates and update the unknowns
+                computeNumericalFluxes();
+            }
+            
+            // Read the simulated time (waits for the time steps on the first device)
+            cl::Event e;
+            queues[0].enqueueReadBuffer(timesteps[0], CL_TRUE, 0, sizeof(timestep), timestep, NULL, &e);
+            addProfilingEvent(e, "read timestep");
+            
+            t = timestep[TIMESTEP_TIME];
+            maxTimestep = timestep[TIMESTEP_DT];
+            
+            std::cout << "Simulation at time " << t << std::endl << std::flush;
+        } while(t < tEnd);
+        
+        // Wait for all devices before the unknowns are read or written
+        cl::Event::waitForEvents(stepEvents);
+        stepEvents.clear();
+        
+        cl::Event e;
+        queues[0].enqueueReadBuffer(timestepCounts[0], CL_TRUE, 0, sizeof(steps), &steps, NULL, &e);
+        addProfilingEvent(e, "read timestep count");
+    } catch(cl::Error &e) {
+        handleError(e);
+    }
+    
+    simulatedTimesteps = steps;
+    
+    return t;
+}
+
+double SWE_DimensionalSplittingOpenCL::measureTimestep(unsigned int steps)
+{
+    timeval start, end;
+    try {
+        // as in simulate, but the end time is never reached
+        if(deviceTimestep)
+            writeTimestep(0.f, std::numeric_limits<float>::max());
         
-        // compute net updates for every edge
+        // not measured: lazy kernel compilation and device balancing
+        setGhostLayer();
         computeNumericalFluxes();
-        //execute a wave propagation time step
-        updateUnknowns(maxTimestep);
-        t += maxTimestep;
+        if(!stepEvents.empty())
+            cl::Event::waitForEvents(stepEvents);
         
-        std::cout << "Simulation at time " << t << std::endl << std::flush;
-    } while(t < tEnd);
+        gettimeofday(&start, NULL);
+        for(unsigned int step = 0; step < steps; step++) {
+            setGhostLayer();
+            computeNumericalFluxes();
+        }
+        // the last commands of all devices
+        if(!stepEvents.empty())
+            cl::Event::waitForEvents(stepEvents);
+        gettimeofday(&end, NULL);
+    } catch(cl::Error &e) {
+        handleError(e, "Unable to measure the time step");
+    }
+    
+    return ((end.tv_sec - start.tv_sec) * 1.0e9 + (end.tv_usec - start.tv_usec) * 1.0e3) / steps;
+}
 
-    return t;
+KernelConfig SWE_DimensionalSplittingOpenCL::tune(OpenCLTuningCache &cache,
+    int l_nx, int l_ny,
+    float l_dx, float l_dy,
+    SWE_Scenario &scenario,
+    float offsetX, float offsetY,
+    cl_device_type preferredDeviceType,
+    unsigned int maxDevices,
+    bool deviceTimestep,
+    bool fusedReduction,
+    const std::string &programCacheDirectory)
+{
+    std::string deviceDescription;
+    {
+        // the context is sufficient to find the cache entry
+        OpenCLWrapper wrapper(preferredDeviceType);
+        deviceDescription = wrapper.getDeviceDescription(maxDevices);
+    }
+    // the separate reduce kernels change the fastest configuration
+    std::string cacheKey = deviceDescription;
+    if(!fusedReduction)
+        cacheKey += ", separate reduction";
+    
+    KernelConfig best;
+    if(cache.find(cacheKey, l_nx, l_ny, best)) {
+        std::cout << "Using tuned kernel configuration for " << deviceDescription << std::endl;
+        return best;
+    }
+    
+    std::cout << "Tuning kernels for " << deviceDescription
+              << " (" << l_nx << " x " << l_ny << " cells):" << std::endl;
+    
+    best.kernelType = MEM_GLOBAL;
+    best.workGroupSize = MAX_TUNING_GROUP_SIZE;
+    double bestTime = 0.;
+    
+    const KernelType kernelTypes[] = {MEM_GLOBAL, MEM_LOCAL};
+    for(unsigned int t = 0; t < 2; t++) {
+        for(size_t groupSize = MIN_TUNING_GROUP_SIZE; groupSize <= MAX_TUNING_GROUP_SIZE; groupSize *= 2) {
+            SWE_DimensionalSplittingOpenCL block(l_nx, l_ny, l_dx, l_dy,
+                preferredDeviceType, maxDevices, kernelTypes[t], groupSize, deviceTimestep,
+                fusedReduction, programCacheDirectory);
+            block.initScenario(offsetX, offsetY, scenario);
+            
+            double time = block.measureTimestep(TUNING_STEPS);
+            std::cout << "    " << ((kernelTypes[t] == MEM_GLOBAL) ? "global" : "local")
+                      << " memory, work group size " << groupSize << ": "
+                      << time/1.0e3 << " us per time step" << std::endl;
+            
+            if(bestTime == 0. || time < bestTime) {
+                bestTime = time;
+                best.kernelType = kernelTypes[t];
+                best.workGroupSize = groupSize;
+            }
+            
+            // larger work groups are not supported by any device
+            size_t maxGroupSize = 0;
+            for(unsigned int i = 0; i < block.useDevices; i++)
+                maxGroupSize = std::max(maxGroupSize, block.devices[i].getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>());
+            if(groupSize >= maxGroupSize)
+                break;
+        }
+    }
+    
+    cache.store(cacheKey, l_nx, l_ny, best, bestTime);
+    return best;
 }
 
 #endif /* SWE_DIMENSIONALSPLITTINGOPENCL_CPP_ */
@@ -8,6 +8,32 @@
 //! Type to set options for kernel optimization types (e.g. memory)
 typedef enum {MEM_LOCAL, MEM_GLOBAL} KernelType;
 
+//! Kernel options found by the auto-tuning (see SWE_DimensionalSplittingOpenCL::tune)
+typedef struct {
+    KernelType kernelType;      //!< the kernel memory type
+    size_t workGroupSize;       //!< the maximum work group size
+} KernelConfig;
+
+class OpenCLTuningCache;
+
+//! Indices of the values in the time step buffer (see TIMESTEP_* in the kernels)
+typedef enum {
+    TIMESTEP_DT,        //!< the last time step
+    TIMESTEP_DT_DX,     //!< dt/dx of the current time step (0 after the end time)
+    TIMESTEP_DT_DY,     //!< dt/dy of the current time step (0 after the end time)
+    TIMESTEP_TIME,      //!< the simulated time
+    TIMESTEP_END,       //!< the end time
+    TIMESTEP_SIZE
+} TimestepIndex;
+
+//! Columns exchanged between neighbouring devices in a time step
+typedef enum {
+    EDGE_NET_UPDATES,   //!< left going h and hu net updates of the first edge of device i+1 (to device i)
+    EDGE_X_UPDATE,      //!< h and hu of the last column of device i after the X-Update (to device i+1)
+    EDGE_Y_UPDATE,      //!< h and hv of the last column of device i after the Y-Update (to device i+1)
+    EDGE_NONE           //!< no exchange (number of exchanges)
+} EdgeExchange;
+
 /**
  * OpenCL Dimensional Splitting Block
  *
@@ -34,15 +60,30 @@ protected:
     std::vector<cl::Buffer> huNetUpdatesLeft;
     //! internal buffers for hu net updates (right) on computing device
     std::vector<cl::Buffer> huNetUpdatesRight;
-    //! internal buffers for computed wavespeeds
+    //! internal buffers for computed wavespeeds (the maximum is stored in the first element)
     std::vector<cl::Buffer> waveSpeeds;
     
-    //! internal copy-buffers to copy left going h net-updates at edge from device i+1 to device i
-    std::vector<cl::Buffer> hNetUpdatesLeftEdgeCopy;
-    //! internal copy-buffers to copy left going hu net-updates at edge from device i+1 to device i
-    std::vector<cl::Buffer> huNetUpdatesLeftEdgeCopy;
+    //! edge buffers (two columns) written by the device that computes the edge columns, one per exchange and pair of devices
+    /**
+     * The kernels of a device only access its own buffers and the edge buffers.
+     * The transfer queues only copy the edge buffers, so no buffer is used
+     * by two queues at the same time.
+     */
+    std::vector<cl::Buffer> edgeSendBuffers[EDGE_NONE];
+    //! edge buffers (two columns) read by the neighbouring device, one per exchange and pair of devices
+    std::vector<cl::Buffer> edgeReceiveBuffers[EDGE_NONE];
+    
+    //! maximum wave speed of each device (device time step only)
+    cl::Buffer maxWaveSpeeds;
+    //! time step buffers (see TimestepIndex) on computing devices (device time step only)
+    std::vector<cl::Buffer> timesteps;
+    //! number of time steps (cl_uint) since the time step buffers were initialized (device time step only)
+    std::vector<cl::Buffer> timestepCounts;
+    
+    //! Events the next enqueued time step has to wait for (device time step only)
+    std::vector<cl::Event> stepEvents;
     
-    //! SubBuffer column chunk size
+    //! SubBuffer column chunk size (largest number of edges per device)
     unsigned int chunkSize;
     
     //! Buffer chunk sizes (start column index and length) for multiple devices
@@ -51,12 +92,24 @@ protected:
     //! Number of devices that should be used
     unsigned int useDevices;
     
+    //! The buffer chunks have been weighted by the measured device throughput
+    bool balancedDevices;
+    
     //! The kernel memory type to be used
     KernelType kernelType;
     
     //! The kernel type used for reductions (e.g. maxWaveSpeed reduction)
     KernelType kernelReduceType;
     
+    //! Reduce the maximum wave speed in the sweep kernels (atomically) instead of separate reduce kernels
+    bool fusedReduction;
+    
+    //! Compute the time step on the devices instead of the host
+    bool deviceTimestep;
+    
+    //! Number of time steps computed by the last call of simulate
+    unsigned int simulatedTimesteps;
+    
     /// Reduce maximum value in an OpenCL buffer (overwrites the buffer!)
     /**
      * @param queue The command queue to perform the reduction on
@@ -70,16 +123,127 @@ protected:
                         size_t length,
                         cl::Event *waitEvent = NULL,
                         cl::Event *event = NULL);
+    
+    /// Reset the maximum wave speed of a device before a fused reduction
+    /**
+     * @param i The device
+     * @param waitList Events to wait for before the reset, replaced by the
+     *  event of the reset
+     */
+    void resetMaximum(unsigned int i, std::vector<cl::Event> &waitList);
    
     /// Create OpenCL device buffers for h, hu, hv, and b variables
     void createBuffers();
     
+    /// Create the OpenCL device buffers that depend on the buffer chunks
+    /**
+     * Existing buffers are released, the values are not copied.
+     */
+    void createChunkBuffers();
+    
+    /// Enqueue a kernel on the boundary columns before the interior columns
+    /**
+     * The boundary columns are written into the edge buffer of the exchange
+     * (on the same queue) before the interior columns are enqueued. Thus, the
+     * transfer to the neighbouring device (see enqueueEdgeTransfer) can run
+     * while the interior columns are computed.
+     * 
+     * @param i The device
+     * @param k The kernel (arguments must be set)
+     * @param globalRange The kernel range (columns in x-direction)
+     * @param localRange The work group size (or cl::NullRange)
+     * @param edge The exchange of the boundary columns: EDGE_NET_UPDATES for the
+     *  first, EDGE_X_UPDATE or EDGE_Y_UPDATE for the last work group, EDGE_NONE
+     *  for a single launch without boundary
+     * @param waitList Events to wait for
+     * @param boundaryEvent Returns the event of the boundary columns
+     *  (the event of the kernel without boundary)
+     * @param edgeEvent Returns the event of writing the edge buffer (not set without boundary)
+     * @param event Returns the event of the kernel (the interior columns)
+     * @param name Description of the kernel (profiling)
+     */
+    void enqueueBoundaryFirst(unsigned int i,
+                        cl::Kernel &k,
+                        const cl::NDRange &globalRange,
+                        const cl::NDRange &localRange,
+                        EdgeExchange edge,
+                        std::vector<cl::Event> *waitList,
+                        cl::Event &boundaryEvent,
+                        cl::Event &edgeEvent,
+                        cl::Event &event,
+                        const char* name);
+    
+    /// Write the boundary columns of a device into the edge buffer of an exchange
+    /**
+     * @param i The device computing the boundary columns
+     * @param edge The exchange
+     * @param event Returns the event of the last command
+     */
+    void enqueueEdgeGather(unsigned int i, EdgeExchange edge, cl::Event &event);
+    
+    /// Copy an edge buffer to the neighbouring device and read it into the unknowns or net updates
+    /**
+     * The edge buffer is copied on the transfer queue, the columns are
+     * written on the queue of the receiving device after all commands
+     * enqueued so far (e.g. the update of the receiving device).
+     * 
+     * @param i The pair of devices i and i+1
+     * @param edge The exchange
+     * @param edgeEvent The event of writing the edge buffer (see enqueueEdgeGather)
+     * @param event Returns the event of the last command on the receiving device
+     */
+    void enqueueEdgeTransfer(unsigned int i, EdgeExchange edge, cl::Event &edgeEvent, cl::Event &event);
+    
+    /// Enqueue the X-Sweep on a device
+    /**
+     * The first columns are computed first on all devices but the first one,
+     * since their net updates are copied to the previous device.
+     * 
+     * @param i The device
+     * @param waitList Events to wait for
+     * @param boundaryEvent Returns the event of the first columns
+     * @param edgeEvent Returns the event of writing the edge buffer (devices i > 0)
+     * @param event Returns the event of the X-Sweep
+     * @return Number of wave speeds to reduce (without fused reduction)
+     */
+    size_t enqueueXSweep(unsigned int i,
+                        std::vector<cl::Event> &waitList,
+                        cl::Event &boundaryEvent,
+                        cl::Event &edgeEvent,
+                        cl::Event &event);
+    
+    /// Weight the buffer chunks by the measured throughput of the devices
+    /**
+     * Measures the X-Sweep on every device and moves the columns
+     * to the new buffer chunks (multiple devices only). Without
+     * profiling information, the equal split is kept.
+     */
+    void balanceDevices();
+    
+    /// Compute the time step on all devices from their maximum wave speeds
+    /**
+     * @param waitList Events of the maximum reductions (one per device), replaced
+     *  by the events of the time step computations
+     */
+    void enqueueComputeTimestep(std::vector<cl::Event> &waitList);
+    
+    /// Write the simulated time and the end time into the time step buffers of all devices
+    /**
+     * Resets the time step counters (device time step only).
+     * 
+     * @param tStart The simulated time
+     * @param tEnd The end time, the devices compute no time steps after it
+     */
+    void writeTimestep(float tStart, float tEnd);
+    
     /// Calculate buffer chunk sizes for splitting domain among multiple devices
     /**
      * @param cols Total number of columns (including ghosts)
      * @param deviceCount Total number of devices to be used
+     * @param weights Relative throughput of each device (equal split if empty)
      */
-    void calculateBufferChunks(size_t cols, size_t deviceCount);
+    void calculateBufferChunks(size_t cols, size_t deviceCount,
+                        const std::vector<float> &weights = std::vector<float>());
     
     /// Sync specified OpenCL buffers from compute devices to host memory
     /**
@@ -116,13 +280,87 @@ public:
      * @param maxDevices Maximum number of computing devices to be used (0 = unlimited)
      * @param kernelType The kernel memory type to use (MEM_GLOBAL or MEM_LOCAL)
      * @param workGroupSize The maximum work group size to use (should be a power of two)
+     * @param deviceTimestep Compute the time step on the devices (see simulate)
+     * @param fusedReduction Reduce the maximum wave speed in the sweep kernels with
+     *  a single atomic operation per work group (instead of separate reduce kernels)
+     * @param programCacheDirectory Directory of the cached program binaries
+     *  (empty = always build the kernels from source)
      */
     SWE_DimensionalSplittingOpenCL(int l_nx, int l_ny,
         float l_dx, float l_dy,
         cl_device_type preferredDeviceType = 0,
         unsigned int maxDevices = 0,
         KernelType kernelType = MEM_GLOBAL,
-        size_t workGroupSize = 1024);
+        size_t workGroupSize = 1024,
+        bool deviceTimestep = false,
+        bool fusedReduction = true,
+        const std::string &programCacheDirectory = std::string());
+    
+    //! Maximum number of time steps enqueued before the simulated time is read (device time step only)
+    static const unsigned int MAX_QUEUED_TIMESTEPS = 256;
+    
+    //! Minimum number of edges per device of a weighted split
+    static const unsigned int MIN_CHUNK_EDGES = 2;
+    
+    //! Number of X-Sweeps measured per device to weight the split (the fastest one is used)
+    static const unsigned int BALANCE_RUNS = 3;
+    
+    //! Smallest work group size measured by the auto-tuning
+    static const size_t MIN_TUNING_GROUP_SIZE = 16;
+    
+    //! Largest work group size measured by the auto-tuning (if supported by the devices)
+    static const size_t MAX_TUNING_GROUP_SIZE = 1024;
+    
+    //! Number of time steps measured per kernel configuration by the auto-tuning
+    static const unsigned int TUNING_STEPS = 5;
+    
+    /// Find the fastest kernel memory type and work group size (auto-tuning)
+    /**
+     * Measures the time steps of all kernel memory types and work group
+     * sizes (powers of two) with the given scenario. The fastest configuration
+     * is stored in the tuning cache, later calls with the same devices and
+     * grid size return it without measuring.
+     * 
+     * @param cache The tuning cache
+     * @param l_nx The grid size in x-direction (excluding ghost cells)
+     * @param l_ny The grid size in y-direction (excluding ghost cells)
+     * @param l_dx The mesh size of the Cartesian grid in x-direction
+     * @param l_dy The mesh size of the Cartesian grid in y-direction
+     * @param scenario The scenario used for the measurements
+     * @param offsetX The x-coordinate of the origin of the grid
+     * @param offsetY The y-coordinate of the origin of the grid
+     * @param preferredDeviceType The preferred OpenCL device type to use for computation
+     * @param maxDevices Maximum number of computing devices to be used (0 = unlimited)
+     * @param deviceTimestep Compute the time step on the devices
+     * @param fusedReduction Reduce the maximum wave speed in the sweep kernels
+     * @param programCacheDirectory Directory of the cached program binaries
+     *  (empty = always build the kernels from source)
+     * @return The fastest configuration
+     */
+    static KernelConfig tune(OpenCLTuningCache &cache,
+        int l_nx, int l_ny,
+        float l_dx, float l_dy,
+        SWE_Scenario &scenario,
+        float offsetX, float offsetY,
+        cl_device_type preferredDeviceType = 0,
+        unsigned int maxDevices = 0,
+        bool deviceTimestep = false,
+        bool fusedReduction = true,
+        const std::string &programCacheDirectory = std::string());
+    
+    /// Measure the time of a time step
+    /**
+     * Computes time steps (see computeNumericalFluxes) and measures the
+     * wall clock time until all devices are done, so commands that overlap
+     * on different queues or devices are counted once. An additional first
+     * time step is not measured, since it may include lazy kernel compilation
+     * and the device balancing. With the device time step, the end time is
+     * never reached.
+     * 
+     * @param steps Number of measured time steps
+     * @return Average time per time step in nanoseconds
+     */
+    double measureTimestep(unsigned int steps);
     
     /// Print information about OpenCL devices used
     void printDeviceInformation();
@@ -145,18 +383,36 @@ public:
     
     /// Simulate from a start to an end time
     /**
+     * With the device time step, the time steps are enqueued back to back
+     * without waiting for the devices. The simulated time is only read
+     * after each batch of time steps, whose size is estimated from the
+     * last time step.
+     * 
      * @param	tStart The time where the simulation is started
      * @param	tEnd The time of the next checkpoint 
      * @return	The actual end time reached
      */
     float simulate(float tStart, float tEnd);
     
+    /**
+     * @return Number of time steps computed by the last call of simulate
+     */
+    unsigned int getSimulatedTimesteps() {
+        return simulatedTimesteps;
+    }
+    
     /// Compute the numerical fluxes for every edge and store the net updates in member variables.
     /**
      * First, we're computing all updates in x direction (X-Sweep) 
      * and store intermediate heights (used in the Y-Sweep) in the 
      * hStar member variable.
      * Then, we're computing all updates in y direction (Y-Sweep).
+     * 
+     * With the device time step, this function does not wait for
+     * the devices and does not update maxTimestep (use simulate).
+     * 
+     * With multiple devices, the columns are split by the device
+     * throughput measured in the first call (see balanceDevices).
      */
     void computeNumericalFluxes();
     
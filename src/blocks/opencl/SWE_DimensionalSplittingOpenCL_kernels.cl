@@ -20,6 +20,21 @@ inline size_t rowMajor(size_t x, size_t y, size_t cols)
     return (y * cols) + x;
 }
 
+// Indices of the time step buffer (see TimestepIndex in SWE_DimensionalSplittingOpenCL.hh)
+#define TIMESTEP_DT 0
+#define TIMESTEP_DT_DX 1
+#define TIMESTEP_DT_DY 2
+#define TIMESTEP_TIME 3
+#define TIMESTEP_END 4
+
+// With ATOMIC_REDUCE, the first element of a wave speed buffer holds the
+// maximum of all edges, the wave speeds of the edges (MEM_GLOBAL) follow it
+#ifdef ATOMIC_REDUCE
+#define WAVE_SPEED_OFFSET 1
+#else
+#define WAVE_SPEED_OFFSET 0
+#endif
+
 /// Kernel to reduce the maximum value of an array in local memory
 /**
  * After return of the function, the result can be read from the first
@@ -42,15 +57,71 @@ void localReduceMaximum(__local float* values, unsigned int length, unsigned int
     }
 }
 
+/// Reduce the maximum value of all work items of a work group
+/**
+ * Uses sequential addressing: in each step, the first half of the
+ * active work items combines its values with the second half. Thus, the
+ * active work items stay contiguous and no modulo operation is required.
+ * The work group size does not have to be a power of two.
+ * All work items of the group MUST call this function.
+ *
+ * @param value The value of the current work item
+ * @param scratch Local scratch memory (at least one float per work item)
+ * @return The maximum of the work group
+ */
+float workGroupReduceMaximum(float value, __local float* scratch)
+{
+    size_t local_id = rowMajor(get_local_id(0), get_local_id(1), get_local_size(0));
+    size_t size = get_local_size(0) * get_local_size(1);
+    
+    scratch[local_id] = value;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    
+    // Largest power of two smaller than the work group size
+    size_t active = 1;
+    while((active << 1) < size)
+        active <<= 1;
+    
+    for(; active > 0; active >>= 1) {
+        if(local_id < active && local_id + active < size)
+            scratch[local_id] = fmax(scratch[local_id], scratch[local_id + active]);
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    
+    return scratch[0];
+}
+
+/// Atomic maximum of a non-negative float in global memory
+/**
+ * Non-negative floats have the same order as their bit patterns
+ * interpreted as integers, hence the integer atomic suffices.
+ *
+ * @param address The maximum in global memory (initialized to zero)
+ * @param value A non-negative value
+ */
+void atomicMaximum(__global float* address, float value)
+{
+    atomic_max((volatile __global int*)address, as_int(value));
+}
+
 /// Compute net updates (X-Sweep)
 /**
  * Kernel Range should be set to (#cols-1, #rows)
+ * 
+ * The columns may be enqueued in several parts with a global work offset
+ * in x-direction (e.g. the boundary columns first), the work group size
+ * must divide the offsets.
  *
  * If maxWaveSpeed is reduced globally, the dimensions for maxWaveSpeeds
  * are (cols-1)*rows (aka edges*rows). For net-updates, the dimensions are
  * cols*rows (aka (edges+1)*rows) since we need to keep room for the net-updates
  * at the edge that are copied from the "next" device.
  * 
+ * With ATOMIC_REDUCE, the maximum of each work group is combined atomically
+ * in maxWaveSpeed[0] (which must be zero before), no further reduction
+ * is required. The kernel range is padded to a multiple of the work group
+ * size in this case.
+ * 
  * @param h                             Pointer to global water heights memory
  * @param hu                            Pointer to global horizontal water momentums memory
  * @param b                             Pointer to global bathymetry memory
@@ -66,8 +137,8 @@ void localReduceMaximum(__local float* values, unsigned int length, unsigned int
  * @param hNetUpdatesRightScratch       Pointer to local right going water updates scratch memory (LOCAL ONLY)
  * @param huNetUpdatesLeftScratch       Pointer to local left going momentum updates scratch memory (LOCAL ONLY)
  * @param huNetUpdatesRightScratch      Pointer to local right going momentum updates scratch memory (LOCAL ONLY)
- * @param maxWaveSpeedScratch           Pointer to local maximum wavespeed scratch memory (LOCAL ONLY)
- * @param edges                         Number of edges (LOCAL ONLY)
+ * @param maxWaveSpeedScratch           Pointer to local maximum wavespeed scratch memory (LOCAL or ATOMIC_REDUCE)
+ * @param edges                         Number of edges
  * @param rows                          Number of rows (LOCAL ONLY)
  */
 __kernel void dimensionalSplitting_XSweep_netUpdates(
@@ -91,6 +162,13 @@ __kernel void dimensionalSplitting_XSweep_netUpdates(
     __local float* maxWaveSpeedScratch,
     __const uint edges, // cols-1
     __const uint rows
+#else
+    ,
+    __const uint edges // cols-1
+#ifdef ATOMIC_REDUCE
+    ,
+    __local float* maxWaveSpeedScratch
+#endif
 #endif
 )
 {    
@@ -99,25 +177,35 @@ __kernel void dimensionalSplitting_XSweep_netUpdates(
     size_t x = get_global_id(0);
     size_t y = get_global_id(1);
     size_t rows = get_global_size(1);
-    size_t edges = get_global_size(0);
-    
-    size_t leftId = colMajor(x, y, rows);
-    size_t rightId = colMajor(x+1, y, rows);
-    size_t updateId = rowMajor(x, y, edges+1); // leave room for edge-update from next device
-    size_t waveId = rowMajor(x, y, edges); // leave room for edge-update from next device
-    computeNetUpdates(
-        h[leftId], h[rightId],
-        hu[leftId], hu[rightId],
-        b[leftId], b[rightId],
-        &(hNetUpdatesLeft[updateId]), &(hNetUpdatesRight[updateId]),
-        &(huNetUpdatesLeft[updateId]), &(huNetUpdatesRight[updateId]),
-        &(maxWaveSpeed[waveId])
-    );
+    
+    size_t waveId = rowMajor(x, y, edges) + WAVE_SPEED_OFFSET;
+    // The kernel range is padded with ATOMIC_REDUCE
+    if(x < edges) {
+        size_t leftId = colMajor(x, y, rows);
+        size_t rightId = colMajor(x+1, y, rows);
+        size_t updateId = rowMajor(x, y, edges+1); // leave room for edge-update from next device
+        computeNetUpdates(
+            h[leftId], h[rightId],
+            hu[leftId], hu[rightId],
+            b[leftId], b[rightId],
+            &(hNetUpdatesLeft[updateId]), &(hNetUpdatesRight[updateId]),
+            &(huNetUpdatesLeft[updateId]), &(huNetUpdatesRight[updateId]),
+            &(maxWaveSpeed[waveId])
+        );
+    }
+    
+#ifdef ATOMIC_REDUCE
+    // Reduce maximum (wave speeds are non-negative, zero is the neutral element)
+    float waveSpeed = workGroupReduceMaximum((x < edges) ? maxWaveSpeed[waveId] : 0.f, maxWaveSpeedScratch);
+    if(get_local_id(0) == 0)
+        atomicMaximum(maxWaveSpeed, waveSpeed);
+#endif
 #else
     // LOCAL
     size_t localsize = get_local_size(0);
-    size_t gid = get_group_id(0);
-    size_t start = gid*localsize;
+    // first column of the group (independent of the global work offset)
+    size_t start = get_global_id(0) - get_local_id(0);
+    size_t gid = start/localsize;
     size_t offset = colMajor(start, get_group_id(1), rows);
     // Number of floats to load (make sure we stay in bounds)
     size_t num = min(localsize, edges-start) + 1;
@@ -156,7 +244,12 @@ __kernel void dimensionalSplitting_XSweep_netUpdates(
     event[3] = async_work_group_copy(huNetUpdatesRight+offset, huNetUpdatesRightScratch, num, 0);
     
     // Reduce maximum
-#ifdef LOCAL_REDUCE
+#if defined(ATOMIC_REDUCE)
+    // wave speeds are non-negative, zero is the neutral element
+    float waveSpeed = workGroupReduceMaximum((id < num) ? maxWaveSpeedScratch[id] : 0.f, maxWaveSpeedScratch);
+    if(id == 0)
+        atomicMaximum(maxWaveSpeed, waveSpeed);
+#elif defined(LOCAL_REDUCE)
     // fill buffer with neutral element -INFINITY to a length of a power of two
     if(id >= num)
         maxWaveSpeedScratch[id] = -INFINITY;
@@ -164,7 +257,7 @@ __kernel void dimensionalSplitting_XSweep_netUpdates(
     localReduceMaximum(maxWaveSpeedScratch, localsize, id);
     // Store maximum of group
     if(id == 0)
-        maxWaveSpeed[rowMajor(gid, get_group_id(1), get_num_groups(0))] = maxWaveSpeedScratch[0];
+        maxWaveSpeed[rowMajor(gid, get_group_id(1), (edges+localsize-1)/localsize)] = maxWaveSpeedScratch[0];
 #else
     offset = rowMajor(start, get_group_id(1), edges);
     event_t waveEvent = async_work_group_copy(maxWaveSpeed+offset, maxWaveSpeedScratch, num, 0);
@@ -180,6 +273,9 @@ __kernel void dimensionalSplitting_XSweep_netUpdates(
 /**
  * Kernel Range should be set to (#cols, #rows-1)
  * 
+ * The maximum wave speed is only required for the CFL check (DEBUG),
+ * see the X-Sweep for ATOMIC_REDUCE.
+ * 
  * @param h                             Pointer to water heights
  * @param hv                            Pointer to vertical water momentums
  * @param b                             Pointer to bathymetry
@@ -195,9 +291,9 @@ __kernel void dimensionalSplitting_XSweep_netUpdates(
  * @param hNetUpdatesRightScratch       Pointer to local right going water updates scratch memory (LOCAL ONLY)
  * @param hvNetUpdatesLeftScratch       Pointer to local left going momentum updates scratch memory (LOCAL ONLY)
  * @param hvNetUpdatesRightScratch      Pointer to local right going momentum updates scratch memory (LOCAL ONLY)
- * @param maxWaveSpeedScratch           Pointer to local maximum wavespeed scratch memory (LOCAL ONLY)
+ * @param maxWaveSpeedScratch           Pointer to local maximum wavespeed scratch memory (LOCAL or ATOMIC_REDUCE)
  * @param cols                          Number of columns (LOCAL ONLY)
- * @param edges                         Number of edges (LOCAL ONLY)
+ * @param edges                         Number of edges (LOCAL or ATOMIC_REDUCE)
  */
 __kernel void dimensionalSplitting_YSweep_netUpdates(
     __global float* h,
@@ -220,6 +316,10 @@ __kernel void dimensionalSplitting_YSweep_netUpdates(
     __local float* maxWaveSpeedScratch,
     __const uint cols,
     __const uint edges // rows-1
+#elif defined(ATOMIC_REDUCE)
+    ,
+    __local float* maxWaveSpeedScratch,
+    __const uint edges // rows-1
 #endif
 )
 {
@@ -227,20 +327,31 @@ __kernel void dimensionalSplitting_YSweep_netUpdates(
     // GLOBAL
     size_t x = get_global_id(0);
     size_t y = get_global_id(1);
-    size_t rows = get_global_size(1);
+#ifndef ATOMIC_REDUCE
+    size_t edges = get_global_size(1);
+#endif
+    
+    size_t updateId = colMajor(x, y, edges);
+    // The kernel range is padded with ATOMIC_REDUCE
+    if(y < edges) {
+        size_t leftId = colMajor(x, y, edges+1);
+        size_t rightId = colMajor(x, y+1, edges+1);
+        computeNetUpdates(
+            h[leftId], h[rightId],
+            hv[leftId], hv[rightId],
+            b[leftId], b[rightId],
+            &(hNetUpdatesLeft[updateId]), &(hNetUpdatesRight[updateId]),
+            &(hvNetUpdatesLeft[updateId]), &(hvNetUpdatesRight[updateId]),
+            &(maxWaveSpeed[updateId + WAVE_SPEED_OFFSET])
+        );
+    }
     
-    size_t leftId = colMajor(x, y, rows+1);
-    size_t rightId = colMajor(x, y+1, rows+1);
-    size_t updateId = colMajor(x, y, rows);
-    
-    computeNetUpdates(
-        h[leftId], h[rightId],
-        hv[leftId], hv[rightId],
-        b[leftId], b[rightId],
-        &(hNetUpdatesLeft[updateId]), &(hNetUpdatesRight[updateId]),
-        &(hvNetUpdatesLeft[updateId]), &(hvNetUpdatesRight[updateId]),
-        &(maxWaveSpeed[updateId])
-    );
+#if defined(DEBUG) && defined(ATOMIC_REDUCE)
+    // Reduce maximum (wave speeds are non-negative, zero is the neutral element)
+    float waveSpeed = workGroupReduceMaximum((y < edges) ? maxWaveSpeed[updateId + WAVE_SPEED_OFFSET] : 0.f, maxWaveSpeedScratch);
+    if(get_local_id(1) == 0)
+        atomicMaximum(maxWaveSpeed, waveSpeed);
+#endif
 #else
     // LOCAL
     size_t localsize = get_local_size(1);
@@ -284,7 +395,12 @@ __kernel void dimensionalSplitting_YSweep_netUpdates(
 
     // Reduce maximum
 #ifdef DEBUG
-#ifdef LOCAL_REDUCE
+#if defined(ATOMIC_REDUCE)
+    // wave speeds are non-negative, zero is the neutral element
+    float waveSpeed = workGroupReduceMaximum((id < num) ? maxWaveSpeedScratch[id] : 0.f, maxWaveSpeedScratch);
+    if(id == 0)
+        atomicMaximum(maxWaveSpeed, waveSpeed);
+#elif defined(LOCAL_REDUCE)
     // fill buffer with neutral element -INFINITY to a length of a power of two
     if(id >= num)
         maxWaveSpeedScratch[id] = -INFINITY;
@@ -307,18 +423,27 @@ __kernel void dimensionalSplitting_YSweep_netUpdates(
 
 /// Update Unknowns (X-Sweep)
 /**
- * Kernel Range should be set to (#cols-2, #rows)
+ * Kernel Range should be set to (#cols-1, #rows)
+ * 
+ * The columns may be enqueued in several parts with a global work offset
+ * in x-direction, see the X-Sweep.
  * 
  * @param dt_dx                 The desired update step
+ *                              (with DEVICE_TIMESTEP: pointer to the time step buffer)
  * @param h                     Pointer to water heights
  * @param hu                    Pointer to horizontal water momentums
  * @param hNetUpdatesLeft       Pointer to left going water updates
  * @param hNetUpdatesRight      Pointer to right going water updates
  * @param huNetUpdatesLeft      Pointer to left going momentum updates
  * @param huNetUpdatesRight     Pointer to right going momentum updates
+ * @param edges                 Number of edges
  */
 __kernel void dimensionalSplitting_XSweep_updateUnknowns(
+#ifdef DEVICE_TIMESTEP
+    __global const float* timestep,
+#else
     float dt_dx,
+#endif
     __global float* h,
     __global float* hu,
     __global float* hNetUpdatesLeft,
@@ -333,17 +458,24 @@ __kernel void dimensionalSplitting_XSweep_updateUnknowns(
     __local float* hNetUpdatesRightScratch,
     __local float* huNetUpdatesLeftScratch,
     __local float* huNetUpdatesRightScratch,
-    __const uint edges, // cols-2
+    __const uint edges, // cols-1
     __const uint rows
+#else
+    ,
+    __const uint edges // cols-1
 #endif
         )
 {
+#ifdef DEVICE_TIMESTEP
+    const float dt_dx = timestep[TIMESTEP_DT_DX];
+#endif
+    
 #ifndef MEM_LOCAL
     // GLOBAL
     size_t x = get_global_id(0);
     size_t y = get_global_id(1);
     size_t rows = get_global_size(1);
-    size_t cols = get_global_size(0)+1;
+    size_t cols = edges+1;
     
     size_t cellId = colMajor(x+1, y, rows);
     size_t leftId = rowMajor(x, y, cols);
@@ -359,9 +491,9 @@ __kernel void dimensionalSplitting_XSweep_updateUnknowns(
 #else
     // LOCAL
     size_t id = get_local_id(0);
-    size_t gid = get_group_id(0);
     size_t localsize = get_local_size(0);
-    size_t start = gid*localsize;
+    // first column of the group (independent of the global work offset)
+    size_t start = get_global_id(0) - id;
     size_t cols = edges+1;
     
     size_t cellOffset = colMajor(start+1, get_group_id(1), rows); // skip ghost column
@@ -402,7 +534,11 @@ __kernel void dimensionalSplitting_XSweep_updateUnknowns(
 /**
  * Kernel Range should be set to (#cols, #rows-2)
  * 
+ * The columns may be enqueued in several parts with a global work offset
+ * in x-direction.
+ * 
  * @param dt_dy                 The desired update step
+ *                              (with DEVICE_TIMESTEP: pointer to the time step buffer)
  * @param h                     Pointer to water heights
  * @param hv                    Pointer to vertical water momentums
  * @param hNetUpdatesLeft       Pointer to left going water updates
@@ -411,7 +547,11 @@ __kernel void dimensionalSplitting_XSweep_updateUnknowns(
  * @param hvNetUpdatesRight     Pointer to right going momentum updates
  */
 __kernel void dimensionalSplitting_YSweep_updateUnknowns(
+#ifdef DEVICE_TIMESTEP
+    __global const float* timestep,
+#else
     float dt_dy,
+#endif
     __global float* h,
     __global float* hv,
     __global float* hNetUpdatesLeft,
@@ -431,6 +571,10 @@ __kernel void dimensionalSplitting_YSweep_updateUnknowns(
 #endif
 )
 {
+#ifdef DEVICE_TIMESTEP
+    const float dt_dy = timestep[TIMESTEP_DT_DY];
+#endif
+    
 #ifndef MEM_LOCAL
     // GLOBAL 
     size_t x = get_global_id(0);
@@ -456,8 +600,9 @@ __kernel void dimensionalSplitting_YSweep_updateUnknowns(
     size_t localsize = get_local_size(1);
     size_t start = gid*localsize;
     
-    size_t cellOffset = colMajor(get_group_id(0), start+1, edges+1); // skip ghost column
-    size_t leftOffset = colMajor(get_group_id(0), start, edges);
+    // the work groups contain a single column
+    size_t cellOffset = colMajor(get_global_id(0), start+1, edges+1); // skip ghost column
+    size_t leftOffset = colMajor(get_global_id(0), start, edges);
     size_t rightOffset = leftOffset+1;
     
     size_t num = min(localsize, edges-1-start);
@@ -568,6 +713,47 @@ __kernel void reduceMaximumCPU(
     values[start] = acc;
 }
 
+/// Kernel computing the time step from the maximum wave speeds of all devices
+/**
+ * Kernel range should be set to (1)
+ * 
+ * The time step is only advanced while the simulated time is smaller than
+ * the end time, afterwards dt_dx and dt_dy are set to zero and further
+ * time steps do not change the unknowns. This allows to enqueue several
+ * time steps without reading the simulated time on the host.
+ * 
+ * @param maxWaveSpeeds     Pointer to the maximum wave speed of each device
+ * @param count             Number of devices
+ * @param dx                The mesh size in x-direction
+ * @param dy                The mesh size in y-direction
+ * @param timestep          Pointer to the time step buffer (see TIMESTEP_*)
+ * @param steps             Pointer to the number of computed time steps
+ */
+__kernel void computeTimestep(
+    __global const float* maxWaveSpeeds,
+    __const uint count,
+    __const float dx,
+    __const float dy,
+    __global float* timestep,
+    __global uint* steps)
+{
+    if(timestep[TIMESTEP_TIME] < timestep[TIMESTEP_END]) {
+        float maxWaveSpeed = -INFINITY;
+        for(uint i = 0; i < count; i++)
+            maxWaveSpeed = fmax(maxWaveSpeed, maxWaveSpeeds[i]);
+        
+        float dt = dx/maxWaveSpeed * 0.4f;
+        timestep[TIMESTEP_DT] = dt;
+        timestep[TIMESTEP_DT_DX] = dt / dx;
+        timestep[TIMESTEP_DT_DY] = dt / dy;
+        timestep[TIMESTEP_TIME] += dt;
+        steps[0]++;
+    } else {
+        timestep[TIMESTEP_DT_DX] = 0.f;
+        timestep[TIMESTEP_DT_DY] = 0.f;
+    }
+}
+
 /// Kernel setting boundary conditions (OUTFLOW or WALL) on the left boundary
 /**
  * Kernel range should be set to (#rows)
@@ -691,34 +877,46 @@ __kernel void setBottomTopBoundary(
 
 
  
-/// Write the left-most column of a buffer into a copy-column buffer that is transferred to another device
+/// Write the left-most columns of two buffers into an edge buffer that is transferred to another device
 /**
- * Note that the source buffer is assumed to be in row-major order
+ * Kernel range should be set to (#rows)
+ * 
+ * Note that the source buffers are assumed to be in row-major order,
+ * the edge buffer holds the column of hSource followed by the column of huSource
  * 
- * @param source The source buffer
- * @param copyBuffer The column buffer
- * @param cols The number of columns of the source buffer
+ * @param hSource The first source buffer (h net updates)
+ * @param huSource The second source buffer (hu net updates)
+ * @param copyBuffer The edge buffer (two columns)
+ * @param cols The number of columns of the source buffers
  */
-__kernel void writeNetUpdatesEdgeCopy(__global float* source, __global float* copyBuffer, __const uint cols)
+__kernel void writeNetUpdatesEdgeCopy(__global float* hSource, __global float* huSource,
+    __global float* copyBuffer, __const uint cols)
 {
     size_t sourceId = rowMajor(0, get_global_id(0), (size_t)cols);
     size_t destinationId = get_global_id(0);
     
-    copyBuffer[destinationId] = source[sourceId];
+    copyBuffer[destinationId] = hSource[sourceId];
+    copyBuffer[destinationId + get_global_size(0)] = huSource[sourceId];
 }
 
-/// read the right-most column from a copy-column buffer into a destination buffer
+/// Read the right-most columns of two buffers from an edge buffer
 /**
- * Note that the destination buffer is assumed to be in row-major order
+ * Kernel range should be set to (#rows)
+ * 
+ * Note that the destination buffers are assumed to be in row-major order,
+ * the edge buffer holds the column of hDestination followed by the column of huDestination
  * 
- * @param source The destination buffer
- * @param copyBuffer The column buffer
- * @param cols The number of columns of the destination buffer
+ * @param hDestination The first destination buffer (h net updates)
+ * @param huDestination The second destination buffer (hu net updates)
+ * @param copyBuffer The edge buffer (two columns)
+ * @param cols The number of columns of the destination buffers
  */
-__kernel void readNetUpdatesEdgeCopy(__global float* destination, __global float* copyBuffer, __const uint cols)
+__kernel void readNetUpdatesEdgeCopy(__global float* hDestination, __global float* huDestination,
+    __global float* copyBuffer, __const uint cols)
 {
     size_t sourceId = get_global_id(0);
     size_t destinationId = rowMajor(cols-1, get_global_id(0), (size_t)cols);
     
-    destination[destinationId] = copyBuffer[sourceId];
+    hDestination[destinationId] = copyBuffer[sourceId];
+    huDestination[destinationId] = copyBuffer[sourceId + get_global_size(0)];
 }
@@ -0,0 +1,378 @@
+#include "FWaveBatch.hh"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define FWAVEBATCH_AVX2
+#if (__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#define FWAVEBATCH_AVX512
+#endif
+#endif
+
+namespace solver {
+
+/**
+ * Net updates of a single edge
+ *
+ * All implementations follow the same order of operations, so the
+ * results only differ by the (optional) contraction into fused multiply-adds.
+ *
+ * @return The maximum wave speed at this edge
+ */
+static inline float computeEdge(float g, float dryTol, float zeroTol,
+    float hL, float hR, float huL, float huR, float bL, float bR,
+    float &o_hUpdateLeft, float &o_hUpdateRight,
+    float &o_huUpdateLeft, float &o_huUpdateRight)
+{
+    bool wetL = hL >= dryTol;
+    bool wetR = hR >= dryTol;
+    
+    o_hUpdateLeft = o_hUpdateRight = o_huUpdateLeft = o_huUpdateRight = 0.f;
+    if(!wetL && !wetR)
+        return 0.f;
+    
+    // reflecting boundary at the dry cell
+    if(!wetL) {
+        hL = hR; huL = -huR; bL = bR;
+    } else if(!wetR) {
+        hR = hL; huR = -huL; bR = bL;
+    }
+    
+    float uL = huL / hL;
+    float uR = huR / hR;
+    float sqrtHL = std::sqrt(hL);
+    float sqrtHR = std::sqrt(hR);
+    
+    // Roe averages and Einfeldt speeds
+    float hRoe = .5f * (hL + hR);
+    float uRoe = (uL * sqrtHL + uR * sqrtHR) / (sqrtHL + sqrtHR);
+    float cRoe = std::sqrt(g * hRoe);
+    float s0 = std::min(uRoe - cRoe, uL - std::sqrt(g * hL));
+    float s1 = std::max(uRoe + cRoe, uR + std::sqrt(g * hR));
+    
+    // flux difference including the bathymetry source term
+    float f0 = huR - huL;
+    float f1 = (huR * uR + .5f * g * hR * hR) - (huL * uL + .5f * g * hL * hL)
+        + .5f * g * (hR + hL) * (bR - bL);
+    
+    float inverseSpeedDiff = 1.f / (s1 - s0);
+    float beta0 = (s1 * f0 - f1) * inverseSpeedDiff;
+    float beta1 = (f1 - s0 * f0) * inverseSpeedDiff;
+    
+    float waves[2][2] = { { beta0, beta0 * s0 }, { beta1, beta1 * s1 } };
+    float speeds[2] = { s0, s1 };
+    for(int k = 0; k < 2; k++) {
+        float fractionLeft = (speeds[k] < -zeroTol) ? 1.f : ((speeds[k] > zeroTol) ? 0.f : .5f);
+        float fractionRight = (speeds[k] > zeroTol) ? 1.f : ((speeds[k] < -zeroTol) ? 0.f : .5f);
+        o_hUpdateLeft += fractionLeft * waves[k][0];
+        o_huUpdateLeft += fractionLeft * waves[k][1];
+        o_hUpdateRight += fractionRight * waves[k][0];
+        o_huUpdateRight += fractionRight * waves[k][1];
+    }
+    
+    // no updates for the dry cell
+    if(!wetL) {
+        o_hUpdateLeft = o_huUpdateLeft = 0.f;
+    } else if(!wetR) {
+        o_hUpdateRight = o_huUpdateRight = 0.f;
+    }
+    
+    return std::max(std::fabs(s0), std::fabs(s1));
+}
+
+static void computeNetUpdatesScalar(float g, float dryTol, float zeroTol, int n,
+    const float *hL, const float *hR, const float *huL, const float *huR,
+    const float *bL, const float *bR,
+    float *hUL, float *hUR, float *huUL, float *huUR, float &o_maxWaveSpeed)
+{
+    float maxWaveSpeed = o_maxWaveSpeed;
+    for(int k = 0; k < n; k++) {
+        float speed = computeEdge(g, dryTol, zeroTol, hL[k], hR[k], huL[k], huR[k], bL[k], bR[k],
+            hUL[k], hUR[k], huUL[k], huUR[k]);
+        maxWaveSpeed = std::max(maxWaveSpeed, speed);
+    }
+    o_maxWaveSpeed = maxWaveSpeed;
+}
+
+#ifdef FWAVEBATCH_AVX2
+__attribute__((target("avx2,fma")))
+static void computeNetUpdatesAVX2(float g, float dryTol, float zeroTol, int n,
+    const float *hL, const float *hR, const float *huL, const float *huR,
+    const float *bL, const float *bR,
+    float *hUL, float *hUR, float *huUL, float *huUR, float &o_maxWaveSpeed)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 half = _mm256_set1_ps(.5f);
+    const __m256 one = _mm256_set1_ps(1.f);
+    const __m256 gravity = _mm256_set1_ps(g);
+    const __m256 halfGravity = _mm256_set1_ps(.5f * g);
+    const __m256 dry = _mm256_set1_ps(dryTol);
+    const __m256 posZero = _mm256_set1_ps(zeroTol);
+    const __m256 negZero = _mm256_set1_ps(-zeroTol);
+    const __m256 signMask = _mm256_set1_ps(-0.f);
+    
+    __m256 maxSpeed = zero;
+    
+    int k = 0;
+    for(; k + 8 <= n; k += 8) {
+        __m256 hLeft = _mm256_loadu_ps(hL + k);
+        __m256 hRight = _mm256_loadu_ps(hR + k);
+        __m256 huLeft = _mm256_loadu_ps(huL + k);
+        __m256 huRight = _mm256_loadu_ps(huR + k);
+        __m256 bLeft = _mm256_loadu_ps(bL + k);
+        __m256 bRight = _mm256_loadu_ps(bR + k);
+        
+        __m256 wetL = _mm256_cmp_ps(hLeft, dry, _CMP_GE_OQ);
+        __m256 wetR = _mm256_cmp_ps(hRight, dry, _CMP_GE_OQ);
+        __m256 wet = _mm256_or_ps(wetL, wetR);
+        __m256 dryL = _mm256_andnot_ps(wetL, wetR);
+        __m256 dryR = _mm256_andnot_ps(wetR, wetL);
+        
+        // reflecting boundary at dry cells, dummy state where both cells are dry
+        __m256 hL0 = hLeft, huL0 = huLeft, bL0 = bLeft;
+        hLeft = _mm256_blendv_ps(hLeft, hRight, dryL);
+        huLeft = _mm256_blendv_ps(huLeft, _mm256_xor_ps(huRight, signMask), dryL);
+        bLeft = _mm256_blendv_ps(bLeft, bRight, dryL);
+        hRight = _mm256_blendv_ps(hRight, hL0, dryR);
+        huRight = _mm256_blendv_ps(huRight, _mm256_xor_ps(huL0, signMask), dryR);
+        bRight = _mm256_blendv_ps(bRight, bL0, dryR);
+        hLeft = _mm256_blendv_ps(one, hLeft, wet);
+        hRight = _mm256_blendv_ps(one, hRight, wet);
+        
+        __m256 uL = _mm256_div_ps(huLeft, hLeft);
+        __m256 uR = _mm256_div_ps(huRight, hRight);
+        __m256 sqrtHL = _mm256_sqrt_ps(hLeft);
+        __m256 sqrtHR = _mm256_sqrt_ps(hRight);
+        
+        __m256 hRoe = _mm256_mul_ps(half, _mm256_add_ps(hLeft, hRight));
+        __m256 uRoe = _mm256_div_ps(_mm256_add_ps(_mm256_mul_ps(uL, sqrtHL), _mm256_mul_ps(uR, sqrtHR)),
+            _mm256_add_ps(sqrtHL, sqrtHR));
+        __m256 cRoe = _mm256_sqrt_ps(_mm256_mul_ps(gravity, hRoe));
+        __m256 s0 = _mm256_min_ps(_mm256_sub_ps(uRoe, cRoe),
+            _mm256_sub_ps(uL, _mm256_sqrt_ps(_mm256_mul_ps(gravity, hLeft))));
+        __m256 s1 = _mm256_max_ps(_mm256_add_ps(uRoe, cRoe),
+            _mm256_add_ps(uR, _mm256_sqrt_ps(_mm256_mul_ps(gravity, hRight))));
+        
+        __m256 f0 = _mm256_sub_ps(huRight, huLeft);
+        __m256 fluxR = _mm256_add_ps(_mm256_mul_ps(huRight, uR), _mm256_mul_ps(_mm256_mul_ps(halfGravity, hRight), hRight));
+        __m256 fluxL = _mm256_add_ps(_mm256_mul_ps(huLeft, uL), _mm256_mul_ps(_mm256_mul_ps(halfGravity, hLeft), hLeft));
+        __m256 f1 = _mm256_add_ps(_mm256_sub_ps(fluxR, fluxL),
+            _mm256_mul_ps(_mm256_mul_ps(halfGravity, _mm256_add_ps(hRight, hLeft)), _mm256_sub_ps(bRight, bLeft)));
+        
+        __m256 inverseSpeedDiff = _mm256_div_ps(one, _mm256_sub_ps(s1, s0));
+        __m256 beta0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(s1, f0), f1), inverseSpeedDiff);
+        __m256 beta1 = _mm256_mul_ps(_mm256_sub_ps(f1, _mm256_mul_ps(s0, f0)), inverseSpeedDiff);
+        
+        __m256 hUpdateLeft = zero, hUpdateRight = zero, huUpdateLeft = zero, huUpdateRight = zero;
+        __m256 speeds[2] = { s0, s1 };
+        __m256 betas[2] = { beta0, beta1 };
+        for(int w = 0; w < 2; w++) {
+            __m256 negative = _mm256_cmp_ps(speeds[w], negZero, _CMP_LT_OQ);
+            __m256 positive = _mm256_cmp_ps(speeds[w], posZero, _CMP_GT_OQ);
+            __m256 fractionLeft = _mm256_blendv_ps(_mm256_blendv_ps(half, zero, positive), one, negative);
+            __m256 fractionRight = _mm256_blendv_ps(_mm256_blendv_ps(half, zero, negative), one, positive);
+            __m256 waveMomentum = _mm256_mul_ps(betas[w], speeds[w]);
+            hUpdateLeft = _mm256_add_ps(hUpdateLeft, _mm256_mul_ps(fractionLeft, betas[w]));
+            huUpdateLeft = _mm256_add_ps(huUpdateLeft, _mm256_mul_ps(fractionLeft, waveMomentum));
+            hUpdateRight = _mm256_add_ps(hUpdateRight, _mm256_mul_ps(fractionRight, betas[w]));
+            huUpdateRight = _mm256_add_ps(huUpdateRight, _mm256_mul_ps(fractionRight, waveMomentum));
+        }
+        
+        // no updates for dry cells
+        __m256 updateLeft = _mm256_and_ps(wetL, wet);
+        __m256 updateRight = _mm256_and_ps(wetR, wet);
+        _mm256_storeu_ps(hUL + k, _mm256_and_ps(hUpdateLeft, updateLeft));
+        _mm256_storeu_ps(huUL + k, _mm256_and_ps(huUpdateLeft, updateLeft));
+        _mm256_storeu_ps(hUR + k, _mm256_and_ps(hUpdateRight, updateRight));
+        _mm256_storeu_ps(huUR + k, _mm256_and_ps(huUpdateRight, updateRight));
+        
+        __m256 speed = _mm256_max_ps(_mm256_andnot_ps(signMask, s0), _mm256_andnot_ps(signMask, s1));
+        maxSpeed = _mm256_max_ps(maxSpeed, _mm256_and_ps(speed, wet));
+    }
+    
+    // horizontal maximum
+    __m128 max4 = _mm_max_ps(_mm256_castps256_ps128(maxSpeed), _mm256_extractf128_ps(maxSpeed, 1));
+    max4 = _mm_max_ps(max4, _mm_movehl_ps(max4, max4));
+    max4 = _mm_max_ss(max4, _mm_shuffle_ps(max4, max4, 1));
+    o_maxWaveSpeed = std::max(o_maxWaveSpeed, _mm_cvtss_f32(max4));
+    
+    // remaining edges
+    computeNetUpdatesScalar(g, dryTol, zeroTol, n - k, hL + k, hR + k, huL + k, huR + k, bL + k, bR + k,
+        hUL + k, hUR + k, huUL + k, huUR + k, o_maxWaveSpeed);
+}
+#endif
+
+#ifdef FWAVEBATCH_AVX512
+__attribute__((target("avx512f")))
+static void computeNetUpdatesAVX512(float g, float dryTol, float zeroTol, int n,
+    const float *hL, const float *hR, const float *huL, const float *huR,
+    const float *bL, const float *bR,
+    float *hUL, float *hUR, float *huUL, float *huUR, float &o_maxWaveSpeed)
+{
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 half = _mm512_set1_ps(.5f);
+    const __m512 one = _mm512_set1_ps(1.f);
+    const __m512 gravity = _mm512_set1_ps(g);
+    const __m512 halfGravity = _mm512_set1_ps(.5f * g);
+    const __m512 dry = _mm512_set1_ps(dryTol);
+    const __m512 posZero = _mm512_set1_ps(zeroTol);
+    const __m512 negZero = _mm512_set1_ps(-zeroTol);
+    
+    __m512 maxSpeed = zero;
+    
+    for(int k = 0; k < n; k += 16) {
+        // the last iteration handles the remaining edges with masked loads/stores
+        __mmask16 active = (n - k >= 16) ? (__mmask16) 0xFFFF : (__mmask16) ((1u << (n - k)) - 1);
+        
+        __m512 hLeft = _mm512_maskz_loadu_ps(active, hL + k);
+        __m512 hRight = _mm512_maskz_loadu_ps(active, hR + k);
+        __m512 huLeft = _mm512_maskz_loadu_ps(active, huL + k);
+        __m512 huRight = _mm512_maskz_loadu_ps(active, huR + k);
+        __m512 bLeft = _mm512_maskz_loadu_ps(active, bL + k);
+        __m512 bRight = _mm512_maskz_loadu_ps(active, bR + k);
+        
+        __mmask16 wetL = _mm512_mask_cmp_ps_mask(active, hLeft, dry, _CMP_GE_OQ);
+        __mmask16 wetR = _mm512_mask_cmp_ps_mask(active, hRight, dry, _CMP_GE_OQ);
+        __mmask16 wet = wetL | wetR;
+        __mmask16 dryL = ~wetL & wetR;
+        __mmask16 dryR = wetL & ~wetR;
+        
+        // reflecting boundary at dry cells, dummy state where both cells are dry
+        __m512 hL0 = hLeft, huL0 = huLeft, bL0 = bLeft;
+        hLeft = _mm512_mask_blend_ps(dryL, hLeft, hRight);
+        huLeft = _mm512_mask_blend_ps(dryL, huLeft, _mm512_sub_ps(zero, huRight));
+        bLeft = _mm512_mask_blend_ps(dryL, bLeft, bRight);
+        hRight = _mm512_mask_blend_ps(dryR, hRight, hL0);
+        huRight = _mm512_mask_blend_ps(dryR, huRight, _mm512_sub_ps(zero, huL0));
+        bRight = _mm512_mask_blend_ps(dryR, bRight, bL0);
+        hLeft = _mm512_mask_blend_ps(wet, one, hLeft);
+        hRight = _mm512_mask_blend_ps(wet, one, hRight);
+        
+        // the masked intrinsics below keep the lanes past the last edge defined
+        // (the unmasked versions pass undefined registers through)
+        __m512 uL = _mm512_div_ps(huLeft, hLeft);
+        __m512 uR = _mm512_div_ps(huRight, hRight);
+        __m512 sqrtHL = _mm512_mask_sqrt_ps(one, active, hLeft);
+        __m512 sqrtHR = _mm512_mask_sqrt_ps(one, active, hRight);
+        
+        __m512 hRoe = _mm512_mul_ps(half, _mm512_add_ps(hLeft, hRight));
+        __m512 uRoe = _mm512_div_ps(_mm512_add_ps(_mm512_mul_ps(uL, sqrtHL), _mm512_mul_ps(uR, sqrtHR)),
+            _mm512_add_ps(sqrtHL, sqrtHR));
+        __m512 cRoe = _mm512_mask_sqrt_ps(one, active, _mm512_mul_ps(gravity, hRoe));
+        __m512 s0 = _mm512_maskz_min_ps(active, _mm512_sub_ps(uRoe, cRoe),
+            _mm512_sub_ps(uL, _mm512_mask_sqrt_ps(one, active, _mm512_mul_ps(gravity, hLeft))));
+        __m512 s1 = _mm512_maskz_max_ps(active, _mm512_add_ps(uRoe, cRoe),
+            _mm512_add_ps(uR, _mm512_mask_sqrt_ps(one, active, _mm512_mul_ps(gravity, hRight))));
+        
+        __m512 f0 = _mm512_sub_ps(huRight, huLeft);
+        __m512 fluxR = _mm512_add_ps(_mm512_mul_ps(huRight, uR), _mm512_mul_ps(_mm512_mul_ps(halfGravity, hRight), hRight));
+        __m512 fluxL = _mm512_add_ps(_mm512_mul_ps(huLeft, uL), _mm512_mul_ps(_mm512_mul_ps(halfGravity, hLeft), hLeft));
+        __m512 f1 = _mm512_add_ps(_mm512_sub_ps(fluxR, fluxL),
+            _mm512_mul_ps(_mm512_mul_ps(halfGravity, _mm512_add_ps(hRight, hLeft)), _mm512_sub_ps(bRight, bLeft)));
+        
+        __m512 inverseSpeedDiff = _mm512_div_ps(one, _mm512_sub_ps(s1, s0));
+        __m512 beta0 = _mm512_mul_ps(_mm512_sub_ps(_mm512_mul_ps(s1, f0), f1), inverseSpeedDiff);
+        __m512 beta1 = _mm512_mul_ps(_mm512_sub_ps(f1, _mm512_mul_ps(s0, f0)), inverseSpeedDiff);
+        
+        __m512 hUpdateLeft = zero, hUpdateRight = zero, huUpdateLeft = zero, huUpdateRight = zero;
+        __m512 speeds[2] = { s0, s1 };
+        __m512 betas[2] = { beta0, beta1 };
+        for(int w = 0; w < 2; w++) {
+            __mmask16 negative = _mm512_cmp_ps_mask(speeds[w], negZero, _CMP_LT_OQ);
+            __mmask16 positive = _mm512_cmp_ps_mask(speeds[w], posZero, _CMP_GT_OQ);
+            __m512 fractionLeft = _mm512_mask_blend_ps(negative, _mm512_mask_blend_ps(positive, half, zero), one);
+            __m512 fractionRight = _mm512_mask_blend_ps(positive, _mm512_mask_blend_ps(negative, half, zero), one);
+            __m512 waveMomentum = _mm512_mul_ps(betas[w], speeds[w]);
+            hUpdateLeft = _mm512_add_ps(hUpdateLeft, _mm512_mul_ps(fractionLeft, betas[w]));
+            huUpdateLeft = _mm512_add_ps(huUpdateLeft, _mm512_mul_ps(fractionLeft, waveMomentum));
+            hUpdateRight = _mm512_add_ps(hUpdateRight, _mm512_mul_ps(fractionRight, betas[w]));
+            huUpdateRight = _mm512_add_ps(huUpdateRight, _mm512_mul_ps(fractionRight, waveMomentum));
+        }
+        
+        // no updates for dry cells
+        __mmask16 updateLeft = wetL & wet;
+        __mmask16 updateRight = wetR & wet;
+        _mm512_mask_storeu_ps(hUL + k, active, _mm512_maskz_mov_ps(updateLeft, hUpdateLeft));
+        _mm512_mask_storeu_ps(huUL + k, active, _mm512_maskz_mov_ps(updateLeft, huUpdateLeft));
+        _mm512_mask_storeu_ps(hUR + k, active, _mm512_maskz_mov_ps(updateRight, hUpdateRight));
+        _mm512_mask_storeu_ps(huUR + k, active, _mm512_maskz_mov_ps(updateRight, huUpdateRight));
+        
+        __m512 speed = _mm512_maskz_max_ps(active, _mm512_abs_ps(s0), _mm512_abs_ps(s1));
+        maxSpeed = _mm512_mask_max_ps(maxSpeed, wet, maxSpeed, speed);
+    }
+    
+    // horizontal maximum
+    float lanes[16];
+    _mm512_storeu_ps(lanes, maxSpeed);
+    float maxWaveSpeed = o_maxWaveSpeed;
+    for(int l = 0; l < 16; l++)
+        maxWaveSpeed = std::max(maxWaveSpeed, lanes[l]);
+    o_maxWaveSpeed = maxWaveSpeed;
+}
+#endif
+
+FWaveBatch::FWaveBatch(float i_dryTol, float i_gravity, float i_zeroTol)
+    : dryTol(i_dryTol),
+      gravity(i_gravity),
+      zeroTol(i_zeroTol),
+      instructionSet(detectInstructionSet())
+{
+}
+
+void FWaveBatch::computeNetUpdates(int n,
+    const float *hLeft, const float *hRight,
+    const float *huLeft, const float *huRight,
+    const float *bLeft, const float *bRight,
+    float *o_hUpdateLeft, float *o_hUpdateRight,
+    float *o_huUpdateLeft, float *o_huUpdateRight,
+    float &o_maxWaveSpeed) const
+{
+    switch(instructionSet) {
+#ifdef FWAVEBATCH_AVX512
+        case AVX512:
+            computeNetUpdatesAVX512(gravity, dryTol, zeroTol, n, hLeft, hRight, huLeft, huRight, bLeft, bRight,
+                o_hUpdateLeft, o_hUpdateRight, o_huUpdateLeft, o_huUpdateRight, o_maxWaveSpeed);
+            break;
+#endif
+#ifdef FWAVEBATCH_AVX2
+        case AVX2:
+            computeNetUpdatesAVX2(gravity, dryTol, zeroTol, n, hLeft, hRight, huLeft, huRight, bLeft, bRight,
+                o_hUpdateLeft, o_hUpdateRight, o_huUpdateLeft, o_huUpdateRight, o_maxWaveSpeed);
+            break;
+#endif
+        default:
+            computeNetUpdatesScalar(gravity, dryTol, zeroTol, n, hLeft, hRight, huLeft, huRight, bLeft, bRight,
+                o_hUpdateLeft, o_hUpdateRight, o_huUpdateLeft, o_huUpdateRight, o_maxWaveSpeed);
+            break;
+    }
+}
+
+FWaveBatch::InstructionSet FWaveBatch::detectInstructionSet()
+{
+#ifdef FWAVEBATCH_AVX2
+    __builtin_cpu_init();
+  #ifdef FWAVEBATCH_AVX512
+    if(__builtin_cpu_supports("avx512f"))
+        return AVX512;
+  #endif
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return AVX2;
+#endif
+    return SCALAR;
+}
+
+const char* FWaveBatch::getInstructionSetName(InstructionSet i_instructionSet)
+{
+    switch(i_instructionSet) {
+        case AVX512:
+            return "AVX-512";
+        case AVX2:
+            return "AVX2";
+        default:
+            return "scalar";
+    }
+}
+
+}
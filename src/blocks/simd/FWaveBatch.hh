@@ -0,0 +1,80 @@
+#ifndef FWAVEBATCH_HH_
+#define FWAVEBATCH_HH_
+
+namespace solver {
+
+/**
+ * F-Wave solver computing the net updates of a batch of edges at once.
+ *
+ * The edges of a batch are passed as arrays, i.e. a whole column of the
+ * X-Sweep (h[i][*] and h[i+1][*]) or of the Y-Sweep (hStar[i][j] and hStar[i][j+1])
+ * can be processed with one call.
+ * Wet/dry states are handled with masks instead of branches (reflecting
+ * wall at dry cells, zero updates for two dry cells) and the maximum wave
+ * speed is reduced in registers.
+ *
+ * The implementation (scalar, AVX2 or AVX-512) is selected at runtime
+ * depending on the features of the CPU.
+ */
+class FWaveBatch {
+public:
+    /// Available implementations
+    enum InstructionSet {
+        SCALAR, AVX2, AVX512
+    };
+    
+private:
+    //! Water heights below dryTol are considered dry
+    float dryTol;
+    //! Gravity constant
+    float gravity;
+    //! Wave speeds with an absolute value below zeroTol are split between both cells
+    float zeroTol;
+    
+    //! The implementation used by computeNetUpdates
+    InstructionSet instructionSet;
+    
+public:
+    /// Constructor
+    /**
+     * Selects the fastest implementation supported by the CPU
+     *
+     * @param i_dryTol Water heights below this value are considered dry
+     * @param i_gravity Gravity constant
+     * @param i_zeroTol Wave speeds below this value are treated as zero
+     */
+    FWaveBatch(float i_dryTol = 0.01f, float i_gravity = 9.81f, float i_zeroTol = 0.000000001f);
+    
+    /// Compute the net updates for n edges
+    /**
+     * Edge k lies between the cells (hLeft[k], huLeft[k], bLeft[k])
+     * and (hRight[k], huRight[k], bRight[k]).
+     *
+     * @param n Number of edges
+     * @param o_maxWaveSpeed Set to the maximum of its old value and the
+     *  wave speeds of all edges in the batch
+     */
+    void computeNetUpdates(int n,
+        const float *hLeft, const float *hRight,
+        const float *huLeft, const float *huRight,
+        const float *bLeft, const float *bRight,
+        float *o_hUpdateLeft, float *o_hUpdateRight,
+        float *o_huUpdateLeft, float *o_huUpdateRight,
+        float &o_maxWaveSpeed) const;
+    
+    /// @return The implementation used by this solver
+    InstructionSet getInstructionSet() const { return instructionSet; }
+    
+    /// Force a specific implementation (it must be supported by the CPU)
+    void setInstructionSet(InstructionSet i_instructionSet) { instructionSet = i_instructionSet; }
+    
+    /// @return The fastest implementation supported by the CPU (and the compiler)
+    static InstructionSet detectInstructionSet();
+    
+    /// @return Name of an implementation
+    static const char* getInstructionSetName(InstructionSet i_instructionSet);
+};
+
+}
+
+#endif /* FWAVEBATCH_HH_ */
@@ -1,8 +1,10 @@
+#include <cstdio>
 #include <iostream>
 #include <unistd.h>
 
 #ifdef USEOPENCL
 #include "blocks/opencl/SWE_DimensionalSplittingOpenCL.hh"
+#include "blocks/opencl/OpenCLTuningCache.hh"
 #else
 #include "blocks/SWE_DimensionalSplitting.hh"
 #endif
@@ -18,6 +20,9 @@
 #else
 #include "writer/VtkWriter.hh"
 #endif
+#ifdef ASYNC_OUTPUT
+#include "writer/AsyncWriter.hh"
+#endif
 
 #include "tools/help.hh"
 #include "tools/Logger.hh"
@@ -58,6 +63,39 @@ int main( int argc, char** argv ) {
     
     //! Chosen kernel optimization type
     KernelType l_kernelType = MEM_GLOBAL;
+    
+    //! Compute the time step on the device and read it only at checkpoints
+    bool l_deviceTimestep = false;
+    
+    //! Reduce the maximum wave speed in the sweep kernels (false = separate reduce kernels)
+    bool l_fusedReduction = true;
+    
+    //! Preferred OpenCL device type (0 = best available type)
+    cl_device_type l_deviceType = 0;
+    
+    //! Tuning cache file name (empty = no auto-tuning)
+    std::string l_tuningCacheFileName;
+    
+    //! Directory of the cached OpenCL program binaries (empty = build from source)
+    std::string l_programCacheDirectory;
+#else
+    //! Tile width of the fused X/Y-Sweep (0 = separate sweeps)
+    int l_fusedTileWidth = 0;
+    
+    //! Number of rows per strip of the X-Sweep (0 = whole columns)
+    int l_sweepBlockRows = 0;
+    
+    //! Size of the tiles used to skip inactive regions (0 = compute all cells)
+    int l_activeTileSize = 0;
+    
+    //! Pad the columns of all arrays to cache line boundaries
+    bool l_paddedArrays = false;
+    
+    //! Use the vectorized batch F-Wave solver
+    bool l_batchSolver = false;
+    
+    //! CFL number used to compute the timestep
+    float l_cflNumber = .4f;
 #endif
     
     //! type of boundary conditions at LEFT, RIGHT, TOP, and BOTTOM boundary
@@ -82,6 +120,11 @@ int main( int argc, char** argv ) {
     //! number of checkpoints for visualization (at each checkpoint in time, an output file is written).
     int l_numberOfCheckPoints = 20;
     
+#ifdef WRITENETCDF
+    //! chunking, compression and precision of the output file
+    io::NetCdfOptions l_netCdfOptions;
+#endif
+    
     // Option Parsing
     // REQUIRED
     // -x <num>        // Number of cells in x-dir
@@ -95,9 +138,26 @@ int main( int argc, char** argv ) {
     // -l <num>        // maximum number of computing devices
     // -m <code>       // Kernel memory optimization type
     // -g <num         // Kernel work group size
+    // -w <num>        // Tile width of the fused X/Y-Sweep (0 = separate sweeps)
+    // -v              // Use the vectorized batch F-Wave solver
+    // -r <num>        // Number of rows per strip of the X-Sweep (0 = whole columns)
+    // -a <num>        // Size of the tiles used to skip inactive regions (0 = compute all cells)
+    // -P              // Pad the columns of all arrays to cache line boundaries
+    // -F <float>      // CFL number used to compute the timestep
     // -n <num>        // Number of checkpoints
     // -t <float>      // Simulation time in seconds
     // -s <scenario>   // Artificial scenario name ("artificialtsunami", "partialdambreak")
+    // -z <num>        // Deflate level of the netCDF output
+    // -S              // Shuffle the bytes of the netCDF output before compression
+    // -k <x>,<y>      // Chunk size of the netCDF output
+    // -p <h>[,<hu>]   // Store the unknowns as 16 bit fixed point with the given resolutions of h and hu/hv
+    // -q <num>        // Store the unknowns with the given number of mantissa bits
+    // -K <num>[,<float>] // Keyframe interval and tolerance of incremental netCDF output
+    // -T              // Compute the time step on the device (OpenCL only)
+    // -R              // Reduce the maximum wave speed with separate kernels (OpenCL only)
+    // -A              // Use all devices of the platform, e.g. CPU and GPU (OpenCL only)
+    // -U <file>       // Auto-tune the kernels, cache the results in <file> (OpenCL only)
+    // -C <dir>        // Cache the compiled kernels in <dir> (OpenCL only)
     // -b <code>       // Boundary conditions, "w" or "o"
     //                 // 1 value: for all
     //                 // 2 values: first is left/right, second is top/bottom
@@ -105,7 +165,7 @@ int main( int argc, char** argv ) {
     int c;
     int showUsage = 0;
     std::string optstr;
-    while ((c = getopt(argc, argv, "x:y:o:i:d:c:n:t:b:s:f:l:m:g:")) != -1) {
+    while ((c = getopt(argc, argv, "x:y:o:i:d:c:n:t:b:s:f:l:m:g:w:vr:a:z:Sk:p:q:K:TRAU:C:PF:")) != -1) {
         switch(c) {
             case 'x':
                 l_nX = atoi(optarg);
@@ -137,6 +197,61 @@ int main( int argc, char** argv ) {
                 l_maxGroupSize = atoi(optarg);
 #endif
             break;
+            case 'T':
+#ifdef USEOPENCL
+                l_deviceTimestep = true;
+#endif
+                break;
+            case 'R':
+#ifdef USEOPENCL
+                l_fusedReduction = false;
+#endif
+                break;
+            case 'A':
+#ifdef USEOPENCL
+                l_deviceType = CL_DEVICE_TYPE_ALL;
+#endif
+                break;
+            case 'U':
+#ifdef USEOPENCL
+                l_tuningCacheFileName = std::string(optarg);
+#endif
+                break;
+            case 'C':
+#ifdef USEOPENCL
+                l_programCacheDirectory = std::string(optarg);
+#endif
+                break;
+            case 'w':
+#ifndef USEOPENCL
+                l_fusedTileWidth = atoi(optarg);
+#endif
+                break;
+            case 'v':
+#ifndef USEOPENCL
+                l_batchSolver = true;
+#endif
+                break;
+            case 'r':
+#ifndef USEOPENCL
+                l_sweepBlockRows = atoi(optarg);
+#endif
+                break;
+            case 'a':
+#ifndef USEOPENCL
+                l_activeTileSize = atoi(optarg);
+#endif
+                break;
+            case 'P':
+#ifndef USEOPENCL
+                l_paddedArrays = true;
+#endif
+                break;
+            case 'F':
+#ifndef USEOPENCL
+                l_cflNumber = atof(optarg);
+#endif
+                break;
             case 'm':
 #ifdef USEOPENCL
                 optstr = std::string(optarg);
@@ -193,6 +308,44 @@ int main( int argc, char** argv ) {
             case 'f':
                 l_coarseness = atof(optarg);
                 break;
+#ifdef WRITENETCDF
+            case 'z':
+                l_netCdfOptions.deflateLevel = atoi(optarg);
+                break;
+            case 'S':
+                l_netCdfOptions.shuffle = true;
+                break;
+            case 'k':
+                if(sscanf(optarg, "%u,%u", &l_netCdfOptions.chunkX, &l_netCdfOptions.chunkY) != 2) {
+                    std::cerr << "Invalid option argument: Invalid chunk size (-k)" << std::endl;
+                    showUsage = 1;
+                }
+                break;
+            case 'p':
+                l_netCdfOptions.precision = io::NetCdfOptions::FIXED_POINT;
+                switch(sscanf(optarg, "%f,%f", &l_netCdfOptions.heightResolution, &l_netCdfOptions.dischargeResolution)) {
+                    case 2:
+                        break;
+                    case 1:
+                        // the discharge uses the resolution of the height by default
+                        l_netCdfOptions.dischargeResolution = l_netCdfOptions.heightResolution;
+                        break;
+                    default:
+                        // rejected below
+                        l_netCdfOptions.heightResolution = 0.f;
+                }
+                break;
+            case 'q':
+                l_netCdfOptions.precision = io::NetCdfOptions::ROUNDED_FLOAT;
+                l_netCdfOptions.mantissaBits = atoi(optarg);
+                break;
+            case 'K':
+                if(sscanf(optarg, "%u,%f", &l_netCdfOptions.keyframeInterval, &l_netCdfOptions.keyframeTolerance) < 1) {
+                    std::cerr << "Invalid option argument: Invalid keyframe interval (-K)" << std::endl;
+                    showUsage = 1;
+                }
+                break;
+#endif
             default:
                 showUsage = 1;
                 break;
@@ -221,6 +374,21 @@ int main( int argc, char** argv ) {
             std::cerr << "Invalid option argument: The coarseness factor must be greater than or equal to 1.0 (-f)" << std::endl;
             showUsage = 1;
         }
+#ifdef WRITENETCDF
+        if(l_netCdfOptions.deflateLevel < 0 || l_netCdfOptions.deflateLevel > 9) {
+            std::cerr << "Invalid option argument: The deflate level must be between 0 and 9 (-z)" << std::endl;
+            showUsage = 1;
+        }
+        if(l_netCdfOptions.precision == io::NetCdfOptions::FIXED_POINT
+            && !(l_netCdfOptions.heightResolution > 0.f && l_netCdfOptions.dischargeResolution > 0.f)) {
+            std::cerr << "Invalid option argument: The fixed point resolution must be greater than zero (-p)" << std::endl;
+            showUsage = 1;
+        }
+        if(l_netCdfOptions.mantissaBits < 1 || l_netCdfOptions.mantissaBits > 23) {
+            std::cerr << "Invalid option argument: The number of mantissa bits must be between 1 and 23 (-q)" << std::endl;
+            showUsage = 1;
+        }
+#endif
         
         // Check if a checkpoint-file is given as input. If so, switch to checkpoint scenario
         if(!l_checkpointFileName.empty()) {
@@ -255,6 +423,15 @@ int main( int argc, char** argv ) {
             std::cout << "Group size must be greater than zero and a power of two!" << std::endl;
             showUsage = 1;
         }
+#else
+        if(l_fusedTileWidth < 0) {
+            std::cerr << "Invalid option argument: The tile width must not be negative (-w)" << std::endl;
+            showUsage = 1;
+        }
+        if(!(l_cflNumber > 0.f && l_cflNumber <= .5f)) {
+            std::cerr << "Invalid option argument: The CFL number must be in (0, 0.5] (-F)" << std::endl;
+            showUsage = 1;
+        }
 #endif
     }
     
@@ -276,7 +453,31 @@ int main( int argc, char** argv ) {
         std::cout << "    -n <num>        Number of checkpoints to be written" << std::endl;
         std::cout << "    -t <time>       Total simulation time" << std::endl;
         std::cout << "    -f <num>        Coarseness factor (> 1.0)" << std::endl;
+        std::cout << "    -z <num>        Deflate level of the output, 0 for no compression (NetCDF only)" << std::endl;
+        std::cout << "    -S              Shuffle the bytes of the output before compression (NetCDF only)" << std::endl;
+        std::cout << "    -k <x>,<y>      Chunk size of the output, 0 for the whole dimension (NetCDF only)" << std::endl;
+        std::cout << "    -p <h>[,<hu>]   Store h, hu and hv as 16 bit fixed point numbers with the resolution <h> of h" << std::endl;
+        std::cout << "                    and <hu> (default <h>) of hu and hv, values beyond +-32767 times the" << std::endl;
+        std::cout << "                    resolution are clipped with a warning (NetCDF only)" << std::endl;
+        std::cout << "    -q <num>        Store h, hu and hv with only the given number of mantissa bits, 1-23 (NetCDF only)" << std::endl;
+        std::cout << "    -K <num>[,<tol>] Write a full checkpoint every <num> checkpoints, in between only the tiles (-k)" << std::endl;
+        std::cout << "                    that changed by more than <tol> (default 0) since the last full one (NetCDF only)" << std::endl;
         std::cout << "    -l <num>        Maximum number of computing devices (OpenCL only)" << std::endl;
+        std::cout << "    -T              Compute the time step on the devices, synchronize only at checkpoints (OpenCL only)" << std::endl;
+        std::cout << "    -R              Reduce the maximum wave speed with separate kernels instead of" << std::endl;
+        std::cout << "                    in the sweep kernels (OpenCL only)" << std::endl;
+        std::cout << "    -A              Use all devices of the platform, e.g. CPU and GPU, the columns are split" << std::endl;
+        std::cout << "                    by the measured device throughput (OpenCL only)" << std::endl;
+        std::cout << "    -U <filename>   Measure all kernel memory types and work group sizes and use the fastest," << std::endl;
+        std::cout << "                    the results are cached in the file for later runs, overrides -m and -g (OpenCL only)" << std::endl;
+        std::cout << "    -C <directory>  Cache the compiled kernels in the directory to skip the kernel build" << std::endl;
+        std::cout << "                    in later runs (OpenCL only)" << std::endl;
+        std::cout << "    -w <num>        Tile width (columns) of the fused X/Y-Sweep, 0 for separate sweeps (CPU only)" << std::endl;
+        std::cout << "    -v              Use the vectorized batch F-Wave solver (CPU only)" << std::endl;
+        std::cout << "    -r <num>        Rows per strip of the X-Sweep, 0 for whole columns (CPU only)" << std::endl;
+        std::cout << "    -a <num>        Size of the tiles used to skip regions without changes, 0 to compute all cells (CPU only)" << std::endl;
+        std::cout << "    -P              Pad the columns of all arrays to cache line boundaries (CPU only)" << std::endl;
+        std::cout << "    -F <float>      CFL number used to compute the time step, 0 < CFL <= 0.5 (default 0.4, CPU only)" << std::endl;
         std::cout << "    -b <code>       Boundary Conditions" << std::endl;
         std::cout << "                    Codes: Combination of 'w' (WALL) and 'o' (OUTFLOW)" << std::endl;
         std::cout << "                      One char: Option for ALL boundaries" << std::endl;
@@ -289,7 +490,7 @@ int main( int argc, char** argv ) {
         std::cout << "                    Scenarios: 'artificialtsunami', 'partialdambreak'" << std::endl;
         std::cout << "" << std::endl;
         std::cout << "Notes when using a checkpointfile:" << std::endl;
-        std::cout << "    -x, -y, -n, -t, -b, -i, -d, -s are ignored (values are read from checkpointfile)" << std::endl;
+        std::cout << "    -x, -y, -n, -t, -b, -i, -d, -s, -z, -S, -k, -p, -q are ignored (values are read from checkpointfile)" << std::endl;
         std::cout << "    An output file (-o) can be specified. In that case, the checkpointfile" << std::endl;
         std::cout << "    is copied to that location and output is appended to the output file." << std::endl;
         std::cout << "    If no output file is specified, output is appended to the checkpointfile." << std::endl;
@@ -376,9 +577,30 @@ int main( int argc, char** argv ) {
     
     //! Dimensional Splitting Block
 #ifndef USEOPENCL
+    if(l_paddedArrays)
+        Float2D::setDefaultPadding(Float2D::PADDING_ALIGNED);
     SWE_DimensionalSplitting l_dimensionalSplitting(l_nX, l_nY, l_dX, l_dY);
+    l_dimensionalSplitting.setFusedTileWidth(l_fusedTileWidth);
+    l_dimensionalSplitting.setBatchSolver(l_batchSolver);
+    l_dimensionalSplitting.setSweepBlockRows(l_sweepBlockRows);
+    l_dimensionalSplitting.setActiveTileSize(l_activeTileSize);
+    l_dimensionalSplitting.setCflNumber(l_cflNumber);
+    if(l_batchSolver)
+        std::cout << "Using batch F-Wave solver ("
+                  << solver::FWaveBatch::getInstructionSetName(l_dimensionalSplitting.getBatchSolver().getInstructionSet())
+                  << ")" << std::endl;
 #else
-    SWE_DimensionalSplittingOpenCL l_dimensionalSplitting(l_nX, l_nY, l_dX, l_dY, 0, l_maxDevices, l_kernelType, l_maxGroupSize);
+    if(!l_tuningCacheFileName.empty()) {
+        OpenCLTuningCache l_tuningCache(l_tuningCacheFileName);
+        KernelConfig l_kernelConfig = SWE_DimensionalSplittingOpenCL::tune(l_tuningCache,
+            l_nX, l_nY, l_dX, l_dY, *l_scenario,
+            l_scenario->getBoundaryPos(BND_LEFT), l_scenario->getBoundaryPos(BND_BOTTOM),
+            l_deviceType, l_maxDevices, l_deviceTimestep, l_fusedReduction, l_programCacheDirectory);
+        l_kernelType = l_kernelConfig.kernelType;
+        l_maxGroupSize = l_kernelConfig.workGroupSize;
+    }
+    SWE_DimensionalSplittingOpenCL l_dimensionalSplitting(l_nX, l_nY, l_dX, l_dY, l_deviceType, l_maxDevices, l_kernelType, l_maxGroupSize, l_deviceTimestep,
+        l_fusedReduction, l_programCacheDirectory);
     l_dimensionalSplitting.printDeviceInformation();
 #endif
     
@@ -471,7 +693,9 @@ int main( int argc, char** argv ) {
   		l_nX, l_nY,
   		l_dX, l_dY,
   		l_originX, l_originY,
-        l_coarseness);
+        l_coarseness,
+        0,
+        l_netCdfOptions);
         
         l_writer.writeSimulationInfo(l_numberOfCheckPoints, l_endSimulation, l_boundaryTypes);
 #else
@@ -483,10 +707,17 @@ int main( int argc, char** argv ) {
   		l_dX, l_dY,
         0, 0,
         l_coarseness);
+#endif
+#ifdef ASYNC_OUTPUT
+    // write the output in a background thread
+    io::AsyncWriter l_asyncWriter(l_writer);
+    io::Writer &l_output = l_asyncWriter;
+#else
+    io::Writer &l_output = l_writer;
 #endif
     if(l_scenarioName != SCENARIO_CHECKPOINT_TSUNAMI) {
         // Write zero time step
-        l_writer.writeTimeStep( l_dimensionalSplitting.getWaterHeight(),
+        l_output.writeTimeStep( l_dimensionalSplitting.getWaterHeight(),
                                 l_dimensionalSplitting.getDischarge_hu(),
                                 l_dimensionalSplitting.getDischarge_hv(), 
                                 (float) 0.);
@@ -507,6 +738,16 @@ int main( int argc, char** argv ) {
     // loop over checkpoints
     while(l_checkpoint <= l_numberOfCheckPoints) {
         
+#ifdef USEOPENCL
+        if(l_deviceTimestep && l_t < l_checkPoints[l_checkpoint]) {
+            // enqueue all time steps until the next checkpoint at once
+            tools::Logger::logger.resetCpuClockToCurrentTime();
+            l_t = l_dimensionalSplitting.simulate(l_t, l_checkPoints[l_checkpoint]);
+            tools::Logger::logger.updateCpuTime();
+            l_iterations += l_dimensionalSplitting.getSimulatedTimesteps();
+        }
+#endif
+        
         // do time steps until next checkpoint is reached
         while( l_t < l_checkPoints[l_checkpoint] ) {
             // set values in ghost cells:
@@ -542,7 +783,7 @@ int main( int argc, char** argv ) {
         progressBar.update(l_t);
         
         // write output
-        l_writer.writeTimeStep( l_dimensionalSplitting.getWaterHeight(),
+        l_output.writeTimeStep( l_dimensionalSplitting.getWaterHeight(),
                               l_dimensionalSplitting.getDischarge_hu(),
                               l_dimensionalSplitting.getDischarge_hv(),
                               l_t);
@@ -553,6 +794,11 @@ int main( int argc, char** argv ) {
     /**
      * Finalize.
      */
+#ifdef ASYNC_OUTPUT
+    // wait for the remaining output
+    l_asyncWriter.flush();
+#endif
+    
     // write the statistics message
     progressBar.clear();
     tools::Logger::logger.printStatisticsMessage();
@@ -563,6 +809,11 @@ int main( int argc, char** argv ) {
     // print the wall clock time (includes plotting)
     tools::Logger::logger.printWallClockTime(time(NULL));
     
+#ifdef ASYNC_OUTPUT
+    // print the output time and how much of it was overlapped with the simulation
+    tools::Logger::logger.printAsynchronousOutputTime(l_asyncWriter.getWriteTime(), l_asyncWriter.getHiddenTime());
+#endif
+    
     // printer iteration counter
     tools::Logger::logger.printIterationsDone(l_iterations);
     
@@ -31,8 +31,11 @@
 #include <cassert>
 #include <cmath>
 #include <cstdlib>
+#include <fstream>
+#include <limits>
 #include <mpi.h>
 #include <string>
+#include <unistd.h>
 #include <vector>
 
 #ifndef CUDA
@@ -43,9 +46,13 @@
 
 #ifdef WRITENETCDF
 #include "writer/NetCdfWriter.hh"
+#include "scenarios/SWE_CheckpointTsunamiScenario.hh"
 #else
 #include "writer/VtkWriter.hh"
 #endif
+#ifdef ASYNC_OUTPUT
+#include "writer/AsyncWriter.hh"
+#endif
 
 #ifdef ASAGI
 #include "scenarios/SWE_AsagiScenario.hh"
@@ -88,6 +95,33 @@ void exchangeBottomTopGhostLayers( const int i_bottomNeighborRank, SWE_Block1D*
                                    const int i_topNeighborRank,    SWE_Block1D* o_topNeighborInflow,    SWE_Block1D* i_topNeighborOutflow,
                                    const MPI_Datatype i_mpiRow);
 
+#ifdef OVERLAP_COMMUNICATION
+/**
+ * Ghost and copy layer at one boundary of the block,
+ * including the buffers for the packed non-blocking exchange.
+ */
+struct PackedGhostLayer {
+  //! MPI rank of the neighbor (MPI_PROC_NULL at the boundary of the domain)
+  int neighborRank;
+  //! ghost layer, where the neighbor writes into
+  SWE_Block1D* inflow;
+  //! copy layer, where the neighbor reads from
+  SWE_Block1D* outflow;
+  //! number of cells of the layer (without ghost cells)
+  int size;
+  //! h, hu and hv of the copy layer
+  std::vector<float> sendBuffer;
+  //! h, hu and hv of the ghost layer
+  std::vector<float> receiveBuffer;
+};
+
+// Packs the copy layers and starts the exchange with all neighbors.
+void startGhostLayerExchange(PackedGhostLayer* io_layers, MPI_Request* o_requests);
+
+// Waits for the exchange and unpacks the ghost layers.
+void finishGhostLayerExchange(PackedGhostLayer* io_layers, MPI_Request* io_requests);
+#endif // OVERLAP_COMMUNICATION
+
 // Get command line argument by the specified name.
 static char* getArgByName(std::vector<std::string> vargs, std::string arg_name, char** argv)
 {
@@ -157,11 +191,52 @@ int main( int argc, char** argv ) {
   vargs.push_back("simul_area_max_y");
   vargs.push_back("simul_duration_secs");
   #endif
-  if (argc != vargs.size()) {
-    std::cout << "Usage: " << vargs[0];
+
+  //! Size of the tiles used to skip regions without changes (0 = compute all cells)
+  int l_activeTileSize = 0;
+
+  //! netCDF output to resume the simulation from (empty = start at time zero),
+  //! the file of the whole domain (NETCDF_COLLECTIVE) or the base name of the files of all processes
+  std::string l_checkpointFileName;
+
+  int c;
+  int showUsage = 0;
+  while((c = getopt(argc, argv, "a:r:")) != -1) {
+    switch(c) {
+      case 'a':
+        l_activeTileSize = atoi(optarg);
+        if(l_activeTileSize < 0)
+          showUsage = 1;
+        break;
+      case 'r':
+        l_checkpointFileName = std::string(optarg);
+        break;
+      default:
+        showUsage = 1;
+        break;
+    }
+  }
+  // the positional arguments follow the options
+  argc -= optind - 1;
+  argv += optind - 1;
+
+  if (showUsage || argc != vargs.size()) {
+    std::cout << "Usage: " << vargs[0] << " [OPTIONS]";
     for (int i = 1, e = vargs.size(); i != e; i++)
       std::cout << " <" << vargs[i] << ">";
-    std::cout << std::endl << std::flush;
+    std::cout << std::endl
+              << "Options:" << std::endl
+              << "\t-a <num>\tSize of the tiles used to skip regions without changes, 0 to compute all cells (CPU only)" << std::endl
+#ifdef NETCDF_COLLECTIVE
+              << "\t-r <file>\tResume the simulation from the last time step of a netCDF file of the whole domain." << std::endl
+              << "\t\t\tThe grid size and the number of output steps are read from the file." << std::endl
+#else
+              << "\t-r <base>\tResume the simulation from the last time step of the netCDF files <base>_<x><y>.nc" << std::endl
+              << "\t\t\tof a run with the same grid size and number of processes (netCDF only)." << std::endl
+              << "\t\t\tThe number of output steps is read from the files." << std::endl
+#endif
+              << "\t\t\tThe output continues the checkpoint (or a copy if the output name differs)." << std::endl
+              << std::flush;
 
     MPI_Finalize();
     return 1;
@@ -181,6 +256,23 @@ int main( int argc, char** argv ) {
   l_baseName = std::string(ARG("output_basepath"));
   #endif
 
+#ifdef WRITENETCDF
+  //! checkpoint to resume from, every process reads the cells of its own block
+  SWE_CheckpointTsunamiScenario* l_checkpointScenario = 0L;
+#ifdef NETCDF_COLLECTIVE
+  if (!l_checkpointFileName.empty()) {
+    l_checkpointScenario = new SWE_CheckpointTsunamiScenario(l_checkpointFileName);
+    l_checkpointScenario->getNumberOfCells(l_nX, l_nY);
+  }
+#endif
+#else
+  if (!l_checkpointFileName.empty()) {
+    std::cerr << "Resuming from a checkpoint requires netCDF output (-r)" << std::endl;
+    MPI_Finalize();
+    return 1;
+  }
+#endif
+
   // read xml file
   #ifdef READXML
   assert(false); //TODO: not implemented.
@@ -217,6 +309,14 @@ int main( int argc, char** argv ) {
   l_blockPositionX = l_mpiRank / l_blocksY;
   l_blockPositionY = l_mpiRank % l_blocksY;
 
+#if defined(WRITENETCDF) && !defined(NETCDF_COLLECTIVE)
+  if (!l_checkpointFileName.empty()) {
+    // every process resumes from its own output file (same layout of blocks)
+    l_checkpointFileName = generateBaseFileName(l_checkpointFileName, l_blockPositionX, l_blockPositionY) + ".nc";
+    l_checkpointScenario = new SWE_CheckpointTsunamiScenario(l_checkpointFileName);
+  }
+#endif
+
   #ifdef ASAGI
   /*
    * Pixel node registration used [Cartesian grid]
@@ -244,9 +344,21 @@ int main( int argc, char** argv ) {
   SWE_BathymetryDamBreakScenario l_scenario;
   #endif
 
+  //! scenario the block is initialized with (the checkpoint if the simulation is resumed)
+  SWE_Scenario* l_initialScenario = &l_scenario;
+
   //! number of checkpoints for visualization (at each checkpoint in time, an output file is written).
   int l_numberOfCheckPoints = atoi(ARG("output_steps_count"));
 
+#ifdef WRITENETCDF
+  if (l_checkpointScenario != 0L) {
+#ifdef NETCDF_COLLECTIVE
+    l_initialScenario = l_checkpointScenario;
+#endif
+    l_numberOfCheckPoints = l_checkpointScenario->getNumberOfCheckpoints();
+  }
+#endif
+
   //! number of grid cells in x- and y-direction per process.
   int l_nXLocal, l_nYLocal;
 
@@ -258,8 +370,8 @@ int main( int argc, char** argv ) {
   l_nYLocal = (l_blockPositionY < l_blocksY-1) ? l_nY/l_blocksY : l_nY - (l_blocksY-1)*(l_nY/l_blocksY);
 
   // compute the size of a single cell
-  l_dX = (l_scenario.getBoundaryPos(BND_RIGHT) - l_scenario.getBoundaryPos(BND_LEFT) )/l_nX;
-  l_dY = (l_scenario.getBoundaryPos(BND_TOP) - l_scenario.getBoundaryPos(BND_BOTTOM) )/l_nY;
+  l_dX = (l_initialScenario->getBoundaryPos(BND_RIGHT) - l_initialScenario->getBoundaryPos(BND_LEFT) )/l_nX;
+  l_dY = (l_initialScenario->getBoundaryPos(BND_TOP) - l_initialScenario->getBoundaryPos(BND_BOTTOM) )/l_nY;
 
   // print information about the cell size and local number of cells
   tools::Logger::logger.printCellSize(l_dX, l_dY);
@@ -268,13 +380,33 @@ int main( int argc, char** argv ) {
   //! origin of the simulation domain in x- and y-direction
   float l_originX, l_originY;
 
-  // get the origin from the scenario
-  l_originX = l_scenario.getBoundaryPos(BND_LEFT) + l_blockPositionX*l_nXLocal*l_dX;;
-  l_originY = l_scenario.getBoundaryPos(BND_BOTTOM) + l_blockPositionY*l_nYLocal*l_dY;
+  //! offset of the local block in the global grid (the last block may be larger)
+  int l_offsetX = l_blockPositionX*(l_nX/l_blocksX);
+  int l_offsetY = l_blockPositionY*(l_nY/l_blocksY);
+
+  // get the origin from the scenario of the whole domain
+  l_originX = l_initialScenario->getBoundaryPos(BND_LEFT) + l_offsetX*l_dX;
+  l_originY = l_initialScenario->getBoundaryPos(BND_BOTTOM) + l_offsetY*l_dY;
+
+#if defined(WRITENETCDF) && !defined(NETCDF_COLLECTIVE)
+  if (l_checkpointScenario != 0L) {
+    // the file of a process only covers its block, the domain (cell size and origin) is the one of the scenario
+    int l_checkpointNX, l_checkpointNY;
+    l_checkpointScenario->getNumberOfCells(l_checkpointNX, l_checkpointNY);
+    if (l_checkpointNX != l_nXLocal || l_checkpointNY != l_nYLocal) {
+      std::cerr << l_checkpointFileName << " has " << l_checkpointNX << " x " << l_checkpointNY
+                << " cells, expected " << l_nXLocal << " x " << l_nYLocal
+                << " (resume with the grid size and number of processes of the checkpoint)" << std::endl;
+      MPI_Abort(MPI_COMM_WORLD, -1);
+    }
+    l_initialScenario = l_checkpointScenario;
+  }
+#endif
 
   // create a single wave propagation block
   #ifndef CUDA
   SWE_WavePropagationBlock l_wavePropgationBlock(l_nXLocal,l_nYLocal,l_dX,l_dY);
+  l_wavePropgationBlock.setActiveTileSize(l_activeTileSize);
   #else
   //! number of CUDA devices per node TODO: hardcoded
   int l_cudaDevicesPerNode = 7;
@@ -288,10 +420,41 @@ int main( int argc, char** argv ) {
   #endif
 
   // initialize the wave propgation block
-  l_wavePropgationBlock.initScenario(l_originX, l_originY, l_scenario, true);
+  l_wavePropgationBlock.initScenario(l_originX, l_originY, *l_initialScenario, true);
 
   //! time when the simulation ends.
-  float l_endSimulation = l_scenario.endSimulation();
+  float l_endSimulation = l_initialScenario->endSimulation();
+
+  //! simulation time.
+  float l_t = 0.0;
+
+  //! first checkpoint to compute
+  int l_firstCheckPoint = 1;
+
+#ifdef WRITENETCDF
+  if (l_checkpointScenario != 0L) {
+    // continue after the last time step of the checkpoint file
+    l_checkpointScenario->getLastCheckpoint(l_firstCheckPoint, l_t);
+    l_firstCheckPoint++;
+
+#ifndef NETCDF_COLLECTIVE
+    // the files of all processes have to end with the same checkpoint
+    int l_checkpointRange[2] = { -l_firstCheckPoint, l_firstCheckPoint };
+    MPI_Allreduce(MPI_IN_PLACE, l_checkpointRange, 2, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    if (-l_checkpointRange[0] != l_checkpointRange[1]) {
+      if (l_mpiRank == 0)
+        std::cerr << "The checkpoint files end with different checkpoints ("
+                  << -l_checkpointRange[0]-1 << " to " << l_checkpointRange[1]-1 << ")" << std::endl;
+      MPI_Finalize();
+      return 1;
+    }
+#endif
+
+    // close the checkpoint file before the writer opens it
+    delete l_checkpointScenario;
+    l_initialScenario = &l_scenario;
+  }
+#endif
 
   //! checkpoints when output files are written.
   float* l_checkPoints = new float[l_numberOfCheckPoints+1];
@@ -355,14 +518,16 @@ int main( int argc, char** argv ) {
    *
    *
    *  -> The stride for a row is ny+2, because we have to jump over a whole column
-   *     for every row-element. This holds only in the CPU-version, in CUDA a buffer is implemented.
+   *     for every row-element. If the columns are padded (see Float2D::setDefaultPadding)
+   *     the stride is the leading dimension of the arrays instead.
+   *     This holds only in the CPU-version, in CUDA a buffer is implemented.
    *     See SWE_BlockCUDA.hh/.cu for details.
    *  -> The stride for a column is 1, because we can access the elements linear in memory.
    */
-  //! MPI row-vector: l_nXLocal+2 blocks, 1 element per block, stride of l_nYLocal+2
+  //! MPI row-vector: l_nXLocal+2 blocks, 1 element per block, stride of the leading dimension (l_nYLocal+2 without padding)
   MPI_Datatype l_mpiRow;
   #ifndef CUDA
-  MPI_Type_vector(l_nXLocal+2, 1          , l_nYLocal+2, MPI_FLOAT, &l_mpiRow);
+  MPI_Type_vector(l_nXLocal+2, 1          , l_wavePropgationBlock.getWaterHeight().getLeadingDimension(), MPI_FLOAT, &l_mpiRow);
   #else
   MPI_Type_vector(1,           l_nXLocal+2, 1          , MPI_FLOAT, &l_mpiRow);
   #endif
@@ -398,24 +563,84 @@ int main( int argc, char** argv ) {
                   l_topNeighborRank,    l_topInflow,    l_topOutflow,
                   l_mpiRow );
 
+#ifdef OVERLAP_COMMUNICATION
+  //! ghost and copy layers for the packed exchange (indexed by BoundaryEdge)
+  PackedGhostLayer l_ghostLayers[4];
+  l_ghostLayers[BND_LEFT].neighborRank   = l_leftNeighborRank;
+  l_ghostLayers[BND_LEFT].inflow         = l_leftInflow;
+  l_ghostLayers[BND_LEFT].outflow        = l_leftOutflow;
+  l_ghostLayers[BND_LEFT].size           = l_nYLocal;
+  l_ghostLayers[BND_RIGHT].neighborRank  = l_rightNeighborRank;
+  l_ghostLayers[BND_RIGHT].inflow        = l_rightInflow;
+  l_ghostLayers[BND_RIGHT].outflow       = l_rightOutflow;
+  l_ghostLayers[BND_RIGHT].size          = l_nYLocal;
+  l_ghostLayers[BND_BOTTOM].neighborRank = l_bottomNeighborRank;
+  l_ghostLayers[BND_BOTTOM].inflow       = l_bottomInflow;
+  l_ghostLayers[BND_BOTTOM].outflow      = l_bottomOutflow;
+  l_ghostLayers[BND_BOTTOM].size         = l_nXLocal;
+  l_ghostLayers[BND_TOP].neighborRank    = l_topNeighborRank;
+  l_ghostLayers[BND_TOP].inflow          = l_topInflow;
+  l_ghostLayers[BND_TOP].outflow         = l_topOutflow;
+  l_ghostLayers[BND_TOP].size            = l_nXLocal;
+  for(int i = 0; i < 4; i++) {
+    l_ghostLayers[i].sendBuffer.resize(3*l_ghostLayers[i].size);
+    l_ghostLayers[i].receiveBuffer.resize(3*l_ghostLayers[i].size);
+  }
+
+  //! pending receives and sends of the exchange
+  MPI_Request l_requests[8];
+#endif // OVERLAP_COMMUNICATION
+
   // Init fancy progressbar
   tools::ProgressBar progressBar(l_endSimulation, l_mpiRank);
 
   // write the output at time zero
-  tools::Logger::logger.printOutputTime(0);
-  progressBar.update(0.);
+  tools::Logger::logger.printOutputTime(l_t);
+  progressBar.update(l_t);
 
   std::string l_fileName = generateBaseFileName(l_baseName,l_blockPositionX,l_blockPositionY);
   //boundary size of the ghost layers
   io::BoundarySize l_boundarySize = {{1, 1, 1, 1}};
 #ifdef WRITENETCDF
+  io::NetCdfOptions l_netCdfOptions;
+#ifdef NETCDF_COLLECTIVE
+  // all processes write their block into one file
+  l_fileName = l_baseName;
+  l_netCdfOptions.communicator = MPI_COMM_WORLD;
+  l_netCdfOptions.blockPositionX = l_blockPositionX;
+  l_netCdfOptions.blockPositionY = l_blockPositionY;
+#ifdef NETCDF_AGGREGATORS
+  l_netCdfOptions.aggregators = NETCDF_AGGREGATORS;
+#endif
+#endif // NETCDF_COLLECTIVE
+  if (!l_checkpointFileName.empty() && l_checkpointFileName != l_fileName + ".nc") {
+    // continue the checkpoint file in a copy (the writer appends to existing files),
+    // the collective file is copied by the first process only
+#ifdef NETCDF_COLLECTIVE
+    if (l_mpiRank == 0)
+#endif
+    {
+      std::ifstream l_source(l_checkpointFileName.c_str(), std::ios::binary);
+      std::ofstream l_destination((l_fileName + ".nc").c_str(), std::ios::binary);
+      l_destination << l_source.rdbuf();
+    }
+#ifdef NETCDF_COLLECTIVE
+    MPI_Barrier(MPI_COMM_WORLD);
+#endif
+  }
   //construct a NetCdfWriter
   io::NetCdfWriter l_writer( l_fileName,
 		  l_wavePropgationBlock.getBathymetry(),
 		  l_boundarySize,
 		  l_nXLocal, l_nYLocal,
 		  l_dX, l_dY,
-          l_originX, l_originY );
+          l_originX, l_originY,
+          1.f, 0, l_netCdfOptions );
+
+  // the outer boundaries are always outflow boundaries (see above)
+  BoundaryType l_boundaryTypes[4] = { OUTFLOW, OUTFLOW, OUTFLOW, OUTFLOW };
+  // required to resume the simulation from the output
+  l_writer.writeSimulationInfo(l_numberOfCheckPoints, l_endSimulation, l_boundaryTypes);
 #else
   // Construct a VtkWriter
   io::VtkWriter l_writer( l_fileName,
@@ -423,13 +648,22 @@ int main( int argc, char** argv ) {
 		  l_boundarySize,
 		  l_nXLocal, l_nYLocal,
 		  l_dX, l_dY,
-		  l_blockPositionX*l_nXLocal, l_blockPositionY*l_nYLocal );
+		  l_offsetX, l_offsetY );
+#endif
+#ifdef ASYNC_OUTPUT
+  // write the output in a background thread
+  io::AsyncWriter l_asyncWriter(l_writer);
+  io::Writer &l_output = l_asyncWriter;
+#else
+  io::Writer &l_output = l_writer;
 #endif
-  // Write zero time step
-  l_writer.writeTimeStep( l_wavePropgationBlock.getWaterHeight(),
-                          l_wavePropgationBlock.getDischarge_hu(),
-                          l_wavePropgationBlock.getDischarge_hv(),
-                          (float) 0.);
+  if (l_firstCheckPoint == 1) {
+    // Write zero time step
+    l_output.writeTimeStep( l_wavePropgationBlock.getWaterHeight(),
+                            l_wavePropgationBlock.getDischarge_hu(),
+                            l_wavePropgationBlock.getDischarge_hv(),
+                            (float) 0.);
+  }
   /**
    * Simulation.
    */
@@ -438,20 +672,96 @@ int main( int argc, char** argv ) {
   tools::Logger::logger.printStartMessage();
   tools::Logger::logger.initWallClockTime(time(NULL));
 
-  //! simulation time.
-  float l_t = 0.0;
   progressBar.update(l_t);
 
   unsigned int l_iterations = 0;
 
+#if TIMESTEP_WINDOW > 1
+  /*
+   * The global time step width is only reduced every TIMESTEP_WINDOW time steps.
+   * Within a window, all processes use the same fixed time step width, which is
+   * the reduced time step width of the previous window multiplied by a safety factor.
+   * At the end of the window, the smallest allowed time step width of all steps
+   * and processes is reduced. If it is smaller than the fixed time step width,
+   * the window is repeated with a smaller time step width.
+   */
+  //! safety factor for the fixed time step width
+  const float l_safetyFactor = .8f;
+
+  //! number of time steps done in the current window
+  int l_windowSteps = 0;
+
+  //! simulation time at the beginning of the current window
+  float l_windowStartTime = 0.f;
+
+  //! smallest allowed time step width of all time steps in the current window
+  float l_windowMaxTimeStepWidth = 0.f;
+
+  //! number of repeated windows
+  unsigned int l_rollbacks = 0;
+
+  //! fixed time step width of the current window
+  float l_windowTimeStepWidth;
+
+  // compute the time step width of the first window
+  exchangeLeftRightGhostLayers( l_leftNeighborRank,  l_leftInflow,  l_leftOutflow,
+                  l_rightNeighborRank, l_rightInflow, l_rightOutflow,
+                  l_mpiCol );
+
+  exchangeBottomTopGhostLayers( l_bottomNeighborRank, l_bottomInflow, l_bottomOutflow,
+                  l_topNeighborRank,    l_topInflow,    l_topOutflow,
+                  l_mpiRow );
+
+  l_wavePropgationBlock.setGhostLayer();
+  l_wavePropgationBlock.computeNumericalFluxes();
+
+  l_windowMaxTimeStepWidth = l_wavePropgationBlock.getMaxTimestep();
+  MPI_Allreduce(&l_windowMaxTimeStepWidth, &l_windowTimeStepWidth, 1, MPI_FLOAT, MPI_MIN, MPI_COMM_WORLD);
+  l_windowTimeStepWidth *= l_safetyFactor;
+#endif // TIMESTEP_WINDOW > 1
+
   // loop over checkpoints
-  for(int c=1; c<=l_numberOfCheckPoints; c++) {
+  for(int c=l_firstCheckPoint; c<=l_numberOfCheckPoints; c++) {
 
     // do time steps until next checkpoint is reached
     while( l_t < l_checkPoints[c] ) {
+#if TIMESTEP_WINDOW > 1
+      if (l_windowSteps == 0) {
+        // start a new window, store the unknowns in case the window has to be repeated
+        l_wavePropgationBlock.storeUnknowns();
+        l_windowStartTime = l_t;
+        l_windowMaxTimeStepWidth = std::numeric_limits<float>::max();
+      }
+#endif // TIMESTEP_WINDOW > 1
+
       //reset CPU-Communication clock
       tools::Logger::logger.resetCpuCommunicationClockToCurrentTime();
 
+#ifdef OVERLAP_COMMUNICATION
+      // start the exchange of ghost and copy layers
+      startGhostLayerExchange(l_ghostLayers, l_requests);
+
+      // reset the cpu clock
+      tools::Logger::logger.resetCpuClockToCurrentTime();
+
+      // set values in ghost cells at the boundary of the domain
+      l_wavePropgationBlock.setGhostLayer();
+
+      // compute numerical flux on each edge, which does not depend on the ghost layers
+      l_wavePropgationBlock.computeInteriorNumericalFluxes();
+
+      // update the cpu time in the logger
+      tools::Logger::logger.updateCpuTime();
+
+      // wait for the ghost layers of the neighbors
+      finishGhostLayerExchange(l_ghostLayers, l_requests);
+
+      // reset the cpu clock
+      tools::Logger::logger.resetCpuClockToCurrentTime();
+
+      // compute numerical flux on the remaining edges
+      l_wavePropgationBlock.computeBoundaryNumericalFluxes();
+#else // OVERLAP_COMMUNICATION
       // exchange ghost and copy layers
       exchangeLeftRightGhostLayers( l_leftNeighborRank,  l_leftInflow,  l_leftOutflow,
                       l_rightNeighborRank, l_rightInflow, l_rightOutflow,
@@ -469,6 +779,7 @@ int main( int argc, char** argv ) {
 
       // compute numerical flux on each edge
       l_wavePropgationBlock.computeNumericalFluxes();
+#endif // OVERLAP_COMMUNICATION
 
       //! maximum allowed time step width within a block.
       float l_maxTimeStepWidth = l_wavePropgationBlock.getMaxTimestep();
@@ -479,8 +790,16 @@ int main( int argc, char** argv ) {
       //! maximum allowed time steps of all blocks
       float l_maxTimeStepWidthGlobal;
 
+#if TIMESTEP_WINDOW > 1
+      // the time step width is checked at the end of the window
+      l_windowMaxTimeStepWidth = std::min(l_windowMaxTimeStepWidth, l_maxTimeStepWidth);
+      l_maxTimeStepWidthGlobal = l_windowTimeStepWidth;
+#else // TIMESTEP_WINDOW > 1
       // determine smallest time step of all blocks
+      tools::Logger::logger.resetReductionClockToCurrentTime();
       MPI_Allreduce(&l_maxTimeStepWidth, &l_maxTimeStepWidthGlobal, 1, MPI_FLOAT, MPI_MIN, MPI_COMM_WORLD);
+      tools::Logger::logger.updateReductionTime();
+#endif // TIMESTEP_WINDOW > 1
 
       // reset the cpu time
       tools::Logger::logger.resetCpuClockToCurrentTime();
@@ -496,6 +815,34 @@ int main( int argc, char** argv ) {
       l_t += l_maxTimeStepWidthGlobal;
       l_iterations++;
 
+#if TIMESTEP_WINDOW > 1
+      l_windowSteps++;
+
+      if (l_windowSteps == TIMESTEP_WINDOW || l_t >= l_checkPoints[c]) {
+        //! smallest allowed time step width of all processes in the window
+        float l_windowMaxTimeStepWidthGlobal;
+
+        tools::Logger::logger.resetReductionClockToCurrentTime();
+        MPI_Allreduce(&l_windowMaxTimeStepWidth, &l_windowMaxTimeStepWidthGlobal, 1, MPI_FLOAT, MPI_MIN, MPI_COMM_WORLD);
+        tools::Logger::logger.updateReductionTime();
+
+        // (the negated comparison also catches NaNs)
+        if (!(l_windowMaxTimeStepWidthGlobal >= l_windowTimeStepWidth)) {
+          // the fixed time step width was too large: repeat the window
+          l_wavePropgationBlock.restoreUnknowns();
+          l_t = l_windowStartTime;
+          l_iterations -= l_windowSteps;
+          l_rollbacks++;
+
+          l_windowTimeStepWidth = std::min(.5f*l_windowTimeStepWidth,
+                                           l_safetyFactor*l_windowMaxTimeStepWidthGlobal);
+        } else
+          l_windowTimeStepWidth = l_safetyFactor*l_windowMaxTimeStepWidthGlobal;
+
+        l_windowSteps = 0;
+      }
+#endif // TIMESTEP_WINDOW > 1
+
       // print the current simulation time
       progressBar.clear();
       tools::Logger::logger.printSimulationTime(l_t);
@@ -508,7 +855,7 @@ int main( int argc, char** argv ) {
     progressBar.update(l_t);
 
     // write output
-    l_writer.writeTimeStep( l_wavePropgationBlock.getWaterHeight(),
+    l_output.writeTimeStep( l_wavePropgationBlock.getWaterHeight(),
                             l_wavePropgationBlock.getDischarge_hu(),
                             l_wavePropgationBlock.getDischarge_hv(),
                             l_t);
@@ -522,6 +869,11 @@ int main( int argc, char** argv ) {
   l_scenario.deleteGrids();
 #endif
 
+#ifdef ASYNC_OUTPUT
+  // wait for the remaining output
+  l_asyncWriter.flush();
+#endif
+
   progressBar.clear();
 
   // write the statistics message
@@ -533,11 +885,22 @@ int main( int argc, char** argv ) {
   // print CPU + Communication time
   tools::Logger::logger.printCpuCommunicationTime();
 
+  // print the time spent in the global reductions of the time step width
+  tools::Logger::logger.printReductionTime();
+
+#ifdef ASYNC_OUTPUT
+  // print the output time and how much of it was overlapped with the simulation
+  tools::Logger::logger.printAsynchronousOutputTime(l_asyncWriter.getWriteTime(), l_asyncWriter.getHiddenTime());
+#endif
+
   // print the wall clock time (includes plotting)
   tools::Logger::logger.printWallClockTime(time(NULL));
 
   // printer iteration counter
   tools::Logger::logger.printIterationsDone(l_iterations);
+#if TIMESTEP_WINDOW > 1
+  tools::Logger::logger.printIterationsDone(l_rollbacks, "time step windows repeated");
+#endif
 
   // print the finish message
   tools::Logger::logger.printFinishMessage();
@@ -637,3 +1000,68 @@ void exchangeBottomTopGhostLayers( const int i_bottomNeighborRank, SWE_Block1D*
                 MPI_COMM_WORLD, &l_status );
 
 }
+
+#ifdef OVERLAP_COMMUNICATION
+/**
+ * Packs h, hu and hv of each copy layer into one message and starts
+ * the non-blocking exchange with all neighbors.
+ *
+ * Only the cells 1..size of the layers are exchanged. The corner ghost
+ * cells are not required by the wave propagation solvers.
+ *
+ * The message for the left neighbor is received at its right boundary (and so on),
+ * therefore the tag is the edge of the receiving block.
+ *
+ * @param io_layers ghost and copy layers of all four boundaries (indexed by BoundaryEdge).
+ * @param o_requests 8 requests, which are required by finishGhostLayerExchange.
+ */
+void startGhostLayerExchange(PackedGhostLayer* io_layers, MPI_Request* o_requests) {
+  for(int l_edge = 0; l_edge < 4; l_edge++) {
+    PackedGhostLayer &l_layer = io_layers[l_edge];
+    o_requests[2*l_edge] = o_requests[2*l_edge+1] = MPI_REQUEST_NULL;
+
+    if(l_layer.neighborRank == MPI_PROC_NULL)
+      continue;
+
+    // receive the copy layer of the neighbor on the opposite edge
+    MPI_Irecv( &l_layer.receiveBuffer[0], 3*l_layer.size, MPI_FLOAT, l_layer.neighborRank,
+               l_edge, MPI_COMM_WORLD, &o_requests[2*l_edge] );
+
+    for(int k = 0; k < l_layer.size; k++) {
+      l_layer.sendBuffer[k]                   = l_layer.outflow->h[k+1];
+      l_layer.sendBuffer[l_layer.size + k]    = l_layer.outflow->hu[k+1];
+      l_layer.sendBuffer[2*l_layer.size + k]  = l_layer.outflow->hv[k+1];
+    }
+
+    // BND_LEFT <-> BND_RIGHT, BND_BOTTOM <-> BND_TOP
+    int l_oppositeEdge = l_edge ^ 1;
+    MPI_Isend( &l_layer.sendBuffer[0], 3*l_layer.size, MPI_FLOAT, l_layer.neighborRank,
+               l_oppositeEdge, MPI_COMM_WORLD, &o_requests[2*l_edge+1] );
+  }
+}
+
+/**
+ * Waits until the exchange started by startGhostLayerExchange is complete
+ * and unpacks the received messages into the ghost layers.
+ *
+ * @param io_layers ghost and copy layers of all four boundaries (indexed by BoundaryEdge).
+ * @param io_requests the requests of startGhostLayerExchange.
+ */
+void finishGhostLayerExchange(PackedGhostLayer* io_layers, MPI_Request* io_requests) {
+  MPI_Waitall(8, io_requests, MPI_STATUSES_IGNORE);
+
+  for(int l_edge = 0; l_edge < 4; l_edge++) {
+    PackedGhostLayer &l_layer = io_layers[l_edge];
+
+    // keep the boundary conditions at the boundary of the domain
+    if(l_layer.neighborRank == MPI_PROC_NULL)
+      continue;
+
+    for(int k = 0; k < l_layer.size; k++) {
+      l_layer.inflow->h[k+1]  = l_layer.receiveBuffer[k];
+      l_layer.inflow->hu[k+1] = l_layer.receiveBuffer[l_layer.size + k];
+      l_layer.inflow->hv[k+1] = l_layer.receiveBuffer[2*l_layer.size + k];
+    }
+  }
+}
+#endif // OVERLAP_COMMUNICATION
@@ -0,0 +1,405 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#ifdef USEOPENMP
+#include <omp.h>
+#endif
+
+#include "blocks/SWE_MultiBlock.hh"
+#include "scenarios/SWE_Scenario.hh"
+#include "scenarios/SWE_PartialDambreak.hh"
+#include "scenarios/SWE_ArtificialTsunamiScenario.hh"
+
+#ifdef WRITENETCDF
+#include "writer/NetCdfWriter.hh"
+
+#include "scenarios/SWE_TsunamiScenario.hh"
+#else
+#include "writer/VtkWriter.hh"
+#endif
+
+#include "tools/help.hh"
+#include "tools/Logger.hh"
+#include "tools/ProgressBar.hh"
+
+int main( int argc, char** argv ) {
+
+    //! Number of cells in x direction
+    int l_nX = 0;
+
+    //! Number of cells in y direction
+    int l_nY = 0;
+
+    //! Number of blocks in x direction
+    int l_blocksX = 0;
+
+    //! Number of blocks in y direction
+    int l_blocksY = 0;
+
+    //! Size of the tiles used to skip inactive regions (0 = compute all cells)
+    int l_activeTileSize = 0;
+
+    //! l_baseName of the plots.
+    std::string l_baseName;
+
+    //! bathymetry input file name
+    std::string l_bathymetryFileName;
+
+    //! displacement input file name
+    std::string l_displacementFileName;
+
+    //! the total simulation time
+    float l_simulationTime = 0.0;
+
+    //! List of defined scenarios
+    typedef enum {
+        SCENARIO_TSUNAMI, SCENARIO_ARTIFICIAL_TSUNAMI, SCENARIO_PARTIAL_DAMBREAK
+    } ScenarioName;
+
+    //! the name of the chosen scenario
+    ScenarioName l_scenarioName;
+#ifdef WRITENETCDF
+    l_scenarioName = SCENARIO_TSUNAMI;
+#else
+    l_scenarioName = SCENARIO_PARTIAL_DAMBREAK;
+#endif
+
+    //! number of checkpoints for visualization (at each checkpoint in time, an output file is written).
+    int l_numberOfCheckPoints = 20;
+
+    // Option Parsing
+    // REQUIRED
+    // -x <num>        // Number of cells in x-dir
+    // -y <num>        // Number of cells in y-dir
+    // -o <file>       // Output file basename
+    // OPTIONAL (may be required for certain scenarios)
+    // -i <file>       // initial bathymetry data file name (REQUIRED for the tsunami scenario)
+    // -d <file>       // input displacement data file name (REQUIRED for the tsunami scenario)
+    // -X <num>        // Number of blocks in x-dir
+    // -Y <num>        // Number of blocks in y-dir
+    // -a <num>        // Size of the tiles used to skip inactive regions (0 = compute all cells)
+    // -n <num>        // Number of checkpoints
+    // -t <float>      // Simulation time in seconds
+    // -s <scenario>   // Artificial scenario name ("artificialtsunami", "partialdambreak")
+    int c;
+    int showUsage = 0;
+    std::string optstr;
+    while ((c = getopt(argc, argv, "x:y:o:i:d:X:Y:a:n:t:s:")) != -1) {
+        switch(c) {
+            case 'x':
+                l_nX = atoi(optarg);
+                break;
+            case 'y':
+                l_nY = atoi(optarg);
+                break;
+            case 'o':
+                l_baseName = std::string(optarg);
+                break;
+#ifdef WRITENETCDF
+            case 'i':
+                l_bathymetryFileName = std::string(optarg);
+                break;
+            case 'd':
+                l_displacementFileName = std::string(optarg);
+                break;
+#endif
+            case 'X':
+                l_blocksX = atoi(optarg);
+                break;
+            case 'Y':
+                l_blocksY = atoi(optarg);
+                break;
+            case 'a':
+                l_activeTileSize = atoi(optarg);
+                break;
+            case 'n':
+                l_numberOfCheckPoints = atoi(optarg);
+                break;
+            case 't':
+                l_simulationTime = atof(optarg);
+                break;
+            case 's':
+                optstr = std::string(optarg);
+                if(optstr == "artificialtsunami") {
+                    l_scenarioName = SCENARIO_ARTIFICIAL_TSUNAMI;
+                } else if(optstr == "partialdambreak") {
+                    l_scenarioName = SCENARIO_PARTIAL_DAMBREAK;
+                } else {
+                    std::cerr << "Invalid option argument: Unknown scenario (-s)" << std::endl;
+                    showUsage = 1;
+                }
+                break;
+            default:
+                showUsage = 1;
+                break;
+        }
+    }
+
+    // By default, use 4 blocks per thread to balance the load
+    if(l_blocksX <= 0 && l_blocksY <= 0) {
+#ifdef USEOPENMP
+        l_blocksX = 2 * omp_get_max_threads();
+        l_blocksY = 2;
+#else
+        l_blocksX = l_blocksY = 1;
+#endif
+    } else if(l_blocksX <= 0) {
+        l_blocksX = 1;
+    } else if(l_blocksY <= 0) {
+        l_blocksY = 1;
+    }
+
+    // Do several checks on supplied options
+    if(!showUsage) {
+        if(l_nX == 0 || l_nY == 0) {
+            std::cerr << "Missing required arguments: number of cells in X (-x) and Y (-y) direction" << std::endl;
+            showUsage = 1;
+        }
+        if(l_baseName.empty()) {
+            std::cerr << "Missing required argument: base name of output file (-o)" << std::endl;
+            showUsage = 1;
+        }
+        if(l_numberOfCheckPoints <= 0) {
+            std::cerr << "Invalid option argument: Number of checkpoints must be greater than zero (-n)" << std::endl;
+            showUsage = 1;
+        }
+        if(l_blocksX > l_nX || l_blocksY > l_nY) {
+            std::cerr << "Invalid option argument: More blocks than cells (-X, -Y)" << std::endl;
+            showUsage = 1;
+        }
+        if(l_scenarioName == SCENARIO_TSUNAMI) {
+            if(l_bathymetryFileName.empty() || l_displacementFileName.empty()) {
+                std::cerr << "Missing required argument: bathymetry (-i) and displacement (-d) files must be supplied" << std::endl;
+                showUsage = 1;
+            }
+        }
+    }
+
+    if(showUsage) {
+        std::cout << "Usage:" << std::endl;
+        std::cout << "Simulating a tsunami with bathymetry and displacement input:" << std::endl;
+        std::cout << "    ./SWE_<opt> -i <bathymetryfile> -d <displacementfile> [OPTIONS]" << std::endl;
+        std::cout << "Simulating an artificial scenario:" << std::endl;
+        std::cout << "    ./SWE_<opt> -s <scenarioname> [OPTIONS]" << std::endl;
+        std::cout << "" << std::endl;
+        std::cout << "Options:" << std::endl;
+        std::cout << "    -o <filename>   The output file base name" << std::endl;
+        std::cout << "    -x <num>        The number of cells in x-direction" << std::endl;
+        std::cout << "    -y <num>        The number of cells in y-direction" << std::endl;
+        std::cout << "    -X <num>        The number of blocks in x-direction (default: 2 per thread)" << std::endl;
+        std::cout << "    -Y <num>        The number of blocks in y-direction (default: 2)" << std::endl;
+        std::cout << "    -a <num>        Size of the tiles used to skip regions without changes, 0 to compute all cells" << std::endl;
+        std::cout << "    -n <num>        Number of checkpoints to be written" << std::endl;
+        std::cout << "    -t <time>       Total simulation time" << std::endl;
+        std::cout << "    -i <filename>   Name of bathymetry data file" << std::endl;
+        std::cout << "    -d <filename>   Name of displacement data file" << std::endl;
+        std::cout << "    -s <scenario>   Name of artificial scenario" << std::endl;
+        std::cout << "                    Scenarios: 'artificialtsunami', 'partialdambreak'" << std::endl;
+        std::cout << "" << std::endl;
+        std::cout << "Each block is written to its own file <filename>_<bx>_<by>." << std::endl;
+
+        return 0;
+    }
+
+    //! Pointer to instance of chosen scenario
+    SWE_Scenario *l_scenario;
+
+    // Create scenario according to chosen options
+    switch(l_scenarioName) {
+#ifdef WRITENETCDF
+        case SCENARIO_TSUNAMI:
+            l_scenario = new SWE_TsunamiScenario(l_bathymetryFileName, l_displacementFileName);
+            break;
+#endif
+        case SCENARIO_ARTIFICIAL_TSUNAMI:
+            l_scenario = new SWE_ArtificialTsunamiScenario();
+            break;
+        case SCENARIO_PARTIAL_DAMBREAK:
+            l_scenario = new SWE_PartialDambreak();
+            break;
+        default:
+            std::cerr << "Invalid Scenario" << std::endl;
+            exit(1);
+            break;
+    }
+
+    // print information about the grid
+    tools::Logger::logger.printNumberOfCells(l_nX, l_nY);
+    tools::Logger::logger.printNumberOfBlocks(l_blocksX, l_blocksY);
+
+    //! size of a single cell in x- and y-direction
+    float l_dX, l_dY;
+
+    // compute the size of a single cell
+    l_dX = (l_scenario->getBoundaryPos(BND_RIGHT) - l_scenario->getBoundaryPos(BND_LEFT) )/l_nX;
+    l_dY = (l_scenario->getBoundaryPos(BND_TOP) - l_scenario->getBoundaryPos(BND_BOTTOM) )/l_nY;
+
+    //! The blocks
+    SWE_MultiBlock l_multiBlock(l_nX, l_nY, l_dX, l_dY, l_blocksX, l_blocksY);
+
+    //! origin of the simulation domain in x- and y-direction
+    float l_originX, l_originY;
+
+    // get the origin from the scenario
+    l_originX = l_scenario->getBoundaryPos(BND_LEFT);
+    l_originY = l_scenario->getBoundaryPos(BND_BOTTOM);
+
+    // initialize the blocks
+    l_multiBlock.initScenario(l_originX, l_originY, *l_scenario);
+    for(int bx = 0; bx < l_blocksX; bx++)
+        for(int by = 0; by < l_blocksY; by++)
+            l_multiBlock.getBlock(bx, by).setActiveTileSize(l_activeTileSize);
+
+    //! time when the simulation ends.
+    float l_endSimulation;
+    if(l_simulationTime <= 0.0) {
+        // We haven't got a valid simulation time as arguments, use the pre-defied one from scenario
+        l_endSimulation = l_scenario->endSimulation();
+    } else {
+        // Use time given from command line
+        l_endSimulation = l_simulationTime;
+    }
+
+    // Delete scenario to free resources and close opened files
+    delete l_scenario;
+
+    //! checkpoints when output files are written.
+    float* l_checkPoints = new float[l_numberOfCheckPoints+1];
+
+    // compute the checkpoints in time
+    for(int cp = 0; cp <= l_numberOfCheckPoints; cp++) {
+        l_checkPoints[cp] = cp*(l_endSimulation/l_numberOfCheckPoints);
+    }
+
+    // Init fancy progressbar
+    tools::ProgressBar progressBar(l_endSimulation);
+
+    // write the output at time zero
+    tools::Logger::logger.printOutputTime((float) 0.);
+    progressBar.update(0.);
+
+    //boundary size of the ghost layers
+    io::BoundarySize l_boundarySize = {{1, 1, 1, 1}};
+
+    //! One writer per block
+    std::vector<io::Writer*> l_writers;
+    for(int bx = 0; bx < l_blocksX; bx++) {
+        for(int by = 0; by < l_blocksY; by++) {
+            SWE_WavePropagationBlock &l_block = l_multiBlock.getBlock(bx, by);
+            // separate the block indices, "_1_11" and "_11_1" must not collide
+            std::ostringstream l_blockName;
+            l_blockName << l_baseName << "_" << bx << "_" << by;
+            std::string l_fileName = l_blockName.str();
+#ifdef WRITENETCDF
+            l_writers.push_back(new io::NetCdfWriter( l_fileName,
+                l_block.getBathymetry(),
+                l_boundarySize,
+                l_block.getNx(), l_block.getNy(),
+                l_dX, l_dY,
+                l_originX + l_multiBlock.getBlockOffsetX(bx)*l_dX,
+                l_originY + l_multiBlock.getBlockOffsetY(by)*l_dY));
+#else
+            l_writers.push_back(new io::VtkWriter( l_fileName,
+                l_block.getBathymetry(),
+                l_boundarySize,
+                l_block.getNx(), l_block.getNy(),
+                l_dX, l_dY,
+                l_multiBlock.getBlockOffsetX(bx), l_multiBlock.getBlockOffsetY(by)));
+#endif
+            // Write zero time step
+            l_writers.back()->writeTimeStep( l_block.getWaterHeight(),
+                                             l_block.getDischarge_hu(),
+                                             l_block.getDischarge_hv(),
+                                             (float) 0.);
+        }
+    }
+
+    /**
+     * Simulation.
+     */
+    // print the start message and reset the wall clock time
+    progressBar.clear();
+    tools::Logger::logger.printStartMessage();
+    tools::Logger::logger.initWallClockTime(time(NULL));
+
+    //! simulation time.
+    float l_t = 0.0;
+    progressBar.update(l_t);
+
+    unsigned int l_iterations = 0;
+
+    // loop over checkpoints
+    for(int c = 1; c <= l_numberOfCheckPoints; c++) {
+
+        // do time steps until next checkpoint is reached
+        while( l_t < l_checkPoints[c] ) {
+            // reset the cpu clock
+            tools::Logger::logger.resetCpuClockToCurrentTime();
+
+            // set values in ghost cells and compute numerical flux on each edge
+            l_multiBlock.computeNumericalFluxes();
+
+            //! maximum allowed time step width of all blocks.
+            float l_maxTimeStepWidth = l_multiBlock.getMaxTimestep();
+
+            // update the cell values
+            l_multiBlock.updateUnknowns(l_maxTimeStepWidth);
+
+            // update the cpu time in the logger
+            tools::Logger::logger.updateCpuTime();
+
+            // update simulation time with time step width.
+            l_t += l_maxTimeStepWidth;
+            l_iterations++;
+
+            // print the current simulation time
+            progressBar.clear();
+            tools::Logger::logger.printSimulationTime(l_t);
+            progressBar.update(l_t);
+        }
+
+        // print current simulation time of the output
+        progressBar.clear();
+        tools::Logger::logger.printOutputTime(l_t);
+        progressBar.update(l_t);
+
+        // write output
+        for(int bx = 0; bx < l_blocksX; bx++) {
+            for(int by = 0; by < l_blocksY; by++) {
+                SWE_WavePropagationBlock &l_block = l_multiBlock.getBlock(bx, by);
+                l_writers[bx*l_blocksY + by]->writeTimeStep( l_block.getWaterHeight(),
+                                                             l_block.getDischarge_hu(),
+                                                             l_block.getDischarge_hv(),
+                                                             l_t);
+            }
+        }
+    }
+
+    /**
+     * Finalize.
+     */
+    for(unsigned int i = 0; i < l_writers.size(); i++)
+        delete l_writers[i];
+    delete [] l_checkPoints;
+
+    // write the statistics message
+    progressBar.clear();
+    tools::Logger::logger.printStatisticsMessage();
+
+    // print the cpu time
+    tools::Logger::logger.printCpuTime();
+
+    // print the wall clock time (includes plotting)
+    tools::Logger::logger.printWallClockTime(time(NULL));
+
+    // printer iteration counter
+    tools::Logger::logger.printIterationsDone(l_iterations);
+
+    // print average time per cell per iteration
+    tools::Logger::logger.printAverageCPUTimePerCellPerIteration(l_iterations, l_nX*l_nY);
+
+    return 0;
+}
@@ -30,6 +30,7 @@
 #include <cstdlib>
 #include <string>
 #include <iostream>
+#include <unistd.h>
 
 #ifndef CUDA
 #include "blocks/SWE_WavePropagationBlock.hh"
@@ -64,12 +65,37 @@ int main( int argc, char** argv ) {
   /**
    * Initialization.
    */
+  //! Pad the columns of all arrays to cache line boundaries
+  bool l_paddedArrays = false;
+  //! Size of the tiles used to skip regions without changes (0 = compute all cells)
+  int l_activeTileSize = 0;
+
   // check if the necessary command line input parameters are given
   #ifndef READXML
-  if(argc != 4) {
+  int c;
+  int showUsage = 0;
+  while((c = getopt(argc, argv, "Pa:")) != -1) {
+    switch(c) {
+      case 'P':
+        l_paddedArrays = true;
+        break;
+      case 'a':
+        l_activeTileSize = atoi(optarg);
+        if(l_activeTileSize < 0)
+          showUsage = 1;
+        break;
+      default:
+        showUsage = 1;
+        break;
+    }
+  }
+  if(showUsage || argc - optind != 3) {
     std::cout << "Aborting ... please provide proper input parameters." << std::endl
-              << "Example: ./SWE_parallel 200 300 /work/openmp_out" << std::endl
-              << "\tfor a single block of size 200 * 300" << std::endl;
+              << "Example: ./SWE_parallel [OPTIONS] 200 300 /work/openmp_out" << std::endl
+              << "\tfor a single block of size 200 * 300" << std::endl
+              << "Options:" << std::endl
+              << "\t-P\tPad the columns of all arrays to cache line boundaries (CPU only)" << std::endl
+              << "\t-a <num>\tSize of the tiles used to skip regions without changes, 0 to compute all cells (CPU only)" << std::endl;
     return 1;
   }
   #endif
@@ -82,9 +108,9 @@ int main( int argc, char** argv ) {
 
   // read command line parameters
   #ifndef READXML
-  l_nY = l_nX = atoi(argv[1]);
-  l_nY = atoi(argv[2]);
-  l_baseName = std::string(argv[3]);
+  l_nY = l_nX = atoi(argv[optind]);
+  l_nY = atoi(argv[optind+1]);
+  l_baseName = std::string(argv[optind+2]);
   #endif
 
   // read xml file
@@ -143,7 +169,10 @@ int main( int argc, char** argv ) {
 
   // create a single wave propagation block
   #ifndef CUDA
+  if(l_paddedArrays)
+    Float2D::setDefaultPadding(Float2D::PADDING_ALIGNED);
   SWE_WavePropagationBlock l_wavePropgationBlock(l_nX,l_nY,l_dX,l_dY);
+  l_wavePropgationBlock.setActiveTileSize(l_activeTileSize);
   #else
   SWE_WavePropagationBlockCuda l_wavePropgationBlock(l_nX,l_nY,l_dX,l_dY);
   #endif
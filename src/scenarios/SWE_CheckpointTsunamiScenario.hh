@@ -1,13 +1,16 @@
 #ifndef __SWE_CHECKPOINTTSUNAMISCENARIO_HH
 #define __SWE_CHECKPOINTTSUNAMISCENARIO_HH
 
+#include <algorithm>
 #include <iostream>
 #include <cassert>
 #include <cstdlib>
+#include <vector>
 
 #include <netcdf.h>
 
 #include "SWE_Scenario.hh"
+#include "tools/NetCdfKeyframeReader.hh"
 
 /**
  * Scenario "Checkpoint Tsunami"
@@ -58,6 +61,14 @@ protected:
     //! The NetCDF step width in y dimension (step width between two cells)
     float y_step;
     
+    //! scale_factor of h, hu and hv (1 if the variable is not packed)
+    float h_scale, hu_scale, hv_scale;
+    //! add_offset of h, hu and hv (0 if the variable is not packed)
+    float h_offset, hu_offset, hv_offset;
+    
+    //! Reconstructs incremental time steps of h, hu and hv
+    tools::NetCdfKeyframeReader keyframes;
+    
     /**
      * Load the checkpoint file
      *
@@ -128,6 +139,27 @@ protected:
         
         // Step size should be greater than zero
         assert(x_step > 0.0); assert(y_step > 0.0);
+        
+        // Read the packing of the unknowns (fixed point output)
+        readPacking(h_id, h_scale, h_offset);
+        readPacking(hu_id, hu_scale, hu_offset);
+        readPacking(hv_id, hv_scale, hv_offset);
+        
+        // Incremental output stores only the changed tiles of the unknowns
+        keyframes.setFile(file_id);
+    }
+    
+    /// Read the CF packing attributes of a variable
+    /**
+     * @param varid The NetCDF variable ID
+     * @param scale Reference to where the scale_factor should be written (1 if not present)
+     * @param offset Reference to where the add_offset should be written (0 if not present)
+     */
+    void readPacking(int varid, float &scale, float &offset) {
+        if(nc_get_att_float(file_id, varid, "scale_factor", &scale) != NC_NOERR)
+            scale = 1.f;
+        if(nc_get_att_float(file_id, varid, "add_offset", &offset) != NC_NOERR)
+            offset = 0.f;
     }
     
     /// Abort execution with netCDF error message
@@ -197,11 +229,74 @@ protected:
         }
         
         float value;
-        int status = nc_get_var1_float(file_id, varid, (const size_t *)index, &value);
+        int status;
+        if(isTimeDependent) {
+            const size_t count[] = {1, 1};
+            status = keyframes.getSlab(varid, index[0], index+1, count, &value);
+        } else {
+            status = nc_get_var1_float(file_id, varid, (const size_t *)index, &value);
+        }
         if(status != NC_NOERR) handleNetCDFError(status);
         return value;
     }
     
+    /// Read the values of a variable for all cells of a block
+    /**
+     * Reads the hyperslab covering the block (of the latest time step)
+     * with a single netCDF call. The checkpoint file is opened read-only,
+     * so each MPI rank can read the rectangle of its own block.
+     *
+     * @param varid The NetCDF variable ID from which to read
+     * @param x The absolute x positions of the columns
+     * @param nx The number of columns
+     * @param y The absolute y positions of the rows
+     * @param ny The number of rows
+     * @param isTimeDependent Whether the variable is a function of the time (true) or not (false)
+     * @param stride The distance between two columns in the output array
+     * @param o_values The values, the value of cell (i,j) is stored at i*stride+j
+     */
+    void readFloatBlock(int varid, const float *x, int nx, const float *y, int ny,
+                        bool isTimeDependent, int stride, float *o_values) {
+        if(nx <= 0 || ny <= 0)
+            return;
+
+        // Indices of all columns and rows
+        const float left = getBoundaryPos(BND_LEFT);
+        const float bottom = getBoundaryPos(BND_BOTTOM);
+        std::vector<size_t> xIndices(nx), yIndices(ny);
+        for(int i = 0; i < nx; i++)
+            xIndices[i] = getIndex1D(x[i]-left, x_step, x_len);
+        for(int j = 0; j < ny; j++)
+            yIndices[j] = getIndex1D(y[j]-bottom, y_step, y_len);
+
+        const size_t xMin = *std::min_element(xIndices.begin(), xIndices.end());
+        const size_t xMax = *std::max_element(xIndices.begin(), xIndices.end());
+        const size_t yMin = *std::min_element(yIndices.begin(), yIndices.end());
+        const size_t yMax = *std::max_element(yIndices.begin(), yIndices.end());
+        const size_t slabX = xMax - xMin + 1;
+        const size_t slabY = yMax - yMin + 1;
+
+        // We want the values at the latest time step
+        size_t start[] = {time_len - 1, yMin, xMin};
+        size_t count[] = {1, slabY, slabX};
+
+        std::vector<float> slab(slabX * slabY);
+        int status;
+        if(isTimeDependent)
+            status = keyframes.getSlab(varid, start[0], start+1, count+1, &slab[0]);
+        else
+            status = nc_get_vara_float(file_id, varid, start+1, count+1, &slab[0]);
+        if(status != NC_NOERR) handleNetCDFError(status);
+
+        // The file is stored row by row, Float2D column by column
+#ifdef USEOPENMP
+#pragma omp parallel for
+#endif
+        for(int i = 0; i < nx; i++)
+            for(int j = 0; j < ny; j++)
+                o_values[i*stride + j] = slab[(yIndices[j]-yMin)*slabX + (xIndices[i]-xMin)];
+    }
+    
     /// Read and decode the boundary type from a NetCDF attribute
     /**
      * @param name The name of the attribute
@@ -278,7 +373,7 @@ public:
      * @return water height at pos
      */
     float getWaterHeight(float x, float y) {
-        return readFloatValue(h_id, x, y);
+        return readFloatValue(h_id, x, y) * h_scale + h_offset;
     };
     
     /**
@@ -287,7 +382,7 @@ public:
     float getVeloc_u(float x, float y) {
         float height = getWaterHeight(x, y);
         if(height >= tolerance)
-            return readFloatValue(hu_id, x, y) / height;
+            return (readFloatValue(hu_id, x, y) * hu_scale + hu_offset) / height;
         return 0.0;
     };
     
@@ -297,10 +392,52 @@ public:
     float getVeloc_v(float x, float y) {
         float height = getWaterHeight(x, y);
         if(height >= tolerance)
-            return readFloatValue(hv_id, x, y) / height;
+            return (readFloatValue(hv_id, x, y) * hv_scale + hv_offset) / height;
         return 0.0;
     };
     
+    /**
+     * Reads h, hu and hv of the block with one hyperslab per variable
+     *
+     * @see SWE_Scenario::getInitialValuesBlock
+     */
+    void getInitialValuesBlock(const float *i_x, int i_nx, const float *i_y, int i_ny,
+                               int i_stride, float *o_h, float *o_u, float *o_v) {
+        readFloatBlock(h_id, i_x, i_nx, i_y, i_ny, true, i_stride, o_h);
+        readFloatBlock(hu_id, i_x, i_nx, i_y, i_ny, true, i_stride, o_u);
+        readFloatBlock(hv_id, i_x, i_nx, i_y, i_ny, true, i_stride, o_v);
+
+        // same as getWaterHeight, getVeloc_u and getVeloc_v
+#ifdef USEOPENMP
+#pragma omp parallel for
+#endif
+        for(int i = 0; i < i_nx; i++) {
+            for(int j = 0; j < i_ny; j++) {
+                float &height = o_h[i*i_stride + j];
+                float &u = o_u[i*i_stride + j];
+                float &v = o_v[i*i_stride + j];
+
+                height = height * h_scale + h_offset;
+                if(height >= tolerance) {
+                    u = (u * hu_scale + hu_offset) / height;
+                    v = (v * hv_scale + hv_offset) / height;
+                } else {
+                    u = v = 0.0;
+                }
+            }
+        }
+    }
+    
+    /**
+     * Reads b of the block with one hyperslab
+     *
+     * @see SWE_Scenario::getBathymetryBlock
+     */
+    void getBathymetryBlock(const float *i_x, int i_nx, const float *i_y, int i_ny,
+                            int i_stride, float *o_b) {
+        readFloatBlock(b_id, i_x, i_nx, i_y, i_ny, false, i_stride, o_b);
+    }
+    
     /// Get the number of grid cells in x- and y-direction
     /**
      * @param nX Pointer to where the number of grid cells in x-direction should be written
@@ -59,6 +59,50 @@ class SWE_Scenario {
     virtual float getVeloc_u(float x, float y) { return 0.0f; };
     virtual float getVeloc_v(float x, float y) { return 0.0f; };
     virtual float getBathymetry(float x, float y) { return 0.0f; };
+
+    /// Sample the initial water height and velocities at the cells of a block
+    /**
+     * The cell (i,j) is located at (i_x[i], i_y[j]), its values are stored at
+     * index i*i_stride+j (the column-major layout of Float2D).
+     * Scenarios that read their data from files should override this to
+     * load the data required by the whole block at once.
+     *
+     * @param i_x x-positions of the columns
+     * @param i_nx number of columns
+     * @param i_y y-positions of the rows
+     * @param i_ny number of rows
+     * @param i_stride distance between two columns in the output arrays
+     * @param o_h water heights
+     * @param o_u velocities in x-direction
+     * @param o_v velocities in y-direction
+     */
+    virtual void getInitialValuesBlock(const float *i_x, int i_nx, const float *i_y, int i_ny,
+                                       int i_stride, float *o_h, float *o_u, float *o_v) {
+       for(int i = 0; i < i_nx; i++)
+          for(int j = 0; j < i_ny; j++) {
+             o_h[i*i_stride + j] = getWaterHeight(i_x[i], i_y[j]);
+             o_u[i*i_stride + j] = getVeloc_u(i_x[i], i_y[j]);
+             o_v[i*i_stride + j] = getVeloc_v(i_x[i], i_y[j]);
+          }
+    };
+
+    /// Sample the bathymetry at the cells of a block
+    /**
+     * @see getInitialValuesBlock
+     *
+     * @param i_x x-positions of the columns
+     * @param i_nx number of columns
+     * @param i_y y-positions of the rows
+     * @param i_ny number of rows
+     * @param i_stride distance between two columns in the output array
+     * @param o_b bathymetry
+     */
+    virtual void getBathymetryBlock(const float *i_x, int i_nx, const float *i_y, int i_ny,
+                                    int i_stride, float *o_b) {
+       for(int i = 0; i < i_nx; i++)
+          for(int j = 0; j < i_ny; j++)
+             o_b[i*i_stride + j] = getBathymetry(i_x[i], i_y[j]);
+    };
     
     virtual float waterHeightAtRest() { return 10.0f; };
 
@@ -1,12 +1,17 @@
 #ifndef __SWE_TSUNAMISCENARIO_HH
 #define __SWE_TSUNAMISCENARIO_HH
 
+#include <algorithm>
 #include <iostream>
 #include <cassert>
 #include <cstdlib>
+#include <vector>
 #include <netcdf.h>
 
 #include "SWE_Scenario.hh"
+#ifdef MMAP_INPUT_CACHE
+#include "tools/InputCache.hh"
+#endif
 
 /**
  * Scenario "Tsunami"
@@ -55,7 +60,11 @@ protected:
     float bathymetry_y_step;
 #ifdef NETCDF_CACHE
     //! NetCDF bathymetry z data as cache (for fast read access)
-    float *bathymetry_z_cache;
+    const float *bathymetry_z_cache;
+#endif
+#ifdef MMAP_INPUT_CACHE
+    //! Memory mapping of the raw bathymetry cache
+    tools::InputCache bathymetry_z_mapping;
 #endif
     
     //! The NetCDF displacement file ID
@@ -90,7 +99,11 @@ protected:
     float displacement_y_step;
 #ifdef NETCDF_CACHE
     //! NetCDF displacement z data as cache (for fast read access)
-    float *displacement_z_cache;
+    const float *displacement_z_cache;
+#endif
+#ifdef MMAP_INPUT_CACHE
+    //! Memory mapping of the raw displacement cache
+    tools::InputCache displacement_z_mapping;
 #endif
     
     /// Load both the bathymetry and displacement file
@@ -132,10 +145,13 @@ protected:
         bathymetry_y_values = new float[bathymetry_y_len];
         
 #ifdef NETCDF_CACHE
-        // Allocate memory for netcdf bathymetry cache
-        bathymetry_z_cache = new float[bathymetry_y_len*bathymetry_x_len];
-        // Load complete var
-        nc_get_var_float(bathymetry_file_id, bathymetry_z_id, bathymetry_z_cache);
+#ifdef MMAP_INPUT_CACHE
+        // Map the raw cache (created by SWE_netcdf_to_cache) if it exists
+        if(mapCache(bathymetryFileName, bathymetry_x_len, bathymetry_y_len, bathymetry_z_mapping))
+            bathymetry_z_cache = bathymetry_z_mapping.getValues();
+        else
+#endif
+        bathymetry_z_cache = loadCache(bathymetry_file_id, bathymetry_z_id, bathymetry_x_len, bathymetry_y_len);
 #endif
         
         // Read dimensions from file
@@ -197,10 +213,13 @@ protected:
         displacement_y_values = new float[displacement_y_len];
         
 #ifdef NETCDF_CACHE
-        // Allocate memory for netcdf bathymetry cache
-        displacement_z_cache = new float[displacement_y_len*displacement_x_len];
-        // Load complete var
-        nc_get_var_float(displacement_file_id, displacement_z_id, displacement_z_cache);
+#ifdef MMAP_INPUT_CACHE
+        // Map the raw cache (created by SWE_netcdf_to_cache) if it exists
+        if(mapCache(displacementFileName, displacement_x_len, displacement_y_len, displacement_z_mapping))
+            displacement_z_cache = displacement_z_mapping.getValues();
+        else
+#endif
+        displacement_z_cache = loadCache(displacement_file_id, displacement_z_id, displacement_x_len, displacement_y_len);
 #endif
         
         // Read dimensions from file
@@ -230,6 +249,56 @@ protected:
         displacement_top = displacement_y_values[displacement_y_len-1] + displacement_y_step/2;
     }
     
+#ifdef NETCDF_CACHE
+    /// Load the complete z variable of an input file into memory
+    /**
+     * @param fileId The NetCDF file ID
+     * @param varId The NetCDF z variable ID
+     * @param xLength The length of the x dimension
+     * @param yLength The length of the y dimension
+     * @return The values (allocated with new[])
+     */
+    float* loadCache(int fileId, int varId, size_t xLength, size_t yLength) {
+        // Allocate memory for netcdf cache
+        float *cache = new float[yLength*xLength];
+        // Load complete var
+        int retval = nc_get_var_float(fileId, varId, cache);
+        if(retval != NC_NOERR) handleNetCDFError(retval);
+        return cache;
+    }
+
+    /// Free a cache loaded with loadCache (mapped caches are unmapped by their InputCache)
+    void freeCache(const float *cache) {
+#ifdef MMAP_INPUT_CACHE
+        if(cache == bathymetry_z_mapping.getValues() || cache == displacement_z_mapping.getValues())
+            return;
+#endif
+        delete[] cache;
+    }
+#endif
+
+#ifdef MMAP_INPUT_CACHE
+    /// Map the raw cache of an input file
+    /**
+     * All processes on a node share the pages of a mapped cache and
+     * only the pages that are accessed are read from disk.
+     *
+     * @param fileName The file name of the netCDF input file
+     * @param xLength The length of the x dimension
+     * @param yLength The length of the y dimension
+     * @param mapping The mapping
+     * @return True if the cache was mapped
+     */
+    bool mapCache(const std::string &fileName, size_t xLength, size_t yLength, tools::InputCache &mapping) {
+        if(mapping.map(fileName, xLength, yLength))
+            return true;
+
+        std::cerr << "WARNING: " << tools::InputCache::fileName(fileName) << " is missing or out of date"
+                << " (create it with SWE_netcdf_to_cache), loading " << fileName << " into memory" << std::endl;
+        return false;
+    }
+#endif
+    
     /// Abort execution with netCDF error message
     /**
      * @param status The error status returned by a netCDF function call
@@ -376,6 +445,182 @@ protected:
 #endif
     }
     
+    /// Calculate the nearest cell indices for all rows or columns of a block
+    /**
+     * Positions outside of [left, right] are skipped if onlyInside is set.
+     *
+     * @param positions The positions of the rows/columns
+     * @param length The number of rows/columns
+     * @param origin The origin of the domain
+     * @param end The end of the domain (opposite of the origin)
+     * @param stepWidth The assumed step width between cells
+     * @param values Array of dimension data (the center position of each cell)
+     * @param valuesLength The total length of the values array
+     * @param onlyInside Skip positions outside of the domain
+     * @param o_blockIndices The rows/columns that are not skipped
+     * @param o_indices The nearest cell index of each row/column that is not skipped
+     */
+    void getIndices1D(const float *positions, int length, float origin, float end, float stepWidth,
+                      float *values, size_t valuesLength, bool onlyInside,
+                      std::vector<int> &o_blockIndices, std::vector<size_t> &o_indices) {
+        o_blockIndices.clear();
+        for(int i = 0; i < length; i++) {
+            if(!onlyInside || isBetween(positions[i], origin, end))
+                o_blockIndices.push_back(i);
+        }
+
+        o_indices.resize(o_blockIndices.size());
+#ifdef USEOPENMP
+#pragma omp parallel for
+#endif
+        for(int i = 0; i < (int) o_blockIndices.size(); i++)
+            o_indices[i] = getIndex1D(positions[o_blockIndices[i]], origin, stepWidth, values, valuesLength);
+    }
+
+    /// Read the values of a netCDF variable for all combinations of x and y indices
+    /**
+     * Reads the sub-slab covering all indices with a single netCDF call.
+     * If the sub-slab is much larger than the result (the input data is
+     * finer than the block), only the required rows are read.
+     *
+     * @param fileId The netCDF file ID
+     * @param varId The netCDF variable ID
+     * @param xLength The length of the x dimension of the variable
+     * @param cache The cached variable (may be NULL)
+     * @param xIndices The x indices
+     * @param yIndices The y indices
+     * @param o_values The values, o_values[j*xIndices.size() + i] is the value at (xIndices[i], yIndices[j])
+     */
+    void readValues(int fileId, int varId, size_t xLength, const float *cache,
+                    const std::vector<size_t> &xIndices, const std::vector<size_t> &yIndices,
+                    std::vector<float> &o_values) {
+        const int nx = xIndices.size();
+        const int ny = yIndices.size();
+        o_values.resize(nx*ny);
+        if(nx == 0 || ny == 0)
+            return;
+
+        if(cache != 0L) {
+#ifdef USEOPENMP
+#pragma omp parallel for
+#endif
+            for(int j = 0; j < ny; j++)
+                for(int i = 0; i < nx; i++)
+                    o_values[j*nx + i] = cache[yIndices[j]*xLength + xIndices[i]];
+            return;
+        }
+
+        // The COARDS dimensions may be decreasing, therefore we need the range of the indices
+        const size_t xMin = *std::min_element(xIndices.begin(), xIndices.end());
+        const size_t xMax = *std::max_element(xIndices.begin(), xIndices.end());
+        const size_t yMin = *std::min_element(yIndices.begin(), yIndices.end());
+        const size_t yMax = *std::max_element(yIndices.begin(), yIndices.end());
+        const size_t slabX = xMax - xMin + 1;
+        const size_t slabY = yMax - yMin + 1;
+
+        int status;
+        if(slabX * slabY <= 4 * o_values.size()) {
+            std::vector<float> slab(slabX * slabY);
+            size_t start[] = {yMin, xMin};
+            size_t count[] = {slabY, slabX};
+            status = nc_get_vara_float(fileId, varId, start, count, &slab[0]);
+            if(status != NC_NOERR) handleNetCDFError(status);
+
+#ifdef USEOPENMP
+#pragma omp parallel for
+#endif
+            for(int j = 0; j < ny; j++)
+                for(int i = 0; i < nx; i++)
+                    o_values[j*nx + i] = slab[(yIndices[j]-yMin)*slabX + (xIndices[i]-xMin)];
+        } else {
+            std::vector<float> row(slabX);
+            for(int j = 0; j < ny; j++) {
+                if(j > 0 && yIndices[j] == yIndices[j-1]) {
+                    std::copy(&o_values[(j-1)*nx], &o_values[j*nx], &o_values[j*nx]);
+                    continue;
+                }
+
+                size_t start[] = {yIndices[j], xMin};
+                size_t count[] = {1, slabX};
+                status = nc_get_vara_float(fileId, varId, start, count, &row[0]);
+                if(status != NC_NOERR) handleNetCDFError(status);
+
+                for(int i = 0; i < nx; i++)
+                    o_values[j*nx + i] = row[xIndices[i]-xMin];
+            }
+        }
+    }
+
+    /// Compute the bathymetry and the water height for all cells of a block
+    /**
+     * Same as getBathymetry and getWaterHeight, but the bathymetry and the
+     * displacement are read with a few netCDF calls.
+     *
+     * @param x The x-positions of the columns
+     * @param nx The number of columns
+     * @param y The y-positions of the rows
+     * @param ny The number of rows
+     * @param stride The distance between two columns in the output arrays
+     * @param o_b The bathymetry (may be NULL)
+     * @param o_h The water height (may be NULL)
+     */
+    void getBlock(const float *x, int nx, const float *y, int ny, int stride, float *o_b, float *o_h) {
+#ifdef NETCDF_CACHE
+        const float *bathymetryCache = bathymetry_z_cache;
+        const float *displacementCache = displacement_z_cache;
+#else
+        const float *bathymetryCache = 0L;
+        const float *displacementCache = 0L;
+#endif
+
+        // nearest cell indices of all rows and columns
+        std::vector<int> columns, rows;
+        std::vector<size_t> xIndices, yIndices;
+
+        getIndices1D(x, nx, bathymetry_left, bathymetry_right, bathymetry_x_step,
+                bathymetry_x_values, bathymetry_x_len, false, columns, xIndices);
+        getIndices1D(y, ny, bathymetry_bottom, bathymetry_top, bathymetry_y_step,
+                bathymetry_y_values, bathymetry_y_len, false, rows, yIndices);
+        std::vector<float> bathymetry;
+        readValues(bathymetry_file_id, bathymetry_z_id, bathymetry_x_len, bathymetryCache,
+                xIndices, yIndices, bathymetry);
+
+        // the displacement is zero outside of the displacement domain
+        getIndices1D(x, nx, displacement_left, displacement_right, displacement_x_step,
+                displacement_x_values, displacement_x_len, true, columns, xIndices);
+        getIndices1D(y, ny, displacement_bottom, displacement_top, displacement_y_step,
+                displacement_y_values, displacement_y_len, true, rows, yIndices);
+        std::vector<float> displacementValues;
+        readValues(displacement_file_id, displacement_z_id, displacement_x_len, displacementCache,
+                xIndices, yIndices, displacementValues);
+
+        std::vector<float> displacement(nx*ny, 0.f);
+        for(size_t j = 0; j < rows.size(); j++)
+            for(size_t i = 0; i < columns.size(); i++)
+                displacement[rows[j]*nx + columns[i]] = displacementValues[j*columns.size() + i];
+
+#ifdef USEOPENMP
+#pragma omp parallel for
+#endif
+        for(int i = 0; i < nx; i++) {
+            for(int j = 0; j < ny; j++) {
+                float value = bathymetry[j*nx + i] + displacement[j*nx + i];
+
+                // same rounding as in getBathymetry
+                if(std::fabs(value) < 20.0)
+                    value = (value >= 0.0) ? 20.0 : -20.0;
+
+                if(o_b != 0L)
+                    o_b[i*stride + j] = value;
+                if(o_h != 0L) {
+                    // same as in getWaterHeight
+                    float height = -(value - displacement[j*nx + i]);
+                    o_h[i*stride + j] = (height >= 0.0) ? height : 0.0;
+                }
+            }
+        }
+    }
+
     /// Checks if a supplied value lies between two boundaries 
     /**
      * @param value The value to perform the boundary check on
@@ -446,8 +691,8 @@ public:
         delete[] displacement_x_values;
         delete[] displacement_y_values;
 #ifdef NETCDF_CACHE
-        delete[] bathymetry_z_cache;
-        delete[] displacement_z_cache;
+        freeCache(bathymetry_z_cache);
+        freeCache(displacement_z_cache);
 #endif
     }
     
@@ -477,6 +722,32 @@ public:
         return 0.0;
     };
     
+    /**
+     * Reads the bathymetry and displacement of the whole block at once
+     *
+     * @see SWE_Scenario::getInitialValuesBlock
+     */
+    void getInitialValuesBlock(const float *i_x, int i_nx, const float *i_y, int i_ny,
+                               int i_stride, float *o_h, float *o_u, float *o_v) {
+        getBlock(i_x, i_nx, i_y, i_ny, i_stride, 0L, o_h);
+
+        for(int i = 0; i < i_nx; i++)
+            for(int j = 0; j < i_ny; j++) {
+                o_u[i*i_stride + j] = getVeloc_u(i_x[i], i_y[j]);
+                o_v[i*i_stride + j] = getVeloc_v(i_x[i], i_y[j]);
+            }
+    }
+
+    /**
+     * Reads the bathymetry and displacement of the whole block at once
+     *
+     * @see SWE_Scenario::getBathymetryBlock
+     */
+    void getBathymetryBlock(const float *i_x, int i_nx, const float *i_y, int i_ny,
+                            int i_stride, float *o_b) {
+        getBlock(i_x, i_nx, i_y, i_ny, i_stride, o_b, 0L);
+    }
+
     /**
      * @return time when to end simulation
      */
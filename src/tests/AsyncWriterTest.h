@@ -0,0 +1,132 @@
+#include <cxxtest/TestSuite.h>
+#include <unistd.h>
+#include <vector>
+
+#include "writer/AsyncWriter.hh"
+
+/**
+ * Writer that records the written time steps
+ */
+class RecordingWriter : public io::Writer {
+    public:
+        //! Simulation times of the written time steps
+        std::vector<float> times;
+        //! Water height of cell (1,1) of the written time steps
+        std::vector<float> heights;
+        //! Sum of hu and hv of all cells of the written time steps
+        std::vector<float> discharges;
+
+        //! Time (in microseconds) each write takes
+        unsigned int delay;
+
+        RecordingWriter(const Float2D &i_b, const io::BoundarySize &i_boundarySize,
+                int i_nX, int i_nY)
+            : io::Writer("recording", i_b, i_boundarySize, i_nX, i_nY),
+              delay(0)
+        {
+        }
+
+        void writeTimeStep(const Float2D &i_h, const Float2D &i_hu, const Float2D &i_hv,
+                float i_time) {
+            usleep(delay);
+
+            float discharge = 0;
+            for(int i = 0; i < i_hu.getCols(); i++)
+                for(int j = 0; j < i_hu.getRows(); j++)
+                    discharge += i_hu[i][j] + i_hv[i][j];
+
+            times.push_back(i_time);
+            heights.push_back(i_h[1][1]);
+            discharges.push_back(discharge);
+            timeStep++;
+        }
+};
+
+/**
+ * Unit test for the AsyncWriter
+ */
+class AsyncWriterTest : public CxxTest::TestSuite {
+    private:
+        //! Number of cells in x-direction
+        static const int NX = 7;
+        //! Number of cells in y-direction
+        static const int NY = 5;
+
+        //! Number of time steps to write
+        static const int TIMESTEPS = 10;
+
+        /**
+         * Write TIMESTEPS time steps and check that all time steps arrive
+         * in the correct order with the values at the time of the call
+         *
+         * @param delay Time (in microseconds) each write of the wrapped writer takes
+         */
+        void checkTimeSteps(unsigned int delay) {
+            io::BoundarySize boundarySize = {{1, 1, 1, 1}};
+            Float2D b(NX+2, NY+2), h(NX+2, NY+2), hu(NX+2, NY+2), hv(NX+2, NY+2);
+
+            RecordingWriter recordingWriter(b, boundarySize, NX, NY);
+            recordingWriter.delay = delay;
+
+            {
+                io::AsyncWriter asyncWriter(recordingWriter);
+
+                for(int step = 0; step < TIMESTEPS; step++) {
+                    for(int i = 0; i < NX+2; i++) {
+                        for(int j = 0; j < NY+2; j++) {
+                            h[i][j] = step;
+                            hu[i][j] = 1;
+                            hv[i][j] = step;
+                        }
+                    }
+
+                    asyncWriter.writeTimeStep(h, hu, hv, .5f * step);
+                }
+
+                asyncWriter.flush();
+                TS_ASSERT_EQUALS(recordingWriter.times.size(), (unsigned int) TIMESTEPS);
+                TS_ASSERT_LESS_THAN_EQUALS(asyncWriter.getHiddenTime(), asyncWriter.getWriteTime());
+            }
+
+            TS_ASSERT_EQUALS(recordingWriter.times.size(), (unsigned int) TIMESTEPS);
+            for(unsigned int step = 0; step < recordingWriter.times.size(); step++) {
+                TS_ASSERT_EQUALS(recordingWriter.times[step], .5f * step);
+                TS_ASSERT_EQUALS(recordingWriter.heights[step], step);
+                TS_ASSERT_EQUALS(recordingWriter.discharges[step], (NX+2)*(NY+2)*(1.f + step));
+            }
+        }
+
+    public:
+        /**
+         * A fast writer (the staging buffers are usually free)
+         */
+        void testFastWriter() {
+            checkTimeSteps(0);
+        }
+
+        /**
+         * A slow writer (writeTimeStep has to wait for a free staging buffer)
+         */
+        void testSlowWriter() {
+            checkTimeSteps(2000);
+        }
+
+        /**
+         * Destroying the writer writes all queued time steps
+         */
+        void testDestructor() {
+            io::BoundarySize boundarySize = {{1, 1, 1, 1}};
+            Float2D b(NX+2, NY+2), h(NX+2, NY+2);
+
+            RecordingWriter recordingWriter(b, boundarySize, NX, NY);
+            recordingWriter.delay = 2000;
+
+            {
+                io::AsyncWriter asyncWriter(recordingWriter);
+                for(int step = 0; step < TIMESTEPS; step++)
+                    asyncWriter.writeTimeStep(h, h, h, step);
+            }
+
+            TS_ASSERT_EQUALS(recordingWriter.times.size(), (unsigned int) TIMESTEPS);
+        }
+};
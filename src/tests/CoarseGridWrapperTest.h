@@ -1,5 +1,6 @@
 
 #include <cxxtest/TestSuite.h>
+#include <vector>
 
 #define private public
 #define protected public
@@ -38,6 +39,18 @@ class CoarseGridWrapperTest : public CxxTest::TestSuite {
         static const unsigned int altRows = 13;
         //! coarseness factor (alternative testing sequence)
         static const float altCoarseness = 4.0f;
+
+        /// Compare getAllElems with getElem
+        void checkAllElems(io::CoarseGridWrapper &i_wrapper) {
+            std::vector<float> values(i_wrapper.getCols() * i_wrapper.getRows());
+            i_wrapper.getAllElems(&values[0]);
+
+            for(unsigned int i = 0; i < i_wrapper.getCols(); i++) {
+                for(unsigned int j = 0; j < i_wrapper.getRows(); j++) {
+                    TS_ASSERT_DELTA(values[j*i_wrapper.getCols() + i], i_wrapper.getElem(i,j), 1e-5);
+                }
+            }
+        }
     public:
 
         /// Set Up called before each test case (create wrapper)
@@ -118,6 +131,22 @@ class CoarseGridWrapperTest : public CxxTest::TestSuite {
             }
         }
         
+        /// Test reading all coarse values at once
+        void testGetAllElems() {
+            checkAllElems(*wrapper);
+            checkAllElems(*altWrapper);
+            checkAllElems(*identicalWrapper);
+
+            // integer step width in both directions
+            io::CoarseGridWrapper integerWrapper(*grid, boundary, cols, rows, 2.f);
+            TS_ASSERT_EQUALS(integerWrapper.getCols(), 6);
+            checkAllElems(integerWrapper);
+            // integer step width only in x-direction
+            io::CoarseGridWrapper mixedWrapper(*grid, boundary, cols, altRows, 3.f);
+            TS_ASSERT_EQUALS(mixedWrapper.stepWidthX, 3.f);
+            checkAllElems(mixedWrapper);
+        }
+
         /// Test reading of number of coarse grid columns
         void testGetCols() {
             TS_ASSERT_EQUALS(wrapper->getCols(), 8);
@@ -0,0 +1,165 @@
+#include <cxxtest/TestSuite.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "blocks/simd/FWaveBatch.hh"
+#include "fwave_solver/FWave.hpp"
+
+/**
+ * Unit test for the batch F-Wave solver: checks the vectorized implementations
+ * against the scalar implementation and all implementations against the
+ * edge-by-edge F-Wave solver
+ */
+class FWaveBatchTest : public CxxTest::TestSuite {
+    private:
+        /** relative tolerance for comparing different implementations */
+        const static float REL_TOLERANCE = 1e-4;
+        
+        /** Number of edges (not a multiple of the vector length) */
+        const static int EDGES = 1003;
+        
+        std::vector<float> hL, hR, huL, huR, bL, bR;
+        
+        /// simple deterministic pseudo random numbers in [0,1)
+        float random(unsigned int &state) {
+            state = state * 1103515245u + 12345u;
+            return ((state >> 8) & 0xFFFF) / 65536.f;
+        }
+        
+        /// Compute updates of all edges with the given implementation
+        float compute(solver::FWaveBatch::InstructionSet instructionSet, std::vector<float> o_updates[4]) {
+            solver::FWaveBatch batchSolver;
+            batchSolver.setInstructionSet(instructionSet);
+            for(int k = 0; k < 4; k++)
+                o_updates[k].assign(EDGES, -1.f);
+            
+            float maxWaveSpeed = 0.f;
+            batchSolver.computeNetUpdates(EDGES, &hL[0], &hR[0], &huL[0], &huR[0], &bL[0], &bR[0],
+                &o_updates[0][0], &o_updates[1][0], &o_updates[2][0], &o_updates[3][0], maxWaveSpeed);
+            return maxWaveSpeed;
+        }
+        
+    public:
+        /// Create random edges with wet, dry and wet/dry states
+        void setUp() {
+            unsigned int state = 42;
+            hL.resize(EDGES); hR.resize(EDGES); huL.resize(EDGES); huR.resize(EDGES); bL.resize(EDGES); bR.resize(EDGES);
+            for(int k = 0; k < EDGES; k++) {
+                hL[k] = (random(state) < .1f) ? 0.f : 100.f * random(state);
+                hR[k] = (random(state) < .1f) ? 0.f : 100.f * random(state);
+                huL[k] = 200.f * (random(state) - .5f);
+                huR[k] = 200.f * (random(state) - .5f);
+                bL[k] = -100.f * random(state);
+                bR[k] = -100.f * random(state);
+            }
+        }
+        
+        /// All implementations supported by the CPU compute the same updates
+        void testInstructionSets() {
+            std::vector<float> reference[4];
+            float referenceSpeed = compute(solver::FWaveBatch::SCALAR, reference);
+            TS_ASSERT_LESS_THAN(0.f, referenceSpeed);
+            
+            solver::FWaveBatch::InstructionSet best = solver::FWaveBatch::detectInstructionSet();
+            for(int set = solver::FWaveBatch::AVX2; set <= best; set++) {
+                std::vector<float> updates[4];
+                float speed = compute((solver::FWaveBatch::InstructionSet) set, updates);
+                TS_ASSERT_DELTA(speed, referenceSpeed, REL_TOLERANCE * referenceSpeed);
+                
+                for(int u = 0; u < 4; u++)
+                    for(int k = 0; k < EDGES; k++)
+                        TS_ASSERT_DELTA(updates[u][k], reference[u][k],
+                            REL_TOLERANCE * (1.f + std::fabs(reference[u][k])));
+            }
+        }
+        
+        /// All implementations compute the same updates as solver::FWave
+        void testReferenceSolver() {
+            // dry tolerance of both solvers (default)
+            const float dryTol = 0.01f;
+            const float boundaryHeights[3] = { .99f * dryTol, dryTol, 1.01f * dryTol };
+            
+            unsigned int state = 7;
+            for(int k = 0; k < EDGES; k++) {
+                switch(k % 5) {
+                case 0:
+                    // dry/wet
+                    hL[k] = 0.f;
+                    break;
+                case 1:
+                    // wet/dry
+                    hR[k] = 0.f;
+                    break;
+                case 2:
+                    // dry/dry
+                    hL[k] = hR[k] = 0.f;
+                    break;
+                case 3:
+                    // one cell just below, at or just above the dry tolerance
+                    if(random(state) < .5f)
+                        hL[k] = boundaryHeights[(k/5) % 3];
+                    else
+                        hR[k] = boundaryHeights[(k/5) % 3];
+                    break;
+                default:
+                    // random state of setUp
+                    break;
+                }
+                
+                // keep the velocities of shallow cells bounded
+                huL[k] = hL[k] * 20.f * (random(state) - .5f);
+                huR[k] = hR[k] * 20.f * (random(state) - .5f);
+            }
+            
+            std::vector<float> reference[4];
+            for(int u = 0; u < 4; u++)
+                reference[u].resize(EDGES);
+            
+            solver::FWave<float> edgeSolver;
+            float referenceSpeed = 0.f;
+            for(int k = 0; k < EDGES; k++) {
+                float speed;
+                edgeSolver.computeNetUpdates(hL[k], hR[k], huL[k], huR[k], bL[k], bR[k],
+                    reference[0][k], reference[1][k], reference[2][k], reference[3][k], speed);
+                referenceSpeed = std::max(referenceSpeed, speed);
+            }
+            TS_ASSERT_LESS_THAN(0.f, referenceSpeed);
+            
+            solver::FWaveBatch::InstructionSet best = solver::FWaveBatch::detectInstructionSet();
+            for(int set = solver::FWaveBatch::SCALAR; set <= best; set++) {
+                std::vector<float> updates[4];
+                float speed = compute((solver::FWaveBatch::InstructionSet) set, updates);
+                TS_ASSERT_DELTA(speed, referenceSpeed, REL_TOLERANCE * referenceSpeed);
+                
+                for(int u = 0; u < 4; u++)
+                    for(int k = 0; k < EDGES; k++)
+                        TS_ASSERT_DELTA(updates[u][k], reference[u][k],
+                            REL_TOLERANCE * (1.f + std::fabs(reference[u][k])));
+            }
+        }
+        
+        /// Dry cells and a lake at rest do not produce any updates
+        void testSteadyStates() {
+            for(int k = 0; k < EDGES; k++) {
+                if(k % 2) {
+                    // both cells dry
+                    hL[k] = hR[k] = 0.f;
+                } else {
+                    // lake at rest
+                    hL[k] = 50.f - bL[k];
+                    hR[k] = 50.f - bR[k];
+                    huL[k] = huR[k] = 0.f;
+                }
+            }
+            
+            solver::FWaveBatch::InstructionSet best = solver::FWaveBatch::detectInstructionSet();
+            for(int set = solver::FWaveBatch::SCALAR; set <= best; set++) {
+                std::vector<float> updates[4];
+                compute((solver::FWaveBatch::InstructionSet) set, updates);
+                for(int u = 0; u < 4; u++)
+                    for(int k = 0; k < EDGES; k++)
+                        TS_ASSERT_DELTA(updates[u][k], 0.f, 1e-2);
+            }
+        }
+};
@@ -0,0 +1,97 @@
+#include <cxxtest/TestSuite.h>
+
+#include "tools/help.hh"
+
+/**
+ * Unit test for the memory layout of Float2D (alignment, padding, allocators)
+ */
+class Float2DTest : public CxxTest::TestSuite {
+    private:
+        /**
+         * Allocator that counts allocations and deallocations
+         */
+        class CountingAllocator : public AlignedFloat2DAllocator {
+            public:
+                int allocations;
+                int deallocations;
+                
+                CountingAllocator() : allocations(0), deallocations(0) {}
+                
+                float* allocate(size_t n) {
+                    allocations++;
+                    return AlignedFloat2DAllocator::allocate(n);
+                }
+                
+                void deallocate(float* p, size_t n) {
+                    deallocations++;
+                    AlignedFloat2DAllocator::deallocate(p, n);
+                }
+        };
+        
+        /**
+         * Fill the array with unique values and check them using all access methods
+         */
+        void checkAccess(Float2D &a) {
+            for(int i = 0; i < a.getCols(); i++)
+                for(int j = 0; j < a.getRows(); j++)
+                    a[i][j] = i * 1000 + j;
+            
+            for(int i = 0; i < a.getCols(); i++) {
+                Float1D col = a.getColProxy(i);
+                for(int j = 0; j < a.getRows(); j++) {
+                    TS_ASSERT_EQUALS(col[j], i * 1000 + j);
+                    TS_ASSERT_EQUALS(a.elemVector()[i * a.getLeadingDimension() + j], i * 1000 + j);
+                }
+            }
+            for(int j = 0; j < a.getRows(); j++) {
+                Float1D row = a.getRowProxy(j);
+                for(int i = 0; i < a.getCols(); i++)
+                    TS_ASSERT_EQUALS(row[i], i * 1000 + j);
+            }
+        }
+        
+    public:
+        /// Arrays without padding are contiguous and aligned
+        void testNoPadding() {
+            Float2D a(7, 13);
+            TS_ASSERT_EQUALS(a.getLeadingDimension(), 13);
+            TS_ASSERT_EQUALS(reinterpret_cast<size_t>(a.elemVector()) % Float2D::ALIGNMENT, 0);
+            for(int i = 0; i < 7; i++)
+                for(int j = 0; j < 13; j++)
+                    TS_ASSERT_EQUALS(a[i][j], 0.f);
+            checkAccess(a);
+        }
+        
+        /// Padded columns are aligned and do not have a 4 KiB stride
+        void testPadding() {
+            Float2D a(5, 13, true, Float2D::PADDING_ALIGNED);
+            TS_ASSERT_EQUALS(a.getLeadingDimension(), 16);
+            for(int i = 0; i < 5; i++)
+                TS_ASSERT_EQUALS(reinterpret_cast<size_t>(a[i]) % Float2D::ALIGNMENT, 0);
+            checkAccess(a);
+            
+            Float2D b(3, 1024, false, Float2D::PADDING_ALIGNED);
+            TS_ASSERT_LESS_THAN(1024, b.getLeadingDimension());
+            TS_ASSERT_EQUALS(reinterpret_cast<size_t>(b[1]) % Float2D::ALIGNMENT, 0);
+        }
+        
+        /// Default padding and allocator are used by all arrays created afterwards
+        void testDefaults() {
+            CountingAllocator allocator;
+            Float2D::setDefaultAllocator(&allocator);
+            Float2D::setDefaultPadding(Float2D::PADDING_ALIGNED);
+            {
+                Float2D a(4, 20);
+                TS_ASSERT_EQUALS(a.getLeadingDimension(), 32);
+                TS_ASSERT_EQUALS(allocator.allocations, 1);
+                checkAccess(a);
+            }
+            TS_ASSERT_EQUALS(allocator.deallocations, 1);
+            
+            Float2D::setDefaultAllocator(0L);
+            Float2D::setDefaultPadding(Float2D::PADDING_NONE);
+            Float2D b(4, 20);
+            TS_ASSERT_EQUALS(b.getLeadingDimension(), 20);
+            TS_ASSERT_EQUALS(allocator.allocations, 1);
+        }
+};
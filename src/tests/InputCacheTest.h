@@ -0,0 +1,89 @@
+#include <cxxtest/TestSuite.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "tools/InputCache.hh"
+
+/**
+ * Unit test for the memory-mapped raw input cache
+ */
+class InputCacheTest : public CxxTest::TestSuite {
+    private:
+        //! Number of values in x-direction
+        static const size_t NX = 300;
+        //! Number of values in y-direction
+        static const size_t NY = 70;
+
+        //! Name of the (dummy) netCDF file
+        std::string netCdfFileName;
+        //! Name of the test file
+        std::string fileName;
+
+    public:
+        /// Write a cache file with the values y*NX + x
+        void setUp() {
+            netCdfFileName = "InputCacheTest.nc";
+            fileName = tools::InputCache::fileName(netCdfFileName);
+
+            FILE* netCdfFile = fopen(netCdfFileName.c_str(), "wb");
+            TS_ASSERT(netCdfFile != 0L);
+            fputs("CDF", netCdfFile);
+            fclose(netCdfFile);
+
+            std::vector<float> values(NX*NY);
+            for(size_t i = 0; i < values.size(); i++)
+                values[i] = i;
+
+            FILE* file = fopen(fileName.c_str(), "wb");
+            TS_ASSERT(file != 0L);
+            TS_ASSERT(tools::InputCache::writeHeader(file, netCdfFileName, NX, NY));
+            TS_ASSERT_EQUALS(fwrite(&values[0], sizeof(float), values.size(), file), values.size());
+            fclose(file);
+        }
+
+        void tearDown() {
+            remove(fileName.c_str());
+            remove(netCdfFileName.c_str());
+        }
+
+        /// Test mapping a valid cache
+        void testMap() {
+            tools::InputCache cache;
+            TS_ASSERT(cache.getValues() == 0L);
+
+            TS_ASSERT(cache.map(netCdfFileName, NX, NY));
+            const float* values = cache.getValues();
+            TS_ASSERT(values != 0L);
+            TS_ASSERT_EQUALS(reinterpret_cast<size_t>(values) % 4096, 0u);
+
+            for(size_t y = 0; y < NY; y++) {
+                for(size_t x = 0; x < NX; x++)
+                    TS_ASSERT_EQUALS(values[y*NX + x], y*NX + x);
+            }
+
+            cache.unmap();
+            TS_ASSERT(cache.getValues() == 0L);
+        }
+
+        /// Test rejecting missing files and caches of other variables
+        void testInvalid() {
+            tools::InputCache cache;
+            TS_ASSERT(!cache.map(netCdfFileName + ".missing", NX, NY));
+            TS_ASSERT(!cache.map(netCdfFileName, NY, NX));
+            TS_ASSERT(!cache.map(netCdfFileName, NX, NY+1));
+            TS_ASSERT(cache.getValues() == 0L);
+        }
+
+        /// Test rejecting the cache of a modified netCDF file
+        void testOutdated() {
+            FILE* netCdfFile = fopen(netCdfFileName.c_str(), "ab");
+            TS_ASSERT(netCdfFile != 0L);
+            fputs("modified", netCdfFile);
+            fclose(netCdfFile);
+
+            tools::InputCache cache;
+            TS_ASSERT(!cache.map(netCdfFileName, NX, NY));
+            TS_ASSERT(cache.getValues() == 0L);
+        }
+};
@@ -0,0 +1,286 @@
+#include <cxxtest/TestSuite.h>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "writer/NetCdfWriter.hh"
+#include "scenarios/SWE_CheckpointTsunamiScenario.hh"
+#include "tools/NetCdfKeyframeReader.hh"
+
+/**
+ * Unit test for the storage options of the NetCdfWriter
+ * (the files are read with SWE_CheckpointTsunamiScenario)
+ */
+class NetCdfWriterTest : public CxxTest::TestSuite {
+    private:
+        //! Number of cells in x-direction
+        static const int NX = 12;
+        //! Number of cells in y-direction
+        static const int NY = 9;
+
+        //! Base name of the test file
+        std::string baseName;
+
+        /**
+         * Write two time steps with the given options, read the last one with the
+         * checkpoint scenario and compare it with the original values
+         *
+         * @param options Storage options of the writer
+         * @param heightTolerance Largest allowed error of the water height
+         * @param dischargeTolerance Largest allowed error of the discharge
+         * @param depth Offset of the water heights
+         * @return Number of values clipped by the writer
+         */
+        size_t checkOptions(const io::NetCdfOptions &options, float heightTolerance, float dischargeTolerance,
+                float depth = 0.f) {
+            Float2D h(NX+2, NY+2), hu(NX+2, NY+2), hv(NX+2, NY+2), b(NX+2, NY+2);
+            for(int i = 0; i < NX+2; i++) {
+                for(int j = 0; j < NY+2; j++) {
+                    h[i][j] = depth + 10.f + std::sin(.3f * i) + .01f * j;
+                    hu[i][j] = std::cos(.2f * j) + .123f * i;
+                    hv[i][j] = -.7f * hu[i][j];
+                    b[i][j] = -depth - 10.f - .5f * i;
+                }
+            }
+
+            io::BoundarySize boundarySize = {{1, 1, 1, 1}};
+            size_t saturatedValues;
+            {
+                io::NetCdfWriter writer(baseName, b, boundarySize, NX, NY, 1.f, 1.f, 0.f, 0.f,
+                    1.f, 0, options);
+                writer.writeTimeStep(hu, hu, hv, 0.f);
+                writer.writeTimeStep(h, hu, hv, 1.f);
+                saturatedValues = writer.getSaturatedValues();
+            }
+
+            SWE_CheckpointTsunamiScenario scenario(baseName + ".nc");
+            for(int i = 1; i <= NX; i++) {
+                for(int j = 1; j <= NY; j++) {
+                    float x = i - .5f;
+                    float y = j - .5f;
+                    TS_ASSERT_EQUALS(scenario.getBathymetry(x, y), b[i][j]);
+                    TS_ASSERT_DELTA(scenario.getWaterHeight(x, y), h[i][j], heightTolerance);
+                    TS_ASSERT_DELTA(scenario.getVeloc_u(x, y) * scenario.getWaterHeight(x, y),
+                        hu[i][j], dischargeTolerance);
+                    TS_ASSERT_DELTA(scenario.getVeloc_v(x, y) * scenario.getWaterHeight(x, y),
+                        hv[i][j], dischargeTolerance);
+                }
+            }
+
+            return saturatedValues;
+        }
+
+    public:
+        void setUp() {
+            baseName = "NetCdfWriterTest";
+        }
+
+        void tearDown() {
+            remove((baseName + ".nc").c_str());
+        }
+
+        /**
+         * Compression and chunking do not change the values
+         */
+        void testCompression() {
+            io::NetCdfOptions options;
+            options.deflateLevel = 5;
+            options.shuffle = true;
+            options.chunkX = 5;
+            options.chunkY = 4;
+            checkOptions(options, 1e-5f, 1e-5f);
+        }
+
+        /**
+         * 16 bit fixed point output
+         */
+        void testFixedPoint() {
+            io::NetCdfOptions options;
+            options.precision = io::NetCdfOptions::FIXED_POINT;
+            options.heightResolution = .001f;
+            options.dischargeResolution = .0001f;
+            TS_ASSERT_EQUALS(checkOptions(options, .0006f, .00006f), 0u);
+        }
+
+        /**
+         * Fixed point output of deep water with separate resolutions of h and hu/hv
+         */
+        void testFixedPointDeepWater() {
+            io::NetCdfOptions options;
+            options.precision = io::NetCdfOptions::FIXED_POINT;
+            options.heightResolution = .25f;
+            options.dischargeResolution = .001f;
+            // h > 4000 is beyond the range of the default resolution (327.67)
+            TS_ASSERT_EQUALS(checkOptions(options, .13f, .0006f, 4000.f), 0u);
+        }
+
+        /**
+         * Water heights beyond the fixed point range are reported
+         */
+        void testFixedPointSaturation() {
+            io::NetCdfOptions options;
+            options.precision = io::NetCdfOptions::FIXED_POINT;
+            const size_t saturatedValues = checkOptions(options, 1e10f, .006f, 4000.f);
+            TS_ASSERT_EQUALS(saturatedValues, (size_t) (NX*NY));
+        }
+
+        /**
+         * Floating point output with rounded mantissa
+         */
+        void testRoundedFloat() {
+            io::NetCdfOptions options;
+            options.precision = io::NetCdfOptions::ROUNDED_FLOAT;
+            options.mantissaBits = 12;
+            options.deflateLevel = 1;
+            // relative error 2^-13, absolute values < 16
+            checkOptions(options, 16.f / 8192.f, 4.f / 8192.f);
+        }
+
+        /**
+         * Incremental output stores only the changed tiles between two keyframes
+         */
+        void testKeyframes() {
+            io::NetCdfOptions options;
+            options.keyframeInterval = 3;
+            options.keyframeTolerance = .01f;
+            options.chunkX = 4;
+            options.chunkY = 3;
+
+            Float2D h(NX+2, NY+2), b(NX+2, NY+2);
+            for(int i = 0; i < NX+2; i++) {
+                for(int j = 0; j < NY+2; j++) {
+                    h[i][j] = 10.f + i + .1f * j;
+                    b[i][j] = -10.f;
+                }
+            }
+
+            // expected values of all time steps (row by row)
+            std::vector<std::vector<float> > expected;
+
+            io::BoundarySize boundarySize = {{1, 1, 1, 1}};
+            {
+                io::NetCdfWriter writer(baseName, b, boundarySize, NX, NY, 1.f, 1.f, 0.f, 0.f,
+                    1.f, 0, options);
+                for(int t = 0; t < 5; t++) {
+                    // small changes everywhere, a large change in one tile
+                    const int tileX = (t == 4) ? 0 : 1;
+                    const int tileY = (t == 4) ? 0 : 1;
+                    std::vector<float> values(NX*NY);
+                    for(int i = 0; i < NX; i++) {
+                        for(int j = 0; j < NY; j++) {
+                            h[i+1][j+1] += .001f;
+                            if(t > 0 && i/4 == tileX && j/3 == tileY)
+                                h[i+1][j+1] += 1.f;
+                            values[j*NX + i] = h[i+1][j+1];
+                        }
+                    }
+
+                    // unchanged tiles keep the values of the keyframe
+                    const size_t keyframe = (t < 3) ? 0 : 3;
+                    for(int i = 0; i < NX; i++) {
+                        for(int j = 0; j < NY; j++) {
+                            if(keyframe < (size_t) t && std::abs(values[j*NX + i] - expected[keyframe][j*NX + i]) < .5f)
+                                values[j*NX + i] = expected[keyframe][j*NX + i];
+                        }
+                    }
+                    expected.push_back(values);
+
+                    writer.writeTimeStep(h, h, h, t);
+                }
+            }
+
+            int file;
+            TS_ASSERT_EQUALS(nc_open((baseName + ".nc").c_str(), NC_NOWRITE, &file), NC_NOERR);
+            int hVar;
+            TS_ASSERT_EQUALS(nc_inq_varid(file, "h", &hVar), NC_NOERR);
+
+            tools::NetCdfKeyframeReader reader(file);
+            TS_ASSERT(reader.isIncremental());
+
+            const size_t start[] = {0, 0};
+            const size_t count[] = {NY, NX};
+            std::vector<float> values(NX*NY);
+            for(size_t t = 0; t < expected.size(); t++) {
+                TS_ASSERT_EQUALS(reader.getKeyframe(t), (t < 3) ? 0u : 3u);
+                TS_ASSERT_EQUALS(reader.getSlab(hVar, t, start, count, &values[0]), NC_NOERR);
+                for(size_t i = 0; i < values.size(); i++)
+                    TS_ASSERT_EQUALS(values[i], expected[t][i]);
+            }
+
+            // the first tile of time step 1 is not stored
+            const size_t rawStart[] = {1, 0, 0};
+            const size_t rawCount[] = {1, 3, 4};
+            TS_ASSERT_EQUALS(nc_get_vara_float(file, hVar, rawStart, rawCount, &values[0]), NC_NOERR);
+            for(int i = 0; i < 12; i++)
+                TS_ASSERT_EQUALS(values[i], NC_FILL_FLOAT);
+            nc_close(file);
+
+            // restart from the last (incremental) time step
+            SWE_CheckpointTsunamiScenario scenario(baseName + ".nc");
+            for(int i = 0; i < NX; i++) {
+                for(int j = 0; j < NY; j++)
+                    TS_ASSERT_EQUALS(scenario.getWaterHeight(i + .5f, j + .5f), expected[4][j*NX + i]);
+            }
+        }
+
+        /**
+         * Per-process output files of a 2x2 layout of blocks (as written by swe_mpi
+         * without collective output) store the origin of their block.
+         * Resuming from them uses the block origin computed from the domain.
+         */
+        void testBlockCheckpointOrigins() {
+            const int blocksX = 2, blocksY = 2;
+            const float domainX = -3.f, domainY = 2.f;
+            const float dX = 2.f, dY = .5f;
+
+            for(int bx = 0; bx < blocksX; bx++) {
+                for(int by = 0; by < blocksY; by++) {
+                    // block layout of swe_mpi
+                    const int nXLocal = (bx < blocksX-1) ? NX/blocksX : NX - (blocksX-1)*(NX/blocksX);
+                    const int nYLocal = (by < blocksY-1) ? NY/blocksY : NY - (blocksY-1)*(NY/blocksY);
+                    const int offsetX = bx*(NX/blocksX);
+                    const int offsetY = by*(NY/blocksY);
+                    const float originX = domainX + offsetX*dX;
+                    const float originY = domainY + offsetY*dY;
+
+                    Float2D h(nXLocal+2, nYLocal+2), b(nXLocal+2, nYLocal+2);
+                    for(int i = 0; i < nXLocal+2; i++) {
+                        for(int j = 0; j < nYLocal+2; j++) {
+                            // unique values in the global grid
+                            h[i][j] = 10.f + (offsetX + i) + .01f * (offsetY + j);
+                            b[i][j] = -h[i][j];
+                        }
+                    }
+
+                    std::ostringstream fileName;
+                    fileName << baseName << '_' << bx << '_' << by;
+                    io::BoundarySize boundarySize = {{1, 1, 1, 1}};
+                    {
+                        io::NetCdfWriter writer(fileName.str(), b, boundarySize, nXLocal, nYLocal,
+                            dX, dY, originX, originY);
+                        writer.writeTimeStep(h, h, h, 0.f);
+                    }
+
+                    SWE_CheckpointTsunamiScenario scenario(fileName.str() + ".nc");
+                    int nX, nY;
+                    scenario.getNumberOfCells(nX, nY);
+                    TS_ASSERT_EQUALS(nX, nXLocal);
+                    TS_ASSERT_EQUALS(nY, nYLocal);
+
+                    // the checkpoint already contains the block offset
+                    TS_ASSERT_DELTA(scenario.getBoundaryPos(BND_LEFT), originX, 1e-5f);
+                    TS_ASSERT_DELTA(scenario.getBoundaryPos(BND_BOTTOM), originY, 1e-5f);
+
+                    for(int i = 0; i < nXLocal; i++) {
+                        for(int j = 0; j < nYLocal; j++)
+                            TS_ASSERT_EQUALS(scenario.getWaterHeight(originX + (i+.5f)*dX, originY + (j+.5f)*dY),
+                                h[i+1][j+1]);
+                    }
+
+                    remove((fileName.str() + ".nc").c_str());
+                }
+            }
+        }
+};
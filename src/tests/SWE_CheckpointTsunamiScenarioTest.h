@@ -1,5 +1,6 @@
 
 #include <cxxtest/TestSuite.h>
+#include <vector>
 
 #define private public
 #define protected public
@@ -18,6 +19,37 @@ class SWE_CheckpointTsunamiScenarioTest : public CxxTest::TestSuite {
         //! numerical tolerance for assertions
         static const double TOLERANCE = 1e-5;
         
+        /// Compare the block functions with the functions for single cells
+        /**
+         * @param originX Lower left corner of the block
+         * @param originY Lower left corner of the block
+         * @param nx Number of columns of the block
+         * @param ny Number of rows of the block
+         * @param dx Cell size of the block
+         */
+        void checkBlock(float originX, float originY, int nx, int ny, float dx) {
+            std::vector<float> x(nx), y(ny);
+            for(int i = 0; i < nx; i++)
+                x[i] = originX + (i+.5f) * dx;
+            for(int j = 0; j < ny; j++)
+                y[j] = originY + (j+.5f) * dx;
+
+            // use a stride larger than the number of rows
+            const int stride = ny + 5;
+            std::vector<float> b(nx*stride), h(nx*stride), u(nx*stride), v(nx*stride);
+            scenario->getBathymetryBlock(&x[0], nx, &y[0], ny, stride, &b[0]);
+            scenario->getInitialValuesBlock(&x[0], nx, &y[0], ny, stride, &h[0], &u[0], &v[0]);
+
+            for(int i = 0; i < nx; i++) {
+                for(int j = 0; j < ny; j++) {
+                    TS_ASSERT_EQUALS(b[i*stride + j], scenario->getBathymetry(x[i], y[j]));
+                    TS_ASSERT_EQUALS(h[i*stride + j], scenario->getWaterHeight(x[i], y[j]));
+                    TS_ASSERT_EQUALS(u[i*stride + j], scenario->getVeloc_u(x[i], y[j]));
+                    TS_ASSERT_EQUALS(v[i*stride + j], scenario->getVeloc_v(x[i], y[j]));
+                }
+            }
+        }
+        
     public:
 
         /// Set Up called before each test case (create scenario)
@@ -154,6 +186,16 @@ class SWE_CheckpointTsunamiScenarioTest : public CxxTest::TestSuite {
             TSM_ASSERT_DELTA("Inside", scenario->getVeloc_u(143.5, 79.5), -0.16962381738999849827, TOLERANCE);
         }
         
+        /// Test reading the unknowns of a block inside the domain (including ghost cells)
+        void testBlock() {
+            checkBlock(100.f - 5.f, 50.f - 5.f, 32, 22, 5.f);
+        }
+        
+        /// Test reading the unknowns of a block larger than the domain with a different cell size
+        void testOutsideBlock() {
+            checkBlock(-20.f, -10.f, 70, 30, 7.f);
+        }
+        
         /// Test reading of vertical velocity from the checkpoint file
         void testGetVeloc_v() {
             TSM_ASSERT_DELTA("X (below)", scenario->getVeloc_v(-10.0, 102.5), -0.23309630086701798561, TOLERANCE);
@@ -4,6 +4,7 @@
 #define private public
 #define protected private
 #include "blocks/opencl/OpenCLWrapper.hh"
+#include "blocks/opencl/SWE_DimensionalSplittingOpenCL.hh"
 #include "kernels/kernels.h"
 
 /**
@@ -812,32 +813,41 @@ class SWE_DimensionalSplittingOpenCLKernelsTest : public CxxTest::TestSuite {
             unsigned int x = 5;
             unsigned int y = 4;
             unsigned int size = x*y;
-            float values[] = {
+            float hValues[] = {
                 17, 10, 9, 16, 12,
                 2, 6, 7, 13, 15,
                 5, 3, 20, 4, 14,
                 18, 11, 19, 1, 8
             };
+            float huValues[] = {
+                -17, 10, 9, 16, 12,
+                -2, 6, 7, 13, 15,
+                -5, 3, 20, 4, 14,
+                -18, 11, 19, 1, 8
+            };
             
-            float expectedEdge[] = {17, 2, 5, 18};
-            float edge[y];
+            // the column of h followed by the column of hu
+            float expectedEdge[] = {17, 2, 5, 18, -17, -2, -5, -18};
+            float edge[2*y];
             
-            cl::Buffer valuesBuf(wrapper->context, (CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR), size*sizeof(cl_float), values);
-            cl::Buffer edgeBuf(wrapper->context, CL_MEM_READ_WRITE, y*sizeof(cl_float));
+            cl::Buffer hValuesBuf(wrapper->context, (CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR), size*sizeof(cl_float), hValues);
+            cl::Buffer huValuesBuf(wrapper->context, (CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR), size*sizeof(cl_float), huValues);
+            cl::Buffer edgeBuf(wrapper->context, CL_MEM_READ_WRITE, 2*y*sizeof(cl_float));
             
             cl::Kernel *k = &(wrapper->kernels["writeNetUpdatesEdgeCopy"]);
-            k->setArg(0, valuesBuf);
-            k->setArg(1, edgeBuf);
-            k->setArg(2, x);
+            k->setArg(0, hValuesBuf);
+            k->setArg(1, huValuesBuf);
+            k->setArg(2, edgeBuf);
+            k->setArg(3, x);
             
             try {
                 wrapper->queues[0].enqueueNDRangeKernel(*k, cl::NullRange, cl::NDRange(y), cl::NullRange);
-                wrapper->queues[0].enqueueReadBuffer(edgeBuf, CL_TRUE, 0, y*sizeof(cl_float), edge);
+                wrapper->queues[0].enqueueReadBuffer(edgeBuf, CL_TRUE, 0, 2*y*sizeof(cl_float), edge);
             } catch(cl::Error &e) {
                 wrapper->handleError(e);
             }
         
-            for(unsigned int i = 0; i < y; i++) {
+            for(unsigned int i = 0; i < 2*y; i++) {
                 TS_ASSERT_EQUALS(edge[i], expectedEdge[i]);
             }
         }
@@ -846,39 +856,95 @@ class SWE_DimensionalSplittingOpenCLKernelsTest : public CxxTest::TestSuite {
             unsigned int x = 6;
             unsigned int y = 4;
             unsigned int size = x*y;
-            float values[] = {
+            float hValues[] = {
                 17, 12, 10, 9, 16, -1,
                 2, 6, 21, 7, 13, -2,
                 5, 3, 20, 26, 4, -3,
                 18, 11, 19, 7, 1, -4
             };
+            float huValues[] = {
+                1, 2, 3, 4, 5, 6,
+                7, 8, 9, 10, 11, 12,
+                13, 14, 15, 16, 17, 18,
+                19, 20, 21, 22, 23, 24
+            };
             
-            float expectedValues[] = {
+            float expectedHValues[] = {
                 17, 12, 10, 9, 16, 17,
                 2, 6, 21, 7, 13, 2,
                 5, 3, 20, 26, 4, 5,
                 18, 11, 19, 7, 1, 18
             };
+            float expectedHuValues[] = {
+                1, 2, 3, 4, 5, -6,
+                7, 8, 9, 10, 11, -12,
+                13, 14, 15, 16, 17, -18,
+                19, 20, 21, 22, 23, -24
+            };
             
-            float edge[] = {17, 2, 5, 18};
+            // the column of h followed by the column of hu
+            float edge[] = {17, 2, 5, 18, -6, -12, -18, -24};
             
-            cl::Buffer valuesBuf(wrapper->context, (CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR), size*sizeof(cl_float), values);
-            cl::Buffer edgeBuf(wrapper->context, (CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR), y*sizeof(cl_float), edge);
+            cl::Buffer hValuesBuf(wrapper->context, (CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR), size*sizeof(cl_float), hValues);
+            cl::Buffer huValuesBuf(wrapper->context, (CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR), size*sizeof(cl_float), huValues);
+            cl::Buffer edgeBuf(wrapper->context, (CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR), 2*y*sizeof(cl_float), edge);
             
             cl::Kernel *k = &(wrapper->kernels["readNetUpdatesEdgeCopy"]);
-            k->setArg(0, valuesBuf);
-            k->setArg(1, edgeBuf);
-            k->setArg(2, x);
+            k->setArg(0, hValuesBuf);
+            k->setArg(1, huValuesBuf);
+            k->setArg(2, edgeBuf);
+            k->setArg(3, x);
             
             try {
                 wrapper->queues[0].enqueueNDRangeKernel(*k, cl::NullRange, cl::NDRange(y), cl::NullRange);
-                wrapper->queues[0].enqueueReadBuffer(valuesBuf, CL_TRUE, 0, size*sizeof(cl_float), values);
+                wrapper->queues[0].enqueueReadBuffer(hValuesBuf, CL_TRUE, 0, size*sizeof(cl_float), hValues);
+                wrapper->queues[0].enqueueReadBuffer(huValuesBuf, CL_TRUE, 0, size*sizeof(cl_float), huValues);
             } catch(cl::Error &e) {
                 wrapper->handleError(e);
             }
         
             for(unsigned int i = 0; i < size; i++) {
-                TS_ASSERT_EQUALS(values[i], expectedValues[i]);
+                TS_ASSERT_EQUALS(hValues[i], expectedHValues[i]);
+                TS_ASSERT_EQUALS(huValues[i], expectedHuValues[i]);
             }
         }
+        
+        /// Test Kernel computing the time step from the maximum wave speeds of all devices
+        void testComputeTimestep() {
+            unsigned int count = 3;
+            float maxWaveSpeeds[] = {2.f, 8.f, 4.f};
+            
+            // dt, dt_dx, dt_dy, time, end time
+            float timestep[TIMESTEP_SIZE] = {0.f, 0.f, 0.f, 0.85f, 1.f};
+            cl_uint steps = 0;
+            
+            cl::Buffer maxWaveSpeedsBuf(wrapper->context, (CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR), count*sizeof(cl_float), maxWaveSpeeds);
+            cl::Buffer timestepBuf(wrapper->context, (CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR), TIMESTEP_SIZE*sizeof(cl_float), timestep);
+            cl::Buffer stepsBuf(wrapper->context, (CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR), sizeof(cl_uint), &steps);
+            
+            cl::Kernel *k = &(wrapper->kernels["computeTimestep"]);
+            k->setArg(0, maxWaveSpeedsBuf);
+            k->setArg(1, count);
+            k->setArg(2, 2.f);
+            k->setArg(3, 4.f);
+            k->setArg(4, timestepBuf);
+            k->setArg(5, stepsBuf);
+            
+            try {
+                // the second time step ends after the end time, the third one is empty
+                for(unsigned int i = 0; i < 3; i++)
+                    wrapper->queues[0].enqueueNDRangeKernel(*k, cl::NullRange, cl::NDRange(1), cl::NullRange);
+                wrapper->queues[0].enqueueReadBuffer(timestepBuf, CL_TRUE, 0, TIMESTEP_SIZE*sizeof(cl_float), timestep);
+                wrapper->queues[0].enqueueReadBuffer(stepsBuf, CL_TRUE, 0, sizeof(cl_uint), &steps);
+            } catch(cl::Error &e) {
+                wrapper->handleError(e);
+            }
+            
+            TS_ASSERT_DELTA(timestep[TIMESTEP_DT], 0.1f, 1e-6);
+            TS_ASSERT_EQUALS(timestep[TIMESTEP_DT_DX], 0.f);
+            TS_ASSERT_EQUALS(timestep[TIMESTEP_DT_DY], 0.f);
+            TS_ASSERT_DELTA(timestep[TIMESTEP_TIME], 1.05f, 1e-6);
+            TS_ASSERT_EQUALS(timestep[TIMESTEP_END], 1.f);
+            TS_ASSERT_EQUALS(steps, 2u);
+        }
 };
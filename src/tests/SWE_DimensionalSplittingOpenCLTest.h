@@ -1,10 +1,13 @@
 
 #include <cxxtest/TestSuite.h>
+#include <cstdio>
+#include <dirent.h>
 
 #define private public
 #define protected public
 
 #include "blocks/opencl/SWE_DimensionalSplittingOpenCL.hh"
+#include "blocks/opencl/OpenCLTuningCache.hh"
 
 #include "DamBreak1DTestScenario.hh"
 
@@ -128,6 +131,72 @@ private:
            }
        }
    }
+   
+   /**
+    * Apply a function to all files in a directory
+    * @param directory The directory
+    * @param function Called with the path of each file
+    */
+   void forEachFile(const std::string &directory, void (*function)(const std::string&)) {
+       DIR* dir = opendir(directory.c_str());
+       if(dir == NULL)
+           return;
+       struct dirent* entry;
+       while((entry = readdir(dir)) != NULL) {
+           std::string name(entry->d_name);
+           if(name != "." && name != "..")
+               function(directory + "/" + name);
+       }
+       closedir(dir);
+   }
+   
+   /// Remove a file
+   static void removeFile(const std::string &fileName) {
+       remove(fileName.c_str());
+   }
+   
+   /// Change the source hash of a cached program binary
+   static void changeSourceHash(const std::string &fileName) {
+       FILE* file = fopen(fileName.c_str(), "r+b");
+       if(file == NULL)
+           return;
+       fseek(file, 8, SEEK_SET);
+       int c = fgetc(file);
+       fseek(file, 8, SEEK_SET);
+       fputc(c ^ 1, file);
+       fclose(file);
+   }
+   
+   /**
+    * Compare the maximum reduction in the sweep kernels with the separate reduce kernels
+    * @param kernelType The kernel type, e.g. whether to use local or global memory
+    */
+   void compareFusedReduction(KernelType kernelType) {
+       // the fused reduction also works with work group sizes that are not a power of two
+       SWE_DimensionalSplittingOpenCL separate(SIZE, SIZE, 1.f, 1.f, 0, 0, kernelType, 1024, false, false);
+       SWE_DimensionalSplittingOpenCL fused(SIZE, SIZE, 1.f, 1.f, 0, 0, kernelType, 20, false, true);
+       
+       DamBreak1DTestScenario scenario(DamBreak1DTestScenario::DIR_X);
+       separate.initScenario(0.f, 0.f, scenario);
+       fused.initScenario(0.f, 0.f, scenario);
+       
+       for(unsigned int step = 0; step < TIMESTEPS; step++) {
+           separate.setGhostLayer();
+           separate.computeNumericalFluxes();
+           fused.setGhostLayer();
+           fused.computeNumericalFluxes();
+           
+           // the maximum does not depend on the order of the reduction
+           TS_ASSERT_EQUALS(fused.getMaxTimestep(), separate.getMaxTimestep());
+       }
+       
+       const Float2D &hSeparate = separate.getWaterHeight();
+       const Float2D &hFused = fused.getWaterHeight();
+       for(int i = 1; i <= SIZE; i++) {
+           for(int j = 1; j <= SIZE; j++)
+               TS_ASSERT_EQUALS(hFused[i][j], hSeparate[i][j]);
+       }
+   }
 public:
     
     /// Test maximum reduction of an array (may yield different results on GPU and CPU hardware!)
@@ -195,6 +264,42 @@ public:
         TS_ASSERT_EQUALS(block->bufferChunks[2].second, 32);
     }
     
+    /// Test splitting of computational domain weighted by the device throughput
+    void testCalculateBufferChunksWeighted() {
+        block = new SWE_DimensionalSplittingOpenCL(100, 100, 1.0, 1.0);
+        block->bufferChunks.clear();
+        
+        // Device 1 is three times faster than device 0
+        std::vector<float> weights;
+        weights.push_back(1.f);
+        weights.push_back(3.f);
+        block->calculateBufferChunks(100, 2, weights);
+        TS_ASSERT_EQUALS(block->chunkSize, 74);
+        TS_ASSERT_EQUALS(block->bufferChunks.size(), 2);
+        TS_ASSERT_EQUALS(block->bufferChunks[0].first, 0);
+        TS_ASSERT_EQUALS(block->bufferChunks[0].second, 26);
+        TS_ASSERT_EQUALS(block->bufferChunks[1].first, 25);
+        TS_ASSERT_EQUALS(block->bufferChunks[1].second, 75);
+        
+        delete block;
+        
+        block = new SWE_DimensionalSplittingOpenCL(100, 100, 1.0, 1.0);
+        block->bufferChunks.clear();
+        
+        // Every device gets at least MIN_CHUNK_EDGES edges
+        weights.clear();
+        weights.push_back(1.f);
+        weights.push_back(1000.f);
+        weights.push_back(1.f);
+        block->calculateBufferChunks(100, 3, weights);
+        TS_ASSERT_EQUALS(block->bufferChunks.size(), 3);
+        TS_ASSERT_EQUALS(block->bufferChunks[0].first, 0);
+        TS_ASSERT_EQUALS(block->bufferChunks[0].second, SWE_DimensionalSplittingOpenCL::MIN_CHUNK_EDGES+1);
+        TS_ASSERT_EQUALS(block->bufferChunks[1].first, (size_t)SWE_DimensionalSplittingOpenCL::MIN_CHUNK_EDGES);
+        TS_ASSERT_EQUALS(block->bufferChunks[2].first, 99-SWE_DimensionalSplittingOpenCL::MIN_CHUNK_EDGES);
+        TS_ASSERT_EQUALS(block->bufferChunks[2].second, SWE_DimensionalSplittingOpenCL::MIN_CHUNK_EDGES+1);
+    }
+        
     /// Simulate the 1D DamBreak in Y direction with global memory
     void testDamBreakYGlobal() {
         testDamBreak(DamBreak1DTestScenario::DIR_Y, MEM_GLOBAL);
@@ -212,4 +317,143 @@ public:
     void testDamBreakXLocal() {
         testDamBreak(DamBreak1DTestScenario::DIR_X, MEM_LOCAL);
     }
+    
+    /// Compare the fused maximum reduction with the separate reduce kernels (global memory)
+    void testFusedReductionGlobal() {
+        compareFusedReduction(MEM_GLOBAL);
+    }
+    /// Compare the fused maximum reduction with the separate reduce kernels (local memory)
+    void testFusedReductionLocal() {
+        compareFusedReduction(MEM_LOCAL);
+    }
+    
+    /// Compare the time step computed on the device with the time step computed on the host
+    void testDeviceTimestep() {
+        SWE_DimensionalSplittingOpenCL hostTimestep(SIZE, SIZE, 1.f, 1.f, 0, 0, MEM_GLOBAL, 1024, false);
+        SWE_DimensionalSplittingOpenCL deviceTimestep(SIZE, SIZE, 1.f, 1.f, 0, 0, MEM_GLOBAL, 1024, true);
+        
+        DamBreak1DTestScenario scenario(DamBreak1DTestScenario::DIR_X);
+        hostTimestep.initScenario(0.f, 0.f, scenario);
+        deviceTimestep.initScenario(0.f, 0.f, scenario);
+        
+        // two checkpoints: the first one estimates the batch size from a single time step
+        float tEnd = DamBreak1DTestScenario::checkTimecodes[TIMESTEPS-1];
+        float tHost = 0.f, tDevice = 0.f;
+        for(unsigned int checkpoint = 1; checkpoint <= 2; checkpoint++) {
+            tHost = hostTimestep.simulate(tHost, checkpoint * tEnd / 2);
+            tDevice = deviceTimestep.simulate(tDevice, checkpoint * tEnd / 2);
+            
+            TS_ASSERT_EQUALS(deviceTimestep.getSimulatedTimesteps(), hostTimestep.getSimulatedTimesteps());
+            TS_ASSERT_DELTA(tDevice, tHost, TOLERANCE);
+            TS_ASSERT_DELTA(deviceTimestep.getMaxTimestep(), hostTimestep.getMaxTimestep(), TOLERANCE);
+        }
+        
+        const Float2D &hHost = hostTimestep.getWaterHeight();
+        const Float2D &hDevice = deviceTimestep.getWaterHeight();
+        for(int i = 1; i <= SIZE; i++) {
+            for(int j = 1; j <= SIZE; j++)
+                TS_ASSERT_DELTA(hDevice[i][j], hHost[i][j], TOLERANCE);
+        }
+    }
+    
+    /// Test storing and reading kernel configurations in the tuning cache
+    void testTuningCache() {
+        const char* fileName = "OpenCLTuningCacheTest.txt";
+        remove(fileName);
+        
+        KernelConfig config = {MEM_LOCAL, 64};
+        {
+            OpenCLTuningCache cache(fileName);
+            TS_ASSERT(!cache.find("Device (1.0)", SIZE, SIZE, config));
+            cache.store("Device (1.0)", SIZE, SIZE, config, 1000.);
+            // the later entry replaces the first one
+            config.workGroupSize = 128;
+            cache.store("Device (1.0)", SIZE, SIZE, config, 900.);
+            config.kernelType = MEM_GLOBAL;
+            cache.store("Device\t(2.0)", SIZE, SIZE, config, 800.);
+        }
+        
+        OpenCLTuningCache cache(fileName);
+        KernelConfig found;
+        TS_ASSERT(cache.find("Device (1.0)", SIZE, SIZE, found));
+        TS_ASSERT_EQUALS(found.kernelType, MEM_LOCAL);
+        TS_ASSERT_EQUALS(found.workGroupSize, 128u);
+        TS_ASSERT(cache.find("Device\t(2.0)", SIZE, SIZE, found));
+        TS_ASSERT_EQUALS(found.kernelType, MEM_GLOBAL);
+        // other devices and grid sizes
+        TS_ASSERT(!cache.find("Device (1.1)", SIZE, SIZE, found));
+        TS_ASSERT(!cache.find("Device (1.0)", SIZE, SIZE+1, found));
+        
+        remove(fileName);
+    }
+    
+    /// Test creating the program from cached binaries
+    void testProgramCache() {
+        const std::string directory = "OpenCLProgramCacheTest";
+        forEachFile(directory, removeFile);
+        
+        SWE_DimensionalSplittingOpenCL source(SIZE, SIZE, 1.f, 1.f, 0, 0, MEM_GLOBAL, 1024, false, true, directory);
+        TS_ASSERT(!source.programFromCache);
+        
+        SWE_DimensionalSplittingOpenCL cached(SIZE, SIZE, 1.f, 1.f, 0, 0, MEM_GLOBAL, 1024, false, true, directory);
+        TS_ASSERT(cached.programFromCache);
+        
+        // the binaries of other build options are cached separately
+        SWE_DimensionalSplittingOpenCL local(SIZE, SIZE, 1.f, 1.f, 0, 0, MEM_LOCAL, 1024, false, true, directory);
+        TS_ASSERT(!local.programFromCache);
+        
+        // binaries of other sources are rebuilt
+        forEachFile(directory, changeSourceHash);
+        SWE_DimensionalSplittingOpenCL changed(SIZE, SIZE, 1.f, 1.f, 0, 0, MEM_GLOBAL, 1024, false, true, directory);
+        TS_ASSERT(!changed.programFromCache);
+        
+        // the cached program computes the same results
+        DamBreak1DTestScenario scenario(DamBreak1DTestScenario::DIR_X);
+        source.initScenario(0.f, 0.f, scenario);
+        cached.initScenario(0.f, 0.f, scenario);
+        for(unsigned int step = 0; step < 5; step++) {
+            source.setGhostLayer();
+            source.computeNumericalFluxes();
+            cached.setGhostLayer();
+            cached.computeNumericalFluxes();
+        }
+        const Float2D &hSource = source.getWaterHeight();
+        const Float2D &hCached = cached.getWaterHeight();
+        for(int i = 1; i <= SIZE; i++) {
+            for(int j = 1; j <= SIZE; j++)
+                TS_ASSERT_EQUALS(hCached[i][j], hSource[i][j]);
+        }
+        
+        forEachFile(directory, removeFile);
+        rmdir(directory.c_str());
+    }
+    
+    /// Test the auto-tuning of the kernel configuration
+    void testTune() {
+        const char* fileName = "OpenCLTuningCacheTest.txt";
+        remove(fileName);
+        
+        DamBreak1DTestScenario scenario(DamBreak1DTestScenario::DIR_X);
+        OpenCLTuningCache cache(fileName);
+        KernelConfig config = SWE_DimensionalSplittingOpenCL::tune(cache, SIZE, SIZE, 1.f, 1.f, scenario, 0.f, 0.f);
+        TS_ASSERT(config.workGroupSize >= SWE_DimensionalSplittingOpenCL::MIN_TUNING_GROUP_SIZE);
+        TS_ASSERT(config.workGroupSize <= SWE_DimensionalSplittingOpenCL::MAX_TUNING_GROUP_SIZE);
+        TS_ASSERT_EQUALS(config.workGroupSize & (config.workGroupSize-1), 0u);
+        
+        // the fastest configuration is stored in the cache file
+        OpenCLWrapper wrapper;
+        OpenCLTuningCache reloaded(fileName);
+        KernelConfig cached;
+        TS_ASSERT(reloaded.find(wrapper.getDeviceDescription(), SIZE, SIZE, cached));
+        TS_ASSERT_EQUALS(cached.kernelType, config.kernelType);
+        TS_ASSERT_EQUALS(cached.workGroupSize, config.workGroupSize);
+        
+        // time step on the devices and separate reduce kernels (a separate cache entry)
+        config = SWE_DimensionalSplittingOpenCL::tune(cache, SIZE, SIZE, 1.f, 1.f, scenario, 0.f, 0.f,
+            0, 0, true, false);
+        TS_ASSERT(config.workGroupSize >= SWE_DimensionalSplittingOpenCL::MIN_TUNING_GROUP_SIZE);
+        TS_ASSERT(config.workGroupSize <= SWE_DimensionalSplittingOpenCL::MAX_TUNING_GROUP_SIZE);
+        
+        remove(fileName);
+    }
 };
@@ -6,6 +6,7 @@
 #define protected public
 
 #include "DamBreak1DTestScenario.hh"
+#include "scenarios/SWE_simple_scenarios.hh"
 
 /**
  * Unit test to check SWE_DimensionalSplitting against a 1D solution by simulating a 1D
@@ -28,10 +29,17 @@ class SWE_DimensionalSplittingTest : public CxxTest::TestSuite {
          * Simulate a one dimensional DamBreak in two dimensions
          * and check the results
          * @param dir The direction of the dambreak (1 for X, 0 for Y)
+         * @param batchSolver Use the batch solver instead of the scalar solver
+         * @param crossSize The mesh size perpendicular to the direction of the dambreak
+         * @param fusedTileWidth Tile width of the fused sweep, 0 for the separate sweeps
          */
-        void testDamBreak(unsigned int dir) {
+        void testDamBreak(unsigned int dir, bool batchSolver = false, float crossSize = 1.f, int fusedTileWidth = 0) {
             // Init dimsplitting
-            SWE_DimensionalSplitting dimensionalSplitting(SIZE, SIZE, 1.f, 1.f);
+            float dx = (dir == DamBreak1DTestScenario::DIR_X) ? 1.f : crossSize;
+            float dy = (dir == DamBreak1DTestScenario::DIR_Y) ? 1.f : crossSize;
+            SWE_DimensionalSplitting dimensionalSplitting(SIZE, SIZE, dx, dy);
+            dimensionalSplitting.setBatchSolver(batchSolver);
+            dimensionalSplitting.setFusedTileWidth(fusedTileWidth);
             
             // Init testing scenario
             DamBreak1DTestScenario scenario(dir);
@@ -130,4 +138,120 @@ class SWE_DimensionalSplittingTest : public CxxTest::TestSuite {
         void testDamBreakX() {
             testDamBreak(DamBreak1DTestScenario::DIR_X);
         }
+        /// Simulate the 1D DamBreak in Y direction using the batch solver
+        void testDamBreakYBatch() {
+            testDamBreak(DamBreak1DTestScenario::DIR_Y, true);
+        }
+        /// Simulate the 1D DamBreak in X direction using the batch solver
+        void testDamBreakXBatch() {
+            testDamBreak(DamBreak1DTestScenario::DIR_X, true);
+        }
+        /// Simulate the 1D DamBreak in Y direction on cells which are much wider than high
+        /**
+         * The waves only travel in y-direction, so the timestep must be limited by dy.
+         */
+        void testDamBreakYAnisotropic() {
+            testDamBreak(DamBreak1DTestScenario::DIR_Y, false, 10.f);
+        }
+        /// Simulate the 1D DamBreak in Y direction on cells which are much wider than high using the fused sweep
+        void testDamBreakYAnisotropicFused() {
+            testDamBreak(DamBreak1DTestScenario::DIR_Y, false, 10.f, 7);
+        }
+        
+        /// Check that the fused sweep produces the same results as the separate sweeps
+        void testFusedSweep() {
+            // tile width which does not divide the number of columns
+            checkSweepVariant(false, 7, 0);
+            checkSweepVariant(true, 7, 0);
+        }
+        
+        /// Check the fused sweep if it falls back to the separate Y-Sweep
+        /**
+         * With the largest CFL number, the bound of the Y wave speeds exceeds
+         * the CFL condition and the separate Y-Sweep is repeated with a smaller timestep.
+         * Every fourth timestep uses the largest CFL number, so the fallback
+         * also follows fused timesteps (which do not track the active tiles).
+         */
+        void testFusedSweepFallback() {
+            TS_ASSERT_EQUALS(checkSweepVariant(false, 7, 0, 0, .5f), TIMESTEPS);
+            TS_ASSERT_EQUALS(checkSweepVariant(true, 7, 0, 0, .5f), TIMESTEPS);
+            TS_ASSERT_EQUALS(checkSweepVariant(false, 7, 0, 2, .4f, 4), TIMESTEPS/4);
+            TS_ASSERT_EQUALS(checkSweepVariant(true, 7, 0, 2, .4f, 4), TIMESTEPS/4);
+        }
+        
+        /// Check that the row-blocked X-Sweep produces the same results as the separate sweeps
+        void testSweepBlockRows() {
+            // strip height which does not divide the number of rows
+            checkSweepVariant(false, 0, 5);
+            checkSweepVariant(true, 0, 5);
+        }
+        
+        /// Check that skipping inactive tiles produces the same results as computing all cells
+        void testActiveTiles() {
+            // tile size which does not divide the number of cells
+            checkSweepVariant(false, 0, 0, 8);
+            checkSweepVariant(true, 0, 0, 8);
+        }
+        
+        /// Compare the separate sweeps with a different sweep variant
+        /**
+         * @param batchSolver Use the batch solver in both blocks
+         * @param fusedTileWidth Tile width of the fused sweep of the variant
+         * @param sweepBlockRows Rows per strip of the X-Sweep of the variant
+         * @param activeTileSize Size of the active tiles of the variant
+         * @param cflNumber CFL number of both blocks
+         * @param largestCflInterval Every largestCflInterval-th timestep uses the
+         *  largest CFL number (.5) instead of cflNumber (0 = never)
+         * @return Number of timesteps in which the fused sweep fell back to the separate Y-Sweep
+         */
+        unsigned int checkSweepVariant(bool batchSolver, int fusedTileWidth, int sweepBlockRows, int activeTileSize = 0,
+                float cflNumber = .4f, unsigned int largestCflInterval = 0) {
+            SWE_DimensionalSplitting separate(SIZE, SIZE, 20.f, 20.f);
+            SWE_DimensionalSplitting variant(SIZE, SIZE, 20.f, 20.f);
+            separate.setBatchSolver(batchSolver);
+            variant.setBatchSolver(batchSolver);
+            variant.setFusedTileWidth(fusedTileWidth);
+            variant.setSweepBlockRows(sweepBlockRows);
+            variant.setActiveTileSize(activeTileSize);
+            
+            SWE_RadialDamBreakScenario scenario;
+            separate.initScenario(0.f, 0.f, scenario);
+            variant.initScenario(0.f, 0.f, scenario);
+            
+            unsigned int fallbackSteps = 0;
+            for(unsigned int step = 0; step < TIMESTEPS; step++) {
+                bool largestCfl = largestCflInterval > 0 && step % largestCflInterval == largestCflInterval-1;
+                separate.setCflNumber(largestCfl ? .5f : cflNumber);
+                variant.setCflNumber(largestCfl ? .5f : cflNumber);
+                
+                separate.setGhostLayer();
+                variant.setGhostLayer();
+                
+                separate.computeNumericalFluxes();
+                variant.computeNumericalFluxes();
+                TS_ASSERT_EQUALS(separate.getMaxTimestep(), variant.getMaxTimestep());
+                if(fusedTileWidth > 0 && !variant.isFusedStep())
+                    fallbackSteps++;
+                
+                separate.updateUnknowns(separate.getMaxTimestep());
+                variant.updateUnknowns(variant.getMaxTimestep());
+                
+                if(activeTileSize > 0 && fusedTileWidth == 0 && step == 0) {
+                    // the waves have not reached the outer tiles yet
+                    int tilesPerDirection = (SIZE + activeTileSize - 1) / activeTileSize;
+                    TS_ASSERT_LESS_THAN(variant.getNumberOfActiveTiles(),
+                        tilesPerDirection * tilesPerDirection);
+                }
+                
+                for(int i = 1; i <= SIZE; i++) {
+                    for(int j = 1; j <= SIZE; j++) {
+                        TS_ASSERT_EQUALS(separate.getWaterHeight()[i][j], variant.getWaterHeight()[i][j]);
+                        TS_ASSERT_EQUALS(separate.getDischarge_hu()[i][j], variant.getDischarge_hu()[i][j]);
+                        TS_ASSERT_EQUALS(separate.getDischarge_hv()[i][j], variant.getDischarge_hv()[i][j]);
+                    }
+                }
+            }
+            
+            return fallbackSteps;
+        }
 };
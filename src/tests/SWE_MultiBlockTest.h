@@ -0,0 +1,95 @@
+#include <cxxtest/TestSuite.h>
+#include "blocks/SWE_MultiBlock.hh"
+#include "scenarios/SWE_simple_scenarios.hh"
+
+/**
+ * Unit test to check SWE_MultiBlock against a single SWE_WavePropagationBlock
+ */
+class SWE_MultiBlockTest : public CxxTest::TestSuite {
+    private:
+        /** Number of cells in x-direction */
+        const static int SIZE_X = 50;
+        /** Number of cells in y-direction */
+        const static int SIZE_Y = 40;
+
+        /** Number of timesteps to compute */
+        const static unsigned int TIMESTEPS = 30;
+
+        /**
+         * Simulate the radial dam break on a single block and on multiple blocks
+         * and compare the results
+         * @param blocksX Number of blocks in x-direction
+         * @param blocksY Number of blocks in y-direction
+         * @param activeTileSize Size of the active tiles in each block (0 = disabled)
+         */
+        void checkMultiBlock(int blocksX, int blocksY, int activeTileSize = 0) {
+            SWE_RadialDamBreakScenario scenario;
+            float originX = scenario.getBoundaryPos(BND_LEFT);
+            float originY = scenario.getBoundaryPos(BND_BOTTOM);
+            float dx = (scenario.getBoundaryPos(BND_RIGHT) - originX) / SIZE_X;
+            float dy = (scenario.getBoundaryPos(BND_TOP) - originY) / SIZE_Y;
+
+            SWE_WavePropagationBlock single(SIZE_X, SIZE_Y, dx, dy);
+            single.initScenario(originX, originY, scenario);
+
+            SWE_MultiBlock multi(SIZE_X, SIZE_Y, dx, dy, blocksX, blocksY);
+            multi.initScenario(originX, originY, scenario);
+            for(int bx = 0; bx < blocksX; bx++)
+                for(int by = 0; by < blocksY; by++)
+                    multi.getBlock(bx, by).setActiveTileSize(activeTileSize);
+
+            for(unsigned int step = 0; step < TIMESTEPS; step++) {
+                single.setGhostLayer();
+                single.computeNumericalFluxes();
+                multi.computeNumericalFluxes();
+
+                // The global minimum has to be the timestep of the whole domain
+                TS_ASSERT_EQUALS(single.getMaxTimestep(), multi.getMaxTimestep());
+
+                single.updateUnknowns(single.getMaxTimestep());
+                multi.updateUnknowns(single.getMaxTimestep());
+            }
+
+            for(int bx = 0; bx < blocksX; bx++) {
+                for(int by = 0; by < blocksY; by++) {
+                    SWE_WavePropagationBlock &block = multi.getBlock(bx, by);
+                    int offsetX = multi.getBlockOffsetX(bx);
+                    int offsetY = multi.getBlockOffsetY(by);
+
+                    for(int i = 1; i <= block.getNx(); i++) {
+                        for(int j = 1; j <= block.getNy(); j++) {
+                            TS_ASSERT_EQUALS(block.getWaterHeight()[i][j],
+                                single.getWaterHeight()[offsetX+i][offsetY+j]);
+                            TS_ASSERT_EQUALS(block.getDischarge_hu()[i][j],
+                                single.getDischarge_hu()[offsetX+i][offsetY+j]);
+                            TS_ASSERT_EQUALS(block.getDischarge_hv()[i][j],
+                                single.getDischarge_hv()[offsetX+i][offsetY+j]);
+                        }
+                    }
+                }
+            }
+        }
+
+    public:
+        /**
+         * A single block has to give the same results as SWE_WavePropagationBlock
+         */
+        void testSingleBlock() {
+            checkMultiBlock(1, 1);
+        }
+
+        /**
+         * Blocks of different sizes (the last block gets the remaining cells)
+         */
+        void testMultipleBlocks() {
+            checkMultiBlock(3, 2);
+            checkMultiBlock(4, 6);
+        }
+
+        /**
+         * Multiple blocks with active tiles
+         */
+        void testMultipleBlocksActiveTiles() {
+            checkMultiBlock(3, 2, 8);
+        }
+};
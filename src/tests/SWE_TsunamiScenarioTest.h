@@ -1,5 +1,6 @@
 
 #include <cxxtest/TestSuite.h>
+#include <vector>
 
 #define private public
 #define protected public
@@ -15,6 +16,37 @@ class SWE_TsunamiScenarioTest : public CxxTest::TestSuite {
         //! The scenario instance to test on
         SWE_TsunamiScenario *scenario;
         
+        /// Compare the block functions with the functions for single cells
+        /**
+         * The block covers [-300, 800] x [-1300, 1300], i.e. the complete
+         * bathymetry domain and a margin of cells outside of the domain.
+         *
+         * @param nx Number of columns of the block
+         * @param ny Number of rows of the block
+         */
+        void checkBlock(int nx, int ny) {
+            std::vector<float> x(nx), y(ny);
+            for(int i = 0; i < nx; i++)
+                x[i] = -300.f + (i+.5f) * 1100.f / nx;
+            for(int j = 0; j < ny; j++)
+                y[j] = -1300.f + (j+.5f) * 2600.f / ny;
+
+            // use a stride larger than the number of rows
+            const int stride = ny + 3;
+            std::vector<float> b(nx*stride), h(nx*stride), u(nx*stride), v(nx*stride);
+            scenario->getBathymetryBlock(&x[0], nx, &y[0], ny, stride, &b[0]);
+            scenario->getInitialValuesBlock(&x[0], nx, &y[0], ny, stride, &h[0], &u[0], &v[0]);
+
+            for(int i = 0; i < nx; i++) {
+                for(int j = 0; j < ny; j++) {
+                    TS_ASSERT_EQUALS(b[i*stride + j], scenario->getBathymetry(x[i], y[j]));
+                    TS_ASSERT_EQUALS(h[i*stride + j], scenario->getWaterHeight(x[i], y[j]));
+                    TS_ASSERT_EQUALS(u[i*stride + j], 0.f);
+                    TS_ASSERT_EQUALS(v[i*stride + j], 0.f);
+                }
+            }
+        }
+        
     public:
 
         /// Set Up called before each test case (create scenario)
@@ -240,6 +272,16 @@ class SWE_TsunamiScenarioTest : public CxxTest::TestSuite {
             TSM_ASSERT_EQUALS("Bathymetry < -20m", scenario->getBathymetry(155.0, -425.0), -213.375);            
         }
         
+        /// Test reading the bathymetry and water height of a block with a finer resolution than the input data
+        void testFineBlock() {
+            checkBlock(150, 80);
+        }
+        
+        /// Test reading the bathymetry and water height of a block with a coarser resolution than the input data
+        void testCoarseBlock() {
+            checkBlock(7, 5);
+        }
+        
         /// Test water height calculation based in read bathymetry data
         void testGetWaterHeight() {
             TSM_ASSERT_EQUALS("Wet Cell (Bathymetry < 20m)", scenario->getWaterHeight(-122.5, 105.0), 20.0);
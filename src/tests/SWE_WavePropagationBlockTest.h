@@ -0,0 +1,117 @@
+#include <cxxtest/TestSuite.h>
+#include "blocks/SWE_WavePropagationBlock.hh"
+#include "scenarios/SWE_simple_scenarios.hh"
+
+/**
+ * Unit test for SWE_WavePropagationBlock
+ */
+class SWE_WavePropagationBlockTest : public CxxTest::TestSuite {
+    private:
+        /** Number of timesteps to compute */
+        const static unsigned int TIMESTEPS = 30;
+
+        /**
+         * Compare the interior/boundary flux computation with computeNumericalFluxes
+         * @param nx Number of cells in x-direction
+         * @param ny Number of cells in y-direction
+         * @param activeTileSize Size of the active tiles (0 = disabled)
+         */
+        void checkSplitFluxes(int nx, int ny, int activeTileSize = 0) {
+            SWE_RadialDamBreakScenario scenario;
+            float originX = scenario.getBoundaryPos(BND_LEFT);
+            float originY = scenario.getBoundaryPos(BND_BOTTOM);
+            float dx = (scenario.getBoundaryPos(BND_RIGHT) - originX) / nx;
+            float dy = (scenario.getBoundaryPos(BND_TOP) - originY) / ny;
+
+            SWE_WavePropagationBlock full(nx, ny, dx, dy);
+            full.setActiveTileSize(activeTileSize);
+            full.initScenario(originX, originY, scenario);
+
+            SWE_WavePropagationBlock split(nx, ny, dx, dy);
+            split.setActiveTileSize(activeTileSize);
+            split.initScenario(originX, originY, scenario);
+
+            for(unsigned int step = 0; step < TIMESTEPS; step++) {
+                full.setGhostLayer();
+                full.computeNumericalFluxes();
+
+                // The ghost layer may be set between both parts
+                split.computeInteriorNumericalFluxes();
+                split.setGhostLayer();
+                split.computeBoundaryNumericalFluxes();
+
+                TS_ASSERT_EQUALS(full.getMaxTimestep(), split.getMaxTimestep());
+
+                full.updateUnknowns(full.getMaxTimestep());
+                split.updateUnknowns(full.getMaxTimestep());
+            }
+
+            for(int i = 1; i <= nx; i++) {
+                for(int j = 1; j <= ny; j++) {
+                    TS_ASSERT_EQUALS(full.getWaterHeight()[i][j], split.getWaterHeight()[i][j]);
+                    TS_ASSERT_EQUALS(full.getDischarge_hu()[i][j], split.getDischarge_hu()[i][j]);
+                    TS_ASSERT_EQUALS(full.getDischarge_hv()[i][j], split.getDischarge_hv()[i][j]);
+                }
+            }
+        }
+
+    public:
+        /**
+         * Interior and boundary edges give the same result as all edges at once
+         */
+        void testSplitFluxes() {
+            checkSplitFluxes(50, 40);
+            checkSplitFluxes(1, 20);
+            checkSplitFluxes(20, 1);
+        }
+
+        /**
+         * Same with active tiles
+         */
+        void testSplitFluxesActiveTiles() {
+            checkSplitFluxes(50, 40, 8);
+        }
+
+        /**
+         * Restoring the stored unknowns resets all cells of padded columns
+         */
+        void testRestoreUnknownsPadded() {
+            // 15 rows per column, padded to the next cache line
+            int nx = 20, ny = 13;
+            Float2D::setDefaultPadding(Float2D::PADDING_ALIGNED);
+            SWE_RadialDamBreakScenario scenario;
+            SWE_WavePropagationBlock block(nx, ny, 1000.f/nx, 1000.f/ny);
+            Float2D::setDefaultPadding(Float2D::PADDING_NONE);
+            TS_ASSERT_LESS_THAN(ny+2, block.getWaterHeight().getLeadingDimension());
+
+            block.initScenario(0.f, 0.f, scenario);
+            block.setGhostLayer();
+            block.computeNumericalFluxes();
+            block.updateUnknowns(block.getMaxTimestep());
+
+            Float2D h(nx+2, ny+2), hu(nx+2, ny+2), hv(nx+2, ny+2);
+            for(int i = 0; i < nx+2; i++) {
+                for(int j = 0; j < ny+2; j++) {
+                    h[i][j] = block.getWaterHeight()[i][j];
+                    hu[i][j] = block.getDischarge_hu()[i][j];
+                    hv[i][j] = block.getDischarge_hv()[i][j];
+                }
+            }
+
+            block.storeUnknowns();
+            for(unsigned int step = 0; step < TIMESTEPS; step++) {
+                block.setGhostLayer();
+                block.computeNumericalFluxes();
+                block.updateUnknowns(block.getMaxTimestep());
+            }
+            block.restoreUnknowns();
+
+            for(int i = 0; i < nx+2; i++) {
+                for(int j = 0; j < ny+2; j++) {
+                    TS_ASSERT_EQUALS(h[i][j], block.getWaterHeight()[i][j]);
+                    TS_ASSERT_EQUALS(hu[i][j], block.getDischarge_hu()[i][j]);
+                    TS_ASSERT_EQUALS(hv[i][j], block.getDischarge_hv()[i][j]);
+                }
+            }
+        }
+};
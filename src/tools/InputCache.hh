@@ -0,0 +1,240 @@
+/**
+ * @file
+ * This file is part of SWE.
+ *
+ * @section LICENSE
+ *
+ * SWE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SWE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SWE.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * @section DESCRIPTION
+ *
+ * Raw, memory-mappable copy of a two-dimensional input variable
+ * (the z variable of a bathymetry or displacement file).
+ *
+ * File layout:
+ *  - InputCacheHeader (incl. size and modification time of the netCDF file)
+ *  - zero padding up to InputCache::ALIGNMENT bytes
+ *  - the values as 32 bit floats in native byte order, row by row
+ *    (value (x,y) at index y*xLength + x, as in the netCDF file)
+ */
+
+#ifndef INPUTCACHE_HH_
+#define INPUTCACHE_HH_
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace tools {
+	struct InputCacheHeader;
+	class InputCache;
+}
+
+/**
+ * Header at the beginning of a cache file
+ */
+struct tools::InputCacheHeader {
+	//! "SWECACHE"
+	char magic[8];
+	//! 0x01020304 in the byte order of the writer
+	uint32_t byteOrderMark;
+	//! version of the file format
+	uint32_t version;
+	//! number of values in x-direction
+	uint64_t xLength;
+	//! number of values in y-direction
+	uint64_t yLength;
+	//! offset of the first value in bytes
+	uint64_t dataOffset;
+	//! size of the netCDF file in bytes
+	uint64_t sourceSize;
+	//! modification time of the netCDF file (seconds since the epoch)
+	int64_t sourceModificationTime;
+};
+
+/**
+ * Read-only memory mapping of a cache file
+ *
+ * The file is mapped shared, so all processes on a node use the same
+ * pages of the page cache and only the touched pages are read from disk.
+ */
+class tools::InputCache
+{
+public:
+	//! Offset of the values (a multiple of all common page sizes)
+	static const uint64_t ALIGNMENT = 65536;
+	//! Current version of the file format
+	static const uint32_t VERSION = 2;
+
+private:
+	//! Start of the mapping
+	void *mapping;
+	//! Size of the mapping in bytes
+	size_t mappingSize;
+
+	// InputCache owns the mapping, copying is not supported
+	InputCache(const InputCache&);
+	InputCache& operator=(const InputCache&);
+
+	/**
+	 * Gets the size and modification time of the netCDF file
+	 *
+	 * @return True on success
+	 */
+	static bool getSource(const std::string &i_netCdfFileName, uint64_t &o_size, int64_t &o_modificationTime)
+	{
+		struct stat l_stat;
+		if (stat(i_netCdfFileName.c_str(), &l_stat) != 0)
+			return false;
+
+		o_size = l_stat.st_size;
+		o_modificationTime = l_stat.st_mtime;
+		return true;
+	}
+
+public:
+	InputCache()
+		: mapping(0L), mappingSize(0)
+	{
+	}
+
+	~InputCache()
+	{
+		unmap();
+	}
+
+	/**
+	 * @param i_netCdfFileName name of the netCDF input file
+	 * @return Name of the cache file of a netCDF input file
+	 */
+	static std::string fileName(const std::string &i_netCdfFileName)
+	{
+		return i_netCdfFileName + ".cache";
+	}
+
+	/**
+	 * Maps the cache file of a netCDF file
+	 *
+	 * The cache is rejected if the netCDF file was modified after the
+	 * cache was written (different size or modification time).
+	 *
+	 * @param i_netCdfFileName name of the netCDF input file
+	 * @param i_xLength expected number of values in x-direction
+	 * @param i_yLength expected number of values in y-direction
+	 * @return True if the file was mapped, false if it does not exist or does not match
+	 */
+	bool map(const std::string &i_netCdfFileName, size_t i_xLength, size_t i_yLength)
+	{
+		unmap();
+
+		uint64_t l_sourceSize;
+		int64_t l_sourceModificationTime;
+		if (!getSource(i_netCdfFileName, l_sourceSize, l_sourceModificationTime))
+			return false;
+
+		int l_file = open(fileName(i_netCdfFileName).c_str(), O_RDONLY);
+		if (l_file < 0)
+			return false;
+
+		InputCacheHeader l_header;
+		struct stat l_stat;
+		bool l_valid = read(l_file, &l_header, sizeof(l_header)) == sizeof(l_header)
+				&& fstat(l_file, &l_stat) == 0
+				&& memcmp(l_header.magic, "SWECACHE", 8) == 0
+				&& l_header.byteOrderMark == 0x01020304
+				&& l_header.version == VERSION
+				&& l_header.xLength == i_xLength
+				&& l_header.yLength == i_yLength
+				&& l_header.dataOffset == ALIGNMENT
+				&& l_header.sourceSize == l_sourceSize
+				&& l_header.sourceModificationTime == l_sourceModificationTime
+				&& (uint64_t) l_stat.st_size >= ALIGNMENT + i_xLength * i_yLength * sizeof(float);
+		if (!l_valid) {
+			close(l_file);
+			return false;
+		}
+
+		mappingSize = ALIGNMENT + i_xLength * i_yLength * sizeof(float);
+		mapping = mmap(0L, mappingSize, PROT_READ, MAP_SHARED, l_file, 0);
+		close(l_file);
+
+		if (mapping == MAP_FAILED) {
+			perror("mmap");
+			mapping = 0L;
+			return false;
+		}
+
+		return true;
+	}
+
+	/**
+	 * Removes the mapping
+	 */
+	void unmap()
+	{
+		if (mapping != 0L)
+			munmap(mapping, mappingSize);
+		mapping = 0L;
+	}
+
+	/**
+	 * @return The mapped values, row by row (NULL if no file is mapped)
+	 */
+	const float* getValues() const
+	{
+		if (mapping == 0L)
+			return 0L;
+		return reinterpret_cast<const float*>(static_cast<const char*>(mapping) + ALIGNMENT);
+	}
+
+	/**
+	 * Writes the header and the padding of a cache file
+	 *
+	 * The values have to be written afterwards (row by row).
+	 *
+	 * @param i_file the cache file
+	 * @param i_netCdfFileName name of the netCDF input file
+	 * @param i_xLength number of values in x-direction
+	 * @param i_yLength number of values in y-direction
+	 * @return True on success
+	 */
+	static bool writeHeader(FILE* i_file, const std::string &i_netCdfFileName, size_t i_xLength, size_t i_yLength)
+	{
+		std::vector<char> l_page(ALIGNMENT, 0);
+
+		InputCacheHeader l_header;
+		memset(&l_header, 0, sizeof(l_header));
+		memcpy(l_header.magic, "SWECACHE", 8);
+		l_header.byteOrderMark = 0x01020304;
+		l_header.version = VERSION;
+		l_header.xLength = i_xLength;
+		l_header.yLength = i_yLength;
+		l_header.dataOffset = ALIGNMENT;
+		if (!getSource(i_netCdfFileName, l_header.sourceSize, l_header.sourceModificationTime))
+			return false;
+		memcpy(&l_page[0], &l_header, sizeof(l_header));
+
+		return fwrite(&l_page[0], 1, l_page.size(), i_file) == l_page.size();
+	}
+};
+
+#endif // INPUTCACHE_HH_
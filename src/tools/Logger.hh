@@ -102,6 +102,13 @@ class tools::Logger {
   clock_t cpuCommClock;
 #endif
 
+  //! Reduction clock
+#if (defined USEMPI && !defined CUDA)
+  double reductionClock;
+#else
+  clock_t reductionClock;
+#endif
+
   //! CPU time
   double cpuTime;
 
@@ -111,6 +118,12 @@ class tools::Logger {
   //! wall clock time: cpu, communication, IO
   double wallClockTime;
 
+  //! time spent in (waiting for) global reductions
+  double reductionTime;
+
+  //! number of global reductions
+  unsigned int reductions;
+
   /**
    * Print the number of 1D quantities.
    *
@@ -179,7 +192,8 @@ class tools::Logger {
             largeDelimiter(i_largeDelimiter),
             indentation(i_indentation) {
       //set time to zero
-      cpuTime = cpuCommTime = wallClockTime = 0.;
+      cpuTime = cpuCommTime = wallClockTime = reductionTime = 0.;
+      reductions = 0;
 
 #ifndef USEMPI
       // Since we have one static logger, we do not know the MPI rank in this
@@ -448,6 +462,19 @@ class tools::Logger {
 #endif
     }
 
+    /**
+     * Update the time spent in global reductions.
+     * Counts one reduction.
+     */
+    void updateReductionTime() {
+#if (defined USEMPI && !defined CUDA)
+      reductionTime += MPI_Wtime() - reductionClock;
+#else
+      reductionTime += (clock() - reductionClock)/(double)CLOCKS_PER_SEC;
+#endif
+      reductions++;
+    }
+
     void resetCpuClockToCurrentTime() {
 #if (defined USEMPI && !defined CUDA)
       cpuClock = MPI_Wtime();
@@ -464,6 +491,14 @@ class tools::Logger {
 #endif
     }
 
+    void resetReductionClockToCurrentTime() {
+#if (defined USEMPI && !defined CUDA)
+      reductionClock = MPI_Wtime();
+#else
+      reductionClock = clock();
+#endif
+    }
+
     /**
      * Initialize the wall clock time.
      *
@@ -508,6 +543,33 @@ class tools::Logger {
                 << cpuCommTime << " seconds"<< std::endl;
     }
 
+    /**
+     * Print the time spent in the asynchronous output.
+     *
+     * @param i_writeTime time spent in the writer (I/O thread).
+     * @param i_hiddenTime part of the write time that overlapped with the simulation.
+     * @param i_outputTimeMessage output time message.
+     */
+    void printAsynchronousOutputTime( const double i_writeTime, const double i_hiddenTime,
+                                      const std::string i_outputTimeMessage = "asynchronous output time" ) {
+      timeCout() << indentation << "process " << processRank << " - "
+                << i_outputTimeMessage << ": "
+                << i_writeTime << " seconds ("
+                << i_hiddenTime << " seconds hidden)" << std::endl;
+    }
+
+    /**
+     * Print the time spent in (waiting for) global reductions.
+     *
+     * @param i_reductionTimeMessage reduction time message.
+     */
+    void printReductionTime( const std::string i_reductionTimeMessage = "time in global reductions" ) {
+      timeCout() << indentation << "process " << processRank << " - "
+                << i_reductionTimeMessage << ": "
+                << reductionTime << " seconds ("
+                << reductions << " reductions)" << std::endl;
+    }
+
     /**
      * Print number of iterations done
      *
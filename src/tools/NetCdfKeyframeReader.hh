@@ -0,0 +1,162 @@
+/**
+ * @file
+ * This file is part of SWE.
+ *
+ * @section LICENSE
+ *
+ * SWE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SWE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SWE.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * @section DESCRIPTION
+ *
+ * Reads time steps of incremental netCDF output
+ * (see io::NetCdfOptions::keyframeInterval).
+ *
+ * The variable keyframe(time) contains the time step of the last full
+ * time step (keyframe) for each time step. Between two keyframes, the
+ * writer only stores the tiles (chunks) of h, hu and hv that changed
+ * since the keyframe. All other tiles are never written and contain
+ * the fill value; their values are taken from the keyframe.
+ */
+
+#ifndef NETCDFKEYFRAMEREADER_HH_
+#define NETCDFKEYFRAMEREADER_HH_
+
+#include <vector>
+#include <netcdf.h>
+
+namespace tools {
+	class NetCdfKeyframeReader;
+}
+
+class tools::NetCdfKeyframeReader
+{
+private:
+	//! The netCDF file id
+	int file;
+
+	//! Id of the keyframe variable (-1 if the file contains only full time steps)
+	int keyframeVar;
+
+public:
+	/**
+	 * @param i_file an open netCDF file
+	 */
+	explicit NetCdfKeyframeReader(int i_file = -1)
+	{
+		setFile(i_file);
+	}
+
+	/**
+	 * @param i_file an open netCDF file
+	 */
+	void setFile(int i_file)
+	{
+		file = i_file;
+		if (i_file < 0 || nc_inq_varid(i_file, "keyframe", &keyframeVar) != NC_NOERR)
+			keyframeVar = -1;
+	}
+
+	/**
+	 * @return True if the file contains incremental time steps
+	 */
+	bool isIncremental() const
+	{
+		return keyframeVar >= 0;
+	}
+
+	/**
+	 * @param i_timeStep a time step
+	 * @return The keyframe of the time step
+	 */
+	size_t getKeyframe(size_t i_timeStep) const
+	{
+		if (keyframeVar < 0)
+			return i_timeStep;
+
+		int l_keyframe;
+		if (nc_get_var1_int(file, keyframeVar, &i_timeStep, &l_keyframe) != NC_NOERR
+				|| l_keyframe < 0)
+			return i_timeStep;
+		return l_keyframe;
+	}
+
+	/**
+	 * Reads a hyperslab of a time dependent variable (time, y, x)
+	 * and replaces unchanged tiles with the values of the keyframe
+	 *
+	 * The values are converted to float, but not unpacked
+	 * (scale_factor and add_offset are not applied).
+	 *
+	 * @param i_var the netCDF variable
+	 * @param i_timeStep the time step
+	 * @param i_start first row and column
+	 * @param i_count number of rows and columns
+	 * @param o_values the values, row by row
+	 * @return The netCDF status
+	 */
+	int getSlab(int i_var, size_t i_timeStep, const size_t i_start[2], const size_t i_count[2],
+			float *o_values) const
+	{
+		size_t l_start[] = {i_timeStep, i_start[0], i_start[1]};
+		size_t l_count[] = {1, i_count[0], i_count[1]};
+
+		int l_status = nc_get_vara_float(file, i_var, l_start, l_count, o_values);
+		if (l_status != NC_NOERR)
+			return l_status;
+
+		l_start[0] = getKeyframe(i_timeStep);
+		if (l_start[0] == i_timeStep)
+			return NC_NOERR;
+
+		const float l_fillValue = getFillValue(i_var);
+		const size_t l_size = i_count[0] * i_count[1];
+		size_t l_first = 0;
+		while (l_first < l_size && o_values[l_first] != l_fillValue)
+			l_first++;
+		if (l_first == l_size)
+			return NC_NOERR;
+
+		std::vector<float> l_keyframe(l_size);
+		l_status = nc_get_vara_float(file, i_var, l_start, l_count, &l_keyframe[0]);
+		if (l_status != NC_NOERR)
+			return l_status;
+
+		for (size_t i = l_first; i < l_size; i++) {
+			if (o_values[i] == l_fillValue)
+				o_values[i] = l_keyframe[i];
+		}
+
+		return NC_NOERR;
+	}
+
+private:
+	/**
+	 * @return The fill value of a variable converted to float
+	 */
+	float getFillValue(int i_var) const
+	{
+		double l_fillValue;
+		if (nc_get_att_double(file, i_var, "_FillValue", &l_fillValue) == NC_NOERR)
+			return l_fillValue;
+
+		nc_type l_type;
+		nc_inq_vartype(file, i_var, &l_type);
+		if (l_type == NC_SHORT)
+			return NC_FILL_SHORT;
+		return NC_FILL_FLOAT;
+	}
+};
+
+#endif // NETCDFKEYFRAMEREADER_HH_
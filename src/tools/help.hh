@@ -29,6 +29,8 @@
 #ifndef __HELP_HH
 #define __HELP_HH
 
+#include <algorithm>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <fstream>
@@ -77,6 +79,47 @@ class Float1D
     float* elem;
 };
 
+/**
+ * Interface for the memory allocation of Float2D arrays.
+ * 
+ * Implementations may use memory arenas, huge pages or memory on a specific
+ * NUMA node. The returned memory must be aligned to at least
+ * Float2D::ALIGNMENT bytes.
+ */
+class Float2DAllocator
+{
+public:
+	virtual ~Float2DAllocator()
+	{
+	}
+	
+	/**
+	 * @param n number of floats
+	 * @return pointer to memory for n floats, aligned to Float2D::ALIGNMENT bytes
+	 */
+	virtual float* allocate(size_t n) = 0;
+	
+	/**
+	 * @param p pointer returned by allocate
+	 * @param n number of floats passed to allocate
+	 */
+	virtual void deallocate(float* p, size_t n) = 0;
+};
+
+/**
+ * Default allocator: aligned memory from the heap (posix_memalign)
+ */
+class AlignedFloat2DAllocator : public Float2DAllocator
+{
+public:
+	float* allocate(size_t n);
+	
+	void deallocate(float* p, size_t n)
+	{
+		free(p);
+	}
+};
+
 /**
  * class Float2D is a very basic helper class to deal with 2D float arrays:
  * indices represent columns (1st index, "horizontal"/x-coordinate) and 
@@ -84,10 +127,30 @@ class Float1D
  * values are sequentially ordered in memory using "column major" order.
  * Besides constructor/deconstructor, the class provides overloading of 
  * the []-operator, such that elements can be accessed as a[i][j]. 
+ *
+ * The array starts at a Float2D::ALIGNMENT byte boundary. Columns may be
+ * padded, i.e. the distance between two columns in memory (the leading
+ * dimension) can be larger than the number of rows. The padding and the
+ * allocator of newly created arrays can be changed for the whole program
+ * with setDefaultPadding and setDefaultAllocator.
  */ 
 class Float2D
 {
 public:
+	/** Alignment (in bytes) of the allocated memory */
+	static const int ALIGNMENT = 64;
+	
+	/** Column padding of newly created arrays */
+	enum Padding {
+		/** no padding, the leading dimension equals the number of rows */
+		PADDING_NONE,
+		/** 
+		 * every column starts at an ALIGNMENT byte boundary; the leading dimension is
+		 * additionally increased if it is a multiple of 4 KiB to avoid cache set conflicts
+		 */
+		PADDING_ALIGNED
+	};
+	
 	/**
      * Constructor
      *
@@ -98,9 +161,7 @@ public:
      */
     Float2D(int _cols, int _rows) : rows(_rows),cols(_cols)
 	{
-		elem = new float[rows*cols];
-		for (int i = 0; i < rows*cols; i++)
-			elem[i] = 0;
+		allocate(computeLeadingDimension(rows, defaultPadding()), 0L, true);
 	}
     
     /**
@@ -111,27 +172,27 @@ public:
      * @param _cols number of columns (i.e., elements in horizontal direction)
      * @param _rows rumber of rows (i.e., elements in vertical directions)
      * @param _init whether to initialize all values to zero (true) or not (false)
+     * @param _padding column padding (default: see setDefaultPadding)
+     * @param _allocator allocator used for this array (default: see setDefaultAllocator)
      */
-    Float2D(int _cols, int _rows, bool _init) : rows(_rows),cols(_cols)
+    Float2D(int _cols, int _rows, bool _init,
+    		Padding _padding = defaultPadding(), Float2DAllocator* _allocator = 0L)
+    	: rows(_rows),cols(_cols)
     {
-        elem = new float[rows*cols];
-        if(_init) {
-            for (int i = 0; i < rows*cols; i++)
-                elem[i] = 0;
-        }
+        allocate(computeLeadingDimension(rows, _padding), _allocator, _init);
     }
     
 	~Float2D()
 	{
-		delete[] elem;
+		allocator->deallocate(elem, size());
 	}
 
 	inline float* operator[](int i) { 
-		return (elem + (rows * i)); 
+		return (elem + (leadingDimension * i)); 
 	}
 
 	inline float const* operator[](int i) const {
-		return (elem + (rows * i)); 
+		return (elem + (leadingDimension * i)); 
 	}
 
 	inline float* elemVector() {
@@ -140,25 +201,119 @@ public:
 
         inline int getRows() const { return rows; }; 
         inline int getCols() const { return cols; }; 
+        /** @return distance (in floats) between two columns in memory */
+        inline int getLeadingDimension() const { return leadingDimension; };
 
 	inline Float1D getColProxy(int i) {
 		// subarray elem[i][*]:
                 // starting at elem[i][0] with rows elements and unit stride
-		return Float1D(elem + (rows * i), rows);
+		return Float1D(elem + (leadingDimension * i), rows);
 	};
 	
 	inline Float1D getRowProxy(int j) {
 		// subarray elem[*][j]
-                // starting at elem[0][j] with cols elements and stride rows
-		return Float1D(elem + j, cols, rows);
+                // starting at elem[0][j] with cols elements and stride leadingDimension
+		return Float1D(elem + j, cols, leadingDimension);
 	};
+	
+	/**
+	 * Set the allocator used for all arrays created afterwards
+	 *
+	 * @param _allocator the new default allocator, NULL restores the aligned heap allocator.
+	 *  The allocator must outlive all arrays created with it.
+	 */
+	static void setDefaultAllocator(Float2DAllocator* _allocator)
+	{
+		if(_allocator == 0L)
+			_allocator = &alignedAllocator();
+		defaultAllocator() = _allocator;
+	}
+	
+	/**
+	 * Set the column padding used for all arrays created afterwards
+	 *
+	 * Note: Code that relies on contiguous columns (OpenCL, CUDA) requires PADDING_NONE
+	 */
+	static void setDefaultPadding(Padding _padding)
+	{
+		defaultPadding() = _padding;
+	}
 
   private:
     int rows;
     int cols;
+    int leadingDimension;
     float* elem; 
+    Float2DAllocator* allocator;
+    
+    size_t size() const
+    {
+    	return static_cast<size_t>(leadingDimension) * cols;
+    }
+    
+    void allocate(int _leadingDimension, Float2DAllocator* _allocator, bool _init)
+    {
+    	leadingDimension = _leadingDimension;
+    	if(_allocator == 0L)
+    		_allocator = defaultAllocator();
+    	allocator = _allocator;
+    	
+    	elem = allocator->allocate(size());
+    	if(_init)
+    		memset(elem, 0, size() * sizeof(float));
+    }
+    
+    static int computeLeadingDimension(int _rows, Padding _padding)
+    {
+    	if(_padding == PADDING_NONE)
+    		return _rows;
+    	
+    	const int floatsPerLine = ALIGNMENT / sizeof(float);
+    	int ld = (_rows + floatsPerLine - 1) / floatsPerLine * floatsPerLine;
+    	// columns which are a multiple of 4 KiB apart map to the same cache sets
+    	if((ld * sizeof(float)) % 4096 == 0)
+    		ld += floatsPerLine;
+    	return ld;
+    }
+    
+    static AlignedFloat2DAllocator& alignedAllocator()
+    {
+    	static AlignedFloat2DAllocator allocator;
+    	return allocator;
+    }
+    
+    /**
+     * The static is initialized once (thread-safe) before the first use,
+     * so arrays may be created concurrently (e.g. in OpenMP loops)
+     */
+    static Float2DAllocator*& defaultAllocator()
+    {
+    	static Float2DAllocator* allocator = &alignedAllocator();
+    	return allocator;
+    }
+    
+    static Padding& defaultPadding()
+    {
+    	static Padding padding = PADDING_NONE;
+    	return padding;
+    }
+    
+    // Float2D owns its memory, copying is not supported
+    Float2D(const Float2D&);
+    Float2D& operator=(const Float2D&);
 };
 
+inline float* AlignedFloat2DAllocator::allocate(size_t n)
+{
+	void* p;
+	// posix_memalign does not like zero sized allocations on all platforms
+	if(posix_memalign(&p, Float2D::ALIGNMENT, std::max(n, static_cast<size_t>(1)) * sizeof(float)) != 0) {
+		std::cerr << "Could not allocate " << n << " floats" << std::endl;
+		exit(1);
+	}
+	return static_cast<float*>(p);
+}
+
 //-------- Methods for Visualistion of Results --------
 
 /**
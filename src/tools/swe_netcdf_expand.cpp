@@ -0,0 +1,230 @@
+/**
+ * @file
+ * This file is part of SWE.
+ *
+ * @section LICENSE
+ *
+ * SWE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SWE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SWE.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * @section DESCRIPTION
+ *
+ * Reconstructs all time steps of incremental netCDF output
+ * (see io::NetCdfOptions::keyframeInterval) and writes them to a file
+ * with full time steps, which can be read by any netCDF reader
+ * (e.g. paraview/netcdf_swe.py).
+ */
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <netcdf.h>
+
+#include "tools/NetCdfKeyframeReader.hh"
+
+/**
+ * Prints a netCDF error
+ *
+ * @return false
+ */
+static bool netCdfError(const std::string &i_fileName, int i_status)
+{
+	std::cerr << i_fileName << ": " << nc_strerror(i_status) << std::endl;
+	return false;
+}
+
+/**
+ * @param i_fileName name of the incremental file
+ * @return Name of the expanded file
+ */
+static std::string expandedFileName(const std::string &i_fileName)
+{
+	std::string l_baseName = i_fileName;
+	if (l_baseName.size() > 3 && l_baseName.compare(l_baseName.size()-3, 3, ".nc") == 0)
+		l_baseName.erase(l_baseName.size()-3);
+	return l_baseName + "_expanded.nc";
+}
+
+/**
+ * Defines the dimensions, variables and attributes of the input file
+ * (without the keyframe variable) in the output file
+ *
+ * @return The netCDF status
+ */
+static int copyDefinitions(int i_input, int i_output, int i_keyframeVar)
+{
+	int l_status, l_nDims, l_nVars, l_nAtts, l_unlimitedDim;
+	if ((l_status = nc_inq(i_input, &l_nDims, &l_nVars, &l_nAtts, &l_unlimitedDim)) != NC_NOERR)
+		return l_status;
+
+	// the dimension ids are equal in both files
+	for (int i = 0; i < l_nDims; i++) {
+		char l_name[NC_MAX_NAME+1];
+		size_t l_length;
+		int l_dim;
+		if ((l_status = nc_inq_dim(i_input, i, l_name, &l_length)) != NC_NOERR
+				|| (l_status = nc_def_dim(i_output, l_name, (i == l_unlimitedDim) ? NC_UNLIMITED : l_length, &l_dim)) != NC_NOERR)
+			return l_status;
+	}
+
+	for (int i = 0; i < l_nAtts; i++) {
+		char l_name[NC_MAX_NAME+1];
+		if ((l_status = nc_inq_attname(i_input, NC_GLOBAL, i, l_name)) != NC_NOERR
+				|| (l_status = nc_copy_att(i_input, NC_GLOBAL, l_name, i_output, NC_GLOBAL)) != NC_NOERR)
+			return l_status;
+	}
+
+	for (int l_var = 0; l_var < l_nVars; l_var++) {
+		if (l_var == i_keyframeVar)
+			continue;
+
+		char l_name[NC_MAX_NAME+1];
+		nc_type l_type;
+		int l_varDims, l_dims[NC_MAX_VAR_DIMS], l_varAtts, l_outputVar;
+		if ((l_status = nc_inq_var(i_input, l_var, l_name, &l_type, &l_varDims, l_dims, &l_varAtts)) != NC_NOERR
+				|| (l_status = nc_def_var(i_output, l_name, l_type, l_varDims, l_dims, &l_outputVar)) != NC_NOERR)
+			return l_status;
+
+		for (int i = 0; i < l_varAtts; i++) {
+			char l_attName[NC_MAX_NAME+1];
+			if ((l_status = nc_inq_attname(i_input, l_var, i, l_attName)) != NC_NOERR
+					|| (l_status = nc_copy_att(i_input, l_var, l_attName, i_output, l_outputVar)) != NC_NOERR)
+				return l_status;
+		}
+	}
+
+	return nc_enddef(i_output);
+}
+
+/**
+ * Copies the values of all variables, time dependent variables (time, y, x)
+ * are reconstructed time step by time step
+ *
+ * @return The netCDF status
+ */
+static int copyValues(int i_input, int i_output, const tools::NetCdfKeyframeReader &i_reader)
+{
+	int l_status, l_nVars, l_unlimitedDim;
+	if ((l_status = nc_inq_nvars(i_input, &l_nVars)) != NC_NOERR
+			|| (l_status = nc_inq_unlimdim(i_input, &l_unlimitedDim)) != NC_NOERR)
+		return l_status;
+
+	std::vector<float> l_values;
+	for (int l_var = 0; l_var < l_nVars; l_var++) {
+		char l_name[NC_MAX_NAME+1];
+		int l_varDims, l_dims[NC_MAX_VAR_DIMS], l_outputVar;
+		if ((l_status = nc_inq_var(i_input, l_var, l_name, 0L, &l_varDims, l_dims, 0L)) != NC_NOERR)
+			return l_status;
+		if (nc_inq_varid(i_output, l_name, &l_outputVar) != NC_NOERR)
+			// the keyframe variable
+			continue;
+
+		size_t l_lengths[NC_MAX_VAR_DIMS];
+		size_t l_size = 1;
+		for (int i = 0; i < l_varDims; i++) {
+			if ((l_status = nc_inq_dimlen(i_input, l_dims[i], &l_lengths[i])) != NC_NOERR)
+				return l_status;
+			l_size *= l_lengths[i];
+		}
+		if (l_size == 0)
+			continue;
+
+		if (l_varDims == 3 && l_dims[0] == l_unlimitedDim) {
+			l_values.resize(l_lengths[1] * l_lengths[2]);
+			const size_t l_start[] = {0, 0};
+			for (size_t t = 0; t < l_lengths[0]; t++) {
+				size_t l_outputStart[] = {t, 0, 0};
+				size_t l_outputCount[] = {1, l_lengths[1], l_lengths[2]};
+				if ((l_status = i_reader.getSlab(l_var, t, l_start, &l_lengths[1], &l_values[0])) != NC_NOERR
+						|| (l_status = nc_put_vara_float(i_output, l_outputVar, l_outputStart, l_outputCount, &l_values[0])) != NC_NOERR)
+					return l_status;
+			}
+		} else {
+			// the unlimited dimension of the new file is still empty
+			const std::vector<size_t> l_start(l_varDims, 0);
+			l_values.resize(l_size);
+			if ((l_status = nc_get_var_float(i_input, l_var, &l_values[0])) != NC_NOERR
+					|| (l_status = nc_put_vara_float(i_output, l_outputVar, &l_start[0], l_lengths, &l_values[0])) != NC_NOERR)
+				return l_status;
+		}
+	}
+
+	return NC_NOERR;
+}
+
+/**
+ * Expands a single netCDF file
+ *
+ * @param i_fileName the incremental netCDF file
+ * @return True on success
+ */
+static bool expand(const std::string &i_fileName)
+{
+	int l_input;
+	int l_status = nc_open(i_fileName.c_str(), NC_NOWRITE, &l_input);
+	if (l_status != NC_NOERR)
+		return netCdfError(i_fileName, l_status);
+
+	tools::NetCdfKeyframeReader l_reader(l_input);
+	if (!l_reader.isIncremental()) {
+		std::cout << i_fileName << " contains only full time steps" << std::endl;
+		nc_close(l_input);
+		return true;
+	}
+
+	int l_keyframeVar;
+	nc_inq_varid(l_input, "keyframe", &l_keyframeVar);
+
+	std::string l_outputFileName = expandedFileName(i_fileName);
+	int l_output;
+	l_status = nc_create(l_outputFileName.c_str(), NC_NETCDF4, &l_output);
+	if (l_status != NC_NOERR) {
+		nc_close(l_input);
+		return netCdfError(l_outputFileName, l_status);
+	}
+
+	l_status = copyDefinitions(l_input, l_output, l_keyframeVar);
+	if (l_status == NC_NOERR)
+		l_status = copyValues(l_input, l_output, l_reader);
+
+	nc_close(l_output);
+	nc_close(l_input);
+
+	if (l_status != NC_NOERR) {
+		netCdfError(i_fileName, l_status);
+		remove(l_outputFileName.c_str());
+		return false;
+	}
+
+	std::cout << i_fileName << " -> " << l_outputFileName << std::endl;
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2) {
+		std::cout << "Usage: " << argv[0] << " <netCDF file> [<netCDF file> ...]" << std::endl;
+		std::cout << "    Writes all time steps of incremental output <name>.nc to <name>_expanded.nc" << std::endl;
+		return 1;
+	}
+
+	int l_failed = 0;
+	for (int i = 1; i < argc; i++) {
+		if (!expand(argv[i]))
+			l_failed++;
+	}
+
+	return (l_failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,144 @@
+/**
+ * @file
+ * This file is part of SWE.
+ *
+ * @section LICENSE
+ *
+ * SWE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SWE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SWE.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * @section DESCRIPTION
+ *
+ * Converts the z variable of netCDF bathymetry and displacement files
+ * into raw cache files that SWE_TsunamiScenario maps into memory
+ * (compile SWE with useMappedInputCache=yes).
+ *
+ * A cache is written to a temporary file and renamed, so simulations
+ * that map an existing cache keep reading the old (unlinked) file.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <netcdf.h>
+#include <unistd.h>
+
+#include "tools/InputCache.hh"
+
+//! Number of values read from the netCDF file at once
+static const size_t VALUES_PER_READ = 16*1024*1024;
+
+/**
+ * Prints a netCDF error
+ *
+ * @return false
+ */
+static bool netCdfError(const std::string &i_fileName, int i_status)
+{
+	std::cerr << i_fileName << ": " << nc_strerror(i_status) << std::endl;
+	return false;
+}
+
+/**
+ * Converts a single netCDF file
+ *
+ * @param i_netCdfFileName the netCDF input file
+ * @return True on success
+ */
+static bool convert(const std::string &i_netCdfFileName)
+{
+	int l_file, l_xDim, l_yDim, l_zVar;
+	size_t l_xLength, l_yLength;
+
+	int l_status = nc_open(i_netCdfFileName.c_str(), NC_NOWRITE, &l_file);
+	if (l_status != NC_NOERR)
+		return netCdfError(i_netCdfFileName, l_status);
+
+	// same variables as in SWE_TsunamiScenario::loadInputFiles
+	if ((l_status = nc_inq_dimid(l_file, "x", &l_xDim)) != NC_NOERR
+			|| (l_status = nc_inq_dimid(l_file, "y", &l_yDim)) != NC_NOERR
+			|| (l_status = nc_inq_varid(l_file, "z", &l_zVar)) != NC_NOERR
+			|| (l_status = nc_inq_dimlen(l_file, l_xDim, &l_xLength)) != NC_NOERR
+			|| (l_status = nc_inq_dimlen(l_file, l_yDim, &l_yLength)) != NC_NOERR) {
+		nc_close(l_file);
+		return netCdfError(i_netCdfFileName, l_status);
+	}
+
+	if (l_xLength == 0 || l_yLength == 0) {
+		std::cerr << i_netCdfFileName << ": z is empty" << std::endl;
+		nc_close(l_file);
+		return false;
+	}
+
+	std::string l_cacheFileName = tools::InputCache::fileName(i_netCdfFileName);
+	// in the same directory, so the rename does not cross file systems
+	char l_suffix[32];
+	sprintf(l_suffix, ".%d.tmp", (int) getpid());
+	std::string l_tmpFileName = l_cacheFileName + l_suffix;
+	FILE* l_cache = fopen(l_tmpFileName.c_str(), "wb");
+	if (l_cache == 0L) {
+		perror(l_tmpFileName.c_str());
+		nc_close(l_file);
+		return false;
+	}
+
+	bool l_success = tools::InputCache::writeHeader(l_cache, i_netCdfFileName, l_xLength, l_yLength);
+
+	// copy blocks of rows
+	size_t l_rowsPerRead = std::max(VALUES_PER_READ / l_xLength, (size_t) 1);
+	std::vector<float> l_values(l_rowsPerRead * l_xLength);
+	for (size_t l_row = 0; l_success && l_row < l_yLength; l_row += l_rowsPerRead) {
+		size_t l_start[] = {l_row, 0};
+		size_t l_count[] = {std::min(l_rowsPerRead, l_yLength - l_row), l_xLength};
+
+		l_status = nc_get_vara_float(l_file, l_zVar, l_start, l_count, &l_values[0]);
+		if (l_status != NC_NOERR)
+			l_success = netCdfError(i_netCdfFileName, l_status);
+		else
+			l_success = fwrite(&l_values[0], sizeof(float), l_count[0] * l_count[1], l_cache)
+					== l_count[0] * l_count[1];
+	}
+
+	l_success = (fclose(l_cache) == 0) && l_success;
+	nc_close(l_file);
+
+	if (!l_success || rename(l_tmpFileName.c_str(), l_cacheFileName.c_str()) != 0) {
+		std::cerr << "Could not write " << l_cacheFileName << std::endl;
+		remove(l_tmpFileName.c_str());
+		return false;
+	}
+
+	std::cout << i_netCdfFileName << " -> " << l_cacheFileName
+			<< " (" << l_xLength << " x " << l_yLength << ")" << std::endl;
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2) {
+		std::cout << "Usage: " << argv[0] << " <netCDF file> [<netCDF file> ...]" << std::endl;
+		std::cout << "    Writes the raw cache <netCDF file>.cache of each file" << std::endl;
+		return 1;
+	}
+
+	int l_failed = 0;
+	for (int i = 1; i < argc; i++) {
+		if (!convert(argv[i]))
+			l_failed++;
+	}
+
+	return (l_failed == 0) ? 0 : 1;
+}
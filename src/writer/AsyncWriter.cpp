@@ -0,0 +1,207 @@
+/**
+ * @file
+ * This file is part of SWE.
+ *
+ * @section LICENSE
+ *
+ * SWE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SWE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SWE.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * @section DESCRIPTION
+ *
+ * Writes the time steps of another writer in a background thread
+ */
+
+#include "AsyncWriter.hh"
+
+#include <cassert>
+#include <ctime>
+#include <iostream>
+
+/**
+ * Creates the I/O thread
+ *
+ * The bathymetry, boundary size and grid size are taken from the wrapped writer.
+ * If the thread cannot be created, the time steps are written synchronously.
+ *
+ * @param i_writer writer that does the actual output
+ */
+io::AsyncWriter::AsyncWriter(io::Writer &i_writer)
+	: io::Writer(i_writer),
+	  writer(i_writer),
+	  firstQueuedBuffer(0), queuedBuffers(0),
+	  finished(false), asynchronous(true),
+	  writeTime(0), copyTime(0), waitTime(0)
+{
+	for (int i = 0; i < NUMBER_OF_BUFFERS; i++)
+		buffers[i].h = buffers[i].hu = buffers[i].hv = 0L;
+
+	pthread_mutex_init(&mutex, 0L);
+	pthread_cond_init(&bufferQueued, 0L);
+	pthread_cond_init(&bufferWritten, 0L);
+
+	if (pthread_create(&ioThread, 0L, ioThreadFunction, this) != 0) {
+		std::cerr << "WARNING: Could not create the I/O thread, writing output synchronously" << std::endl;
+		asynchronous = false;
+	}
+}
+
+/**
+ * Writes the remaining time steps and terminates the I/O thread
+ */
+io::AsyncWriter::~AsyncWriter()
+{
+	if (asynchronous) {
+		pthread_mutex_lock(&mutex);
+		finished = true;
+		pthread_cond_signal(&bufferQueued);
+		pthread_mutex_unlock(&mutex);
+
+		pthread_join(ioThread, 0L);
+	}
+
+	pthread_cond_destroy(&bufferWritten);
+	pthread_cond_destroy(&bufferQueued);
+	pthread_mutex_destroy(&mutex);
+
+	for (int i = 0; i < NUMBER_OF_BUFFERS; i++) {
+		delete buffers[i].h;
+		delete buffers[i].hu;
+		delete buffers[i].hv;
+	}
+}
+
+/**
+ * Copies the unknowns into a staging buffer and queues the buffer for the I/O thread.
+ * Blocks if all staging buffers are queued.
+ *
+ * @param i_h water heights at a given time step.
+ * @param i_hu momentums in x-direction at a given time step.
+ * @param i_hv momentums in y-direction at a given time step.
+ * @param i_time simulation time of the time step.
+ */
+void io::AsyncWriter::writeTimeStep( const Float2D &i_h,
+                                     const Float2D &i_hu,
+                                     const Float2D &i_hv,
+                                     float i_time)
+{
+	if (!asynchronous) {
+		double l_start = currentTime();
+		writer.writeTimeStep(i_h, i_hu, i_hv, i_time);
+		writeTime += currentTime() - l_start;
+		waitTime += currentTime() - l_start;
+		timeStep++;
+		return;
+	}
+
+	// back-pressure: wait for a free staging buffer
+	double l_start = currentTime();
+	pthread_mutex_lock(&mutex);
+	while (queuedBuffers == NUMBER_OF_BUFFERS)
+		pthread_cond_wait(&bufferWritten, &mutex);
+	int l_buffer = (firstQueuedBuffer + queuedBuffers) % NUMBER_OF_BUFFERS;
+	pthread_mutex_unlock(&mutex);
+	waitTime += currentTime() - l_start;
+
+	// the free buffer is not accessed by the I/O thread
+	l_start = currentTime();
+	copyToStagingBuffer(i_h, buffers[l_buffer].h);
+	copyToStagingBuffer(i_hu, buffers[l_buffer].hu);
+	copyToStagingBuffer(i_hv, buffers[l_buffer].hv);
+	buffers[l_buffer].time = i_time;
+	copyTime += currentTime() - l_start;
+
+	pthread_mutex_lock(&mutex);
+	queuedBuffers++;
+	pthread_cond_signal(&bufferQueued);
+	pthread_mutex_unlock(&mutex);
+
+	timeStep++;
+}
+
+/**
+ * Blocks until the I/O thread has written all queued time steps
+ */
+void io::AsyncWriter::flush()
+{
+	if (!asynchronous)
+		return;
+
+	double l_start = currentTime();
+	pthread_mutex_lock(&mutex);
+	while (queuedBuffers > 0)
+		pthread_cond_wait(&bufferWritten, &mutex);
+	pthread_mutex_unlock(&mutex);
+	waitTime += currentTime() - l_start;
+}
+
+/**
+ * Copies the interior and the ghost cells of a Float2D into a staging buffer
+ *
+ * @param i_src the unknowns
+ * @param io_dest the staging buffer, allocated if necessary
+ */
+void io::AsyncWriter::copyToStagingBuffer(const Float2D &i_src, Float2D* &io_dest)
+{
+	if (io_dest == 0L)
+		io_dest = new Float2D(i_src.getCols(), i_src.getRows());
+	assert(io_dest->getCols() == i_src.getCols() && io_dest->getRows() == i_src.getRows());
+
+	for (int i = 0; i < i_src.getCols(); i++)
+		std::copy(i_src[i], i_src[i] + i_src.getRows(), (*io_dest)[i]);
+}
+
+/**
+ * Main loop of the I/O thread: passes the queued buffers to the wrapped writer
+ */
+void io::AsyncWriter::writeBuffers()
+{
+	pthread_mutex_lock(&mutex);
+	while (true) {
+		while (queuedBuffers == 0 && !finished)
+			pthread_cond_wait(&bufferQueued, &mutex);
+		if (queuedBuffers == 0)
+			break;
+
+		StagingBuffer &l_buffer = buffers[firstQueuedBuffer];
+		pthread_mutex_unlock(&mutex);
+
+		double l_start = currentTime();
+		writer.writeTimeStep(*l_buffer.h, *l_buffer.hu, *l_buffer.hv, l_buffer.time);
+		double l_time = currentTime() - l_start;
+
+		pthread_mutex_lock(&mutex);
+		writeTime += l_time;
+		firstQueuedBuffer = (firstQueuedBuffer + 1) % NUMBER_OF_BUFFERS;
+		queuedBuffers--;
+		pthread_cond_signal(&bufferWritten);
+	}
+	pthread_mutex_unlock(&mutex);
+}
+
+void* io::AsyncWriter::ioThreadFunction(void* i_asyncWriter)
+{
+	static_cast<io::AsyncWriter*>(i_asyncWriter)->writeBuffers();
+	return 0L;
+}
+
+/**
+ * @return Wall clock time in seconds
+ */
+double io::AsyncWriter::currentTime()
+{
+	timespec l_time;
+	clock_gettime(CLOCK_MONOTONIC, &l_time);
+	return l_time.tv_sec + l_time.tv_nsec * 1e-9;
+}
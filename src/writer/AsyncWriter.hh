@@ -0,0 +1,140 @@
+/**
+ * @file
+ * This file is part of SWE.
+ *
+ * @section LICENSE
+ *
+ * SWE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * SWE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SWE.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * @section DESCRIPTION
+ *
+ * Writes the time steps of another writer in a background thread
+ */
+
+#ifndef ASYNCWRITER_HH_
+#define ASYNCWRITER_HH_
+
+#include <algorithm>
+#include <pthread.h>
+
+#include "writer/Writer.hh"
+
+namespace io {
+	class AsyncWriter;
+}
+
+/**
+ * Decorator for a writer, which writes the time steps in a separate I/O thread
+ *
+ * writeTimeStep only copies the unknowns into a staging buffer and returns.
+ * The I/O thread passes the buffer to the wrapped writer, i.e. the coarsening
+ * and the file I/O of the wrapped writer overlap with the simulation.
+ *
+ * There are two staging buffers (double buffering). If both buffers are still
+ * queued, writeTimeStep blocks until the I/O thread finished one of them.
+ *
+ * The wrapped writer must not be used directly while the AsyncWriter exists
+ * and has to outlive the AsyncWriter.
+ */
+class io::AsyncWriter : public io::Writer
+{
+private:
+	/** A snapshot of the unknowns */
+	struct StagingBuffer {
+		Float2D *h, *hu, *hv;
+		float time;
+	};
+
+	/** Number of staging buffers */
+	static const int NUMBER_OF_BUFFERS = 2;
+
+	//! The writer that does the actual output
+	io::Writer &writer;
+
+	//! The staging buffers (allocated with the first time step)
+	StagingBuffer buffers[NUMBER_OF_BUFFERS];
+
+	//! Next buffer written by the I/O thread
+	int firstQueuedBuffer;
+
+	//! Number of buffers waiting for the I/O thread
+	int queuedBuffers;
+
+	//! True if the I/O thread should terminate
+	bool finished;
+
+	//! False if the I/O thread could not be created (synchronous output)
+	bool asynchronous;
+
+	pthread_t ioThread;
+	pthread_mutex_t mutex;
+	//! Signaled when a buffer is queued or the writer is finished
+	pthread_cond_t bufferQueued;
+	//! Signaled when the I/O thread finished a buffer
+	pthread_cond_t bufferWritten;
+
+	//! Time spent in the wrapped writer (I/O thread)
+	double writeTime;
+
+	//! Time spent to copy the unknowns into the staging buffers
+	double copyTime;
+
+	//! Time the simulation waited for the I/O thread
+	double waitTime;
+
+	void copyToStagingBuffer(const Float2D &i_src, Float2D* &io_dest);
+
+	void writeBuffers();
+
+	static void* ioThreadFunction(void* i_asyncWriter);
+
+	static double currentTime();
+
+public:
+	AsyncWriter(io::Writer &i_writer);
+	virtual ~AsyncWriter();
+
+	// queues the unknowns at a given time step for the I/O thread
+	void writeTimeStep( const Float2D &i_h,
+	                    const Float2D &i_hu,
+	                    const Float2D &i_hv,
+	                    float i_time);
+
+	// waits until all queued time steps are written
+	void flush();
+
+	/**
+	 * @return Total time (in seconds) the I/O thread spent in the wrapped writer
+	 */
+	double getWriteTime() const { return writeTime; }
+
+	/**
+	 * @return Total time (in seconds) the simulation spent in writeTimeStep and flush
+	 *  (copying the unknowns and waiting for the I/O thread)
+	 */
+	double getBlockingTime() const { return copyTime + waitTime; }
+
+	/**
+	 * @return Total time (in seconds) the simulation waited for the I/O thread
+	 */
+	double getWaitTime() const { return waitTime; }
+
+	/**
+	 * @return Time (in seconds) of the wrapped writer that overlapped with the simulation
+	 */
+	double getHiddenTime() const { return std::max(writeTime - waitTime, 0.); }
+};
+
+#endif // ASYNCWRITER_HH_
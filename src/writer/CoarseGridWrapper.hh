@@ -1,8 +1,10 @@
 #ifndef __COARSEGRIDWRAPPER_HH
 #define __COARSEGRIDWRAPPER_HH
 
+#include <algorithm>
 #include <cmath>
 #include <cassert>
+#include <vector>
 #include "writer/BoundarySize.hh"
 #include "tools/help.hh"
 
@@ -41,6 +43,59 @@ class io::CoarseGridWrapper {
         //! step width of coarse grid in y direction
         /** A stepwidth of n means that a single coarse cell contains n refined cells in that direction */
         float stepWidthY;
+
+        /// Compute the weights of the refined cells along one axis
+        /**
+         * The weight of a refined cell is the fraction of the cell that belongs
+         * to the coarse cell. The weight of a refined cell (x,y) in getElem is the
+         * product of the weights along both axes.
+         *
+         * @param i_coarse Number of coarse cells along the axis
+         * @param i_stepWidth Step width of the coarse grid along the axis
+         * @param o_first Index of the first entry of each coarse cell (and the total number of entries)
+         * @param o_index Refined cell of each entry
+         * @param o_weight Weight of each entry
+         * @param o_sum Sum of the weights of each coarse cell
+         */
+        static void computeWeights( unsigned int i_coarse, float i_stepWidth,
+                                    std::vector<unsigned int> &o_first,
+                                    std::vector<unsigned int> &o_index,
+                                    std::vector<float> &o_weight,
+                                    std::vector<float> &o_sum ) {
+            o_first.resize(i_coarse+1);
+            o_index.clear();
+            o_weight.clear();
+            o_sum.assign(i_coarse, 0.f);
+
+            for(unsigned int c = 0; c < i_coarse; c++) {
+                // same bounds and fractions as in getElem
+                float lower = float(c) * i_stepWidth;
+                float upper = float(c+1) * i_stepWidth;
+
+                unsigned int lowerIndex = static_cast <unsigned int> (std::floor(lower));
+                unsigned int upperIndex = static_cast <unsigned int> (std::ceil(upper));
+
+                float lowerFraction = 1.f - (lower - float(lowerIndex));
+                float upperFraction = 1.f - (float(upperIndex) - upper);
+
+                o_first[c] = o_index.size();
+                for(unsigned int i = lowerIndex; i < upperIndex; i++) {
+                    float fraction = 1.f;
+                    if(i == lowerIndex) fraction *= lowerFraction;
+                    if(i == upperIndex-1) fraction *= upperFraction;
+
+                    o_index.push_back(i);
+                    o_weight.push_back(fraction);
+                    o_sum[c] += fraction;
+                }
+            }
+            o_first[i_coarse] = o_index.size();
+        }
+
+        /// @return The integer step width of the coarse grid along one axis or 0 if it is not an integer
+        static unsigned int integerStepWidth(unsigned int i_refined, unsigned int i_coarse) {
+            return (i_refined % i_coarse == 0) ? i_refined / i_coarse : 0;
+        }
     public:
         /**
          * Constructor
@@ -154,6 +209,90 @@ class io::CoarseGridWrapper {
             return (value / area);
         }
     
+        /// Read the values of all coarse cells
+        /**
+         * Computes the same weighted averages as getElem for the whole coarse grid
+         * in a single pass over the refined grid. The weights are separable, so
+         * each refined column is first reduced in y-direction (contiguous reads)
+         * and then added to the coarse columns it belongs to. If the step widths
+         * are integers, all weights are 1 and the reduction is a plain sum.
+         *
+         * The results match getElem up to the rounding errors of the different
+         * summation order.
+         *
+         * @param o_values Values of the coarse cells, row by row
+         *  (o_values[y*getCols() + x] is the coarse cell (x,y)),
+         *  at least getCols()*getRows() elements
+         */
+        void getAllElems(float *o_values) {
+            const unsigned int factorX = integerStepWidth(refinedX, coarseX);
+            const unsigned int factorY = integerStepWidth(refinedY, coarseY);
+
+            // separable weight tables (not required for integer step widths)
+            std::vector<unsigned int> firstX, indexX, firstY, indexY;
+            std::vector<float> weightX, sumX, weightY, sumY;
+            if(factorX == 0 || factorY == 0) {
+                computeWeights(coarseX, stepWidthX, firstX, indexX, weightX, sumX);
+                computeWeights(coarseY, stepWidthY, firstY, indexY, weightY, sumY);
+            }
+
+            // reduced values of a block of coarse columns, the block is transposed
+            // at once to write whole cache lines of o_values
+            const unsigned int blockSize = 16;
+            std::vector<float> block(blockSize * coarseY);
+
+            for(unsigned int blockX = 0; blockX < coarseX; blockX += blockSize) {
+                const unsigned int blockEnd = std::min(blockX + blockSize, coarseX);
+                block.assign(block.size(), 0.f);
+
+                for(unsigned int x = blockX; x < blockEnd; x++) {
+                    float *column = &block[(x-blockX) * coarseY];
+
+                    if(factorX > 0 && factorY > 0) {
+                        // integer step widths (e.g. coarseness-factor of 1 or 2), all weights are 1
+                        for(unsigned int i = x*factorX; i < (x+1)*factorX; i++) {
+                            const float *refinedColumn = &grid[i + boundarySize[0]][boundarySize[2]];
+
+                            if(factorY == 1) {
+                                for(unsigned int y = 0; y < coarseY; y++)
+                                    column[y] += refinedColumn[y];
+                            } else {
+                                for(unsigned int y = 0; y < coarseY; y++) {
+                                    float sum = 0.f;
+                                    for(unsigned int j = y*factorY; j < (y+1)*factorY; j++)
+                                        sum += refinedColumn[j];
+                                    column[y] += sum;
+                                }
+                            }
+                        }
+
+                        const float area = float(factorX * factorY);
+                        for(unsigned int y = 0; y < coarseY; y++)
+                            column[y] /= area;
+                    } else {
+                        for(unsigned int e = firstX[x]; e < firstX[x+1]; e++) {
+                            const float *refinedColumn = &grid[indexX[e] + boundarySize[0]][boundarySize[2]];
+
+                            for(unsigned int y = 0; y < coarseY; y++) {
+                                float sum = 0.f;
+                                for(unsigned int f = firstY[y]; f < firstY[y+1]; f++)
+                                    sum += weightY[f] * refinedColumn[indexY[f]];
+                                column[y] += weightX[e] * sum;
+                            }
+                        }
+
+                        for(unsigned int y = 0; y < coarseY; y++)
+                            column[y] /= sumX[x] * sumY[y];
+                    }
+                }
+
+                for(unsigned int y = 0; y < coarseY; y++) {
+                    for(unsigned int x = blockX; x < blockEnd; x++)
+                        o_values[y*coarseX + x] = block[(x-blockX) * coarseY + y];
+                }
+            }
+        }
+
         /**
          * @return The number of rows in the coarse grid
          */
@@ -31,6 +31,43 @@
 #include <vector>
 #include <iostream>
 #include <cassert>
+#include <cmath>
+#include <algorithm>
+#include <sstream>
+
+/**
+ * Default tile size of incremental output.
+ */
+static const size_t DEFAULT_TILE_SIZE = 32;
+
+/**
+ * Rounds the mantissa of floating point values to a number of bits.
+ * The dropped bits are zero, which improves the compression.
+ *
+ * @param io_values values which are rounded.
+ * @param i_mantissaBits number of mantissa bits to keep (1-23).
+ */
+static void roundMantissa( std::vector<float> &io_values, int i_mantissaBits ) {
+	int l_droppedBits = 23 - i_mantissaBits;
+	if (l_droppedBits <= 0)
+		return;
+
+	unsigned int l_half = 1u << (l_droppedBits-1);
+	unsigned int l_mask = ~((1u << l_droppedBits) - 1);
+
+	for(size_t i = 0; i < io_values.size(); i++) {
+		unsigned int l_bits;
+		memcpy(&l_bits, &io_values[i], sizeof(float));
+
+		// keep infinity and NaN
+		if ((l_bits & 0x7f800000u) == 0x7f800000u)
+			continue;
+
+		// round to nearest (a carry into the exponent is correct)
+		l_bits = (l_bits + l_half) & l_mask;
+		memcpy(&io_values[i], &l_bits, sizeof(float));
+	}
+}
 
 
 /**
@@ -49,7 +86,13 @@
  * @param i_originY
  * @param i_coarseness The coarseness factor
  * @param i_flush If > 0, flush data to disk every i_flush write operation
+ * @param i_options Chunking, compression and precision of a new file
+ *   and the communicator for collective output
  * @param i_dynamicBathymetry
+ *
+ * With a communicator in i_options (MPI only), the constructor is collective:
+ * all processes open the same file and write their block as a hyperslab of
+ * the global grid. i_originX and i_originY are the origin of the local block.
  */
 io::NetCdfWriter::NetCdfWriter( const std::string &i_baseName,
 		const Float2D &i_b,
@@ -58,10 +101,24 @@ io::NetCdfWriter::NetCdfWriter( const std::string &i_baseName,
 		float i_dX, float i_dY,
 		float i_originX, float i_originY,
 		float i_coarseness,
-        unsigned int i_flush) :
+        unsigned int i_flush,
+        const NetCdfOptions &i_options) :
 		//const bool  &i_dynamicBathymetry) : //!TODO
   io::Writer(i_baseName + ".nc", i_b, i_boundarySize, i_nX, i_nY, i_coarseness),
-  flush(i_flush)
+  flush(i_flush),
+  offsetX(0), offsetY(0),
+  globalX(coarseX), globalY(coarseY),
+  defaultChunkX(coarseX), defaultChunkY(coarseY),
+  writesTime(true),
+  keyframeVar(-1),
+  keyframeInterval(0),
+  keyframeTolerance(0.f),
+  keyframe(0),
+  tileX(0), tileY(0),
+  slab(coarseX * coarseY),
+  precision(NetCdfOptions::FLOAT),
+  mantissaBits(23),
+  saturatedValues(0)
 {
 	int status;
     
@@ -70,8 +127,19 @@ io::NetCdfWriter::NetCdfWriter( const std::string &i_baseName,
     
 	// dimensions
 	int l_timeDim, l_xDim, l_yDim;
+
+#ifdef NETCDF_COLLECTIVE
+	const bool l_collective = (i_options.communicator != MPI_COMM_NULL);
+	if (l_collective)
+		computeGlobalGrid(i_options);
+#endif
     
     // Try to open the file (to see if it is an existing checkpoint file)
+#ifdef NETCDF_COLLECTIVE
+    if (l_collective)
+        status = openParallel(i_options, false);
+    else
+#endif
     status = nc_open(fileName.c_str(), NC_WRITE, &dataFile);
     
     if(status == NC_NOERR) {
@@ -95,16 +163,51 @@ io::NetCdfWriter::NetCdfWriter( const std::string &i_baseName,
         
         // Set next timeStep
         status = nc_inq_dimlen(dataFile, l_timeDim, &timeStep);
+
+        // Continue with the precision of the file
+        nc_type l_type;
+        status = nc_inq_vartype(dataFile, hVar, &l_type);
+        if (l_type == NC_SHORT)
+            precision = NetCdfOptions::FIXED_POINT;
+        else if (nc_get_att_int(dataFile, hVar, "mantissa_bits", &mantissaBits) == NC_NOERR)
+            precision = NetCdfOptions::ROUNDED_FLOAT;
+
+        // Continue incremental output (the next time step is a keyframe)
+        if (nc_inq_varid(dataFile, "keyframe", &keyframeVar) == NC_NOERR) {
+            int l_interval = 0;
+            nc_get_att_int(dataFile, keyframeVar, "keyframe_interval", &l_interval);
+            keyframeInterval = l_interval;
+            nc_get_att_float(dataFile, keyframeVar, "tolerance", &keyframeTolerance);
+
+            int l_storage;
+            size_t l_chunks[3];
+            nc_inq_var_chunking(dataFile, hVar, &l_storage, l_chunks);
+            tileY = l_chunks[1];
+            tileX = l_chunks[2];
+#ifdef NETCDF_COLLECTIVE
+            // write only keyframes
+            if (l_collective)
+                keyframeInterval = 1;
+#endif
+        } else {
+            keyframeVar = -1;
+        }
         
         // Check actual dimensions in file against supplied dimensions
-        assert(l_xLen == coarseX); assert(l_yLen == coarseY);
+        assert(l_xLen == globalX); assert(l_yLen == globalY);
     } else {
         // File does not exist or is not a valid NetCDF file
     	//create a netCDF-file, an existing file will be replaced
+#ifdef NETCDF_COLLECTIVE
+    	if (l_collective)
+    		status = openParallel(i_options, true);
+    	else
+#endif
     	status = nc_create(fileName.c_str(), NC_NETCDF4, &dataFile);
 
         //check if the netCDF-file creation constructor succeeded.
     	if (status != NC_NOERR) {
+    		std::cerr << "Could not create " << fileName << ": " << nc_strerror(status) << std::endl;
     		assert(false);
     		return;
     	}
@@ -114,14 +217,16 @@ io::NetCdfWriter::NetCdfWriter( const std::string &i_baseName,
     	std::cout << "     created/replaced: " << fileName << std::endl;
     	std::cout << "     internal dimensions(nx, ny): " << nX << ", " << nY << std::endl;
         std::cout << "     dimensions(nx, ny): " << coarseX << ", " << coarseY << std::endl;
+        std::cout << "     global dimensions(nx, ny): " << globalX << ", " << globalY << std::endl;
+        std::cout << "     offset(x, y): " << offsetX << ", " << offsetY << std::endl;
         std::cout << "     coarseness: " << coarseness << std::endl;
     	std::cout << "     cell width(dx,dy): " << i_dX << ", " << i_dY << std::endl;
     	std::cout << "     origin(x,y): " << i_originX << ", " << i_originY << std::endl;
 #endif
 
     	nc_def_dim(dataFile, "time", NC_UNLIMITED, &l_timeDim);
-    	nc_def_dim(dataFile, "x", coarseX, &l_xDim);
-    	nc_def_dim(dataFile, "y", coarseY, &l_yDim);
+    	nc_def_dim(dataFile, "x", globalX, &l_xDim);
+    	nc_def_dim(dataFile, "y", globalY, &l_yDim);
 
     	nc_def_var(dataFile, "time", NC_FLOAT, 1, &l_timeDim, &timeVar);
     	ncPutAttText(timeVar, "long_name", "Time");
@@ -129,13 +234,42 @@ io::NetCdfWriter::NetCdfWriter( const std::string &i_baseName,
     	nc_def_var(dataFile, "x", NC_FLOAT, 1, &l_xDim, &l_xVar);
     	nc_def_var(dataFile, "y", NC_FLOAT, 1, &l_yDim, &l_yVar);
 
+    	precision = i_options.precision;
+    	mantissaBits = std::min(std::max(i_options.mantissaBits, 1), 23);
+    	nc_type l_type = (precision == NetCdfOptions::FIXED_POINT) ? NC_SHORT : NC_FLOAT;
+
+    	//incremental output
+    	keyframeInterval = i_options.keyframeInterval;
+#ifdef NETCDF_COLLECTIVE
+    	if (l_collective && keyframeInterval > 1) {
+    		std::cerr << "WARNING: Incremental output is not supported by collective netCDF writers" << std::endl;
+    		keyframeInterval = 0;
+    	}
+#endif
+    	if (keyframeInterval > 1) {
+    		keyframeTolerance = i_options.keyframeTolerance;
+    		tileX = std::min<size_t>((i_options.chunkX > 0) ? i_options.chunkX : DEFAULT_TILE_SIZE, globalX);
+    		tileY = std::min<size_t>((i_options.chunkY > 0) ? i_options.chunkY : DEFAULT_TILE_SIZE, globalY);
+
+    		int l_interval = keyframeInterval;
+    		nc_def_var(dataFile, "keyframe", NC_INT, 1, &l_timeDim, &keyframeVar);
+    		ncPutAttText(keyframeVar, "long_name", "Time step of the last full time step");
+    		nc_put_att_int(dataFile, keyframeVar, "keyframe_interval", NC_INT, 1, &l_interval);
+    		nc_put_att_float(dataFile, keyframeVar, "tolerance", NC_FLOAT, 1, &keyframeTolerance);
+    	}
+
     	//variables, fastest changing index is on the right (C syntax), will be mirrored by the library
     	int dims[] = {l_timeDim, l_yDim, l_xDim};
-    	nc_def_var(dataFile, "h",  NC_FLOAT, 3, dims, &hVar);
-    	nc_def_var(dataFile, "hu", NC_FLOAT, 3, dims, &huVar);
-    	nc_def_var(dataFile, "hv", NC_FLOAT, 3, dims, &hvVar);
+    	nc_def_var(dataFile, "h",  l_type, 3, dims, &hVar);
+    	nc_def_var(dataFile, "hu", l_type, 3, dims, &huVar);
+    	nc_def_var(dataFile, "hv", l_type, 3, dims, &hvVar);
     	nc_def_var(dataFile, "b",  NC_FLOAT, 2, &dims[1], &bVar);
 
+    	defineVarStorage(hVar,  i_options, true, i_options.heightResolution);
+    	defineVarStorage(huVar, i_options, true, i_options.dischargeResolution);
+    	defineVarStorage(hvVar, i_options, true, i_options.dischargeResolution);
+    	defineVarStorage(bVar,  i_options, false, 1.f);
+
     	//set attributes to match CF-1.5 convention
     	ncPutAttText(NC_GLOBAL, "Conventions", "CF-1.5");
     	ncPutAttText(NC_GLOBAL, "title", "Computed tsunami solution");
@@ -145,21 +279,36 @@ io::NetCdfWriter::NetCdfWriter( const std::string &i_baseName,
     	ncPutAttText(NC_GLOBAL, "references", "http://www5.in.tum.de/SWE");
     	ncPutAttText(NC_GLOBAL, "comment", "SWE is free software and licensed under the GNU General Public License. Remark: In general this does not hold for the used input data.");
 
-    	//setup grid size
+    	//setup grid size (the part of the local block)
+    	std::vector<float> l_positions(coarseX);
     	float gridPosition = i_originX + (float).5 * i_dX;
     	for(size_t i = 0; i < coarseX; i++) {
-    		nc_put_var1_float(dataFile, l_xVar, &i, &gridPosition);
+    		l_positions[i] = gridPosition;
 
     		gridPosition += i_dX;
     	}
+    	size_t l_count = coarseX;
+    	nc_put_vara_float(dataFile, l_xVar, &offsetX, &l_count, &l_positions[0]);
 
+    	l_positions.resize(coarseY);
     	gridPosition = i_originY + (float).5 * i_dY;
     	for(size_t j = 0; j < coarseY; j++) {
-    		nc_put_var1_float(dataFile, l_yVar, &j, &gridPosition);
+    		l_positions[j] = gridPosition;
 
         	gridPosition += i_dY;
     	}
+    	l_count = coarseY;
+    	nc_put_vara_float(dataFile, l_yVar, &offsetY, &l_count, &l_positions[0]);
     }
+
+#ifdef NETCDF_COLLECTIVE
+    if (l_collective) {
+    	// extending the time dimension and writing compressed chunks have to be collective
+    	int l_vars[] = {timeVar, hVar, huVar, hvVar, bVar, keyframeVar};
+    	for (int i = 0; i < 6 && l_vars[i] >= 0; i++)
+    		nc_var_par_access(dataFile, l_vars[i], NC_COLLECTIVE);
+    }
+#endif
 }
 
 /**
@@ -169,6 +318,196 @@ io::NetCdfWriter::~NetCdfWriter() {
 	nc_close(dataFile);
 }
 
+#ifdef NETCDF_COLLECTIVE
+/**
+ * Computes the offsets of the local block and the size of the global
+ * output grid from the coarse sizes of all blocks.
+ *
+ * @param i_options communicator and position of the block.
+ */
+void io::NetCdfWriter::computeGlobalGrid( const NetCdfOptions &i_options ) {
+	int l_rank, l_size;
+	MPI_Comm_rank(i_options.communicator, &l_rank);
+	MPI_Comm_size(i_options.communicator, &l_size);
+
+	// position and coarse size of all blocks
+	int l_block[] = {i_options.blockPositionX, i_options.blockPositionY, (int) coarseX, (int) coarseY};
+	std::vector<int> l_blocks(4 * l_size);
+	MPI_Allgather(l_block, 4, MPI_INT, &l_blocks[0], 4, MPI_INT, i_options.communicator);
+
+	offsetX = offsetY = globalX = globalY = 0;
+	for (int i = 0; i < l_size; i++) {
+		const int *l_other = &l_blocks[4*i];
+
+		// blocks in the same row
+		if (l_other[1] == l_block[1]) {
+			globalX += l_other[2];
+			if (l_other[0] < l_block[0])
+				offsetX += l_other[2];
+		}
+
+		// blocks in the same column
+		if (l_other[0] == l_block[0]) {
+			globalY += l_other[3];
+			if (l_other[1] < l_block[1])
+				offsetY += l_other[3];
+		}
+
+		// all processes have to define the same chunks
+		if (l_other[0] == 0 && l_other[1] == 0) {
+			defaultChunkX = l_other[2];
+			defaultChunkY = l_other[3];
+		}
+	}
+
+	writesTime = (l_rank == 0);
+}
+
+/**
+ * Creates or opens the file with parallel netCDF-4.
+ *
+ * @param i_options communicator and number of aggregators.
+ * @param i_create true to create the file, false to open an existing file.
+ * @return The netCDF status.
+ */
+int io::NetCdfWriter::openParallel( const NetCdfOptions &i_options, bool i_create ) {
+	MPI_Info l_info = MPI_INFO_NULL;
+	if (i_options.aggregators > 0) {
+		// collective buffering: only the aggregators access the file system
+		std::ostringstream l_aggregators;
+		l_aggregators << i_options.aggregators;
+
+		MPI_Info_create(&l_info);
+		MPI_Info_set(l_info, const_cast<char*>("cb_nodes"), const_cast<char*>(l_aggregators.str().c_str()));
+		MPI_Info_set(l_info, const_cast<char*>("romio_cb_write"), const_cast<char*>("enable"));
+	}
+
+	int l_status;
+	if (i_create)
+		l_status = nc_create_par(fileName.c_str(), NC_NETCDF4 | NC_MPIIO, i_options.communicator, l_info, &dataFile);
+	else
+		l_status = nc_open_par(fileName.c_str(), NC_WRITE | NC_MPIIO, i_options.communicator, l_info, &dataFile);
+
+	if (l_info != MPI_INFO_NULL)
+		MPI_Info_free(&l_info);
+
+	return l_status;
+}
+#endif
+
+/**
+ * Defines chunking, compression and precision of a new variable.
+ *
+ * By default, there is one chunk per variable, time step and block, which
+ * matches the hyperslabs written by writeTimeStep. With incremental output,
+ * the chunks of h, hu and hv are the tiles.
+ *
+ * @param i_ncVariable netCDF-variable (must be in define mode).
+ * @param i_options storage options.
+ * @param i_lossy true if the precision option applies to the variable.
+ * @param i_resolution resolution of the variable for FIXED_POINT.
+ */
+void io::NetCdfWriter::defineVarStorage( int i_ncVariable,
+                                         const NetCdfOptions &i_options,
+                                         bool i_lossy,
+                                         float i_resolution ) {
+	size_t chunks[] = {1,
+		(i_options.chunkY > 0) ? std::min<size_t>(i_options.chunkY, globalY) : defaultChunkY,
+		(i_options.chunkX > 0) ? std::min<size_t>(i_options.chunkX, globalX) : defaultChunkX};
+	if (keyframeVar >= 0 && i_ncVariable != bVar) {
+		chunks[1] = tileY;
+		chunks[2] = tileX;
+	}
+	//the bathymetry has no time dimension
+	nc_def_var_chunking(dataFile, i_ncVariable, NC_CHUNKED, (i_ncVariable == bVar) ? &chunks[1] : chunks);
+
+	if (i_options.deflateLevel > 0 || i_options.shuffle)
+		nc_def_var_deflate(dataFile, i_ncVariable, i_options.shuffle,
+			i_options.deflateLevel > 0, i_options.deflateLevel);
+
+	if (!i_lossy)
+		return;
+
+	if (precision == NetCdfOptions::FIXED_POINT) {
+		//CF convention for packed data: value = stored value * scale_factor + add_offset
+		float l_offset = 0.f;
+		nc_put_att_float(dataFile, i_ncVariable, "scale_factor", NC_FLOAT, 1, &i_resolution);
+		nc_put_att_float(dataFile, i_ncVariable, "add_offset", NC_FLOAT, 1, &l_offset);
+	} else if (precision == NetCdfOptions::ROUNDED_FLOAT) {
+		nc_put_att_int(dataFile, i_ncVariable, "mantissa_bits", NC_INT, 1, &mantissaBits);
+	}
+}
+
+/**
+ * Copies the coarse output of a variable into the staging buffer.
+ *
+ * Float2D is stored column-wise, whereas x is the fastest changing
+ * dimension in the netCDF-file. Therefore the data is transposed.
+ *
+ * @param i_matrix array which contains the data.
+ */
+void io::NetCdfWriter::fillSlab( const Float2D &i_matrix ) {
+	// Create a grid wrapper for coarse output
+	CoarseGridWrapper gridWrapper(i_matrix, boundarySize, nX, nY, coarseness);
+	gridWrapper.getAllElems(&slab[0]);
+}
+
+/**
+ * Writes a hyperslab of a time dependent variable with the precision of the file.
+ *
+ * @param i_ncVariable time dependent netCDF-variable.
+ * @param i_start first index of the hyperslab (time, y, x).
+ * @param i_count size of the hyperslab (time, y, x).
+ * @param io_values values of the hyperslab, row by row (ROUNDED_FLOAT rounds them in place).
+ */
+void io::NetCdfWriter::putVarTimeDependent( int i_ncVariable,
+                                            const size_t *i_start,
+                                            const size_t *i_count,
+                                            std::vector<float> &io_values ) {
+	switch (precision) {
+	case NetCdfOptions::FIXED_POINT: {
+		float l_scale = 1.f, l_offset = 0.f;
+		nc_get_att_float(dataFile, i_ncVariable, "scale_factor", &l_scale);
+		nc_get_att_float(dataFile, i_ncVariable, "add_offset", &l_offset);
+
+		//values outside of the range are clipped
+		//(the fill value -32767 marks unchanged tiles of incremental output)
+		const float l_min = (keyframeVar >= 0) ? -32766.f : -32767.f;
+		size_t l_saturated = 0;
+		fixedPointSlab.resize(io_values.size());
+		for(size_t i = 0; i < io_values.size(); i++) {
+			float l_value = std::floor((io_values[i] - l_offset) / l_scale + .5f);
+			if (!(l_value >= l_min && l_value <= 32767.f)) {
+				l_saturated++;
+				//NaN is stored as zero
+				l_value = (l_value > 0.f) ? 32767.f : ((l_value < 0.f) ? l_min : 0.f);
+			}
+			fixedPointSlab[i] = static_cast<short>(l_value);
+		}
+
+		saturatedValues += l_saturated;
+		if (l_saturated > 0
+			&& std::find(saturatedVars.begin(), saturatedVars.end(), i_ncVariable) == saturatedVars.end()) {
+			saturatedVars.push_back(i_ncVariable);
+			char l_name[NC_MAX_NAME+1];
+			nc_inq_varname(dataFile, i_ncVariable, l_name);
+			std::cerr << "WARNING: " << l_saturated << " values of " << l_name << " in " << fileName
+				<< " are outside of the fixed point range [" << l_min * l_scale + l_offset
+				<< ", " << 32767.f * l_scale + l_offset << "] and were clipped"
+				<< " (use a coarser resolution)" << std::endl;
+		}
+
+		nc_put_vara_short(dataFile, i_ncVariable, i_start, i_count, &fixedPointSlab[0]);
+		break;
+	}
+	case NetCdfOptions::ROUNDED_FLOAT:
+		roundMantissa(io_values, mantissaBits);
+		//fall through
+	default:
+		nc_put_vara_float(dataFile, i_ncVariable, i_start, i_count, &io_values[0]);
+	}
+}
+
 /**
  * Writes time dependent data to a netCDF-file (-> constructor) with respect to the boundary sizes.
  *
@@ -178,30 +517,71 @@ io::NetCdfWriter::~NetCdfWriter() {
  * boundarySize[3] == top
  *
  * @param i_matrix array which contains time dependent data.
- * @param i_boundarySize size of the boundaries.
  * @param i_ncVariable time dependent netCDF-variable to which the output is written to.
+ * @param io_keyframe values of the variable at the last keyframe (updated for keyframes).
+ * @param i_isKeyframe true if the whole time step is written.
  */
 void io::NetCdfWriter::writeVarTimeDependent( const Float2D &i_matrix,
-                                              int i_ncVariable ) {
+                                              int i_ncVariable,
+                                              std::vector<float> &io_keyframe,
+                                              bool i_isKeyframe ) {
+	fillSlab(i_matrix);
 
-	// Create a grid wrapper for coarse output
-	CoarseGridWrapper gridWrapper(i_matrix, boundarySize, nX, nY, coarseness);
-	
-    // convert column-by-column to coarse output and write to disk
-    float column[coarseY];
+	if (!i_isKeyframe) {
+		writeChangedTiles(i_ncVariable, io_keyframe);
+		return;
+	}
+
+	//keep the keyframe for the following incremental time steps
+	if (keyframeVar >= 0)
+		io_keyframe = slab;
 
-	//write col wise, necessary to get rid of the boundary
-	//storage in Float2D is col wise
+	//write the whole time step at once
 	//read carefully, the dimensions are confusing
-	size_t start[] = {timeStep, 0, 0};
-	size_t count[] = {1, coarseY, 1};
-	for(unsigned int col = 0; col < coarseX; col++) {
-        for(unsigned int row = 0; row < coarseY; row++)
-            column[row] = gridWrapper.getElem(col, row);
-        
-		start[2] = col; //select col (dim "x")
-		nc_put_vara_float(dataFile, i_ncVariable, start, count, column); //write col
-  }
+	size_t start[] = {timeStep, offsetY, offsetX};
+	size_t count[] = {1, coarseY, coarseX};
+	putVarTimeDependent(i_ncVariable, start, count, slab);
+}
+
+/**
+ * Writes the tiles of the staging buffer which changed by more than
+ * the tolerance since the keyframe.
+ *
+ * The other tiles are not written, i.e. their chunks are never allocated.
+ *
+ * @param i_ncVariable time dependent netCDF-variable to which the output is written to.
+ * @param i_keyframe values of the variable at the last keyframe.
+ */
+void io::NetCdfWriter::writeChangedTiles( int i_ncVariable,
+                                          const std::vector<float> &i_keyframe ) {
+	for(size_t l_y = 0; l_y < coarseY; l_y += tileY) {
+		for(size_t l_x = 0; l_x < coarseX; l_x += tileX) {
+			size_t start[] = {timeStep, offsetY + l_y, offsetX + l_x};
+			size_t count[] = {1, std::min<size_t>(tileY, coarseY - l_y), std::min<size_t>(tileX, coarseX - l_x)};
+
+			bool l_changed = false;
+			for(size_t j = 0; j < count[1] && !l_changed; j++) {
+				const size_t l_row = (l_y + j) * coarseX + l_x;
+				for(size_t i = 0; i < count[2]; i++) {
+					//also true for NaN
+					if (!(std::abs(slab[l_row + i] - i_keyframe[l_row + i]) <= keyframeTolerance)) {
+						l_changed = true;
+						break;
+					}
+				}
+			}
+
+			if (!l_changed)
+				continue;
+
+			tile.resize(count[1] * count[2]);
+			for(size_t j = 0; j < count[1]; j++) {
+				const size_t l_row = (l_y + j) * coarseX + l_x;
+				std::copy(&slab[l_row], &slab[l_row] + count[2], &tile[j * count[2]]);
+			}
+			putVarTimeDependent(i_ncVariable, start, count, tile);
+		}
+	}
 }
 
 /**
@@ -218,24 +598,13 @@ void io::NetCdfWriter::writeVarTimeDependent( const Float2D &i_matrix,
  */
 void io::NetCdfWriter::writeVarTimeIndependent( const Float2D &i_matrix,
                                                 int i_ncVariable ) {
+	fillSlab(i_matrix);
 
-	// Create a grid wrapper for coarse output
-	CoarseGridWrapper gridWrapper(i_matrix, boundarySize, nX, nY, coarseness);
-
-    // convert column-by-column to coarse output and write to disk
-    float column[coarseY];
-    
-	//write col wise, necessary to get rid of the boundary
-	//storage in Float2D is col wise
+	//write the whole variable at once
 	//read carefully, the dimensions are confusing
-	size_t start[] = {0, 0};
-	size_t count[] = {coarseY, 1};
-	for(unsigned int col = 0; col < coarseX; col++) {
-        for(unsigned int row = 0; row < coarseY; row++)
-            column[row] = gridWrapper.getElem(col, row);
-		start[1] = col; //select col (dim "x")
-		nc_put_vara_float(dataFile, i_ncVariable, start, count, column); //write col
-  }
+	size_t start[] = {offsetY, offsetX};
+	size_t count[] = {coarseY, coarseX};
+	nc_put_vara_float(dataFile, i_ncVariable, start, count, &slab[0]);
 }
 
 /**
@@ -256,21 +625,33 @@ void io::NetCdfWriter::writeTimeStep( const Float2D &i_h,
                                       const Float2D &i_hu,
                                       const Float2D &i_hv, 
                                       float i_time) {
+	//incremental output: a full time step every keyframeInterval time steps
+	bool l_isKeyframe = (keyframeVar < 0) || hKeyframe.empty()
+		|| timeStep >= keyframe + std::max(keyframeInterval, 1u);
+	if (l_isKeyframe)
+		keyframe = timeStep;
+
 	if (timeStep == 0)
 		// Write bathymetry
 		writeVarTimeIndependent(b, bVar);
 		
-	//write i_time
-	nc_put_var1_float(dataFile, timeVar, &timeStep, &i_time);
+	//write i_time (collective writers: only the first process)
+	size_t l_timeCount = writesTime ? 1 : 0;
+	nc_put_vara_float(dataFile, timeVar, &timeStep, &l_timeCount, &i_time);
+
+	if (keyframeVar >= 0) {
+		int l_keyframe = keyframe;
+		nc_put_vara_int(dataFile, keyframeVar, &timeStep, &l_timeCount, &l_keyframe);
+	}
 
 	//write water height
-	writeVarTimeDependent(i_h, hVar);
+	writeVarTimeDependent(i_h, hVar, hKeyframe, l_isKeyframe);
 
 	//write momentum in x-direction
-	writeVarTimeDependent(i_hu, huVar);
+	writeVarTimeDependent(i_hu, huVar, huKeyframe, l_isKeyframe);
 
 	//write momentum in y-direction
-	writeVarTimeDependent(i_hv, hvVar);
+	writeVarTimeDependent(i_hv, hvVar, hvKeyframe, l_isKeyframe);
 
 	//Write everything to the file
 	nc_sync(dataFile);
@@ -286,6 +667,8 @@ void io::NetCdfWriter::writeTimeStep( const Float2D &i_h,
  * @param i_numberOfCheckpoints The total number of checkpoints to be written
  * @param i_endSimulation The total time to be simulated
  * @param i_boundaryTypes The type of left, right, bottom top boundary (e.g. OUTFLOW or WALL)
+ *
+ * Collective writers: all processes have to pass the same (global) values.
  */
 void io::NetCdfWriter::writeSimulationInfo( int i_numberOfCheckpoints,
                                             float i_endSimulation,
@@ -32,7 +32,7 @@
 #include <cstring>
 #include <string>
 #include <vector>
-#ifdef USEMPI
+#ifdef NETCDF_COLLECTIVE
 #include <mpi.h>
 #ifndef MPI_INCLUDED
 #define MPI_INCLUDED
@@ -40,6 +40,9 @@
 #endif
 #endif
 #include <netcdf.h>
+#ifdef NETCDF_COLLECTIVE
+#include <netcdf_par.h>
+#endif
 #ifdef MPI_INCLUDED_NETCDF
 #undef MPI_INCLUDED
 #undef MPI_INCLUDED_NETCDF
@@ -50,9 +53,91 @@
 #include "CoarseGridWrapper.hh"
 
 namespace io {
+  struct NetCdfOptions;
   class NetCdfWriter;
 }
 
+/**
+ * Storage options for new netCDF-files
+ *
+ * Existing (checkpoint) files are always continued with the
+ * storage of the file.
+ */
+struct io::NetCdfOptions {
+    /** Storage of the unknowns h, hu and hv (the bathymetry is always stored as float) */
+    enum Precision {
+        /** 32 bit floating point */
+        FLOAT,
+        /** 16 bit fixed point (scale_factor attribute, see heightResolution and dischargeResolution) */
+        FIXED_POINT,
+        /** 32 bit floating point, rounded to mantissaBits (compresses better) */
+        ROUNDED_FLOAT
+    };
+
+    /** Chunk size in x-direction (0 = whole dimension) */
+    unsigned int chunkX;
+    /** Chunk size in y-direction (0 = whole dimension) */
+    unsigned int chunkY;
+
+    /** Deflate level (0 = no compression, 1-9) */
+    int deflateLevel;
+    /** Shuffle the bytes before the compression */
+    bool shuffle;
+
+    Precision precision;
+    /**
+     * Resolution of the water height for FIXED_POINT (values are stored as multiples)
+     *
+     * Only values up to 32767 * heightResolution can be represented (327.67 m with the default),
+     * larger values are clipped with a warning (see NetCdfWriter::getSaturatedValues).
+     */
+    float heightResolution;
+    /** Resolution of the discharge for FIXED_POINT (range +-32767 * dischargeResolution) */
+    float dischargeResolution;
+    /** Number of mantissa bits kept for ROUNDED_FLOAT (1-23) */
+    int mantissaBits;
+
+    /**
+     * Number of time steps from one full time step (keyframe) to the next (0 or 1 = only full time steps)
+     *
+     * Between two keyframes, only the tiles (chunks) of h, hu and hv that changed by more
+     * than keyframeTolerance since the last keyframe are stored. Read such files with
+     * tools::NetCdfKeyframeReader. Not supported by collective writers.
+     */
+    unsigned int keyframeInterval;
+    /** Largest change of a value since the keyframe that is not stored */
+    float keyframeTolerance;
+
+#ifdef NETCDF_COLLECTIVE
+    /**
+     * Processes writing one file collectively (MPI_COMM_NULL = one file per process)
+     *
+     * Requires netCDF-4 with parallel I/O (NETCDF_COLLECTIVE builds only).
+     * All processes of the communicator write their block as a hyperslab
+     * of the global grid.
+     */
+    MPI_Comm communicator;
+    /** Position of the block in the grid of blocks (collective output only) */
+    int blockPositionX, blockPositionY;
+    /** Number of processes doing the actual I/O (collective output only, 0 = MPI-IO default) */
+    int aggregators;
+#endif
+
+    NetCdfOptions()
+        : chunkX(0), chunkY(0),
+          deflateLevel(0), shuffle(false),
+          precision(FLOAT),
+          heightResolution(.01f), dischargeResolution(.01f),
+          mantissaBits(23),
+          keyframeInterval(0), keyframeTolerance(0.f)
+#ifdef NETCDF_COLLECTIVE
+          , communicator(MPI_COMM_NULL),
+          blockPositionX(0), blockPositionY(0),
+          aggregators(0)
+#endif
+    {}
+};
+
 class io::NetCdfWriter : public io::Writer {
 private:
     /** netCDF file id*/
@@ -64,9 +149,89 @@ private:
     /** Flush after every x write operation? */
     unsigned int flush;
 
+    /** Offset of the block in the (global) output grid */
+    size_t offsetX, offsetY;
+
+    /** Dimensions of the (global) output grid */
+    size_t globalX, globalY;
+
+    /** Chunk size if none is given (the size of the first block) */
+    size_t defaultChunkX, defaultChunkY;
+
+    /** Does this process write the time variable? */
+    bool writesTime;
+
+    /** Keyframe variable id (-1 = only full time steps) */
+    int keyframeVar;
+
+    /** Number of time steps between two keyframes */
+    unsigned int keyframeInterval;
+
+    /** Largest change since the keyframe that is not stored */
+    float keyframeTolerance;
+
+    /** Time step of the last keyframe */
+    size_t keyframe;
+
+    /** Size of the tiles (chunks of h, hu and hv) of incremental time steps */
+    size_t tileX, tileY;
+
+    /** Values of the last keyframe (before the precision is reduced) */
+    std::vector<float> hKeyframe, huKeyframe, hvKeyframe;
+
+    /** Staging buffer for a single tile */
+    std::vector<float> tile;
+
+    /** Staging buffer for one coarse variable (row-major, as stored in the file) */
+    std::vector<float> slab;
+
+    /** Storage of h, hu and hv */
+    NetCdfOptions::Precision precision;
+
+    /** Mantissa bits of ROUNDED_FLOAT variables */
+    int mantissaBits;
+
+    /** Staging buffer for FIXED_POINT variables */
+    std::vector<short> fixedPointSlab;
+
+    /** Number of FIXED_POINT values clipped to the range of the variable */
+    size_t saturatedValues;
+
+    /** Variables with clipped values that were already reported */
+    std::vector<int> saturatedVars;
+
+    // defines the storage of a variable
+    void defineVarStorage( int i_ncVariable,
+                           const NetCdfOptions &i_options,
+                           bool i_lossy,
+                           float i_resolution );
+
+#ifdef NETCDF_COLLECTIVE
+    // computes the offsets of the block in the grid of all blocks
+    void computeGlobalGrid( const NetCdfOptions &i_options );
+
+    // creates or opens the file collectively
+    int openParallel( const NetCdfOptions &i_options, bool i_create );
+#endif
+
+    // copies a variable into the staging buffer
+    void fillSlab( const Float2D &i_matrix );
+
+    // writes a hyperslab of a time dependent variable with the precision of the file
+    void putVarTimeDependent( int i_ncVariable,
+                              const size_t *i_start,
+                              const size_t *i_count,
+                              std::vector<float> &io_values );
+
     // writer time dependent variables.
     void writeVarTimeDependent( const Float2D &i_matrix,
-                                int i_ncVariable);
+                                int i_ncVariable,
+                                std::vector<float> &io_keyframe,
+                                bool i_isKeyframe );
+
+    // writes the tiles that changed since the keyframe
+    void writeChangedTiles( int i_ncVariable,
+                            const std::vector<float> &i_keyframe );
 
     // writes time independent variables.
     void writeVarTimeIndependent( const Float2D &i_matrix,
@@ -80,7 +245,8 @@ private:
                  float i_dX, float i_dY,
                  float i_originX = 0., float i_originY = 0.,
                  float i_coarseness = 1.f,
-                 unsigned int i_flush = 0);
+                 unsigned int i_flush = 0,
+                 const NetCdfOptions &i_options = NetCdfOptions());
     virtual ~NetCdfWriter();
 
 	// writes the unknowns at a given time step to the netCDF-file.
@@ -89,6 +255,13 @@ private:
                         const Float2D &i_hv,
 						float i_time);
     
+    /**
+     * @return Number of FIXED_POINT values that were clipped to the representable range
+     */
+    size_t getSaturatedValues() const {
+        return saturatedValues;
+    }
+
     // writes meta information needed to restart the simulation to the netCDF-File.
     void writeSimulationInfo( int i_numberOfCheckpoints,
                               float i_simulatedTime,
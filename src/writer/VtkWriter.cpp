@@ -23,14 +23,25 @@
  * @section DESCRIPTION
  */
 
+#include <algorithm>
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <iostream>
+#include <stdint.h>
+#ifdef VTK_ZLIB
+#include <zlib.h>
+#endif
 #include "VtkWriter.hh"
 
 /**
  * Creates a vtk file for each time step.
  * Any existing file will be replaced.
  *
+ * The files are VTK XML RectilinearGrid files. All arrays are stored as
+ * raw binary appended data (zlib compressed if VTK_ZLIB is defined).
+ *
  * @param i_baseName base name of the netCDF-file to which the data will be written to.
  * @param i_nX number of cells in the horizontal direction.
  * @param i_nY number of cells in the vertical direction.
@@ -61,71 +72,163 @@ void io::VtkWriter::writeTimeStep(
         const Float2D &i_hv,
         float i_time)
 {
-	std::ofstream vtkFile(generateFileName().c_str());
-	assert(vtkFile.good());
+	// collect the binary data first, the XML header needs the offsets of all arrays
+	appendedData.clear();
+
+	size_t l_offsetXCoordinates = appendCoordinates(offsetX, coarseX, (dX * float(nX)) / float(coarseX));
+	size_t l_offsetYCoordinates = appendCoordinates(offsetY, coarseY, (dY * float(nY)) / float(coarseY));
+	size_t l_offsetZCoordinates = appendCoordinates(0, 0, 0);
 
-	//Grid wrapper for each grid
-	CoarseGridWrapper gridWrapperH(i_h, boundarySize, nX, nY, coarseness);
-	CoarseGridWrapper gridWrapperHu(i_hu, boundarySize, nX, nY, coarseness);
-	CoarseGridWrapper gridWrapperHv(i_hv, boundarySize, nX, nY, coarseness);
-	CoarseGridWrapper gridWrapperB(b, boundarySize, nX, nY, coarseness);
+	size_t l_offsetH = appendCellData(i_h);
+	size_t l_offsetHu = appendCellData(i_hu);
+	size_t l_offsetHv = appendCellData(i_hv);
+	size_t l_offsetB = appendCellData(b);
+
+	const unsigned int l_one = 1;
+	const bool l_littleEndian = *reinterpret_cast<const unsigned char*>(&l_one) == 1;
 
 	// VTK header
-	vtkFile << "<?xml version=\"1.0\"?>" << std::endl
-			<< "<VTKFile type=\"StructuredGrid\">" << std::endl
-			<< "<StructuredGrid WholeExtent=\"" << offsetX << " " << offsetX+coarseX
-				<< " " << offsetY << " " << offsetY+coarseY << " 0 0\">" << std::endl
-	        << "<Piece Extent=\"" << offsetX << " " << offsetX+coarseX
-	        	<< " " << offsetY << " " << offsetY+coarseY << " 0 0\">" << std::endl;
-
-	vtkFile << "<Points>" << std::endl
-			<< "<DataArray NumberOfComponents=\"3\" type=\"Float32\" format=\"ascii\">" << std::endl;
-
-	//Grid points
-	for (unsigned int j=0; j < coarseX+1; j++)
-        for (unsigned int i=0; i < coarseY+1; i++)
-            vtkFile << (offsetX+i)*((dX * float(nX)) / float(coarseX))
-                << " " << (offsetY+j)*((dY * float(nY)) / float(coarseY))
-                << " 0" << std::endl;
-    
-	vtkFile << "</DataArray>" << std::endl
-			<< "</Points>" << std::endl;
-
-	vtkFile << "<CellData>" << std::endl;
-
-	// Water surface height h
-	vtkFile << "<DataArray Name=\"h\" type=\"Float32\" format=\"ascii\">" << std::endl;
-	for (unsigned int j=0; j < coarseY; j++)
-		for (unsigned int i=0; i < coarseX+0; i++)
-			vtkFile << gridWrapperH.getElem(i, j) << std::endl;
-	vtkFile << "</DataArray>" << std::endl;
-
-	// Momentums
-	vtkFile << "<DataArray Name=\"hu\" type=\"Float32\" format=\"ascii\">" << std::endl;
-	for (unsigned int j=0; j < coarseY; j++)
-		for (unsigned int i=0; i < coarseX; i++)
-			vtkFile << gridWrapperHu.getElem(i, j) << std::endl;
-	vtkFile << "</DataArray>" << std::endl;
-
-	vtkFile << "<DataArray Name=\"hv\" type=\"Float32\" format=\"ascii\">" << std::endl;
-	for (unsigned int j=0; j < coarseY; j++)
-		for (unsigned int i=0; i<coarseX; i++)
-			vtkFile << gridWrapperHv.getElem(i, j) << std::endl;
-	vtkFile << "</DataArray>" << std::endl;
-
-	// Bathymetry
-	vtkFile << "<DataArray Name=\"b\" type=\"Float32\" format=\"ascii\">" << std::endl;
-	for (unsigned int j=0; j<coarseY; j++)
-		for (unsigned int i=0; i<coarseX; i++)
-			vtkFile << gridWrapperB.getElem(i, j) << std::endl;
-	vtkFile << "</DataArray>" << std::endl;
-
-	vtkFile << "</CellData>" << std::endl
-			<< "</Piece>" << std::endl;
-
-	vtkFile << "</StructuredGrid>" << std::endl
-			<< "</VTKFile>" << std::endl;
+	std::ostringstream l_header;
+	l_header << "<?xml version=\"1.0\"?>\n"
+			<< "<VTKFile type=\"RectilinearGrid\" version=\"1.0\" byte_order=\""
+				<< (l_littleEndian ? "LittleEndian" : "BigEndian") << "\" header_type=\"UInt64\""
+#ifdef VTK_ZLIB
+				<< " compressor=\"vtkZLibDataCompressor\""
+#endif
+				<< ">\n"
+			<< "<RectilinearGrid WholeExtent=\"" << offsetX << " " << offsetX+coarseX
+				<< " " << offsetY << " " << offsetY+coarseY << " 0 0\">\n"
+			<< "<Piece Extent=\"" << offsetX << " " << offsetX+coarseX
+				<< " " << offsetY << " " << offsetY+coarseY << " 0 0\">\n";
+
+	l_header << "<Coordinates>\n"
+			<< "<DataArray type=\"Float32\" Name=\"x\" format=\"appended\" offset=\"" << l_offsetXCoordinates << "\"/>\n"
+			<< "<DataArray type=\"Float32\" Name=\"y\" format=\"appended\" offset=\"" << l_offsetYCoordinates << "\"/>\n"
+			<< "<DataArray type=\"Float32\" Name=\"z\" format=\"appended\" offset=\"" << l_offsetZCoordinates << "\"/>\n"
+			<< "</Coordinates>\n";
+
+	// Water surface height h, momentums and bathymetry
+	l_header << "<CellData>\n"
+			<< "<DataArray type=\"Float32\" Name=\"h\" format=\"appended\" offset=\"" << l_offsetH << "\"/>\n"
+			<< "<DataArray type=\"Float32\" Name=\"hu\" format=\"appended\" offset=\"" << l_offsetHu << "\"/>\n"
+			<< "<DataArray type=\"Float32\" Name=\"hv\" format=\"appended\" offset=\"" << l_offsetHv << "\"/>\n"
+			<< "<DataArray type=\"Float32\" Name=\"b\" format=\"appended\" offset=\"" << l_offsetB << "\"/>\n"
+			<< "</CellData>\n"
+			<< "</Piece>\n"
+			<< "</RectilinearGrid>\n";
+
+	// the raw data starts after the underscore
+	l_header << "<AppendedData encoding=\"raw\">\n_";
+
+	const std::string l_footer = "\n</AppendedData>\n</VTKFile>\n";
+
+	std::ofstream vtkFile(generateFileName().c_str(), std::ios::out | std::ios::binary);
+	assert(vtkFile.good());
+
+	const std::string l_headerString = l_header.str();
+	vtkFile.write(l_headerString.data(), l_headerString.size());
+	vtkFile.write(&appendedData[0], appendedData.size());
+	vtkFile.write(l_footer.data(), l_footer.size());
 
 	// Increament time step
 	timeStep++;
 }
+
+/**
+ * Appends the coordinates of a rectilinear grid axis
+ *
+ * @param i_offset index of the first node
+ * @param i_cells number of cells along the axis
+ * @param i_spacing cell size of the output grid
+ * @return offset of the array in the appended data
+ */
+size_t io::VtkWriter::appendCoordinates(float i_offset, unsigned int i_cells, float i_spacing)
+{
+	values.resize(i_cells+1);
+	for (unsigned int i=0; i < i_cells+1; i++)
+		values[i] = (i_offset+i)*i_spacing;
+
+	return appendValues();
+}
+
+/**
+ * Appends the values of the output grid cells
+ *
+ * The values are stored row by row (x is the fastest running index).
+ *
+ * @param i_data values of the computational grid (including the boundary)
+ * @return offset of the array in the appended data
+ */
+size_t io::VtkWriter::appendCellData(const Float2D &i_data)
+{
+	CoarseGridWrapper l_gridWrapper(i_data, boundarySize, nX, nY, coarseness);
+
+	values.resize(coarseX*coarseY);
+	l_gridWrapper.getAllElems(&values[0]);
+
+	return appendValues();
+}
+
+/**
+ * Appends the current content of values to the appended data
+ *
+ * Uncompressed arrays are stored as the size in bytes (UInt64)
+ * followed by the raw values.
+ *
+ * Compressed arrays are split into blocks of 32 KiB which are
+ * compressed independently. The header (UInt64) contains the number of
+ * blocks, the block size, the size of the last block (0 if it is
+ * complete) and the compressed size of each block.
+ *
+ * @return offset of the array in the appended data
+ */
+size_t io::VtkWriter::appendValues()
+{
+	const size_t l_offset = appendedData.size();
+	const size_t l_bytes = values.size() * sizeof(float);
+	const char* l_values = reinterpret_cast<const char*>(&values[0]);
+
+#ifdef VTK_ZLIB
+	const size_t l_blockSize = 32768;
+	const size_t l_blocks = (l_bytes + l_blockSize - 1) / l_blockSize;
+
+	std::vector<uint64_t> l_blockHeader(3 + l_blocks);
+	l_blockHeader[0] = l_blocks;
+	l_blockHeader[1] = l_blockSize;
+	l_blockHeader[2] = l_bytes % l_blockSize;
+
+	// reserve space for the header, it is filled after compressing all blocks
+	const size_t l_headerBytes = l_blockHeader.size() * sizeof(uint64_t);
+	appendedData.resize(l_offset + l_headerBytes);
+
+	for (size_t block = 0; block < l_blocks; block++) {
+		size_t l_start = block * l_blockSize;
+		uLong l_size = std::min(l_blockSize, l_bytes - l_start);
+
+		size_t l_dataEnd = appendedData.size();
+		uLongf l_compressedSize = compressBound(l_size);
+		appendedData.resize(l_dataEnd + l_compressedSize);
+
+		// favor speed over the compression ratio
+		int l_status = compress2(reinterpret_cast<Bytef*>(&appendedData[l_dataEnd]), &l_compressedSize,
+				reinterpret_cast<const Bytef*>(l_values + l_start), l_size, Z_BEST_SPEED);
+		if (l_status != Z_OK) {
+			// the arrays of the file would be incomplete
+			std::cerr << "zlib Error: " << zError(l_status) << " (while writing " << generateFileName() << ")" << std::endl;
+			exit(l_status);
+		}
+
+		appendedData.resize(l_dataEnd + l_compressedSize);
+		l_blockHeader[3 + block] = l_compressedSize;
+	}
+
+	memcpy(&appendedData[l_offset], &l_blockHeader[0], l_headerBytes);
+#else
+	const uint64_t l_size = l_bytes;
+	const char* l_sizeBytes = reinterpret_cast<const char*>(&l_size);
+	appendedData.insert(appendedData.end(), l_sizeBytes, l_sizeBytes + sizeof(l_size));
+	appendedData.insert(appendedData.end(), l_values, l_values + l_bytes);
+#endif
+
+	return l_offset;
+}
@@ -27,6 +27,7 @@
 #define VTKWRITER_HH_
 
 #include <sstream>
+#include <vector>
 #include "writer/Writer.hh"
 
 namespace io {
@@ -41,6 +42,12 @@ private:
 
 	float offsetX, offsetY;
 
+	//! raw binary data of the current time step (written as appended data)
+	std::vector<char> appendedData;
+
+	//! values of the array that is currently appended
+	std::vector<float> values;
+
 public:
 	VtkWriter( const std::string &i_fileName,
 			   const Float2D &i_b,
@@ -57,11 +64,15 @@ public:
                         float i_time);
 
 private:
+    size_t appendCoordinates(float i_offset, unsigned int i_cells, float i_spacing);
+    size_t appendCellData(const Float2D &i_data);
+    size_t appendValues();
+
     std::string generateFileName()
     {
     	std::ostringstream name;
 
-    	name << fileName << '.' << timeStep << ".vts";
+    	name << fileName << '.' << timeStep << ".vtr";
     	return name.str();
     }
 };